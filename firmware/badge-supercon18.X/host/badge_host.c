@@ -0,0 +1,98 @@
+/*
+ * badge - whole badge firmware running headless on host
+ *
+ * usage: badge [-m flash.img] [-a a.img] [-d d.img] [-e e.img] [-f f.img]
+ *        [-g dir] [-s tty] [-x speed] [-p screen.ppm] [-w ms] [-j journal]
+ * Same main(), menu, BASIC, games, CP/M and display code as the badge,
+ * on top of hal_host.c instead of hw.c. Keys come from stdin, text screen
+ * is mirrored to a terminal, or printed on exit when stdout is not one.
+ * -x runs the clock of the badge (millis, timers, CP0 Count) that many
+ * times faster than real time.
+ * -p writes frame of LCD model as PPM on exit and on SIGUSR1.
+ * -w is how long (virtual ms) firmware runs after piped input ends.
+ * -j puts input journal file (e.g. one recorded with jrecs over serial)
+ * into its FLASH region, jplay in menu or BASIC replays it.
+ * ctrl-C is BRK key, ctrl-] quits, RAM disk is saved to its image on exit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/journal.h"
+
+static void usage (void)
+{
+fprintf(stderr,"usage: badge [-m flash.img] [-a a.img] [-d d.img] [-e e.img] [-f f.img] [-g dir]\n");
+fprintf(stderr,"       [-s tty] [-x speed] [-p screen.ppm] [-w ms] [-j journal]\n");
+exit(1);
+}
+
+//journal goes to FLASH as is, rest of region erased
+static int load_journal (const char * fname)
+{
+FILE * in;
+size_t n;
+in = fopen(fname,"rb");
+if (in==NULL) return -1;
+memset(host_flash+JR_BASE,0xFF,JR_SIZE);
+n = fread(host_flash+JR_BASE,1,JR_SIZE,in);
+fclose(in);
+return (n>0) ? 0 : -1;
+}
+
+int main (int argc, char * argv[])
+{
+char * flash_name = NULL, * drive_name[4] = {NULL,NULL,NULL,NULL}, * dir_name = NULL, * serial_name = NULL;
+char * journal_name = NULL;
+const char * drives = "adef", * d;
+uint32_t i;
+int a;
+for (a=1;a<argc;a++)
+	{
+	if ((argv[a][0]!='-')||(argv[a][1]==0)||(argv[a][2]!=0)||(a+1>=argc)) usage();
+	d = strchr(drives,argv[a][1]);
+	if (argv[a][1]=='m') flash_name = argv[++a];
+	else if (argv[a][1]=='g') dir_name = argv[++a];
+	else if (argv[a][1]=='s') serial_name = argv[++a];
+	else if (argv[a][1]=='p') hal_ppm_name = argv[++a];
+	else if (argv[a][1]=='x') hal_speed = atoi(argv[++a]);
+	else if (argv[a][1]=='w') hal_linger_ms = atoi(argv[++a]);
+	else if (argv[a][1]=='j') journal_name = argv[++a];
+	else if (d!=NULL) drive_name[d-drives] = argv[++a];
+	else usage();
+	}
+if (hal_speed==0) usage();
+if (host_flash_open(flash_name)<0)
+	{
+	perror(flash_name);
+	return 1;
+	}
+if ((journal_name!=NULL)&&(load_journal(journal_name)<0))
+	{
+	perror(journal_name);
+	return 1;
+	}
+for (i=0;i<4;i++)
+	if ((drive_name[i]!=NULL)&&(host_map_drive(drives[i],drive_name[i])<0))
+		{
+		perror(drive_name[i]);
+		return 1;
+		}
+if ((dir_name!=NULL)&&(host_bdos_dir(dir_name)<0))
+	{
+	fprintf(stderr,"%s: not a directory\n",dir_name);
+	return 1;
+	}
+if ((serial_name!=NULL)&&(host_serial_open(serial_name)<0))
+	{
+	perror(serial_name);
+	return 1;
+	}
+host_term_raw();
+//clock starts in hw_init, firmware never returns, quit goes through hal_exit
+firmware_main();
+host_term_restore();
+return 0;
+}
@@ -0,0 +1,310 @@
+/*
+ * cpmimg - build and extract CP/M disk images of the badge
+ *
+ * usage: cpmimg [-m flash.img] [-a a.img] ... [-f f.img] command [args]
+ *   ls X:                      list files and free space
+ *   put X:[u/][NAME.EXT] file  copy host file in, name defaults to file name
+ *   get X:[u/]NAME.EXT [file]  copy file out, -t strips text after ^Z
+ *   rm X:[u/]NAME.EXT          delete file
+ *   format X:                  empty directory
+ *
+ * Drives A, D, E and F are the same image files z80sim uses, accessed
+ * through the disk code of firmware (RAM disk compression, big disk
+ * format and FTL included), with geometry taken from DPBs in BIOS.
+ * B and C are raw ROM disk images, feed them to romdisk_pack to build
+ * them into firmware. Without -b/-c the built-in ROM disks are read.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/Z80/hwz.h"
+#include "../src/Z80/sim.h"
+#include "../src/Z80/simglb.h"
+#include "../src/Z80/rdc.h"
+#include "../src/Z80/ftl.h"
+#include "../src/Z80/cpmfs.h"
+
+extern const uint8_t ram_image_a[3];
+extern uint8_t ram_disk[RAMDISK_SIZE];
+void reload_cpm_warm (void);
+
+//raw ROM disk image given with -b/-c, other drives go through firmware (cpm_drive_attach)
+uint8_t * raw_image;
+
+static uint8_t raw_read (void * ctx, uint32_t sect, uint8_t * data)
+{
+memcpy(data,raw_image+(sect*CPMFS_SECT_SIZE),CPMFS_SECT_SIZE);
+return 0;
+}
+
+static uint8_t raw_write (void * ctx, uint32_t sect, uint8_t * data)
+{
+memcpy(raw_image+(sect*CPMFS_SECT_SIZE),data,CPMFS_SECT_SIZE);
+return 0;
+}
+
+//"X:u/NAME.EXT", name part is optional when name is not NULL
+static int parse_spec (const char * spec, uint8_t * drive, uint8_t * user, const char ** name)
+{
+if ((spec[0]==0)||(spec[1]!=':')) return -1;
+*drive = (spec[0]|0x20) - 'a';
+if (*drive>=CPM_DRIVES) return -1;
+spec += 2;
+*user = 0;
+if ((spec[0]>='0')&&(spec[0]<='9')&&(strchr(spec,'/')!=NULL))
+	{
+	*user = atoi(spec);
+	spec = strchr(spec,'/') + 1;
+	if (*user>15) return -1;
+	}
+*name = spec;
+return 0;
+}
+
+static const char * err_str (uint8_t err)
+{
+if (err==CPMFS_ERR_IO) return "I/O error";
+if (err==CPMFS_ERR_NOFILE) return "no such file";
+if (err==CPMFS_ERR_DIRFULL) return "directory full";
+if (err==CPMFS_ERR_DISKFULL) return "disk full";
+if (err==CPMFS_ERR_NAME) return "bad file name";
+return "error";
+}
+
+static int cmd_ls (struct cpmfs * fs)
+{
+uint8_t name[11],user;
+uint32_t size;
+int16_t idx;
+char str[13];
+for (idx=0;(idx=cpmfs_next(fs,idx,&user,name,&size))>=0;idx++)
+	{
+	cpmfs_name_str(name,str);
+	if (user!=0) printf("%2u/%-12s %8lu\n",user,str,(unsigned long)size);
+	else printf("   %-12s %8lu\n",str,(unsigned long)size);
+	}
+printf("%lu bytes free\n",(unsigned long)cpmfs_free(fs));
+return 0;
+}
+
+static int cmd_put (struct cpmfs * fs, uint8_t user, const char * name, const char * fname)
+{
+struct cpmfs_file f;
+uint8_t cname[11],rec[CPMFS_SECT_SIZE],ret;
+const char * base;
+FILE * in;
+size_t n;
+if (*name==0)
+	{
+	base = strrchr(fname,'/');
+	name = (base==NULL) ? fname : base+1;
+	}
+if (cpmfs_name(name,cname))
+	{
+	fprintf(stderr,"%s: %s\n",name,err_str(CPMFS_ERR_NAME));
+	return 1;
+	}
+in = fopen(fname,"rb");
+if (in==NULL)
+	{
+	perror(fname);
+	return 1;
+	}
+ret = cpmfs_create(fs,&f,user,cname);
+//last record is padded with ^Z, end of text for CP/M
+while ((ret==CPMFS_OK)&&((n=fread(rec,1,CPMFS_SECT_SIZE,in))>0))
+	{
+	memset(rec+n,0x1A,CPMFS_SECT_SIZE-n);
+	ret = cpmfs_write(&f,rec);
+	}
+if (ret==CPMFS_OK) ret = cpmfs_close(&f);
+fclose(in);
+if (ret)
+	{
+	//don't leave truncated file behind
+	cpmfs_close(&f);
+	cpmfs_delete(fs,user,cname);
+	fprintf(stderr,"%s: %s\n",name,err_str(ret));
+	return 1;
+	}
+return 0;
+}
+
+static int cmd_get (struct cpmfs * fs, uint8_t user, const char * name, const char * fname, uint8_t text)
+{
+struct cpmfs_file f;
+uint8_t cname[11],rec[CPMFS_SECT_SIZE],ret;
+uint16_t n;
+FILE * out;
+if (cpmfs_name(name,cname))
+	{
+	fprintf(stderr,"%s: %s\n",name,err_str(CPMFS_ERR_NAME));
+	return 1;
+	}
+ret = cpmfs_open(fs,&f,user,cname);
+if (ret)
+	{
+	fprintf(stderr,"%s: %s\n",name,err_str(ret));
+	return 1;
+	}
+out = fopen(fname,"wb");
+if (out==NULL)
+	{
+	perror(fname);
+	return 1;
+	}
+while ((ret=cpmfs_read(&f,rec))==CPMFS_OK)
+	{
+	n = CPMFS_SECT_SIZE;
+	if (text)
+		{
+		for (n=0;(n<CPMFS_SECT_SIZE)&&(rec[n]!=0x1A);n++);
+		fwrite(rec,1,n,out);
+		if (n<CPMFS_SECT_SIZE) break;
+		}
+	else
+		fwrite(rec,1,n,out);
+	}
+fclose(out);
+if ((ret!=CPMFS_OK)&&(ret!=CPMFS_ERR_NOFILE))
+	{
+	fprintf(stderr,"%s: %s\n",name,err_str(ret));
+	return 1;
+	}
+return 0;
+}
+
+static void usage (void)
+{
+fprintf(stderr,"usage: cpmimg [-m flash.img] [-a|-b|-c|-d|-e|-f image] [-t] command\n");
+fprintf(stderr,"  ls X:\n  put X:[u/][NAME.EXT] file\n  get X:[u/]NAME.EXT [file]\n");
+fprintf(stderr,"  rm X:[u/]NAME.EXT\n  format X:\n");
+exit(1);
+}
+
+int main (int argc, char * argv[])
+{
+char * flash_name = NULL, * drive_name[CPM_DRIVES];
+const char * cmd, * name;
+struct cpmfs fs;
+uint8_t drive,user,cname[11],text = 0,ret;
+uint32_t i;
+int a,rc = 0;
+memset(drive_name,0,sizeof(drive_name));
+for (a=1;(a<argc)&&(argv[a][0]=='-');a++)
+	{
+	if ((argv[a][1]==0)||(argv[a][2]!=0)) usage();
+	if (argv[a][1]=='t')
+		{
+		text = 1;
+		continue;
+		}
+	if (a+1>=argc) usage();
+	if (argv[a][1]=='m') flash_name = argv[++a];
+	else if ((argv[a][1]>='a')&&(argv[a][1]<('a'+CPM_DRIVES)))
+		{
+		drive_name[argv[a][1]-'a'] = argv[a+1];
+		a++;
+		}
+	else usage();
+	}
+if (a+1>=argc) usage();
+cmd = argv[a++];
+if (parse_spec(argv[a++],&drive,&user,&name)) usage();
+if (host_flash_open(flash_name)<0)
+	{
+	perror(flash_name);
+	return 1;
+	}
+for (i=0;i<CPM_DRIVES;i++)
+	if ((drive_name[i]!=NULL)&&(i!=1)&&(i!=2)&&(host_map_drive('a'+i,drive_name[i])<0))
+		{
+		perror(drive_name[i]);
+		return 1;
+		}
+//BIOS with DPBs patched for current settings, RAM disk loaded from its image
+for (i=0;i<3;i++) ram[i] = ram_image_a[i];
+reload_cpm_warm();
+#ifdef	USE_RAMDISK
+for (i=0;i<RAMDISK_SIZE;i++) ram_disk[i] = 0xE5;
+#ifdef	RAMDISK_PERSIST
+ramdisk_restore();
+#endif
+#ifdef	RAMDISK_COMPRESSED
+rdc_init();
+#endif
+#endif
+if ((drive==1)||(drive==2))
+	{
+	if (drive_name[drive]!=NULL)
+		{
+		raw_image = host_map_image(drive_name[drive],cpm_drive_sects(drive)*CPMFS_SECT_SIZE,0xE5);
+		if (raw_image==NULL)
+			{
+			perror(drive_name[drive]);
+			return 1;
+			}
+		}
+	}
+#ifndef	RAMDISK_PERSIST
+else if (drive==0)
+	{
+	fprintf(stderr,"RAMDISK_PERSIST is off, drive A: is not kept in image\n");
+	return 1;
+	}
+#endif
+else if (host_drive_size('a'+drive)==0)
+	{
+	fprintf(stderr,"drive %c: is not kept in image\n",'A'+drive);
+	return 1;
+	}
+if (raw_image!=NULL)
+	{
+	fs.read = raw_read;
+	fs.write = raw_write;
+	ret = cpmfs_init(&fs,cpm_drive_dpb(drive),cpm_drive_sects(drive));
+	}
+else
+	ret = cpm_drive_attach(&fs,drive,(strcmp(cmd,"ls")!=0)&&(strcmp(cmd,"get")!=0));
+if (ret)
+	{
+	fprintf(stderr,"can't access %c:\n",'A'+drive);
+	return 1;
+	}
+if (strcmp(cmd,"ls")==0)
+	rc = cmd_ls(&fs);
+else if ((strcmp(cmd,"put")==0)&&(a<argc))
+	{
+	if ((*name!=0)&&((a+1)<argc)) usage();
+	for (;(a<argc)&&(rc==0);a++) rc = cmd_put(&fs,user,name,argv[a]);
+	}
+else if (strcmp(cmd,"get")==0)
+	rc = cmd_get(&fs,user,name,(a<argc)?argv[a]:name,text);
+else if (strcmp(cmd,"rm")==0)
+	{
+	ret = cpmfs_name(name,cname);
+	if (ret==CPMFS_OK) ret = cpmfs_delete(&fs,user,cname);
+	if (ret) fprintf(stderr,"%s: %s\n",name,err_str(ret));
+	rc = (ret!=CPMFS_OK);
+	}
+else if (strcmp(cmd,"format")==0)
+	{
+#ifdef	CPM_FTL
+	//whole directory trimmed, so FTL forgets old sectors
+	if (drive==3)
+		for (i=0;i<((fs.drm+1)/4);i++) ftl_trim(i);
+#endif
+	rc = (cpmfs_format(&fs)!=CPMFS_OK);
+	}
+else
+	usage();
+#ifdef	RAMDISK_PERSIST
+ramdisk_sync();
+#endif
+fl_flush();
+host_flash_close();
+return rc;
+}
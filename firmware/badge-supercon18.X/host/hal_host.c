@@ -0,0 +1,498 @@
+//REG_RIP of ucontext and dl_iterate_phdr, for the profiler
+#define	_GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <ucontext.h>
+#include <link.h>
+#include <plib.h>
+#include <wii_lib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/disp.h"
+#include "../src/Z80/hwz.h"
+#include "../src/journal.h"
+#include "../src/prof.h"
+
+//hw.c of host build: pins, sound and LEDs are plain variables, keyboard is
+//stdin, and a virtual clock runs timer1 (1ms) and timer5 (12ms) tasks of
+//badge.c from SIGALRM, so they interrupt firmware the way the ISRs do
+
+extern uint8_t key_buffer_ptr;
+uint32_t millis (void);
+extern int8_t disp_buffer[DISP_BUFFER_HIGH+1][DISP_BUFFER_WIDE];
+
+volatile uint8_t host_quit;
+volatile uint8_t hal_k_shiftl = 1, hal_k_shiftr = 1, hal_k_pwr = 1, hal_k_brk = 1;
+uint8_t hal_lcd_res, hal_lcd_rd, hal_lcd_wr;
+uint8_t hal_led;
+uint16_t hal_sound[3];
+uint8_t hal_exp_out, hal_exp_ddr = 0x0F;
+
+//clock runs speed times faster than real time, see -x
+uint32_t hal_speed = 1;
+//after stdin ends, firmware gets this many virtual ms to finish before quit
+uint32_t hal_linger_ms = 2000;
+const char * hal_ppm_name;
+
+static struct timespec hal_t0;
+static uint32_t hal_ms, hal_eof_ms, hal_quit_ms;
+static volatile uint8_t hal_in_isr, hal_keyb_lock;
+static uint8_t hal_brk_hold, hal_eof, hal_mirror, hal_mirror_div;
+static int8_t hal_shown[DISP_BUFFER_HIGH][DISP_BUFFER_WIDE];
+static uint32_t rnd_var1, rnd_var2, rnd_var3;
+
+//elapsed virtual time in us
+static uint64_t hal_us (void)
+{
+struct timespec ts;
+uint64_t ns;
+clock_gettime(CLOCK_MONOTONIC,&ts);
+ns = (uint64_t)(ts.tv_sec-hal_t0.tv_sec)*1000000000ULL + ts.tv_nsec - hal_t0.tv_nsec;
+return ns*hal_speed/1000;
+}
+
+//CP0 Count of PIC32 runs at half of SYS_CLK
+uint32_t host_core_count (void)
+{
+return (uint32_t)(hal_us()*CORE_TICKS_US);
+}
+
+//text screen as firmware keeps it, box drawing and colors are not shown
+static void hal_text_screen (int fd, uint8_t home)
+{
+char line[DISP_BUFFER_WIDE+2];
+uint8_t r,c,ch;
+if (home)
+	if (write(fd,"\033[H",3)!=3) return;
+for (r=0;r<DISP_BUFFER_HIGH;r++)
+	{
+	for (c=0;c<DISP_BUFFER_WIDE;c++)
+		{
+		ch = disp_buffer[r][c];
+		line[c] = ((ch>=' ')&&(ch<0x7F)) ? ch : ' ';
+		}
+	line[c++] = home ? '\r' : '\n';
+	line[c++] = home ? '\n' : 0;
+	if (write(fd,line,home ? c : c-1)<0) return;
+	}
+}
+
+static void hal_exit (void)
+{
+struct itimerval it;
+memset(&it,0,sizeof(it));
+setitimer(ITIMER_REAL,&it,NULL);
+//quit is power off, as in loop_badge
+jr_stop();
+#ifdef	RAMDISK_PERSIST
+ramdisk_sync();
+#endif
+fl_flush();
+host_flash_close();
+host_term_restore();
+if ((hal_ppm_name!=NULL)&&(host_lcd_dump(hal_ppm_name)<0)) perror(hal_ppm_name);
+if (hal_mirror==0) hal_text_screen(1,0);
+exit(0);
+}
+
+//one key per timer5 tick, and only once badge took previous one out of key_buffer
+static uint8_t hal_read_key (void)
+{
+fd_set fds;
+struct timeval tv;
+uint8_t c,seq[2];
+FD_ZERO(&fds);
+FD_SET(0,&fds);
+tv.tv_sec = 0;
+tv.tv_usec = 0;
+if (select(1,&fds,NULL,NULL,&tv)<=0) return 0;
+if (read(0,&c,1)!=1)
+	{
+	hal_eof = 1;
+	hal_eof_ms = hal_ms;
+	return 0;
+	}
+if (c==HOST_QUIT_KEY)
+	{
+	host_quit = 1;
+	return 0;
+	}
+//ctrl-C holds BRK key long enough for loop_badge to see it
+if (c==0x03)
+	{
+	hal_k_brk = 0;
+	hal_brk_hold = 15;
+	return 0;
+	}
+if ((c=='\r')||(c=='\n')) return K_ENT;
+if (c==0x7F) return BACKSPACE;
+//cursor keys of terminal, lone ESC is escape key
+if ((c==0x1B)&&(select(1,&fds,NULL,NULL,&tv)>0)&&(read(0,seq,2)==2)&&(seq[0]=='['))
+	{
+	if (seq[1]=='A') return K_UP;
+	if (seq[1]=='B') return K_DN;
+	if (seq[1]=='C') return K_RT;
+	if (seq[1]=='D') return K_LT;
+	return 0;
+	}
+return c;
+}
+
+uint8_t keyb_tasks (void)
+{
+uint8_t c;
+rnd_var3 = rnd_var3 + 12345;
+rnd_var2 = rnd_var2 + millis();
+if (hal_brk_hold>0)
+	if (--hal_brk_hold==0) hal_k_brk = 1;
+if ((hal_eof)&&(host_quit==0)&&((hal_ms-hal_eof_ms)>=hal_linger_ms)) host_quit = 1;
+if ((hal_mirror)&&(++hal_mirror_div>=8))
+	{
+	hal_mirror_div = 0;
+	if (memcmp(hal_shown,disp_buffer,sizeof(hal_shown))!=0)
+		{
+		memcpy(hal_shown,disp_buffer,sizeof(hal_shown));
+		hal_text_screen(1,1);
+		}
+	}
+//stdin waits while input journal plays, EOF timeout starts when it ends
+if (jr_mode==JR_PLAY)
+	{
+	hal_eof_ms = hal_ms;
+	return 0;
+	}
+if ((hal_keyb_lock)||(key_buffer_ptr!=0)||(hal_eof)||(host_quit)) return 0;
+c = hal_read_key();
+rnd_var1 = rnd_var1 + c;
+return c;
+}
+
+//timer1 every virtual ms, timer5 every 12th; when host falls far behind
+//(stopped in debugger) the missed ticks are dropped, like lost interrupts
+static void hal_catch_up (uint8_t display)
+{
+uint32_t due;
+due = hal_us()/1000;
+if ((due-hal_ms)>100) hal_ms = due - 100;
+while ((int32_t)(due-hal_ms)>0)
+	{
+	hal_ms++;
+	tick_ms_tasks();
+	if ((display)&&((hal_ms%12)==0))
+		{
+		hal_in_isr = 1;
+		tick_display_tasks();
+		hal_in_isr = 0;
+		}
+	}
+}
+
+static void hal_alarm (int sig)
+{
+if (hal_in_isr) return;
+hal_catch_up(1);
+//firmware didn't reach a safe point to quit, e.g. busy BASIC program
+if (host_quit)
+	{
+	if (hal_quit_ms==0) hal_quit_ms = hal_ms;
+	else if ((hal_ms-hal_quit_ms)>1000) hal_exit();
+	}
+}
+
+static void hal_usr1 (int sig)
+{
+if (hal_ppm_name!=NULL) host_lcd_dump(hal_ppm_name);
+}
+
+//timer ISRs start running, period of host timer is one virtual ms
+void hal_start (void)
+{
+struct sigaction sa;
+struct itimerval it;
+long us;
+hal_mirror = isatty(1) && isatty(0);
+if (hal_mirror) write(1,"\033[2J",4);
+clock_gettime(CLOCK_MONOTONIC,&hal_t0);
+memset(&sa,0,sizeof(sa));
+sa.sa_handler = hal_alarm;
+sa.sa_flags = SA_RESTART;
+sigaction(SIGALRM,&sa,NULL);
+sa.sa_handler = hal_usr1;
+sigaction(SIGUSR1,&sa,NULL);
+us = 1000/hal_speed;
+if (us<50) us = 50;
+it.it_interval.tv_sec = 0;
+it.it_interval.tv_usec = us;
+it.it_value = it.it_interval;
+setitimer(ITIMER_REAL,&it,NULL);
+}
+
+//profiler samples host pc on SIGPROF, minus load address of badge binary,
+//so addresses match symbols of its ELF as EPC matches firmware ELF
+static uintptr_t hal_load_bias;
+
+static int hal_phdr (struct dl_phdr_info * info, size_t size, void * data)
+{
+hal_load_bias = info->dlpi_addr;
+return 1;
+}
+
+static void hal_prof (int sig, siginfo_t * si, void * ctx)
+{
+ucontext_t * uc = ctx;
+uintptr_t pc = 0;
+#if defined(__x86_64__)
+pc = uc->uc_mcontext.gregs[REG_RIP];
+#elif defined(__aarch64__)
+pc = uc->uc_mcontext.pc;
+#endif
+prof_sample((uint32_t)(pc-hal_load_bias));
+}
+
+//rate is in CPU time of host process, idle waits of firmware don't count
+void prof_hw_start (uint32_t rate)
+{
+struct sigaction sa;
+struct itimerval it;
+dl_iterate_phdr(hal_phdr,NULL);
+memset(&sa,0,sizeof(sa));
+sa.sa_sigaction = hal_prof;
+sa.sa_flags = SA_SIGINFO|SA_RESTART;
+sigaction(SIGPROF,&sa,NULL);
+it.it_interval.tv_sec = 0;
+it.it_interval.tv_usec = 1000000/rate;
+it.it_value = it.it_interval;
+setitimer(ITIMER_PROF,&it,NULL);
+}
+
+void prof_hw_stop (void)
+{
+struct itimerval it;
+memset(&it,0,sizeof(it));
+setitimer(ITIMER_PROF,&it,NULL);
+}
+
+//on the badge this masks sound timer only, key_buffer is guarded by not
+//handing out keys while firmware copies it
+void hal_irq_off (void)
+{
+hal_keyb_lock = 1;
+}
+
+//firmware polls keyboard here, safe point to save FLASH and quit
+void hal_irq_on (void)
+{
+hal_keyb_lock = 0;
+if ((host_quit)&&(hal_in_isr==0)) hal_exit();
+}
+
+//in timer5 context SIGALRM is masked, so it runs timer1 itself, as nested ISR would
+void wait_ms (uint32_t count)
+{
+uint32_t ticks_wait;
+struct timespec ts;
+ticks_wait = millis() + count;
+rnd_var2 = rnd_var2 + ticks_wait;
+ts.tv_sec = 0;
+ts.tv_nsec = 200000/hal_speed;
+while (millis()<=ticks_wait)
+	{
+	if (hal_in_isr)
+		hal_catch_up(0);
+	else
+		{
+		if (host_quit) hal_exit();
+		nanosleep(&ts,NULL);
+		}
+	}
+}
+
+void hw_init (void)
+{
+hal_start();
+wait_ms(50);
+TFT_24_7789_Init();
+tft_fill_area(0,0,320,240,0);
+wait_ms(80);
+}
+
+//power off does nothing, badge wakes again right away
+void hw_sleep (void)
+{
+}
+
+uint16_t get_rnd (void)
+{
+uint32_t var;
+static uint32_t var_prev;
+if (jr_mode!=JR_OFF) return rand()&0xFFFF;
+var = rnd_var1 + rnd_var2 + rnd_var3 + (var_prev*1103515245) + 12345;
+var = var & 0xFFFF;
+var_prev = var;
+return var;
+}
+
+uint8_t key_functional_pressed (void)
+{
+if ((K_SHIFTL==0)||(K_SHIFTR==0)||(KEY_BRK==0)||(K_PWR==0)) return 1;
+return 0;
+}
+
+uint8_t get_led_word (void)
+{
+return hal_led;
+}
+
+void set_led_word (uint8_t val)
+{
+hal_led = val & 0x07;
+}
+
+void set_led (uint8_t led_n, uint8_t led_v)
+{
+if (led_n>2) return;
+if (led_v) hal_led |= 1<<led_n;
+else hal_led &= ~(1<<led_n);
+}
+
+//tone generators are not heard, last note or timer period is kept
+void sound_set_generator (uint16_t period, uint8_t generator)
+{
+if (generator<3) hal_sound[generator] = period;
+}
+
+void sound_set_note (uint8_t note, uint8_t generator)
+{
+sound_set_generator(note,generator);
+}
+
+void sound_play_notes (uint8_t note1, uint8_t note2, uint8_t note3, uint16_t wait)
+{
+sound_set_note(note1,0);
+sound_set_note(note2,1);
+sound_set_note(note3,2);
+wait_ms(wait);
+sound_set_note(0,0);
+sound_set_note(0,1);
+sound_set_note(0,2);
+}
+
+//expansion header, outputs read back, inputs float high
+void exp_set (uint8_t pos, uint8_t val)
+{
+if (pos>3) return;
+if (val) hal_exp_out |= 1<<pos;
+else hal_exp_out &= ~(1<<pos);
+}
+
+void exp_ddr (uint8_t pos, uint8_t val)
+{
+if (pos>3) return;
+if (val) hal_exp_ddr |= 1<<pos;
+else hal_exp_ddr &= ~(1<<pos);
+}
+
+uint8_t exp_get (uint8_t pos)
+{
+if (pos>3) return 0;
+if (hal_exp_ddr&(1<<pos)) return 1;
+return (hal_exp_out>>pos)&1;
+}
+
+void exp_test_init (void)
+{
+hal_exp_ddr = 0;
+}
+
+void exp_test_state (uint8_t state)
+{
+hal_exp_out = (state<6) ? (1<<state) : 0;
+}
+
+//serial port through input journal, as in hw.c
+uint8_t rx_sta (void)
+{
+if (jr_mode==JR_PLAY) return jr_rx_sta();
+return host_rx_sta();
+}
+
+uint8_t rx_read (void)
+{
+uint8_t data;
+if (jr_mode==JR_PLAY) return jr_rx_read();
+data = host_rx_read();
+jr_rx(data);
+return data;
+}
+
+void serial_flush (void)
+{
+while (rx_sta()) rx_read();
+}
+
+//SPI FLASH is modeled at fl_* level (host_flash.c), nothing sits on the bus
+unsigned char SPI_dat (uint8_t data)
+{
+return 0xFF;
+}
+
+//empty I2C bus, every address NACKs
+void iic_init (void)
+{
+}
+
+void iic_start (void)
+{
+}
+
+void iic_restart (void)
+{
+}
+
+unsigned char iic_read (uint8_t ack)
+{
+return 0xFF;
+}
+
+void iic_stop (void)
+{
+}
+
+void iic_write (uint8_t data)
+{
+}
+
+uint8_t iic_ackstat (void)
+{
+return 1;
+}
+
+//lib-wii stand-in, see include/wii_lib.h
+int WiiLib_Init (int module, uint32_t clock, uint8_t target, uint8_t decrypt, WiiLib_Device * device)
+{
+memset(device,0,sizeof(WiiLib_Device));
+device->status = WII_LIB_DEVICE_STATUS_NOT_CONNECTED;
+device->target = WII_LIB_TARGET_DEVICE_UNKNOWN;
+return WII_LIB_RC_TARGET_NOT_FOUND;
+}
+
+int WiiLib_DoMaintenance (WiiLib_Device * device)
+{
+return WII_LIB_RC_SUCCESS;
+}
+
+int WiiLib_PollStatus (WiiLib_Device * device)
+{
+return WII_LIB_RC_TARGET_NOT_FOUND;
+}
+
+int WiiLib_SaveCurrentPositionAsHome (WiiLib_Device * device)
+{
+return WII_LIB_RC_SUCCESS;
+}
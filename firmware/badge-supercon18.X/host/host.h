@@ -0,0 +1,55 @@
+#ifndef		__HOST_H
+#define		__HOST_H
+
+#include <stdint.h>
+
+/*
+ * Host build of the badge Z80/CP/M machine
+ * SPI FLASH is a 4MB memory area, regions of CP/M drives can be backed
+ * by image files mapped with mmap, so FLASH writes of the firmware go
+ * straight to the files. Drive images have exactly the layout the
+ * firmware keeps in FLASH:
+ * a	RAM disk persistence area at 0x300000, header+bitmap, then data
+ * d	disk D at 0x080000, 512kB (1MB with CPM_BIG_DISK, FTL log with CPM_FTL)
+ * e	disk E at 0x180000, 512kB
+ * f	disk F at 0x280000, 512kB
+ * Saved games of zm (0x310000) are kept only with -m flash.img
+ * Drive G can be a host directory instead, served at BDOS level (host_bdos.c)
+ */
+
+#define		HOST_FLASH_SIZE		(4UL*1024UL*1024UL)
+
+//exit key of host simulator, ctrl-]
+#define		HOST_QUIT_KEY		0x1D
+
+extern uint8_t * host_flash;
+extern volatile uint8_t host_quit;
+extern uint8_t host_term_is_raw;
+
+int host_flash_open (const char * fname);
+int host_map_drive (char drive, const char * fname);
+uint8_t * host_map_image (const char * fname, uint32_t size, uint8_t fill);
+uint32_t host_drive_base (char drive);
+uint32_t host_drive_size (char drive);
+void host_flash_close (void);
+int host_bdos_dir (const char * dir);
+int host_serial_open (const char * fname);
+uint8_t host_rx_sta (void);
+uint8_t host_rx_read (void);
+void host_term_raw (void);
+void host_term_restore (void);
+
+//whole firmware on host (badge), see hal_host.c and host_lcd.c
+#define		HOST_LCD_W			320
+#define		HOST_LCD_H			240
+
+extern uint8_t host_lcd_fb[HOST_LCD_H][HOST_LCD_W][3];
+extern uint32_t host_lcd_pixels;
+extern uint32_t hal_speed, hal_linger_ms;
+extern const char * hal_ppm_name;
+
+int host_lcd_dump (const char * fname);
+void hal_start (void);
+int16_t firmware_main (void);
+
+#endif
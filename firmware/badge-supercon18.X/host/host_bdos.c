@@ -0,0 +1,547 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/Z80/hwz.h"
+#include "../src/Z80/sim.h"
+#include "../src/Z80/simglb.h"
+
+//host directory as CP/M drive G
+//BDOS entry at 0xE006 is patched to OUT (HOST_BDOS_PORT),A, file functions
+//addressing drive G are served here straight from host files, everything
+//else continues into the real BDOS. BIOS reads of G return empty sectors,
+//so BDOS login and disk functions see a valid empty disk.
+
+#define		HOST_BDOS_VECT		0xE006
+#define		HOST_BDOS_DRIVE		6
+#define		HOST_FD_CACHE		4
+
+struct host_dirent
+{
+	uint8_t name[11];
+	char fname[13];
+};
+
+struct host_fd
+{
+	int fd;
+	char fname[13];
+	uint32_t used;
+};
+
+char * host_dir;
+uint16_t host_bdos_entry;
+struct host_dirent * host_dir_list;
+uint16_t host_dir_cnt, host_dir_max;
+uint8_t host_dir_dirty = 1;
+struct timespec host_dir_mtime;
+struct host_fd host_fds[HOST_FD_CACHE];
+uint32_t host_fd_clock;
+
+//CP/M state mirrored from calls passing through
+uint8_t host_cur_drive, host_cur_user;
+uint16_t host_dma = 0x80;
+//search first/next
+uint8_t host_srch_on, host_srch_pat[13];
+uint16_t host_srch_idx, host_srch_ext;
+
+int host_bdos_dir (const char * dir)
+{
+struct stat st;
+uint8_t i;
+if ((stat(dir,&st)<0)||(!S_ISDIR(st.st_mode))) return -1;
+host_dir = strdup(dir);
+for (i=0;i<HOST_FD_CACHE;i++) host_fds[i].fd = -1;
+return 0;
+}
+
+void host_bdos_patch (void)
+{
+if (host_dir==NULL) return;
+if (ram[HOST_BDOS_VECT]!=0xC3) return;
+host_bdos_entry = ram[HOST_BDOS_VECT+1] | (ram[HOST_BDOS_VECT+2]<<8);
+ram[HOST_BDOS_VECT] = 0xD3;
+ram[HOST_BDOS_VECT+1] = HOST_BDOS_PORT;
+}
+
+//characters CCP takes as delimiters, or can't be typed
+static uint8_t host_bad_char (char c)
+{
+if ((c<=' ')||(c>0x7E)) return 1;
+return (strchr("<>.,;:=?*[]_",c)!=NULL);
+}
+
+//host name to CP/M 8.3, upper case; names that don't fit are not shown
+static int host_name_cpm (const char * fname, uint8_t * name)
+{
+const char * p;
+uint8_t i, n;
+memset(name,' ',11);
+p = fname;
+for (i=0;(*p!=0)&&(*p!='.');p++,i++)
+	{
+	if ((i>=8)||(host_bad_char(*p))) return -1;
+	name[i] = toupper((unsigned char)*p);
+	}
+if (i==0) return -1;
+if (*p=='.')
+	{
+	for (p++,n=0;*p!=0;p++,n++)
+		{
+		if ((n>=3)||(host_bad_char(*p))) return -1;
+		name[8+n] = toupper((unsigned char)*p);
+		}
+	}
+return 0;
+}
+
+static void host_name_host (const uint8_t * name, char * fname)
+{
+uint8_t i;
+char * p = fname;
+for (i=0;i<8;i++)
+	if ((name[i]&0x7F)!=' ') *p++ = tolower(name[i]&0x7F);
+if ((name[8]&0x7F)!=' ')
+	{
+	*p++ = '.';
+	for (i=8;i<11;i++)
+		if ((name[i]&0x7F)!=' ') *p++ = tolower(name[i]&0x7F);
+	}
+*p = 0;
+}
+
+static void host_path (const char * fname, char * path, size_t len)
+{
+snprintf(path,len,"%s/%s",host_dir,fname);
+}
+
+//directory list is read again only when host directory changed
+static void host_dir_scan (void)
+{
+struct stat st;
+struct dirent * de;
+struct host_dirent * e;
+char path[1024];
+DIR * d;
+uint16_t i;
+if (stat(host_dir,&st)<0) return;
+if ((host_dir_dirty==0)&&(st.st_mtim.tv_sec==host_dir_mtime.tv_sec)&&(st.st_mtim.tv_nsec==host_dir_mtime.tv_nsec)) return;
+host_dir_mtime = st.st_mtim;
+host_dir_dirty = 0;
+host_dir_cnt = 0;
+d = opendir(host_dir);
+if (d==NULL) return;
+while ((de=readdir(d))!=NULL)
+	{
+	if (host_dir_cnt==host_dir_max)
+		{
+		e = realloc(host_dir_list,(host_dir_max+64)*sizeof(struct host_dirent));
+		if (e==NULL) break;
+		host_dir_list = e;
+		host_dir_max += 64;
+		}
+	e = &host_dir_list[host_dir_cnt];
+	if (host_name_cpm(de->d_name,e->name)<0) continue;
+	host_path(de->d_name,path,sizeof(path));
+	if ((stat(path,&st)<0)||(!S_ISREG(st.st_mode))) continue;
+	//README and readme both map to one CP/M name, first one wins
+	for (i=0;i<host_dir_cnt;i++)
+		if (memcmp(host_dir_list[i].name,e->name,11)==0) break;
+	if (i<host_dir_cnt) continue;
+	strcpy(e->fname,de->d_name);
+	host_dir_cnt++;
+	}
+closedir(d);
+}
+
+//pattern may have '?', attribute bits are ignored
+static uint8_t host_name_match (const uint8_t * pat, const uint8_t * name)
+{
+uint8_t i;
+for (i=0;i<11;i++)
+	if (((pat[i]&0x7F)!='?')&&(toupper(pat[i]&0x7F)!=name[i])) return 0;
+return 1;
+}
+
+static int16_t host_dir_find (const uint8_t * pat, uint16_t from)
+{
+uint16_t i;
+host_dir_scan();
+for (i=from;i<host_dir_cnt;i++)
+	if (host_name_match(pat,host_dir_list[i].name)) return i;
+return -1;
+}
+
+static void host_fd_drop (const char * fname)
+{
+uint8_t i;
+for (i=0;i<HOST_FD_CACHE;i++)
+	if ((host_fds[i].fd>=0)&&((fname==NULL)||(strcmp(host_fds[i].fname,fname)==0)))
+		{
+		close(host_fds[i].fd);
+		host_fds[i].fd = -1;
+		}
+}
+
+//few files stay open, so record by record transfers don't open the file each time
+static int host_fd_get (const char * fname, int flags)
+{
+char path[1024];
+uint8_t i, lru;
+int fd;
+lru = 0;
+for (i=0;i<HOST_FD_CACHE;i++)
+	{
+	if ((host_fds[i].fd>=0)&&(strcmp(host_fds[i].fname,fname)==0)&&((flags&O_TRUNC)==0))
+		{
+		host_fds[i].used = ++host_fd_clock;
+		return host_fds[i].fd;
+		}
+	if ((host_fds[i].fd<0)||(host_fds[i].used<host_fds[lru].used)) lru = i;
+	}
+host_fd_drop(fname);
+host_path(fname,path,sizeof(path));
+fd = open(path,O_RDWR|flags,0644);
+if ((fd<0)&&(flags==0)) fd = open(path,O_RDONLY);
+if (fd<0) return -1;
+if (host_fds[lru].fd>=0) close(host_fds[lru].fd);
+host_fds[lru].fd = fd;
+strcpy(host_fds[lru].fname,fname);
+host_fds[lru].used = ++host_fd_clock;
+return fd;
+}
+
+static uint32_t host_fd_records (int fd)
+{
+struct stat st;
+if (fstat(fd,&st)<0) return 0;
+return (st.st_size+127)/128;
+}
+
+static uint8_t * host_fcb (void)
+{
+return &ram[(D<<8)|E];
+}
+
+static uint8_t host_fcb_drive (uint8_t * fcb)
+{
+if ((fcb[0]==0)||(fcb[0]=='?')) return host_cur_drive;
+return fcb[0]-1;
+}
+
+//sequential position in FCB: s2 counts 512k, ex 16k, cr records
+static uint32_t host_fcb_pos (uint8_t * fcb)
+{
+return (((uint32_t)(fcb[14]&0x3F))*32 + (fcb[12]&0x1F))*128 + fcb[32];
+}
+
+//record count of extent holding record rec
+static uint8_t host_ext_recs (uint32_t rec, uint32_t recs)
+{
+rec &= ~0x7FUL;
+if (recs<=rec) return 0;
+if (recs-rec>=128) return 0x80;
+return recs-rec;
+}
+
+static void host_fcb_set_pos (uint8_t * fcb, uint32_t rec, uint32_t recs)
+{
+fcb[32] = rec&0x7F;
+fcb[12] = (rec>>7)&0x1F;
+fcb[14] = rec>>12;
+fcb[15] = host_ext_recs(rec,recs);
+}
+
+static const char * host_fcb_file (uint8_t * fcb)
+{
+int16_t i;
+i = host_dir_find(fcb+1,0);
+if (i<0) return NULL;
+return host_dir_list[i].fname;
+}
+
+static uint8_t host_open (uint8_t * fcb)
+{
+uint32_t recs, rec;
+int16_t i;
+int fd;
+i = host_dir_find(fcb+1,0);
+if (i<0) return 0xFF;
+fd = host_fd_get(host_dir_list[i].fname,0);
+if (fd<0) return 0xFF;
+recs = host_fd_records(fd);
+rec = (((uint32_t)(fcb[14]&0x3F))*32 + (fcb[12]&0x1F))*128;
+if ((rec>0)&&(rec>=recs)) return 0xFF;
+memcpy(fcb+1,host_dir_list[i].name,11);
+fcb[13] = 0;
+fcb[15] = host_ext_recs(rec,recs);
+memset(fcb+16,0,16);
+return 0;
+}
+
+static uint8_t host_make (uint8_t * fcb)
+{
+char fname[13];
+int16_t i;
+int fd;
+for (i=1;i<12;i++)
+	if ((fcb[i]&0x7F)=='?') return 0xFF;
+//existing host file keeps its name, new one is lower case
+i = host_dir_find(fcb+1,0);
+if (i>=0) strcpy(fname,host_dir_list[i].fname);
+	else host_name_host(fcb+1,fname);
+if (fname[0]==0) return 0xFF;
+//BDOS makes further extents of growing file, these are already there
+if (((fcb[12]&0x1F)!=0)||((fcb[14]&0x3F)!=0))
+	fd = host_fd_get(fname,O_CREAT);
+else
+	fd = host_fd_get(fname,O_CREAT|O_TRUNC);
+if (fd<0) return 0xFF;
+host_dir_dirty = 1;
+fcb[13] = 0;
+fcb[15] = 0;
+memset(fcb+16,0,16);
+return 0;
+}
+
+static uint8_t host_rw (uint8_t * fcb, uint32_t rec, uint8_t wr, uint8_t seq)
+{
+const char * fname;
+uint8_t * dma;
+uint32_t recs;
+ssize_t n;
+int fd;
+fname = host_fcb_file(fcb);
+if (fname==NULL) return wr ? 2 : 1;
+fd = host_fd_get(fname,0);
+if (fd<0) return wr ? 2 : 1;
+dma = &ram[host_dma];
+recs = host_fd_records(fd);
+if (wr)
+	{
+	if (pwrite(fd,dma,128,rec*128)!=128) return 2;
+	if (rec>=recs) recs = rec+1;
+	}
+else
+	{
+	if (rec>=recs)
+		{
+		host_fcb_set_pos(fcb,rec,recs);
+		//random read past last extent is "seek to unwritten extent"
+		return (seq||((rec&~0x7FUL)<recs)) ? 1 : 4;
+		}
+	n = pread(fd,dma,128,rec*128);
+	if (n<0) n = 0;
+	if (n<128) memset(dma+n,0x1A,128-n);
+	}
+if (seq) rec++;
+host_fcb_set_pos(fcb,rec,recs);
+return 0;
+}
+
+static uint8_t host_delete (uint8_t * fcb)
+{
+char path[1024];
+uint8_t found = 0;
+int16_t i;
+for (i=host_dir_find(fcb+1,0);i>=0;i=host_dir_find(fcb+1,i+1))
+	{
+	host_fd_drop(host_dir_list[i].fname);
+	host_path(host_dir_list[i].fname,path,sizeof(path));
+	if (unlink(path)==0) found = 1;
+	}
+host_dir_dirty = 1;
+return found ? 0 : 0xFF;
+}
+
+static uint8_t host_rename (uint8_t * fcb)
+{
+char path[1024], path_new[1024], fname[13];
+const char * old;
+uint8_t i;
+for (i=17;i<28;i++)
+	if ((fcb[i]&0x7F)=='?') return 0xFF;
+old = host_fcb_file(fcb);
+if (old==NULL) return 0xFF;
+host_name_host(fcb+17,fname);
+if (fname[0]==0) return 0xFF;
+host_fd_drop(old);
+host_path(old,path,sizeof(path));
+host_path(fname,path_new,sizeof(path_new));
+host_dir_dirty = 1;
+if (rename(path,path_new)<0) return 0xFF;
+return 0;
+}
+
+//directory entries like BDOS would find them, extents described by DPB of G;
+//block numbers are only placeholders, so STAT can count the space
+static uint8_t host_search (void)
+{
+char path[1024];
+struct stat st;
+uint8_t * dir, * dpb;
+uint32_t recs, ent_recs, first, n, lx;
+uint8_t i, bls, ptrs;
+int16_t f;
+dpb = cpm_drive_dpb(HOST_BDOS_DRIVE);
+ent_recs = (dpb[4]+1)*128UL;
+bls = dpb[2];
+ptrs = (dpb[6]==0) ? 16 : 8;
+while (1)
+	{
+	f = host_dir_find(host_srch_pat+1,host_srch_idx);
+	if (f<0) return 0xFF;
+	host_path(host_dir_list[f].fname,path,sizeof(path));
+	recs = (stat(path,&st)<0) ? 0 : (st.st_size+127)/128;
+	first = host_srch_ext*ent_recs;
+	if ((host_srch_ext==0)||(first<recs)) break;
+	host_srch_idx = f+1;
+	host_srch_ext = 0;
+	}
+//all extents only when asked for with '?'
+if (host_srch_pat[12]=='?') host_srch_ext++;
+	else host_srch_idx = f+1;
+if (host_srch_ext*ent_recs>=recs)
+	{
+	host_srch_idx = f+1;
+	host_srch_ext = 0;
+	}
+n = (recs>first) ? recs-first : 0;
+if (n>ent_recs) n = ent_recs;
+dir = &ram[host_dma];
+memset(dir,0,32);
+dir[0] = host_cur_user;
+memcpy(dir+1,host_dir_list[f].name,11);
+lx = (n>0) ? (first+n-1)>>7 : first>>7;
+dir[12] = lx&0x1F;
+dir[14] = lx>>5;
+dir[15] = (n>0) ? host_ext_recs(lx*128,recs) : 0;
+n = (n+(1UL<<bls)-1)>>bls;
+for (i=0;(i<n)&&(i<ptrs);i++)
+	dir[16+((ptrs==16)?i:i*2)] = 1;
+return 0;
+}
+
+static uint8_t host_file_size (uint8_t * fcb)
+{
+const char * fname;
+uint32_t recs;
+int fd;
+fname = host_fcb_file(fcb);
+if (fname==NULL) return 0xFF;
+fd = host_fd_get(fname,0);
+if (fd<0) return 0xFF;
+recs = host_fd_records(fd);
+fcb[33] = recs;
+fcb[34] = recs>>8;
+fcb[35] = recs>>16;
+return 0;
+}
+
+static uint32_t host_fcb_random (uint8_t * fcb)
+{
+return fcb[33] | (fcb[34]<<8) | (((uint32_t)fcb[35])<<16);
+}
+
+//handle file function on host drive, returns 0 when BDOS should take the call
+static uint8_t host_bdos_call (uint8_t * res)
+{
+uint8_t * fcb;
+uint32_t rec;
+fcb = host_fcb();
+switch (C)
+	{
+	case 13:
+		host_cur_drive = 0;
+		host_dma = 0x80;
+		host_fd_drop(NULL);
+		return 0;
+	case 14:
+		host_cur_drive = E;
+		return 0;
+	case 26:
+		host_dma = (D<<8)|E;
+		return 0;
+	case 32:
+		if (E!=0xFF) host_cur_user = E&0x1F;
+		return 0;
+	case 17:
+		host_srch_on = (host_fcb_drive(fcb)==HOST_BDOS_DRIVE);
+		if (host_srch_on==0) return 0;
+		memcpy(host_srch_pat,fcb,13);
+		host_srch_idx = 0;
+		host_srch_ext = 0;
+		*res = host_search();
+		return 1;
+	case 18:
+		if (host_srch_on==0) return 0;
+		*res = host_search();
+		return 1;
+	}
+if ((C<15)||(C>40)) return 0;
+if (host_fcb_drive(fcb)!=HOST_BDOS_DRIVE) return 0;
+switch (C)
+	{
+	case 15:
+		*res = host_open(fcb);
+		return 1;
+	case 16:
+		*res = (host_fcb_file(fcb)==NULL) ? 0xFF : 0;
+		return 1;
+	case 19:
+		*res = host_delete(fcb);
+		return 1;
+	case 20:
+		*res = host_rw(fcb,host_fcb_pos(fcb),0,1);
+		return 1;
+	case 21:
+		*res = host_rw(fcb,host_fcb_pos(fcb),1,1);
+		return 1;
+	case 22:
+		*res = host_make(fcb);
+		return 1;
+	case 23:
+		*res = host_rename(fcb);
+		return 1;
+	case 30:
+		//no attributes on host files
+		*res = (host_fcb_file(fcb)==NULL) ? 0xFF : 0;
+		return 1;
+	case 33:
+	case 34:
+	case 40:
+		rec = host_fcb_random(fcb);
+		if (rec>0xFFFF)
+			{
+			*res = 6;
+			return 1;
+			}
+		*res = host_rw(fcb,rec,C!=33,0);
+		return 1;
+	case 35:
+		*res = host_file_size(fcb);
+		return 1;
+	}
+return 0;
+}
+
+//called on OUT to HOST_BDOS_PORT from BDOS entry vector
+void host_bdos_trap (void)
+{
+uint8_t res;
+if (host_bdos_call(&res)==0)
+	{
+	PC = ram + host_bdos_entry;
+	return;
+	}
+A = L = res;
+B = H = 0;
+PC = ram + (STACK[0] | (STACK[1]<<8));
+STACK += 2;
+}
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "host.h"
+#include "../src/Z80/hwz.h"
+
+//SPI FLASH of the badge, same commands as fl_* in hwz.c, but over memory
+//NOR semantics are kept: erase sets 4k to 0xFF, programming can only clear bits
+
+uint8_t * host_flash;
+extern uint32_t fl_stat_erases;
+extern volatile uint8_t fl_lock;
+
+struct host_region
+{
+	char drive;
+	uint32_t base;
+	uint32_t size;
+	uint8_t fill;
+	int fd;
+};
+
+//fill is content of freshly created image: empty CP/M disk, or erased FLASH
+struct host_region host_regions[] =
+{
+	{'a', RAMDISK_FL_HDR, ((RAMDISK_FL_DATA-RAMDISK_FL_HDR)+RAMDISK_SIZE+4095)&~4095UL, 0xFF, -1},
+#ifdef	CPM_BIG_DISK
+	{'d', CPM_DISK_D_SECT*128UL, 0x100000, 0xE5, -1},
+#endif
+#ifdef	CPM_FTL
+	{'d', CPM_DISK_D_SECT*128UL, 0x080000, 0xFF, -1},
+#endif
+#if !defined(CPM_BIG_DISK) && !defined(CPM_FTL)
+	{'d', CPM_DISK_D_SECT*128UL, 0x080000, 0xE5, -1},
+#endif
+	{'e', CPM_DISK_E_SECT*128UL, 0x080000, 0xE5, -1},
+	{'f', CPM_DISK_F_SECT*128UL, 0x080000, 0xE5, -1},
+	{0, 0, 0, 0, -1}
+};
+int host_flash_fd = -1;
+
+static struct host_region * host_find_region (char drive)
+{
+struct host_region * r;
+for (r=host_regions;r->drive!=0;r++)
+	if (r->drive==drive) return r;
+return NULL;
+}
+
+uint32_t host_drive_base (char drive)
+{
+struct host_region * r = host_find_region(drive);
+return (r==NULL) ? 0 : r->base;
+}
+
+uint32_t host_drive_size (char drive)
+{
+struct host_region * r = host_find_region(drive);
+return (r==NULL) ? 0 : r->size;
+}
+
+//open file, making it at least size bytes long, new bytes get fill value
+static int host_open_image (const char * fname, uint32_t size, uint8_t fill, uint32_t * old_size)
+{
+struct stat st;
+uint8_t buf[4096];
+uint32_t pos;
+int fd;
+fd = open(fname,O_RDWR|O_CREAT,0644);
+if (fd<0) return -1;
+if (fstat(fd,&st)<0)
+	{
+	close(fd);
+	return -1;
+	}
+*old_size = st.st_size;
+if (st.st_size<size)
+	{
+	memset(buf,fill,sizeof(buf));
+	for (pos=st.st_size;pos<size;pos+=(size-pos>sizeof(buf))?sizeof(buf):(size-pos))
+		if (pwrite(fd,buf,(size-pos>sizeof(buf))?sizeof(buf):(size-pos),pos)<0)
+			{
+			close(fd);
+			return -1;
+			}
+	}
+return fd;
+}
+
+//whole FLASH, either in memory only, or in 4MB file when fname is given
+int host_flash_open (const char * fname)
+{
+uint32_t old_size;
+if (fname==NULL)
+	{
+	host_flash = mmap(NULL,HOST_FLASH_SIZE,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+	if (host_flash==MAP_FAILED) return -1;
+	memset(host_flash,0xFF,HOST_FLASH_SIZE);
+	return 0;
+	}
+host_flash_fd = host_open_image(fname,HOST_FLASH_SIZE,0xFF,&old_size);
+if (host_flash_fd<0) return -1;
+host_flash = mmap(NULL,HOST_FLASH_SIZE,PROT_READ|PROT_WRITE,MAP_SHARED,host_flash_fd,0);
+if (host_flash==MAP_FAILED) return -1;
+return 0;
+}
+
+//stand-alone image, mapped in full
+uint8_t * host_map_image (const char * fname, uint32_t size, uint8_t fill)
+{
+uint32_t old_size;
+uint8_t * p;
+int fd;
+fd = host_open_image(fname,size,fill,&old_size);
+if (fd<0) return NULL;
+p = mmap(NULL,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+close(fd);
+if (p==MAP_FAILED) return NULL;
+return p;
+}
+
+//map drive image over its region of FLASH, has to be called after host_flash_open
+int host_map_drive (char drive, const char * fname)
+{
+struct host_region * r;
+uint32_t old_size;
+void * p;
+r = host_find_region(drive);
+if (r==NULL) return -1;
+r->fd = host_open_image(fname,r->size,r->fill,&old_size);
+if (r->fd<0) return -1;
+if (old_size>r->size)
+	fprintf(stderr,"%s: only first %lu bytes are used as drive %c\n",fname,(unsigned long)r->size,drive);
+p = mmap(host_flash+r->base,r->size,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_FIXED,r->fd,0);
+if (p==MAP_FAILED) return -1;
+return 0;
+}
+
+void host_flash_close (void)
+{
+struct host_region * r;
+for (r=host_regions;r->drive!=0;r++)
+	if (r->fd>=0)
+		{
+		msync(host_flash+r->base,r->size,MS_SYNC);
+		close(r->fd);
+		r->fd = -1;
+		}
+if (host_flash_fd>=0)
+	{
+	msync(host_flash,HOST_FLASH_SIZE,MS_SYNC);
+	close(host_flash_fd);
+	host_flash_fd = -1;
+	}
+}
+
+uint8_t fl_rdsr(void)
+{
+return 0;
+}
+
+uint32_t fl_rdid(void)
+{
+//SST26VF032B
+return 0xBF2642;
+}
+
+void fl_read_4k(uint32_t  addr, uint8_t * data)
+{
+fl_read_nk(addr,data,4096);
+}
+
+void fl_read_nk(uint32_t  addr, uint8_t * data, uint16_t n)
+{
+uint16_t i;
+fl_lock++;
+for (i=0;i<n;i++) data[i] = host_flash[(addr+i)%HOST_FLASH_SIZE];
+fl_lock--;
+}
+
+void fl_unlock(void)
+{
+}
+
+void fl_erase_4k(uint32_t  addr)
+{
+fl_lock++;
+memset(host_flash+((addr%HOST_FLASH_SIZE)&~4095UL),0xFF,4096);
+fl_stat_erases++;
+fl_lock--;
+}
+
+void fl_write(uint32_t  addr,uint8_t data)
+{
+fl_lock++;
+host_flash[addr%HOST_FLASH_SIZE] &= data;
+fl_lock--;
+}
+
+void fl_rst_pb(void)
+{
+}
+
+void fl_wren(void)
+{
+}
+
+//program up to 256 bytes, address wraps within page like on the chip
+void fl_write_page(uint32_t  addr, uint8_t * data, uint16_t n)
+{
+uint16_t i;
+uint32_t page;
+fl_lock++;
+page = (addr%HOST_FLASH_SIZE)&~(FL_PAGE_SIZE-1UL);
+for (i=0;i<n;i++) host_flash[page+((addr+i)%FL_PAGE_SIZE)] &= data[i];
+fl_lock--;
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/select.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/Z80/sim.h"
+#include "../src/Z80/simglb.h"
+
+//console of host build: stdin/stdout stand in for keyboard and display
+
+volatile uint8_t host_quit;
+int16_t host_key = -1;
+uint16_t host_idle_polls;
+
+#define		HOST_PIPE_PACE	200
+
+static void host_stop (void)
+{
+host_quit = 1;
+cpu_state = STOPPED;
+}
+
+//poll stdin, once CP/M keeps waiting for a while poll with timeout, so idle host does not spin
+//piped input is paced - next character is offered only after machine polled for a while
+//without printing, so it is taken by CONIN, not by ^S/abort checks during output
+static void host_poll_key (void)
+{
+fd_set fds;
+struct timeval tv;
+uint8_t c;
+if ((host_key>=0)||(host_quit)) return;
+fflush(stdout);
+if ((host_term_is_raw==0)&&(host_idle_polls<HOST_PIPE_PACE))
+	{
+	host_idle_polls++;
+	return;
+	}
+FD_ZERO(&fds);
+FD_SET(0,&fds);
+tv.tv_sec = 0;
+tv.tv_usec = (host_idle_polls>1000) ? 1000 : 0;
+if (select(1,&fds,NULL,NULL,&tv)<=0)
+	{
+	if (host_idle_polls<0xFFFF) host_idle_polls++;
+	return;
+	}
+host_idle_polls = 0;
+if (read(0,&c,1)!=1)
+	{
+	host_stop();
+	return;
+	}
+if (c==HOST_QUIT_KEY)
+	{
+	host_stop();
+	return;
+	}
+//piped input has bare LF line ends, CP/M wants CR
+if ((c=='\n')&&(host_term_is_raw==0)) c = '\r';
+host_key = c;
+}
+
+int8_t stdio_get_state (void)
+{
+host_poll_key();
+//on quit report key, so CONIN wait loop ends
+return ((host_key>=0)||(host_quit)) ? 1 : 0;
+}
+
+int8_t stdio_get (int8_t * dat)
+{
+host_poll_key();
+if (host_key<0)
+	{
+	//nothing will come, let CP/M read something harmless while CPU stops
+	*dat = 0;
+	return 0;
+	}
+*dat = host_key;
+host_key = -1;
+return 1;
+}
+
+uint8_t stdio_c (uint8_t data)
+{
+host_idle_polls = 0;
+putchar(data);
+return 0;
+}
+
+//stdout is buffered already and flushed when CP/M polls keyboard
+void con_put (uint8_t data)
+{
+stdio_c(data);
+}
+
+void con_flush (void)
+{
+}
+
+//no video window on host terminal, IN (0Eh) reads 0 so programs fall back to CONOUT
+uint8_t vwin_set (uint8_t page)
+{
+return 0;
+}
+
+uint8_t vwin_get (void)
+{
+return 0;
+}
+
+void vwin_sync (uint8_t force)
+{
+}
+
+//badge serial port as is, input journal is only in whole firmware build
+uint8_t rx_sta (void)
+{
+return host_rx_sta();
+}
+
+uint8_t rx_read (void)
+{
+return host_rx_read();
+}
+
+uint32_t millis (void)
+{
+struct timespec ts;
+clock_gettime(CLOCK_MONOTONIC,&ts);
+return (ts.tv_sec*1000UL) + (ts.tv_nsec/1000000UL);
+}
+
+uint32_t host_core_count (void)
+{
+struct timespec ts;
+clock_gettime(CLOCK_MONOTONIC,&ts);
+return (ts.tv_sec*24000000UL) + (ts.tv_nsec/1000UL*24UL);
+}
@@ -0,0 +1,105 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/disp.h"
+
+//ST7789 display controller of the badge, fed a byte at a time by disp.c
+//only what firmware uses: CASET/RASET window, RAMWR with 18-bit pixels
+//(COLMOD 0x66, three bytes per pixel, 6 bits each in upper bits), MADCTL
+//is taken as set by TFT_24_7789_Init, so frame is kept in coordinates of
+//firmware - 320 columns by 240 rows, as seen on the badge
+
+uint8_t host_lcd_fb[HOST_LCD_H][HOST_LCD_W][3];
+uint32_t host_lcd_pixels;
+
+static uint16_t lcd_xs, lcd_xe = HOST_LCD_W-1, lcd_ys, lcd_ye = HOST_LCD_H-1, lcd_x, lcd_y;
+static uint8_t lcd_cmd, lcd_arg, lcd_byte, lcd_pix[3];
+uint8_t host_lcd_madctl, host_lcd_colmod, host_lcd_on;
+
+static void lcd_data (uint8_t data)
+{
+switch (lcd_cmd)
+	{
+	case 0x2A:
+		if (lcd_arg==0) lcd_xs = data<<8;
+		if (lcd_arg==1) lcd_xs |= data;
+		if (lcd_arg==2) lcd_xe = data<<8;
+		if (lcd_arg==3) lcd_xe |= data;
+		lcd_arg++;
+		break;
+	case 0x2B:
+		if (lcd_arg==0) lcd_ys = data<<8;
+		if (lcd_arg==1) lcd_ys |= data;
+		if (lcd_arg==2) lcd_ye = data<<8;
+		if (lcd_arg==3) lcd_ye |= data;
+		lcd_arg++;
+		break;
+	case 0x2C:
+	case 0x3C:
+		lcd_pix[lcd_byte++] = data;
+		if (lcd_byte<3) break;
+		lcd_byte = 0;
+		host_lcd_pixels++;
+		//6 bits per color, low two are don't care, scale back to 8 bits
+		if ((lcd_x<HOST_LCD_W)&&(lcd_y<HOST_LCD_H))
+			{
+			host_lcd_fb[lcd_y][lcd_x][0] = (lcd_pix[0]&0xFC)|(lcd_pix[0]>>6);
+			host_lcd_fb[lcd_y][lcd_x][1] = (lcd_pix[1]&0xFC)|(lcd_pix[1]>>6);
+			host_lcd_fb[lcd_y][lcd_x][2] = (lcd_pix[2]&0xFC)|(lcd_pix[2]>>6);
+			}
+		//address counter wraps within window, like the controller
+		if (lcd_x++>=lcd_xe)
+			{
+			lcd_x = lcd_xs;
+			if (lcd_y++>=lcd_ye) lcd_y = lcd_ys;
+			}
+		break;
+	case 0x36:
+		host_lcd_madctl = data;
+		break;
+	case 0x3A:
+		host_lcd_colmod = data;
+		break;
+	}
+}
+
+void TFT_24_7789_Write_Command(uint16_t command)
+{
+lcd_cmd = command;
+lcd_arg = 0;
+lcd_byte = 0;
+if (command==0x2C)
+	{
+	lcd_x = lcd_xs;
+	lcd_y = lcd_ys;
+	}
+if (command==0x29) host_lcd_on = 1;
+if (command==0x28) host_lcd_on = 0;
+}
+
+inline void TFT_24_7789_Write_Data(uint16_t data1)
+{
+lcd_data(data1);
+}
+
+inline void TFT_24_7789_Write_Data3(uint16_t data1,uint16_t data2, uint16_t data3)
+{
+lcd_data(data1);
+lcd_data(data2);
+lcd_data(data3);
+}
+
+//frame as binary PPM, plain write() so it can be called from signal handler
+int host_lcd_dump (const char * fname)
+{
+static const char hdr[] = "P6\n320 240\n255\n";
+int fd,ret = 0;
+fd = open(fname,O_WRONLY|O_CREAT|O_TRUNC,0644);
+if (fd<0) return -1;
+if (write(fd,hdr,sizeof(hdr)-1)!=(sizeof(hdr)-1)) ret = -1;
+if (write(fd,host_lcd_fb,sizeof(host_lcd_fb))!=sizeof(host_lcd_fb)) ret = -1;
+close(fd);
+return ret;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+
+//terminal of host and serial port of badge, shared by all host programs
+
+struct termios host_term_saved;
+uint8_t host_term_is_raw;
+int host_serial_fd = -1;
+uint8_t host_serial_byte, host_serial_have;
+
+void host_term_raw (void)
+{
+struct termios t;
+if (isatty(0)==0) return;
+tcgetattr(0,&host_term_saved);
+t = host_term_saved;
+t.c_iflag &= ~(ICRNL|INLCR|IXON);
+t.c_lflag &= ~(ICANON|ECHO|ISIG|IEXTEN);
+t.c_cc[VMIN] = 1;
+t.c_cc[VTIME] = 0;
+tcsetattr(0,TCSANOW,&t);
+host_term_is_raw = 1;
+}
+
+void host_term_restore (void)
+{
+if (host_term_is_raw) tcsetattr(0,TCSANOW,&host_term_saved);
+host_term_is_raw = 0;
+}
+
+//serial port of badge, connected to tty or pipe given with -s
+int host_serial_open (const char * fname)
+{
+struct termios t;
+host_serial_fd = open(fname,O_RDWR|O_NOCTTY);
+if (host_serial_fd<0) return -1;
+if (isatty(host_serial_fd))
+	{
+	tcgetattr(host_serial_fd,&t);
+	cfmakeraw(&t);
+	tcsetattr(host_serial_fd,TCSANOW,&t);
+	}
+return 0;
+}
+
+uint8_t host_rx_sta (void)
+{
+fd_set fds;
+struct timeval tv;
+if (host_serial_fd<0) return 0;
+if (host_serial_have) return 0xFF;
+FD_ZERO(&fds);
+FD_SET(host_serial_fd,&fds);
+tv.tv_sec = 0;
+tv.tv_usec = 0;
+if (select(host_serial_fd+1,&fds,NULL,NULL,&tv)<=0) return 0;
+if (read(host_serial_fd,&host_serial_byte,1)!=1) return 0;
+host_serial_have = 1;
+return 0xFF;
+}
+
+uint8_t host_rx_read (void)
+{
+if (host_rx_sta()==0) return 0;
+host_serial_have = 0;
+return host_serial_byte;
+}
+
+void tx_write (uint8_t data)
+{
+if (host_serial_fd<0) return;
+if (write(host_serial_fd,&data,1)!=1) return;
+}
@@ -0,0 +1,14 @@
+//host build stand-in for XC32 peripheral library, only what Z80 part uses
+#ifndef		__HOST_PLIB_H
+#define		__HOST_PLIB_H
+
+#include <stdint.h>
+
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+
+//core timer, 24 ticks per microsecond like on PIC32 at 48MHz
+uint32_t host_core_count (void);
+#define	_CP0_GET_COUNT()	host_core_count()
+
+#endif
@@ -0,0 +1 @@
+//host build, no debug I/O
@@ -0,0 +1,54 @@
+//host build stand-in for lib-wii, only what wii_interface.c uses
+//no nunchuck or classic controller is ever found on host I2C bus
+#ifndef		__HOST_WII_LIB_H
+#define		__HOST_WII_LIB_H
+
+#include <stdint.h>
+
+#ifndef		TRUE
+#define		TRUE		1
+#define		FALSE		0
+#endif
+
+#define		I2C1		1
+
+#define		WII_LIB_RC_SUCCESS								0
+#define		WII_LIB_RC_TARGET_NOT_FOUND						1
+
+#define		WII_LIB_DEVICE_STATUS_STRUCTURE_NOT_DEFINED		0
+#define		WII_LIB_DEVICE_STATUS_NOT_CONNECTED				1
+
+#define		WII_LIB_TARGET_DEVICE_UNKNOWN					0
+#define		WII_LIB_TARGET_DEVICE_NUNCHUCK					1
+#define		WII_LIB_TARGET_DEVICE_CLASSIC_CONTROLLER		2
+#define		WII_LIB_TARGET_DEVICE_MOTION_PLUS				3
+#define		WII_LIB_TARGET_DEVICE_MOTION_PLUS_PASS_NUNCHUCK	4
+#define		WII_LIB_TARGET_DEVICE_MOTION_PLUS_PASS_CLASSIC	5
+
+//stick and accelerometer dead zones, unused without a device
+#define		WII_NUNCHUCK_THRESHOLD_ANALOG					50
+#define		WII_NUNCHUCK_THRESHOLD_ACCELEROMETER			100
+
+typedef struct
+{
+	uint8_t buttonA, buttonB, buttonC, buttonX, buttonY, buttonZ, buttonZL, buttonZR;
+	uint8_t buttonHome, buttonPlus, buttonMinus;
+	uint8_t dpadUp, dpadDown, dpadLeft, dpadRight;
+	int16_t accelX, accelY, accelZ;
+	int16_t analogLeftX, analogLeftY, analogRightX, analogRightY;
+} WiiLib_Interface;
+
+typedef struct
+{
+	uint8_t status;
+	uint8_t target;
+	WiiLib_Interface interfaceCurrent;
+	WiiLib_Interface interfaceRelative;
+} WiiLib_Device;
+
+int WiiLib_Init (int module, uint32_t clock, uint8_t target, uint8_t decrypt, WiiLib_Device * device);
+int WiiLib_DoMaintenance (WiiLib_Device * device);
+int WiiLib_PollStatus (WiiLib_Device * device);
+int WiiLib_SaveCurrentPositionAsHome (WiiLib_Device * device);
+
+#endif
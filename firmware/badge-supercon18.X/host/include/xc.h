@@ -0,0 +1 @@
+//host build, no device registers
@@ -0,0 +1,104 @@
+/*
+ * tktest - the re2c scanner of uBASIC against the rules it is made from
+ *
+ * usage: tktest
+ * Keyword and operator rules are taken out of tokenizer_generate/ubasic.re
+ * by the Makefile (tk_rules.h). Every rule, every prefix of it and the rule
+ * with a letter after it are scanned, in lower, upper and mixed case, and
+ * the token and its length have to be those of the longest rule matching
+ * there, or a one letter variable. This catches states of
+ * tokenizer_fast.c that don't follow ubasic.re, e.g. edited by hand.
+ * Exit status is 0 when all match.
+ */
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "../src/basic/tokenizer.h"
+
+struct tk_rule
+	{
+	const char * text;
+	int token;
+	int nocase;			//'text' of re2c, "text" is exact
+	};
+
+static const struct tk_rule tk_rules[] =
+	{
+#include "tk_rules.h"
+	};
+
+#define	TK_RULES		(sizeof(tk_rules)/sizeof(tk_rules[0]))
+
+static int tk_prefix (const char * s, const struct tk_rule * r)
+{
+size_t i,n;
+n = strlen(r->text);
+for (i=0;i<n;i++)
+	{
+	if (s[i]==r->text[i]) continue;
+	if ((r->nocase)&&(s[i]!=0)&&(tolower((unsigned char)s[i])==r->text[i])) continue;
+	return 0;
+	}
+return 1;
+}
+
+//longest match of ubasic.re, letters that start no rule are variables
+static int tk_expect (const char * s, int * len)
+{
+unsigned i;
+int token = TOKENIZER_ERROR;
+*len = 0;
+if (isalpha((unsigned char)s[0]))
+	{
+	token = TOKENIZER_VARIABLE;
+	*len = 1;
+	}
+for (i=0;i<TK_RULES;i++)
+	if ((tk_prefix(s,&tk_rules[i]))&&((int)strlen(tk_rules[i].text)>*len))
+		{
+		token = tk_rules[i].token;
+		*len = strlen(tk_rules[i].text);
+		}
+return token;
+}
+
+static int tk_check (const char * s)
+{
+Scanner sc;
+int token,len;
+memset(&sc,0,sizeof(sc));
+tokenizer_select(&sc);
+tokenizer_init(s);
+token = tk_expect(s,&len);
+if ((tokenizer_token()==token)&&((sc._pchCur-sc.top)==len)) return 0;
+fprintf(stderr,"\"%s\": token %d length %d, ubasic.re gives %d length %d\n",
+	s,tokenizer_token(),(int)(sc._pchCur-sc.top),token,len);
+return 1;
+}
+
+int main (void)
+{
+char s[32];
+unsigned i,j,n,k,c;
+int bad = 0,checks = 0;
+for (i=0;i<TK_RULES;i++)
+	for (c=0;c<3;c++)
+		{
+		if ((c>0)&&(!tk_rules[i].nocase)) break;
+		n = strlen(tk_rules[i].text);
+		//prefixes, whole rule, rule and a letter, each before a space
+		for (k=1;k<=n+1;k++)
+			{
+			memcpy(s,tk_rules[i].text,n);
+			s[n] = 'x';
+			for (j=0;j<k;j++)
+				if ((c==1)||((c==2)&&(j%2==0))) s[j] = toupper((unsigned char)s[j]);
+			s[k] = ' ';
+			s[k+1] = 0;
+			bad |= tk_check(s);
+			checks++;
+			}
+		}
+printf("%u rules, %d scans: %s\n",(unsigned)TK_RULES,checks,bad ? "FAILED" : "ok");
+return bad;
+}
@@ -0,0 +1,192 @@
+/*
+ * ubtest - many uBASIC programs side by side, as bg runs one of them
+ *
+ * usage: ubtest [-n contexts] [-r rounds] [-s seed]
+ * Every program is run alone to its end first, then all contexts are
+ * started together and stepped in random order by random slices of lines
+ * with ubasic_step, as the BASIC prompt loop does with bg. Each context has
+ * its arrays in a slice of its own. Variables, end state and arrays of each
+ * context have to match its run alone. Programs are different texts, so the
+ * line index of ubasic.c keeps being taken over by another one, and one text
+ * is shared by two contexts. Before that, two contexts without slices check
+ * that only one of them gets arrays in the shared arena.
+ * Exit status is 0 when all rounds match.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "../src/basic/ubasic.h"
+
+#define	UT_MAX_CTX		16
+#define	UT_ARENA		8192
+
+static const char * const ut_progs[] =
+	{
+	//squares mod 7 through GOSUB
+	"10 s=0\n20 for i=1 to 300\n30 gosub 100\n40 next i\n50 end\n"
+	"100 s=s+i*i%7\n110 return\n",
+	//sieve in a 16 bit array, count of primes below 500
+	"10 dim p(499),16\n20 fill p,1\n30 c=0\n40 for i=2 to 499\n"
+	"50 if p(i)=0 then goto 110\n60 c=c+1\n70 j=i+i\n"
+	"80 if j>499 then goto 110\n90 p(j)=0\n100 j=j+i\n105 goto 80\n"
+	"110 next i\n120 end\n",
+	//longest Collatz chain of starts below 60
+	"10 m=0\n20 for k=1 to 59\n30 n=k\n40 l=0\n50 if n=1 then goto 100\n"
+	"60 if n%2=0 then goto 66\n62 n=n*3+1\n64 goto 70\n66 n=n/2\n"
+	"70 l=l+1\n80 goto 50\n"
+	"100 if l>m then m=l\n110 if l=m then b=k\n120 next k\n130 end\n",
+	//Fibonacci in a 32 bit array, shifted with COPY
+	"10 dim f(40)\n20 f(1)=1\n30 for i=2 to 40\n40 f(i)=f(i-1)+f(i-2)\n"
+	"50 next i\n60 copy f(1),f(0),40\n70 x=f(40)\n80 y=f(0)+f(1)\n90 end\n",
+	};
+#define	UT_PROGS	(sizeof(ut_progs)/sizeof(ut_progs[0]))
+
+static uint32_t ut_arena[UT_ARENA/4];
+static struct ubasic_ctx ut_ctx[UT_MAX_CTX];
+static struct ubasic_ctx ut_ref[UT_PROGS];
+static uint8_t ut_ref_arena[UT_PROGS][UT_ARENA];
+
+static void usage (void)
+{
+fprintf(stderr,"usage: ubtest [-n contexts] [-r rounds] [-s seed]\n");
+exit(1);
+}
+
+//bytes of arena a program of context c has taken, from the top
+static uint16_t ut_used (struct ubasic_ctx * c)
+{
+uint16_t i,lo;
+lo = UT_ARENA;
+for (i=0;i<MAX_VARNUM;i++)
+	if ((c->arrays[i]!=0)&&(4*(c->arrays[i]-1)<lo)) lo = 4*(c->arrays[i]-1);
+return UT_ARENA - lo;
+}
+
+//arrays are compared through their contents, their place differs
+static int ut_same_arrays (struct ubasic_ctx * c, const uint8_t * a, struct ubasic_ctx * r, const uint8_t * ra)
+{
+uint16_t i,n;
+const uint8_t * h, * rh;
+for (i=0;i<MAX_VARNUM;i++)
+	{
+	if ((c->arrays[i]==0)!=(r->arrays[i]==0)) return 0;
+	if (c->arrays[i]==0) continue;
+	h = a + 4*(c->arrays[i]-1);
+	rh = ra + 4*(r->arrays[i]-1);
+	n = h[0] | (h[1]<<8);
+	if (memcmp(h,rh,4 + n*h[2])!=0) return 0;
+	}
+return 1;
+}
+
+static uint8_t ut_run (struct ubasic_ctx * c)
+{
+uint8_t r;
+do r = ubasic_step(c,1000,0xFFFF);
+while (r==UBASIC_RUNNING);
+return r;
+}
+
+//alone to its end, in one context that is done before the next starts
+static void ut_reference (void)
+{
+uint16_t p;
+for (p=0;p<UT_PROGS;p++)
+	{
+	ubasic_arena(ut_arena,UT_ARENA);
+	ubasic_ctx_init(&ut_ref[p],ut_progs[p]);
+	if (ut_run(&ut_ref[p])!=UBASIC_DONE)
+		{
+		fprintf(stderr,"program %u fails alone\n",p);
+		exit(1);
+		}
+	memcpy(ut_ref_arena[p],ut_arena,UT_ARENA);
+	}
+}
+
+//sieve and Fibonacci both DIM in the shared arena, the second has to wait
+//until the first is started again, which frees only arrays of its own
+static int ut_owner (void)
+{
+int bad = 0;
+ubasic_arena(ut_arena,UT_ARENA);
+ubasic_ctx_init(&ut_ctx[0],ut_progs[1]);
+ubasic_ctx_init(&ut_ctx[1],ut_progs[3]);
+if (ut_run(&ut_ctx[0])!=UBASIC_DONE) bad = 1;
+if (ut_run(&ut_ctx[1])!=UBASIC_ERROR) bad = 1;
+ubasic_ctx_init(&ut_ctx[1],ut_progs[3]);
+if (!ut_same_arrays(&ut_ctx[0],(uint8_t *)ut_arena,&ut_ref[1],ut_ref_arena[1])) bad = 1;
+ubasic_ctx_init(&ut_ctx[0],ut_progs[1]);
+if (ut_run(&ut_ctx[1])!=UBASIC_DONE) bad = 1;
+if (bad) fprintf(stderr,"shared arena taken by two contexts\n");
+return bad;
+}
+
+static int ut_round (uint16_t n)
+{
+uint16_t i,left,off;
+uint8_t r,done[UT_MAX_CTX];
+int bad;
+ubasic_arena(ut_arena,UT_ARENA);
+off = 0;
+for (i=0;i<n;i++)
+	{
+	ubasic_ctx_init(&ut_ctx[i],ut_progs[i%UT_PROGS]);
+	ubasic_ctx_arena(&ut_ctx[i],(uint8_t *)ut_arena + off,ut_used(&ut_ref[i%UT_PROGS]));
+	off += ut_used(&ut_ref[i%UT_PROGS]);
+	done[i] = 0;
+	}
+left = n;
+while (left)
+	{
+	i = rand()%n;
+	if (done[i]) continue;
+	r = ubasic_step(&ut_ctx[i],1 + rand()%24,0xFFFF);
+	if (r==UBASIC_RUNNING) continue;
+	done[i] = 1;
+	left--;
+	}
+bad = 0;
+for (i=0;i<n;i++)
+	{
+	const struct ubasic_ctx * ref = &ut_ref[i%UT_PROGS];
+	if ((ut_ctx[i].error!=ref->error)||(ut_ctx[i].ended!=ref->ended)||
+		(memcmp(ut_ctx[i].variables,ref->variables,sizeof(ref->variables))!=0)||
+		(!ut_same_arrays(&ut_ctx[i],ut_ctx[i].slice,&ut_ref[i%UT_PROGS],ut_ref_arena[i%UT_PROGS])))
+		{
+		fprintf(stderr,"context %u (program %u) differs\n",i,(unsigned)(i%UT_PROGS));
+		bad = 1;
+		}
+	}
+return bad;
+}
+
+int main (int argc, char * argv[])
+{
+int a,n = 8,rounds = 50,bad = 0;
+unsigned seed = 1;
+uint16_t i,used;
+for (a=1;a<argc;a++)
+	{
+	if ((argv[a][0]!='-')||(argv[a][1]==0)||(argv[a][2]!=0)||(a+1>=argc)) usage();
+	if (argv[a][1]=='n') n = atoi(argv[++a]);
+	else if (argv[a][1]=='r') rounds = atoi(argv[++a]);
+	else if (argv[a][1]=='s') seed = atoi(argv[++a]);
+	else usage();
+	}
+if ((n<1)||(n>UT_MAX_CTX)) usage();
+ut_reference();
+used = 0;
+for (i=0;i<n;i++) used += ut_used(&ut_ref[i%UT_PROGS]);
+if (used>UT_ARENA)
+	{
+	fprintf(stderr,"arrays of %d contexts don't fit arena\n",n);
+	return 1;
+	}
+bad = ut_owner();
+srand(seed);
+for (a=0;a<rounds;a++) bad |= ut_round(n);
+printf("%d contexts, %d rounds: %s\n",n,rounds,bad ? "FAILED" : "ok");
+return bad;
+}
@@ -0,0 +1,128 @@
+/*
+ * z80sim - CP/M machine of the badge running on host
+ *
+ * usage: z80sim [-m flash.img] [-a a.img] [-d d.img] [-e e.img] [-f f.img] [-g dir]
+ *        [-s tty] [-t]
+ * Same Z80 core, BIOS and disk code as the firmware, FLASH drives live in
+ * image files (see host.h), missing images are created empty.
+ * -g makes host directory drive G, its files are used directly.
+ * -s connects serial port of badge (YMODEM transfers) to tty or pipe.
+ * -t prints boot-to-prompt times and turn latency (enter to next key
+ * request, compare with zm -t) on exit.
+ * ctrl-] quits, RAM disk is saved to its image on exit.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/Z80/hwz.h"
+#include "../src/Z80/sim.h"
+#include "../src/Z80/simglb.h"
+#include "../src/Z80/rdc.h"
+
+extern const uint8_t ram_image_a[3];
+extern uint8_t ram_disk[RAMDISK_SIZE];
+void reload_cpm_warm (void);
+int cpu ();
+
+static void usage (void)
+{
+fprintf(stderr,"usage: z80sim [-m flash.img] [-a a.img] [-d d.img] [-e e.img] [-f f.img] [-g dir] [-s tty] [-t]\n");
+exit(1);
+}
+
+int main (int argc, char * argv[])
+{
+char * flash_name = NULL, * drive_name[4] = {NULL,NULL,NULL,NULL}, * dir_name = NULL, * serial_name = NULL;
+const char * drives = "adef", * d;
+uint32_t i,cold_us,warm_us,warm_cnt,pages,turns,avg_us,max_us;
+uint8_t boot_stats = 0;
+int a;
+for (a=1;a<argc;a++)
+	{
+	if ((argv[a][0]!='-')||(argv[a][1]==0)||(argv[a][2]!=0)) usage();
+	if (argv[a][1]=='t')
+		{
+		boot_stats = 1;
+		continue;
+		}
+	if (a+1>=argc) usage();
+	d = strchr(drives,argv[a][1]);
+	if (argv[a][1]=='m') flash_name = argv[++a];
+	else if (argv[a][1]=='g') dir_name = argv[++a];
+	else if (argv[a][1]=='s') serial_name = argv[++a];
+	else if (d!=NULL) drive_name[d-drives] = argv[++a];
+	else usage();
+	}
+if (host_flash_open(flash_name)<0)
+	{
+	perror(flash_name);
+	return 1;
+	}
+for (i=0;i<4;i++)
+	if ((drive_name[i]!=NULL)&&(host_map_drive(drives[i],drive_name[i])<0))
+		{
+		perror(drive_name[i]);
+		return 1;
+		}
+if ((dir_name!=NULL)&&(host_bdos_dir(dir_name)<0))
+	{
+	fprintf(stderr,"%s: not a directory\n",dir_name);
+	return 1;
+	}
+if ((serial_name!=NULL)&&(host_serial_open(serial_name)<0))
+	{
+	perror(serial_name);
+	return 1;
+	}
+#ifndef	RAMDISK_PERSIST
+if (drive_name[0]!=NULL) fprintf(stderr,"RAMDISK_PERSIST is off, disk A is not kept in %s\n",drive_name[0]);
+#endif
+//the same as init_z80_cpm() of badge
+cpm_boot_start(1);
+memset(ram,0,65536);
+memcpy(ram,ram_image_a,3);
+reload_cpm_warm();
+#ifdef	USE_RAMDISK
+memset(ram_disk,0xE5,RAMDISK_SIZE);
+#ifdef	RAMDISK_PERSIST
+ramdisk_restore();
+#endif
+#ifdef	RAMDISK_COMPRESSED
+rdc_init();
+#endif
+#endif
+wrk_ram	= PC = STACK = ram;
+init_io(IO_CPM_MODE);
+host_term_raw();
+while (host_quit==0)
+	{
+	cpu_error = NONE;
+	cpu_state = CONTIN_RUN;
+	cpu();
+	if ((host_quit==0)&&(cpu_error!=NONE))
+		{
+		fprintf(stderr,"\r\nZ80 stopped, error %d at %04X\r\n",cpu_error,(unsigned int)(PC-ram));
+		break;
+		}
+	}
+host_term_restore();
+fflush(stdout);
+if (boot_stats)
+	{
+	cpm_get_boot_stats(&cold_us,&warm_us,&warm_cnt,&pages);
+	fprintf(stderr,"boot cold %lu us, warm %lu us, %lu warm boots, %lu pages restored\n",
+		(unsigned long)cold_us,(unsigned long)warm_us,(unsigned long)warm_cnt,(unsigned long)pages);
+	cpm_get_turn_stats(&turns,&avg_us,&max_us);
+	fprintf(stderr,"%lu turns, latency avg %lu us, max %lu us\n",
+		(unsigned long)turns,(unsigned long)avg_us,(unsigned long)max_us);
+	}
+#ifdef	RAMDISK_PERSIST
+ramdisk_sync();
+#endif
+fl_flush();
+host_flash_close();
+return 0;
+}
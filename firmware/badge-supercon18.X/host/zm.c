@@ -0,0 +1,65 @@
+/*
+ * zm - native Z-machine of the badge running on host
+ *
+ * usage: zm [-m flash.img] [-t] [NAME.EXT]
+ * Plays story from ROM disk C (ZORK1.DAT by default) with the same
+ * interpreter as menu entry 5 of badge. -m keeps saved games, -t prints
+ * turn latency on exit. ctrl-] quits.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <plib.h>
+#include "host.h"
+#include "../src/hw.h"
+#include "../src/Z80/hwz.h"
+#include "../src/zmachine.h"
+
+//input journal is part of whole firmware build only, seeds stay live here
+uint32_t jr_seed (uint32_t live)
+{
+return live;
+}
+
+static void usage (void)
+{
+fprintf(stderr,"usage: zm [-m flash.img] [-t] [NAME.EXT]\n");
+exit(1);
+}
+
+int main (int argc, char * argv[])
+{
+char * flash_name = NULL;
+const char * story = "ZORK1.DAT";
+uint32_t turns,avg_us,max_us;
+uint8_t stats = 0,ret;
+int a;
+for (a=1;(a<argc)&&(argv[a][0]=='-');a++)
+	{
+	if ((argv[a][1]==0)||(argv[a][2]!=0)) usage();
+	if (argv[a][1]=='t') stats = 1;
+	else if ((argv[a][1]=='m')&&(a+1<argc)) flash_name = argv[++a];
+	else usage();
+	}
+if (a<argc) story = argv[a++];
+if (a<argc) usage();
+if (host_flash_open(flash_name)<0)
+	{
+	perror(flash_name);
+	return 1;
+	}
+host_term_raw();
+ret = zm_run(2,story);
+host_term_restore();
+fflush(stdout);
+if (ret!=ZM_OK) fprintf(stderr,"%s: %s\n",story,zm_err_str(ret));
+if (stats)
+	{
+	zm_get_stats(&turns,&avg_us,&max_us);
+	fprintf(stderr,"%lu turns, latency avg %lu us, max %lu us\n",
+		(unsigned long)turns,(unsigned long)avg_us,(unsigned long)max_us);
+	}
+fl_flush();
+host_flash_close();
+return (ret!=ZM_OK);
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+# prof.py - flat profile of badge firmware from PROF lines sent by profs
+#
+# usage: prof.py [-n nm] [-a addr2line] [-l N] firmware.elf capture.txt
+# capture is whatever came out of serial port (other lines are skipped),
+# "-" reads stdin. Symbols come from nm of the toolchain, e.g.
+# -n xc32-nm for dist/default/production/badge-supercon18.X.production.elf,
+# plain nm for host/badge. -l N also lists N hottest addresses with
+# source lines (needs -g build and addr2line of the toolchain).
+
+import bisect
+import subprocess
+import sys
+
+
+def usage():
+    sys.stderr.write("usage: prof.py [-n nm] [-a addr2line] [-l N] firmware.elf capture.txt\n")
+    sys.exit(1)
+
+
+# function symbols sorted by address, (addr, size, name)
+def load_symbols(nm, elf):
+    out = subprocess.run([nm, "-n", "-S", "--defined-only", elf],
+                         stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+    syms = []
+    for line in out.splitlines():
+        f = line.split()
+        if len(f) == 4 and f[2] in "tTwW":
+            # bit 0 is ISA mode of MIPS16/microMIPS code, not part of address
+            syms.append((int(f[0], 16) & ~1, int(f[1], 16), f[3]))
+    return syms
+
+
+# histogram out of capture, counts of repeated sends are added up
+def load_capture(f):
+    hist = {}
+    info = ""
+    for line in f:
+        f = line.split()
+        if len(f) < 2 or f[0] != "PROF":
+            continue
+        if f[1] == "rate":
+            info = " ".join(f[1:])
+        elif len(f) == 3:
+            try:
+                pc = int(f[1], 16) & ~1
+                hist[pc] = hist.get(pc, 0) + int(f[2])
+            except ValueError:
+                pass
+    return info, hist
+
+
+def function_of(syms, addrs, pc):
+    i = bisect.bisect_right(addrs, pc) - 1
+    if i < 0:
+        return "?"
+    addr, size, name = syms[i]
+    if size and pc >= addr + size:
+        return "?"
+    return name
+
+
+def main(argv):
+    nm = "nm"
+    a2l = "addr2line"
+    lines = 0
+    args = []
+    i = 0
+    while i < len(argv):
+        if argv[i] in ("-n", "-a", "-l") and i + 1 < len(argv):
+            if argv[i] == "-n":
+                nm = argv[i + 1]
+            elif argv[i] == "-a":
+                a2l = argv[i + 1]
+            else:
+                lines = int(argv[i + 1])
+            i += 2
+        else:
+            args.append(argv[i])
+            i += 1
+    if len(args) != 2:
+        usage()
+    elf, cap = args
+    syms = load_symbols(nm, elf)
+    addrs = [s[0] for s in syms]
+    if cap == "-":
+        info, hist = load_capture(sys.stdin)
+    else:
+        with open(cap) as f:
+            info, hist = load_capture(f)
+    total = sum(hist.values())
+    if total == 0:
+        sys.stderr.write("no PROF samples in %s\n" % cap)
+        return 1
+    funcs = {}
+    for pc, n in hist.items():
+        name = function_of(syms, addrs, pc)
+        funcs[name] = funcs.get(name, 0) + n
+    print("%s, %d samples in histogram" % (info, total))
+    print("    %  samples  function")
+    for name, n in sorted(funcs.items(), key=lambda x: -x[1]):
+        print("%5.1f %8d  %s" % (100.0 * n / total, n, name))
+    if lines > 0:
+        top = sorted(hist.items(), key=lambda x: -x[1])[:lines]
+        out = subprocess.run([a2l, "-e", elf] + ["%x" % pc for pc, n in top],
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout.splitlines()
+        print()
+        print("    %  samples  address   source")
+        for k, (pc, n) in enumerate(top):
+            src = out[k] if k < len(out) else "?"
+            print("%5.1f %8d  %08x  %s  %s" % (100.0 * n / total, n, pc, src, function_of(syms, addrs, pc)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
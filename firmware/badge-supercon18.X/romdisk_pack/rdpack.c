@@ -0,0 +1,352 @@
+/*
+ * romdisk_pack - compress CP/M ROM disk images for the badge
+ *
+ * usage: rdpack [-s chunk_size] -o out.c name=input [name=input ...]
+ *        rdpack -x out.bin input
+ *        rdpack -u file.c:array image.bin
+ * input is either raw binary image, or file.c:array to take the hex
+ * bytes of array from C source (preprocessor lines are ignored, so
+ * images cut by #ifdef are taken whole)
+ * -x writes input as raw image, for cpmimg -b. -u puts raw image back
+ * into the array, each hex byte in its place, so layout and comments of
+ * the source stay as they are.
+ *
+ * Every chunk is compressed on its own, so the badge can decode only
+ * the chunk it needs. LZSS coder is the one from firmware, each packed
+ * image is decoded again and compared with the input.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "../src/Z80/rdz.h"
+
+#define	IMG_MAX		(1024*1024)
+
+static uint8_t * load_bin (const char * fname, uint32_t * len)
+{
+	FILE * f;
+	uint8_t * buf;
+	f = fopen(fname,"rb");
+	if (f==NULL) return NULL;
+	buf = malloc(IMG_MAX);
+	*len = fread(buf,1,IMG_MAX,f);
+	fclose(f);
+	return buf;
+}
+
+static uint8_t * load_c_array (const char * fname, const char * array, uint32_t * len)
+{
+	FILE * f;
+	char line[1024], * p, * q;
+	uint8_t * buf;
+	int inside = 0;
+	f = fopen(fname,"r");
+	if (f==NULL) return NULL;
+	buf = malloc(IMG_MAX);
+	*len = 0;
+	while (fgets(line,sizeof(line),f)!=NULL)
+		{
+		p = line;
+		while ((*p==' ')||(*p=='\t')) p++;
+		if (*p=='#') continue;
+		if (inside==0)
+			{
+			q = strstr(line,array);
+			if ((q==NULL)||(strchr(line,'{')==NULL)) continue;
+			q += strlen(array);
+			if ((*q!='[')&&(*q!=' ')&&(*q!='=')) continue;
+			inside = 1;
+			p = strchr(line,'{') + 1;
+			}
+		q = strstr(p,"//");
+		if (q!=NULL) *q = 0;
+		while (*p!=0)
+			{
+			if (*p=='}')
+				{
+				fclose(f);
+				return buf;
+				}
+			if ((p[0]=='0')&&((p[1]=='x')||(p[1]=='X')))
+				{
+				buf[(*len)++] = strtoul(p,&p,16);
+				if (*len>=IMG_MAX) break;
+				continue;
+				}
+			p++;
+			}
+		}
+	fclose(f);
+	if (inside==0)
+		{
+		free(buf);
+		return NULL;
+		}
+	return buf;
+}
+
+static uint8_t * load_input (char * input, uint32_t * len)
+{
+	char * arr;
+	arr = strrchr(input,':');
+	if (arr==NULL) return load_bin(input,len);
+	*arr++ = 0;
+	return load_c_array(input,arr,len);
+}
+
+//hex bytes of array are overwritten in the same case, rest of file copied
+static int update_c_array (char * input, const uint8_t * img, uint32_t len)
+{
+	FILE * f, * fo;
+	char line[1024], tmpname[1024], * arr, * p, * q, * c;
+	const char * hex = "0123456789ABCDEF";
+	uint32_t n = 0;
+	int inside = 0, done = 0, bad = 0;
+	arr = strrchr(input,':');
+	if (arr==NULL) return 1;
+	*arr++ = 0;
+	f = fopen(input,"r");
+	if (f==NULL) return 1;
+	snprintf(tmpname,sizeof(tmpname),"%s.new",input);
+	fo = fopen(tmpname,"w");
+	if (fo==NULL)
+		{
+		fclose(f);
+		return 1;
+		}
+	while (fgets(line,sizeof(line),f)!=NULL)
+		{
+		p = line;
+		while ((*p==' ')||(*p=='\t')) p++;
+		if ((done==0)&&(*p!='#'))
+			{
+			if (inside==0)
+				{
+				q = strstr(line,arr);
+				if ((q!=NULL)&&(strchr(line,'{')!=NULL))
+					{
+					q += strlen(arr);
+					if ((*q=='[')||(*q==' ')||(*q=='='))
+						{
+						inside = 1;
+						p = strchr(line,'{') + 1;
+						}
+					}
+				}
+			if (inside)
+				{
+				c = strstr(p,"//");
+				while ((*p!=0)&&(p!=c))
+					{
+					if (*p=='}')
+						{
+						done = 1;
+						break;
+						}
+					if ((p[0]=='0')&&((p[1]=='x')||(p[1]=='X')))
+						{
+						q = p + 2;
+						while (isxdigit((unsigned char)*q))
+							{
+							if (isalpha((unsigned char)*q)) hex = islower((unsigned char)*q) ? "0123456789abcdef" : "0123456789ABCDEF";
+							q++;
+							}
+						//other widths aren't written by anything that makes images
+						if (q-p!=4)
+							{
+							bad = 1;
+							break;
+							}
+						if (n<len)
+							{
+							p[2] = hex[img[n]>>4];
+							p[3] = hex[img[n]&0x0F];
+							}
+						n++;
+						p = q;
+						continue;
+						}
+					p++;
+					}
+				}
+			}
+		fputs(line,fo);
+		}
+	fclose(f);
+	fclose(fo);
+	if ((done==0)||(bad)||(n!=len))
+		{
+		remove(tmpname);
+		return 1;
+		}
+	return rename(tmpname,input);
+}
+
+static uint32_t pack_image (const uint8_t * in, uint32_t len, uint16_t chunk_size, uint8_t * out, uint32_t * n_type)
+{
+	uint32_t chunks,c,o,i,n;
+	uint8_t * tmp;
+	const uint8_t * src;
+	chunks = (len + chunk_size - 1)/chunk_size;
+	//worst case LZSS output is 9/8 of input
+	tmp = malloc(chunk_size*3);
+	out[0] = chunk_size&0xFF;
+	out[1] = chunk_size>>8;
+	out[2] = chunks&0xFF;
+	out[3] = chunks>>8;
+	o = RDZ_HDR_LEN + (chunks+1)*4;
+	for (c=0;c<chunks;c++)
+		{
+		out[RDZ_HDR_LEN+c*4+0] = o;
+		out[RDZ_HDR_LEN+c*4+1] = o>>8;
+		out[RDZ_HDR_LEN+c*4+2] = o>>16;
+		out[RDZ_HDR_LEN+c*4+3] = o>>24;
+		src = in + c*chunk_size;
+		//last chunk is padded with 0xE5, the same as empty CP/M disk
+		memset(tmp,0xE5,chunk_size);
+		memcpy(tmp,src,(len-c*chunk_size<chunk_size)?(len-c*chunk_size):chunk_size);
+		for (i=1;(i<chunk_size)&&(tmp[i]==tmp[0]);i++);
+		if (i==chunk_size)
+			{
+			out[o++] = RDZ_CHUNK_FILL;
+			out[o++] = tmp[0];
+			n_type[RDZ_CHUNK_FILL]++;
+			continue;
+			}
+		n = rdz_lzss_encode(tmp,chunk_size,tmp+chunk_size,chunk_size-1);
+		if (n>0)
+			{
+			out[o++] = RDZ_CHUNK_LZSS;
+			memcpy(out+o,tmp+chunk_size,n);
+			o += n;
+			n_type[RDZ_CHUNK_LZSS]++;
+			}
+		else
+			{
+			out[o++] = RDZ_CHUNK_RAW;
+			memcpy(out+o,tmp,chunk_size);
+			o += chunk_size;
+			n_type[RDZ_CHUNK_RAW]++;
+			}
+		}
+	out[RDZ_HDR_LEN+c*4+0] = o;
+	out[RDZ_HDR_LEN+c*4+1] = o>>8;
+	out[RDZ_HDR_LEN+c*4+2] = o>>16;
+	out[RDZ_HDR_LEN+c*4+3] = o>>24;
+	free(tmp);
+	return o;
+}
+
+static int verify_image (const uint8_t * in, uint32_t len, const uint8_t * packed)
+{
+	uint8_t buf[RDZ_CHUNK_MAX];
+	uint16_t c,size;
+	uint32_t i,addr;
+	size = rdz_chunk_size(packed);
+	for (c=0;c<rdz_chunk_count(packed);c++)
+		{
+		if (rdz_decode_chunk(packed,c,buf)!=size) return 1;
+		for (i=0;i<size;i++)
+			{
+			addr = ((uint32_t)(c))*size + i;
+			if ((addr<len)&&(buf[i]!=in[addr])) return 1;
+			}
+		}
+	return 0;
+}
+
+int main (int argc, char * argv[])
+{
+	FILE * fo;
+	char * outname = NULL, * name, * input;
+	uint8_t * img, * packed;
+	uint32_t len, plen, i, n_type[3];
+	uint16_t chunk_size = RDZ_CHUNK_MAX;
+	int a;
+	if ((argc==4)&&(strcmp(argv[1],"-x")==0))
+		{
+		img = load_input(argv[3],&len);
+		fo = fopen(argv[2],"wb");
+		if ((img==NULL)||(len==0)||(fo==NULL)||(fwrite(img,1,len,fo)!=len))
+			{
+			fprintf(stderr,"can't write %s from %s\n",argv[2],argv[3]);
+			return 1;
+			}
+		fclose(fo);
+		return 0;
+		}
+	if ((argc==4)&&(strcmp(argv[1],"-u")==0))
+		{
+		img = load_bin(argv[3],&len);
+		if ((img==NULL)||(update_c_array(argv[2],img,len)))
+			{
+			fprintf(stderr,"can't put %s into %s, array has to be as long as image\n",argv[3],argv[2]);
+			return 1;
+			}
+		return 0;
+		}
+	for (a=1;a<argc;a++)
+		{
+		if ((strcmp(argv[a],"-s")==0)&&(a+1<argc)) chunk_size = atoi(argv[++a]);
+		else if ((strcmp(argv[a],"-o")==0)&&(a+1<argc)) outname = argv[++a];
+		else break;
+		}
+	if ((outname==NULL)||(a>=argc))
+		{
+		fprintf(stderr,"usage: rdpack [-s chunk_size] -o out.c name=image.bin|name=file.c:array ...\n");
+		fprintf(stderr,"       rdpack -x out.bin image.bin|file.c:array\n");
+		fprintf(stderr,"       rdpack -u file.c:array image.bin\n");
+		return 1;
+		}
+	if ((chunk_size<128)||(chunk_size>RDZ_CHUNK_MAX)||(chunk_size%128))
+		{
+		fprintf(stderr,"chunk size has to be multiple of 128, up to %d\n",RDZ_CHUNK_MAX);
+		return 1;
+		}
+	fo = fopen(outname,"w");
+	if (fo==NULL)
+		{
+		fprintf(stderr,"can't open %s\n",outname);
+		return 1;
+		}
+	fprintf(fo,"//generated by romdisk_pack, do not edit\n");
+	fprintf(fo,"#include \"hwz.h\"\n\n#ifdef\tUSE_ROMDISK_COMPRESSED\n\n");
+	packed = malloc(IMG_MAX*2);
+	for (;a<argc;a++)
+		{
+		name = argv[a];
+		input = strchr(name,'=');
+		if (input==NULL)
+			{
+			fprintf(stderr,"bad argument %s\n",name);
+			return 1;
+			}
+		*input++ = 0;
+		img = load_input(input,&len);
+		if ((img==NULL)||(len==0))
+			{
+			fprintf(stderr,"can't load %s\n",input);
+			return 1;
+			}
+		memset(n_type,0,sizeof(n_type));
+		plen = pack_image(img,len,chunk_size,packed,n_type);
+		if (verify_image(img,len,packed))
+			{
+			fprintf(stderr,"%s: verification failed\n",name);
+			return 1;
+			}
+		printf("%s: %u -> %u bytes, %u LZSS, %u fill, %u raw chunks\n",name,len,plen,n_type[RDZ_CHUNK_LZSS],n_type[RDZ_CHUNK_FILL],n_type[RDZ_CHUNK_RAW]);
+		fprintf(fo,"//%u bytes in %u chunks of %u\n",len,(len+chunk_size-1)/chunk_size,chunk_size);
+		fprintf(fo,"const unsigned char %s[%u] = {\n",name,plen);
+		for (i=0;i<plen;i++)
+			fprintf(fo,"0x%02X%s",packed[i],(i==plen-1)?"\n":(((i%16)==15)?",\n":","));
+		fprintf(fo,"};\n\n");
+		free(img);
+		}
+	fprintf(fo,"#endif\n");
+	fclose(fo);
+	free(packed);
+	return 0;
+}
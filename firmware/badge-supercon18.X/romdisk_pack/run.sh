@@ -0,0 +1,2 @@
+gcc -O2 -o rdpack rdpack.c ../src/Z80/rdz.c
+./rdpack -o rd_images_z.c rdz_image=../src/images.c:rd_image rdz_image2=../src/images.c:rd_image2
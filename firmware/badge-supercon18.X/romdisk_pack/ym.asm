@@ -0,0 +1,57 @@
+; YM.COM - YMODEM-1K file transfer over serial port of the badge
+; YM R [d:]            receive batch of files into drive d (current one by default)
+; YM S [d:]name.ext    send file
+; transfer itself runs in firmware (src/Z80/ymodem.c), this only passes
+; FCB and user number through port 0Dh, see ymodem.h
+
+	org	100h
+bdos	equ	5
+fcb1	equ	5ch
+fcb2	equ	6ch
+ymport	equ	0dh
+
+start:	ld	a,(fcb1+1)
+	cp	'R'
+	jr	z,ok
+	cp	'S'
+	jr	z,ok
+	ld	de,usage
+	ld	c,9
+	jp	bdos
+ok:	ld	de,msg
+	ld	c,9
+	call	bdos
+; drive byte of FCB, current drive when not given
+	ld	c,25
+	call	bdos
+	inc	a
+	ld	b,a
+	ld	a,(fcb2)
+	or	a
+	jr	nz,drv
+	ld	a,b
+	ld	(fcb2),a
+; user number goes in B
+drv:	ld	e,0ffh
+	ld	c,32
+	call	bdos
+	ld	b,a
+	ld	de,fcb2
+	ld	a,(fcb1+1)
+	cp	'R'
+	ld	a,1
+	jr	z,go
+	ld	a,2
+go:	out	(ymport),a
+	in	a,(ymport)
+	or	a
+	jr	z,done
+	ld	de,err
+	ld	c,9
+	call	bdos
+; warm boot, so BDOS reads directory again
+done:	jp	0
+
+usage:	db	'YM R [d:]  receive files',13,10,'YM S [d:]name.ext  send file',13,10,'$'
+msg:	db	'YMODEM on serial port, BRK cancels',13,10,'$'
+err:	db	'Transfer failed',13,10,'$'
@@ -0,0 +1,10 @@
+# ym.com (ym.asm assembled) onto drive B: of ../src/images.c, then packed as run.sh does
+gcc -O2 -o rdpack rdpack.c ../src/Z80/rdz.c || exit 1
+make -C ../host cpmimg || exit 1
+./rdpack -x b.bin ../src/images.c:rd_image || exit 1
+../host/cpmimg -b b.bin rm b:ym.com 2>/dev/null
+../host/cpmimg -b b.bin put b: ym.com || exit 1
+./rdpack -u ../src/images.c:rd_image b.bin || exit 1
+rm b.bin
+sh run.sh
+cp rd_images_z.c ../src/Z80
@@ -0,0 +1,407 @@
+#include "cpmfs.h"
+
+static uint32_t cpmfs_dir_sect (struct cpmfs * fs, uint16_t idx)
+{
+return (((uint32_t)(fs->off))*fs->spt) + (idx/(CPMFS_SECT_SIZE/CPMFS_DIRENT_SIZE));
+}
+
+static uint32_t cpmfs_blk_sect (struct cpmfs * fs, uint16_t blk)
+{
+return (((uint32_t)(fs->off))*fs->spt) + (((uint32_t)(blk))<<fs->bsh);
+}
+
+//records held by one directory entry
+static uint32_t cpmfs_ent_recs (struct cpmfs * fs)
+{
+return ((uint32_t)(fs->exm)+1)*128;
+}
+
+static uint16_t cpmfs_get_blk (struct cpmfs * fs, uint8_t * ent, uint8_t i)
+{
+if (fs->dsm>255) return ent[16+(i*2)] | (((uint16_t)(ent[17+(i*2)]))<<8);
+return ent[16+i];
+}
+
+static void cpmfs_set_blk (struct cpmfs * fs, uint8_t * ent, uint8_t i, uint16_t blk)
+{
+if (fs->dsm>255)
+	{
+	ent[16+(i*2)] = blk&0xFF;
+	ent[17+(i*2)] = blk>>8;
+	}
+else
+	ent[16+i] = blk;
+}
+
+static uint8_t cpmfs_ent_ptrs (struct cpmfs * fs)
+{
+return (fs->dsm>255) ? 8 : 16;
+}
+
+static uint16_t cpmfs_ent_ext (uint8_t * ent)
+{
+return (ent[12]&0x1F) | (((uint16_t)(ent[14]&0x3F))<<5);
+}
+
+static uint8_t cpmfs_dir_read (struct cpmfs * fs, uint16_t idx, uint8_t * ent)
+{
+uint8_t buf[CPMFS_SECT_SIZE],i;
+if (fs->read(fs->ctx,cpmfs_dir_sect(fs,idx),buf)) return CPMFS_ERR_IO;
+for (i=0;i<CPMFS_DIRENT_SIZE;i++) ent[i] = buf[((idx%4)*CPMFS_DIRENT_SIZE)+i];
+return CPMFS_OK;
+}
+
+static uint8_t cpmfs_dir_write (struct cpmfs * fs, uint16_t idx, uint8_t * ent)
+{
+uint8_t buf[CPMFS_SECT_SIZE],i;
+if (fs->read(fs->ctx,cpmfs_dir_sect(fs,idx),buf)) return CPMFS_ERR_IO;
+for (i=0;i<CPMFS_DIRENT_SIZE;i++) buf[((idx%4)*CPMFS_DIRENT_SIZE)+i] = ent[i];
+if (fs->write(fs->ctx,cpmfs_dir_sect(fs,idx),buf)) return CPMFS_ERR_IO;
+return CPMFS_OK;
+}
+
+static uint8_t cpmfs_match (uint8_t * ent, uint8_t user, const uint8_t * name)
+{
+uint8_t i;
+if (ent[0]!=user) return 0;
+for (i=0;i<11;i++)
+	if ((ent[1+i]&0x7F)!=name[i]) return 0;
+return 1;
+}
+
+static void cpmfs_mark (struct cpmfs * fs, uint16_t blk)
+{
+if (blk<=fs->dsm) fs->alloc[blk/8] |= 1<<(blk%8);
+}
+
+//build allocation bitmap from directory, the same way BDOS does on login
+static uint8_t cpmfs_scan (struct cpmfs * fs)
+{
+uint8_t ent[CPMFS_DIRENT_SIZE],i;
+uint16_t idx,blk;
+for (blk=0;blk<sizeof(fs->alloc);blk++) fs->alloc[blk] = 0;
+for (blk=0;blk<16;blk++)
+	if (fs->al&(0x8000>>blk)) cpmfs_mark(fs,blk);
+for (blk=0;blk<=fs->dsm;blk++)
+	if ((cpmfs_blk_sect(fs,blk)+(1UL<<fs->bsh))>fs->sects) cpmfs_mark(fs,blk);
+for (idx=0;idx<=fs->drm;idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,ent)) return CPMFS_ERR_IO;
+	if (ent[0]>=32) continue;
+	for (i=0;i<cpmfs_ent_ptrs(fs);i++)
+		{
+		blk = cpmfs_get_blk(fs,ent,i);
+		if (blk!=0) cpmfs_mark(fs,blk);
+		}
+	}
+return CPMFS_OK;
+}
+
+//read and write callbacks and ctx have to be set before
+uint8_t cpmfs_init (struct cpmfs * fs, const uint8_t * dpb, uint32_t sects)
+{
+fs->spt = dpb[0] | (((uint16_t)(dpb[1]))<<8);
+fs->bsh = dpb[2];
+fs->blm = dpb[3];
+fs->exm = dpb[4];
+fs->dsm = dpb[5] | (((uint16_t)(dpb[6]))<<8);
+fs->drm = dpb[7] | (((uint16_t)(dpb[8]))<<8);
+fs->al = (((uint16_t)(dpb[9]))<<8) | dpb[10];
+fs->off = dpb[13] | (((uint16_t)(dpb[14]))<<8);
+fs->sects = sects;
+if ((fs->spt==0)||(fs->dsm>=CPMFS_MAX_BLOCKS)) return CPMFS_ERR_IO;
+return cpmfs_scan(fs);
+}
+
+uint8_t cpmfs_format (struct cpmfs * fs)
+{
+uint8_t buf[CPMFS_SECT_SIZE];
+uint16_t i;
+for (i=0;i<CPMFS_SECT_SIZE;i++) buf[i] = CPMFS_FREE;
+for (i=0;i<((fs->drm+1)/(CPMFS_SECT_SIZE/CPMFS_DIRENT_SIZE));i++)
+	if (fs->write(fs->ctx,cpmfs_dir_sect(fs,i*(CPMFS_SECT_SIZE/CPMFS_DIRENT_SIZE)),buf)) return CPMFS_ERR_IO;
+return cpmfs_scan(fs);
+}
+
+//characters CCP won't accept in file names
+static uint8_t cpmfs_bad_char (char c)
+{
+const char * bad = "<>.,;:=?*[]|/\\";
+if ((c<=' ')||(c>=0x7F)) return 1;
+while (*bad!=0)
+	if (*bad++==c) return 1;
+return 0;
+}
+
+//convert "NAME.EXT" to 11 bytes of directory entry
+uint8_t cpmfs_name (const char * str, uint8_t * name)
+{
+uint8_t i,n;
+char c;
+for (i=0;i<11;i++) name[i] = ' ';
+for (i=0,n=0;(*str!=0)&&(*str!='.');str++,n++)
+	{
+	c = *str;
+	if ((c>='a')&&(c<='z')) c = c - 'a' + 'A';
+	if ((n>=8)||(cpmfs_bad_char(c))) return CPMFS_ERR_NAME;
+	name[i++] = c;
+	}
+if (n==0) return CPMFS_ERR_NAME;
+if (*str=='.') str++;
+for (i=8,n=0;*str!=0;str++,n++)
+	{
+	c = *str;
+	if ((c>='a')&&(c<='z')) c = c - 'a' + 'A';
+	if ((n>=3)||(cpmfs_bad_char(c))) return CPMFS_ERR_NAME;
+	name[i++] = c;
+	}
+return CPMFS_OK;
+}
+
+//back to "NAME.EXT", str has to hold 13 bytes
+void cpmfs_name_str (const uint8_t * name, char * str)
+{
+uint8_t i;
+for (i=0;(i<8)&&((name[i]&0x7F)!=' ');i++) *str++ = name[i]&0x7F;
+if ((name[8]&0x7F)!=' ')
+	{
+	*str++ = '.';
+	for (i=8;(i<11)&&((name[i]&0x7F)!=' ');i++) *str++ = name[i]&0x7F;
+	}
+*str = 0;
+}
+
+//size of file in records, from the entry with highest extent number
+static uint32_t cpmfs_size (struct cpmfs * fs, uint8_t user, const uint8_t * name, uint8_t * found)
+{
+uint8_t ent[CPMFS_DIRENT_SIZE];
+uint16_t idx;
+uint32_t recs,size = 0;
+*found = 0;
+for (idx=0;idx<=fs->drm;idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,ent)) return 0;
+	if (cpmfs_match(ent,user,name)==0) continue;
+	*found = 1;
+	recs = (((uint32_t)(cpmfs_ent_ext(ent)))*128) + ((ent[15]>128)?128:ent[15]);
+	if (recs>size) size = recs;
+	}
+return size;
+}
+
+//find next file starting at directory entry idx, returns entry index or -1
+//every file is reported once, by its first extent
+int16_t cpmfs_next (struct cpmfs * fs, int16_t idx, uint8_t * user, uint8_t * name, uint32_t * size)
+{
+uint8_t ent[CPMFS_DIRENT_SIZE],i,found;
+for (;idx<=((int16_t)(fs->drm));idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,ent)) return -1;
+	if ((ent[0]>=16)||((cpmfs_ent_ext(ent)&~((uint16_t)(fs->exm)))!=0)) continue;
+	*user = ent[0];
+	for (i=0;i<11;i++) name[i] = ent[1+i]&0x7F;
+	*size = cpmfs_size(fs,*user,name,&found)*CPMFS_SECT_SIZE;
+	return idx;
+	}
+return -1;
+}
+
+uint8_t cpmfs_open (struct cpmfs * fs, struct cpmfs_file * f, uint8_t user, const uint8_t * name)
+{
+uint8_t i,found;
+f->fs = fs;
+f->user = user;
+for (i=0;i<11;i++) f->name[i] = name[i];
+f->dir_idx = -1;
+f->rec = 0;
+f->size = cpmfs_size(fs,user,name,&found);
+if (found==0) return CPMFS_ERR_NOFILE;
+return CPMFS_OK;
+}
+
+//find directory entry holding record f->rec
+static uint8_t cpmfs_seek (struct cpmfs_file * f)
+{
+struct cpmfs * fs = f->fs;
+uint16_t idx,grp;
+grp = f->rec/cpmfs_ent_recs(fs);
+if ((f->dir_idx>=0)&&((cpmfs_ent_ext(f->dirent)/(fs->exm+1))==grp)) return CPMFS_OK;
+for (idx=0;idx<=fs->drm;idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,f->dirent)) return CPMFS_ERR_IO;
+	if (cpmfs_match(f->dirent,f->user,f->name)==0) continue;
+	if ((cpmfs_ent_ext(f->dirent)/(fs->exm+1))!=grp) continue;
+	f->dir_idx = idx;
+	return CPMFS_OK;
+	}
+f->dir_idx = -1;
+return CPMFS_ERR_NOFILE;
+}
+
+//read next record, CPMFS_ERR_NOFILE at end of file
+uint8_t cpmfs_read (struct cpmfs_file * f, uint8_t * data)
+{
+struct cpmfs * fs = f->fs;
+uint32_t offs = 0;
+uint16_t blk,i;
+uint8_t ret;
+if (f->rec>=f->size) return CPMFS_ERR_NOFILE;
+ret = cpmfs_seek(f);
+blk = 0;
+if (ret==CPMFS_OK)
+	{
+	offs = f->rec%cpmfs_ent_recs(fs);
+	blk = cpmfs_get_blk(fs,f->dirent,offs>>fs->bsh);
+	}
+else if (ret!=CPMFS_ERR_NOFILE)
+	return ret;
+f->rec++;
+//hole in sparse file
+if ((blk==0)||(blk>fs->dsm))
+	{
+	for (i=0;i<CPMFS_SECT_SIZE;i++) data[i] = CPMFS_FREE;
+	return CPMFS_OK;
+	}
+if (fs->read(fs->ctx,cpmfs_blk_sect(fs,blk)+(offs&fs->blm),data)) return CPMFS_ERR_IO;
+return CPMFS_OK;
+}
+
+//remove file of given name, if there is one
+uint8_t cpmfs_delete (struct cpmfs * fs, uint8_t user, const uint8_t * name)
+{
+uint8_t ent[CPMFS_DIRENT_SIZE],found = 0;
+uint16_t idx;
+for (idx=0;idx<=fs->drm;idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,ent)) return CPMFS_ERR_IO;
+	if (cpmfs_match(ent,user,name)==0) continue;
+	ent[0] = CPMFS_FREE;
+	if (cpmfs_dir_write(fs,idx,ent)) return CPMFS_ERR_IO;
+	found = 1;
+	}
+if (found==0) return CPMFS_ERR_NOFILE;
+return cpmfs_scan(fs);
+}
+
+//start new file, replacing old one of the same name
+uint8_t cpmfs_create (struct cpmfs * fs, struct cpmfs_file * f, uint8_t user, const uint8_t * name)
+{
+uint8_t i,ret;
+ret = cpmfs_delete(fs,user,name);
+if ((ret!=CPMFS_OK)&&(ret!=CPMFS_ERR_NOFILE)) return ret;
+f->fs = fs;
+f->user = user;
+for (i=0;i<11;i++) f->name[i] = name[i];
+f->dir_idx = -1;
+f->rec = 0;
+f->size = 0;
+return CPMFS_OK;
+}
+
+//write directory entry of records written so far
+static uint8_t cpmfs_flush (struct cpmfs_file * f)
+{
+struct cpmfs * fs = f->fs;
+uint32_t n;
+uint16_t ext;
+if (f->dir_idx<0) return CPMFS_OK;
+ext = (cpmfs_ent_ext(f->dirent)/(fs->exm+1))*(fs->exm+1);
+n = f->rec - ((uint32_t)(ext))*128;
+if (n>0) ext += (n-1)/128;
+f->dirent[12] = ext&0x1F;
+f->dirent[14] = ext>>5;
+f->dirent[15] = (n>0) ? (n-(((n-1)/128)*128)) : 0;
+return cpmfs_dir_write(fs,f->dir_idx,f->dirent);
+}
+
+//take free directory entry for file f, extent ext
+static uint8_t cpmfs_new_entry (struct cpmfs_file * f, uint16_t ext)
+{
+struct cpmfs * fs = f->fs;
+uint8_t ent[CPMFS_DIRENT_SIZE],i;
+uint16_t idx;
+for (idx=0;idx<=fs->drm;idx++)
+	{
+	if (cpmfs_dir_read(fs,idx,ent)) return CPMFS_ERR_IO;
+	if (ent[0]==CPMFS_FREE) break;
+	}
+if (idx>fs->drm) return CPMFS_ERR_DIRFULL;
+for (i=0;i<CPMFS_DIRENT_SIZE;i++) f->dirent[i] = 0;
+f->dirent[0] = f->user;
+for (i=0;i<11;i++) f->dirent[1+i] = f->name[i];
+f->dirent[12] = ext&0x1F;
+f->dirent[14] = ext>>5;
+f->dir_idx = idx;
+return cpmfs_dir_write(fs,idx,f->dirent);
+}
+
+static void cpmfs_unmark (struct cpmfs * fs, uint16_t blk)
+{
+if (blk<=fs->dsm) fs->alloc[blk/8] &= ~(1<<(blk%8));
+}
+
+static uint16_t cpmfs_alloc_blk (struct cpmfs * fs)
+{
+uint16_t blk;
+for (blk=0;blk<=fs->dsm;blk++)
+	if ((fs->alloc[blk/8]&(1<<(blk%8)))==0)
+		{
+		cpmfs_mark(fs,blk);
+		return blk;
+		}
+return 0;
+}
+
+//append one record to file opened by cpmfs_create
+uint8_t cpmfs_write (struct cpmfs_file * f, uint8_t * data)
+{
+struct cpmfs * fs = f->fs;
+uint32_t offs;
+uint16_t blk,grp;
+uint8_t ret;
+grp = f->rec/cpmfs_ent_recs(fs);
+offs = f->rec%cpmfs_ent_recs(fs);
+if ((f->dir_idx<0)||(offs==0))
+	{
+	//next entry is taken only when there is block for it
+	ret = cpmfs_flush(f);
+	if (ret) return ret;
+	blk = cpmfs_alloc_blk(fs);
+	if (blk==0) return CPMFS_ERR_DISKFULL;
+	ret = cpmfs_new_entry(f,grp*(fs->exm+1));
+	if (ret)
+		{
+		cpmfs_unmark(fs,blk);
+		return ret;
+		}
+	cpmfs_set_blk(fs,f->dirent,0,blk);
+	}
+blk = cpmfs_get_blk(fs,f->dirent,offs>>fs->bsh);
+if (blk==0)
+	{
+	blk = cpmfs_alloc_blk(fs);
+	if (blk==0) return CPMFS_ERR_DISKFULL;
+	cpmfs_set_blk(fs,f->dirent,offs>>fs->bsh,blk);
+	}
+if (fs->write(fs->ctx,cpmfs_blk_sect(fs,blk)+(offs&fs->blm),data)) return CPMFS_ERR_IO;
+f->rec++;
+f->size = f->rec;
+return CPMFS_OK;
+}
+
+uint8_t cpmfs_close (struct cpmfs_file * f)
+{
+//empty file still needs its directory entry
+if ((f->dir_idx<0)&&(f->rec==0)) return cpmfs_new_entry(f,0);
+return cpmfs_flush(f);
+}
+
+//free space in bytes
+uint32_t cpmfs_free (struct cpmfs * fs)
+{
+uint16_t blk;
+uint32_t n = 0;
+for (blk=0;blk<=fs->dsm;blk++)
+	if ((fs->alloc[blk/8]&(1<<(blk%8)))==0) n++;
+return n<<(fs->bsh+7);
+}
@@ -0,0 +1,80 @@
+#ifndef		__CPMFS_H
+#define		__CPMFS_H
+
+#include <stdint.h>
+
+/*
+ * Minimal CP/M 2.2 file system, works on any drive described by DPB
+ * through sector read/write callbacks. Used by host tools to build disk
+ * images and by firmware to move files in and out of CP/M drives.
+ * Sector numbers passed to callbacks are linear, track*SPT+sector,
+ * the same way BIOS of the badge maps them.
+ *
+ * directory entry:
+ * 0		user number, 0xE5 for free entry
+ * 1..11	name and extension, bit 7 holds attributes
+ * 12		extent number, low 5 bits
+ * 14		extent number, high bits (S2)
+ * 15		record count of last logical extent in entry
+ * 16..31	allocation blocks, 8 bits if DSM<256, 16 bits otherwise
+ */
+
+#define		CPMFS_SECT_SIZE		128
+#define		CPMFS_DIRENT_SIZE	32
+#define		CPMFS_FREE			0xE5
+#define		CPMFS_DPB_LEN		15
+//largest DSM supported, allocation bitmap takes (CPMFS_MAX_BLOCKS/8) bytes
+#define		CPMFS_MAX_BLOCKS	1024
+
+//return values
+#define		CPMFS_OK			0
+#define		CPMFS_ERR_IO		1
+#define		CPMFS_ERR_NOFILE	2
+#define		CPMFS_ERR_DIRFULL	3
+#define		CPMFS_ERR_DISKFULL	4
+#define		CPMFS_ERR_NAME		5
+
+struct cpmfs
+{
+	uint16_t spt;
+	uint8_t bsh;
+	uint8_t blm;
+	uint8_t exm;
+	uint16_t dsm;
+	uint16_t drm;
+	uint16_t al;
+	uint16_t off;
+	//number of sectors actually backed by medium, blocks past it are never allocated
+	uint32_t sects;
+	uint8_t (*read)(void * ctx, uint32_t sect, uint8_t * data);
+	uint8_t (*write)(void * ctx, uint32_t sect, uint8_t * data);
+	void * ctx;
+	uint8_t alloc[CPMFS_MAX_BLOCKS/8];
+};
+
+//file opened for reading or writing, records are accessed in sequence
+struct cpmfs_file
+{
+	struct cpmfs * fs;
+	uint8_t user;
+	uint8_t name[11];
+	uint8_t dirent[CPMFS_DIRENT_SIZE];
+	int16_t dir_idx;
+	uint32_t rec;
+	uint32_t size;
+};
+
+uint8_t cpmfs_init (struct cpmfs * fs, const uint8_t * dpb, uint32_t sects);
+uint8_t cpmfs_format (struct cpmfs * fs);
+uint8_t cpmfs_name (const char * str, uint8_t * name);
+void cpmfs_name_str (const uint8_t * name, char * str);
+int16_t cpmfs_next (struct cpmfs * fs, int16_t idx, uint8_t * user, uint8_t * name, uint32_t * size);
+uint8_t cpmfs_open (struct cpmfs * fs, struct cpmfs_file * f, uint8_t user, const uint8_t * name);
+uint8_t cpmfs_read (struct cpmfs_file * f, uint8_t * data);
+uint8_t cpmfs_create (struct cpmfs * fs, struct cpmfs_file * f, uint8_t user, const uint8_t * name);
+uint8_t cpmfs_write (struct cpmfs_file * f, uint8_t * data);
+uint8_t cpmfs_close (struct cpmfs_file * f);
+uint8_t cpmfs_delete (struct cpmfs * fs, uint8_t user, const uint8_t * name);
+uint32_t cpmfs_free (struct cpmfs * fs);
+
+#endif
@@ -0,0 +1,266 @@
+#include "ftl.h"
+#include <plib.h>
+#include "hwz.h"
+#include "sim.h"
+#include "simglb.h"
+
+#ifdef	CPM_FTL
+
+uint16_t ftl_map[FTL_SECTORS];
+uint32_t ftl_seq[FTL_BLOCKS], ftl_ec[FTL_BLOCKS];
+uint8_t ftl_valid[FTL_BLOCKS], ftl_state[FTL_BLOCKS];
+uint8_t ftl_hdr[FTL_HDR_LEN], ftl_buff[FTL_SECT_SIZE];
+uint8_t ftl_mounted, ftl_cur_blk, ftl_cur_slot, ftl_free;
+uint32_t ftl_seq_max, ftl_erases, ftl_gc_runs;
+
+static uint32_t ftl_get32 (uint8_t * p)
+{
+return ((uint32_t)(p[0])) | (((uint32_t)(p[1]))<<8) | (((uint32_t)(p[2]))<<16) | (((uint32_t)(p[3]))<<24);
+}
+
+static void ftl_put32 (uint8_t * p, uint32_t val)
+{
+p[0] = val;
+p[1] = val>>8;
+p[2] = val>>16;
+p[3] = val>>24;
+}
+
+static uint32_t ftl_blk_addr (uint8_t blk)
+{
+return FTL_BASE + (((uint32_t)(blk))*4096UL);
+}
+
+static uint32_t ftl_phys_addr (uint16_t phys)
+{
+return FTL_BASE + (((uint32_t)(phys))*FTL_SECT_SIZE);
+}
+
+//erase block and write header of free block, keeping its erase count
+static void ftl_erase_blk (uint8_t blk)
+{
+uint8_t i,hdr[12];
+fl_erase_4k(ftl_blk_addr(blk));
+ftl_ec[blk]++;
+ftl_erases++;
+for (i=0;i<12;i++) hdr[i] = 0xFF;
+ftl_put32(hdr,FTL_MAGIC);
+ftl_put32(hdr+8,ftl_ec[blk]);
+fl_write_page(ftl_blk_addr(blk),hdr,12);
+ftl_seq[blk] = 0xFFFFFFFF;
+ftl_valid[blk] = 0;
+ftl_state[blk] = FTL_BLK_FREE;
+}
+
+//mark slot as stale by programming its tag to zero
+static void ftl_kill (uint16_t phys)
+{
+uint8_t blk,slot;
+uint8_t zero[2] = {0,0};
+blk = phys/FTL_SLOTS;
+slot = phys%FTL_SLOTS;
+fl_write_page(ftl_blk_addr(blk)+FTL_HDR_TAGS+((slot-1)*2),zero,2);
+ftl_valid[blk]--;
+}
+
+//take least worn free block as new active one
+static void ftl_open_blk (void)
+{
+uint8_t i,blk = 0xFF, seq[4];
+for (i=0;i<FTL_BLOCKS;i++)
+	{
+	if (ftl_state[i]==FTL_BLK_USED) continue;
+	if ((blk==0xFF)||(ftl_ec[i]<ftl_ec[blk])) blk = i;
+	}
+if (ftl_state[blk]==FTL_BLK_RAW) ftl_erase_blk(blk);
+ftl_seq_max++;
+ftl_put32(seq,ftl_seq_max);
+fl_write_page(ftl_blk_addr(blk)+4,seq,4);
+ftl_seq[blk] = ftl_seq_max;
+ftl_state[blk] = FTL_BLK_USED;
+ftl_free--;
+ftl_cur_blk = blk;
+ftl_cur_slot = 1;
+}
+
+//append sector to the log: data first, tag next, then old copy is marked stale
+static void ftl_append (uint16_t lsn, uint8_t * data)
+{
+uint16_t phys,tag;
+uint8_t tg[2];
+if (ftl_cur_slot>=FTL_SLOTS) ftl_open_blk();
+phys = (((uint16_t)(ftl_cur_blk))*FTL_SLOTS) + ftl_cur_slot;
+fl_write_page(ftl_phys_addr(phys),data,FTL_SECT_SIZE);
+tag = lsn + 1;
+tg[0] = tag;
+tg[1] = tag>>8;
+fl_write_page(ftl_blk_addr(ftl_cur_blk)+FTL_HDR_TAGS+((ftl_cur_slot-1)*2),tg,2);
+ftl_valid[ftl_cur_blk]++;
+ftl_cur_slot++;
+if (ftl_map[lsn]!=FTL_UNMAPPED) ftl_kill(ftl_map[lsn]);
+ftl_map[lsn] = phys;
+}
+
+//pick victim block: least valid sectors, less worn one on tie
+//every FTL_WL_PERIOD erases the coldest block is moved, if wear spread grows too big
+static uint8_t ftl_victim (void)
+{
+uint8_t i,blk = 0xFF, cold = 0xFF;
+uint32_t ec_max = 0;
+for (i=0;i<FTL_BLOCKS;i++)
+	{
+	if (ftl_ec[i]>ec_max) ec_max = ftl_ec[i];
+	if ((ftl_state[i]!=FTL_BLK_USED)||(i==ftl_cur_blk)) continue;
+	if ((cold==0xFF)||(ftl_ec[i]<ftl_ec[cold])) cold = i;
+	if ((blk==0xFF)||(ftl_valid[i]<ftl_valid[blk])) blk = i;
+	else if ((ftl_valid[i]==ftl_valid[blk])&&(ftl_ec[i]<ftl_ec[blk])) blk = i;
+	}
+if ((cold!=0xFF)&&((ftl_erases%FTL_WL_PERIOD)==0)&&((ec_max-ftl_ec[cold])>FTL_WL_DELTA))
+	blk = cold;
+return blk;
+}
+
+//relocate valid sectors of one block and erase it
+static void ftl_gc_step (uint8_t blk)
+{
+uint8_t slot;
+uint16_t phys,lsn;
+if (blk==0xFF) return;
+fl_read_nk(ftl_blk_addr(blk),ftl_hdr,FTL_HDR_LEN);
+for (slot=1;(slot<FTL_SLOTS)&&(ftl_valid[blk]>0);slot++)
+	{
+	lsn = ftl_hdr[FTL_HDR_TAGS+((slot-1)*2)] | (((uint16_t)(ftl_hdr[FTL_HDR_TAGS+((slot-1)*2)+1]))<<8);
+	if ((lsn==0x0000)||(lsn==0xFFFF)) continue;
+	lsn--;
+	phys = (((uint16_t)(blk))*FTL_SLOTS) + slot;
+	if ((lsn>=FTL_SECTORS)||(ftl_map[lsn]!=phys)) continue;
+	fl_read_nk(ftl_phys_addr(phys),ftl_buff,FTL_SECT_SIZE);
+	ftl_append(lsn,ftl_buff);
+	}
+ftl_erase_blk(blk);
+ftl_free++;
+ftl_gc_runs++;
+}
+
+//rebuild map from block headers only, cost does not depend on disk content
+void ftl_mount (void)
+{
+uint16_t i,lsn,phys,old;
+uint8_t blk,slot;
+for (i=0;i<FTL_SECTORS;i++) ftl_map[i] = FTL_UNMAPPED;
+ftl_seq_max = 0;
+ftl_free = 0;
+for (blk=0;blk<FTL_BLOCKS;blk++)
+	{
+	fl_read_nk(ftl_blk_addr(blk),ftl_hdr,FTL_HDR_LEN);
+	ftl_valid[blk] = 0;
+	if (ftl_get32(ftl_hdr)!=FTL_MAGIC)
+		{
+		ftl_state[blk] = FTL_BLK_RAW;
+		ftl_ec[blk] = 0;
+		ftl_seq[blk] = 0xFFFFFFFF;
+		ftl_free++;
+		continue;
+		}
+	ftl_seq[blk] = ftl_get32(ftl_hdr+4);
+	ftl_ec[blk] = ftl_get32(ftl_hdr+8);
+	if (ftl_seq[blk]==0xFFFFFFFF)
+		{
+		ftl_state[blk] = FTL_BLK_FREE;
+		ftl_free++;
+		continue;
+		}
+	ftl_state[blk] = FTL_BLK_USED;
+	if (ftl_seq[blk]>ftl_seq_max) ftl_seq_max = ftl_seq[blk];
+	for (slot=1;slot<FTL_SLOTS;slot++)
+		{
+		lsn = ftl_hdr[FTL_HDR_TAGS+((slot-1)*2)] | (((uint16_t)(ftl_hdr[FTL_HDR_TAGS+((slot-1)*2)+1]))<<8);
+		if ((lsn==0x0000)||(lsn==0xFFFF)) continue;
+		lsn--;
+		if (lsn>=FTL_SECTORS) continue;
+		phys = (((uint16_t)(blk))*FTL_SLOTS) + slot;
+		old = ftl_map[lsn];
+		//power lost before old copy was marked stale, newer block wins
+		if ((old!=FTL_UNMAPPED)&&(ftl_seq[old/FTL_SLOTS]>ftl_seq[blk])) continue;
+		if (old!=FTL_UNMAPPED) ftl_valid[old/FTL_SLOTS]--;
+		ftl_map[lsn] = phys;
+		ftl_valid[blk]++;
+		}
+	}
+//partially written block is not reused, slot after last tag may hold torn data
+ftl_cur_blk = 0xFF;
+ftl_cur_slot = FTL_SLOTS;
+ftl_mounted = 1;
+}
+
+void ftl_read (uint16_t lsn, uint8_t * data)
+{
+uint8_t i;
+if (ftl_mounted==0) ftl_mount();
+if ((lsn>=FTL_SECTORS)||(ftl_map[lsn]==FTL_UNMAPPED))
+	{
+	for (i=0;i<FTL_SECT_SIZE;i++) data[i] = 0xE5;
+	return;
+	}
+fl_read_nk(ftl_phys_addr(ftl_map[lsn]),data,FTL_SECT_SIZE);
+}
+
+void ftl_write (uint16_t lsn, uint8_t * data)
+{
+uint8_t i;
+if (ftl_mounted==0) ftl_mount();
+if (lsn>=FTL_SECTORS) return;
+//CP/M rewrites directory sectors often without change
+if (ftl_map[lsn]!=FTL_UNMAPPED)
+	{
+	fl_read_nk(ftl_phys_addr(ftl_map[lsn]),ftl_buff,FTL_SECT_SIZE);
+	for (i=0;i<FTL_SECT_SIZE;i++)
+		if (ftl_buff[i]!=data[i]) break;
+	if (i==FTL_SECT_SIZE) return;
+	}
+while (ftl_free<FTL_GC_MIN) ftl_gc_step(ftl_victim());
+ftl_append(lsn,data);
+}
+
+//forget sector, it reads as 0xE5 afterwards
+void ftl_trim (uint16_t lsn)
+{
+if (ftl_mounted==0) ftl_mount();
+if ((lsn>=FTL_SECTORS)||(ftl_map[lsn]==FTL_UNMAPPED)) return;
+ftl_kill(ftl_map[lsn]);
+ftl_map[lsn] = FTL_UNMAPPED;
+}
+
+//background GC, called while CP/M machine waits for a key
+void ftl_idle (void)
+{
+uint8_t blk;
+if (ftl_mounted==0) return;
+if (ftl_free>=FTL_GC_IDLE) return;
+//don't spend erases on blocks that are still mostly valid
+blk = ftl_victim();
+if ((blk!=0xFF)&&(ftl_valid[blk]<FTL_GC_IDLE_VALID)) ftl_gc_step(blk);
+}
+
+void ftl_patch_dpb (void)
+{
+ram[FTL_DPB_ADDR+5] = ((FTL_SECTORS/16)-1)&0xFF;
+ram[FTL_DPB_ADDR+6] = ((FTL_SECTORS/16)-1)>>8;
+}
+
+void ftl_get_stats (uint16_t * free_blk, uint32_t * ec_min, uint32_t * ec_max, uint32_t * gc_runs)
+{
+uint8_t i;
+if (ftl_mounted==0) ftl_mount();
+*free_blk = ftl_free;
+*ec_min = 0xFFFFFFFF;
+*ec_max = 0;
+for (i=0;i<FTL_BLOCKS;i++)
+	{
+	if (ftl_ec[i]<*ec_min) *ec_min = ftl_ec[i];
+	if (ftl_ec[i]>*ec_max) *ec_max = ftl_ec[i];
+	}
+*gc_runs = ftl_gc_runs;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef		__FTL_H
+#define		__FTL_H
+
+#include <stdint.h>
+#include "../badge_settings.h"
+
+/*
+ * Log-structured FLASH translation layer for CP/M disk D
+ * Region is split into 4k blocks, each one holding header slot and
+ * 31 slots of 128B CP/M sectors. Sectors are appended to active block,
+ * logical->physical map is kept in RAM and rebuilt from block headers.
+ *
+ * block header (slot 0):
+ * 0..3		magic
+ * 4..7		sequence number, 0xFFFFFFFF for erased (free) block
+ * 8..11	erase count
+ * 16..77	tags of slots 1..31, logical sector+1, 0xFFFF unused, 0x0000 stale
+ */
+
+#define		FTL_BASE		0x080000
+#define		FTL_BLOCKS		128
+#define		FTL_SLOTS		32
+#define		FTL_SECT_SIZE	128
+#define		FTL_MAGIC		0x314C5446
+#define		FTL_HDR_TAGS	16
+#define		FTL_HDR_LEN		(FTL_HDR_TAGS+(2*(FTL_SLOTS-1)))
+
+//logical size of disk, 224 blocks of 2kB, rest is kept as spare for GC
+#define		FTL_SECTORS		3584
+//DPB of disk D in BIOS, DSM is patched to match FTL_SECTORS
+#define		FTL_DPB_ADDR	0xEF65
+
+#define		FTL_UNMAPPED	0xFFFF
+
+//foreground GC keeps at least this many free blocks, so one is left even if GC is interrupted
+//idle GC works up to FTL_GC_IDLE free blocks, on victims with less than FTL_GC_IDLE_VALID sectors
+#define		FTL_GC_MIN		3
+#define		FTL_GC_IDLE		6
+#define		FTL_GC_IDLE_VALID	16
+//static wear levelling check period (in erases) and allowed erase count spread
+#define		FTL_WL_PERIOD	64
+#define		FTL_WL_DELTA	32
+
+#define		FTL_BLK_FREE	0
+#define		FTL_BLK_USED	1
+#define		FTL_BLK_RAW		2
+
+void ftl_mount (void);
+void ftl_read (uint16_t lsn, uint8_t * data);
+void ftl_write (uint16_t lsn, uint8_t * data);
+void ftl_trim (uint16_t lsn);
+void ftl_idle (void);
+void ftl_patch_dpb (void);
+void ftl_get_stats (uint16_t * free_blk, uint32_t * ec_min, uint32_t * ec_max, uint32_t * gc_runs);
+
+#endif
@@ -2,21 +2,39 @@
 #include <xc.h>
 #include <plib.h>
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <sys/appio.h>
 
 #include "sim.h"
 #include "simglb.h"
 #include "../hw.h"
+#include "ftl.h"
+#include "rdz.h"
+#include "rdc.h"
+#include "cpmfs.h"
 
 extern const uint8_t rom_image[65536];
 extern const uint8_t rd_image[131072];
 extern const uint8_t rd_image2[ROMDISK2_SIZE];
+#ifdef	USE_ROMDISK_COMPRESSED
+extern const uint8_t rdz_image[];
+extern const uint8_t rdz_image2[];
+//ROM disk sector read latency, in core timer ticks
+uint32_t rd_stat_ticks, rd_stat_max;
+#endif
 uint8_t drive, sector, track,disk_temp_pointer;
 uint8_t disk_temp[128],flash_buff[4096], conin_buffer[30], conin_buffer_pointer;
 
 uint32_t last_addr = 0xFFFFF000;
 uint8_t unwritten;
+//result of last sector write, read by BIOS through port 0x0C
+uint8_t disk_status;
+
+//erase-avoiding write statistics, see fl_update_4k()
+uint32_t fl_stat_erases, fl_stat_erases_saved, fl_stat_pages_written, fl_stat_pages_skipped;
+//nonzero while FLASH command is in progress, see ramdisk_sync()
+volatile uint8_t fl_lock;
 
 uint8_t fl_rdsr(void);
 uint32_t fl_rdid(void);
@@ -32,16 +50,111 @@ extern const uint8_t ram_image_b[0xFFFF-0xD800];
 
 #ifdef	USE_RAMDISK
 uint8_t ram_disk[RAMDISK_SIZE];
+#ifdef	RAMDISK_PERSIST
+//dirty - written since last sync, pop - copy stored in FLASH, 0 means populated
+uint8_t ramdisk_dirty[(RAMDISK_SECTS+7)/8], ramdisk_pop[(RAMDISK_SECTS+7)/8];
+volatile uint8_t ramdisk_syncing;
+uint32_t ramdisk_last_write;
+uint32_t millis(void);
+#endif
+#endif
+#ifdef	CPM_BIG_DISK
+//SPT 32, BSH 5, BLM 31, EXM 3, DSM 255, DRM 127, AL0/AL1 0x80/0x00, CKS 0, OFF 0
+//one extent maps 64k, so even big files need few directory entries
+const uint8_t cpm_big_dpb[15] = {CPM_BIG_SPT,0, 5,31,3, 255,0, 127,0, 0x80,0x00, 0,0, 0,0};
 #endif
 
+//boot timing, from cold or warm boot until CCP waits for key (port 0x02)
+uint32_t boot_start, boot_cold_ticks, boot_warm_ticks, boot_warm_cnt, boot_pages;
+//1 - cold boot being timed, 2 - warm boot
+uint8_t boot_timing;
+
+void cpm_boot_start (uint8_t cold)
+{
+boot_start = _CP0_GET_COUNT();
+boot_timing = cold ? 1 : 2;
+}
+
+void cpm_boot_done (void)
+{
+if (boot_timing==1) boot_cold_ticks = _CP0_GET_COUNT() - boot_start;
+if (boot_timing==2)
+	{
+	boot_warm_ticks = _CP0_GET_COUNT() - boot_start;
+	boot_warm_cnt++;
+	}
+boot_timing = 0;
+}
+
+void cpm_get_boot_stats (uint32_t * cold_us, uint32_t * warm_us, uint32_t * warm_cnt, uint32_t * pages)
+{
+*cold_us = boot_cold_ticks / CORE_TICKS_US;
+*warm_us = boot_warm_ticks / CORE_TICKS_US;
+*warm_cnt = boot_warm_cnt;
+*pages = boot_pages;
+}
+
+//turn latency, from CR typed at console until program waits for next key,
+//so it covers whole turn of a game like ZORK1 including its output
+uint32_t turn_start, turn_ticks, turn_max, turn_cnt;
+uint8_t turn_on;
+
+void cpm_turn_start (void)
+{
+turn_start = _CP0_GET_COUNT();
+turn_on = 1;
+}
+
+void cpm_turn_done (void)
+{
+uint32_t t;
+if (turn_on==0) return;
+t = _CP0_GET_COUNT() - turn_start;
+turn_ticks += t;
+if (t>turn_max) turn_max = t;
+turn_cnt++;
+turn_on = 0;
+}
+
+void cpm_get_turn_stats (uint32_t * turns, uint32_t * avg_us, uint32_t * max_us)
+{
+*turns = turn_cnt;
+*avg_us = 0;
+if (turn_cnt>0) *avg_us = (turn_ticks/turn_cnt)/CORE_TICKS_US;
+*max_us = turn_max/CORE_TICKS_US;
+}
+
+//CCP, BDOS and BIOS are restored only in 256B pages that differ from image,
+//usually just the ones patched below, unless program overwrote CCP
 void reload_cpm_warm (void)
 {
-uint16_t i;
+uint16_t i,len;
 #ifdef	USE_RAM_IMAGE_OLD
-	for (i=0xD400;i<(0xD400+0x1EFF);i++) ram[i] = ram_image[i];
+	memcpy(ram+0xD400,ram_image+0xD400,0x1EFF);
 #endif
 #ifdef	USE_RAM_IMAGE_NEW
-	for (i=0;i<0x1AFF;i++) ram[i+0xD800] = ram_image_b[i];
+	for (i=0;i<CPM_IMAGE_LEN;i+=CPM_IMAGE_PAGE)
+		{
+		len = CPM_IMAGE_LEN - i;
+		if (len>CPM_IMAGE_PAGE) len = CPM_IMAGE_PAGE;
+		if (memcmp(ram+CPM_IMAGE_BASE+i,ram_image_b+i,len)!=0)
+			{
+			memcpy(ram+CPM_IMAGE_BASE+i,ram_image_b+i,len);
+			boot_pages++;
+			}
+		}
+#endif
+#ifdef	CPM_FTL
+	ftl_patch_dpb();
+#endif
+#ifdef	CPM_BIG_DISK
+	for (i=0;i<15;i++) ram[CPM_DPB_D+i] = cpm_big_dpb[i];
+#endif
+#ifdef	RAMDISK_COMPRESSED
+	rdc_patch_bios();
+#endif
+#ifdef	HOST_BUILD
+	host_bdos_patch();
 #endif
 	}
 
@@ -90,12 +203,22 @@ uint32_t  base,ptr;
 base = (((uint32_t )(track))*16) + sector;
 if (drive==0)
 	{
+#ifdef	RAMDISK_COMPRESSED
+	if (disk_temp_pointer==0)
+		{
+		rdc_read(base,disk_temp);
+		rdc_reserve(base,0);
+		}
+	temp = disk_temp[disk_temp_pointer];
+#endif
+#ifndef	RAMDISK_COMPRESSED
 	base = base*128;
 #ifdef USE_RAMDISK
 	ptr = base + disk_temp_pointer;
 	if (ptr<RAMDISK_SIZE)
 		temp = ram_disk[ptr];
 #endif
+#endif
 #ifndef	USE_RAMDISK
 	temp = 0xA5;
 #endif
@@ -104,7 +227,13 @@ if (drive==1)
 	{
 	base = base*128;
 #ifdef	USE_ROMDISK
+#ifdef	USE_ROMDISK_COMPRESSED
+	if (disk_temp_pointer==0) rd_read_128(rdz_image,base,disk_temp);
+	temp = disk_temp[disk_temp_pointer];
+#endif
+#ifndef	USE_ROMDISK_COMPRESSED
 	temp = rd_image[base + disk_temp_pointer];
+#endif
 #endif
 	}
 if (drive==2)
@@ -115,27 +244,45 @@ if (drive==2)
 #endif
 	base = base*128;
 #ifdef	USE_ROMDISK2
+#ifdef	USE_ROMDISK_COMPRESSED
+	if (disk_temp_pointer==0) rd_read_128(rdz_image2,base,disk_temp);
+	temp = disk_temp[disk_temp_pointer];
+#endif
+#ifndef	USE_ROMDISK_COMPRESSED
 	temp = rd_image2[base + disk_temp_pointer];
+#endif
 #endif
 	}
 
 if (drive==3)
 	{
-	if (disk_temp_pointer==0) fl_read_128(base+(CPM1_DISK1_OFFSET),disk_temp);
+#ifdef	CPM_FTL
+	if (disk_temp_pointer==0) ftl_read(base,disk_temp);
+#endif
+#ifndef	CPM_FTL
+#ifdef	CPM_BIG_DISK
+	base = (((uint32_t )(track))*CPM_BIG_SPT) + sector;
+#endif
+	if (disk_temp_pointer==0) fl_read_128(base+CPM_DISK_D_SECT,disk_temp);
+#endif
 	temp = disk_temp[disk_temp_pointer];
 	}
 if (drive==4)
 	{
-	if (disk_temp_pointer==0) fl_read_128(base+(CPM1_DISK2_OFFSET)+4096,disk_temp);
+	if (disk_temp_pointer==0) fl_read_128(base+CPM_DISK_E_SECT,disk_temp);
 	temp = disk_temp[disk_temp_pointer];
 	}
 if (drive==5)
 	{
-	if (disk_temp_pointer==0) fl_read_128(base+(CPM1_DISK3_OFFSET)+(2*4096),disk_temp);
+	if (disk_temp_pointer==0) fl_read_128(base+CPM_DISK_F_SECT,disk_temp);
 	temp = disk_temp[disk_temp_pointer];
 	}
 if (drive==6)
 	{
+#ifdef	HOST_BUILD
+	//files of host directory drive don't live in sectors
+	temp = 0xE5;
+#endif
 	}
 
 disk_temp_pointer++;
@@ -150,11 +297,24 @@ uint32_t  ptr;
 base = (((unsigned int)(track))*16) + sector;
 if (drive==0)
 	{
+#ifdef	RAMDISK_COMPRESSED
+	disk_temp[disk_temp_pointer] = dat;
+	if (disk_temp_pointer==127)
+		{
+		disk_status = rdc_write(base,disk_temp);
+		rdc_reserve(base,1);
+		}
+#endif
+#ifndef	RAMDISK_COMPRESSED
 #ifdef	USE_RAMDISK
 	base = base*128;
 	ptr = base + disk_temp_pointer;
 	if (ptr<RAMDISK_SIZE)
+		{
 		ram_disk[ptr] = dat;
+		ramdisk_mark(ptr,1);
+		}
+#endif
 #endif
 	}
 if (drive==1)
@@ -177,7 +337,15 @@ if (drive==3)
 	disk_temp[disk_temp_pointer] = dat;
 	if (disk_temp_pointer==127) 
 		{
-		fl_write_128(base+(CPM1_DISK1_OFFSET),disk_temp);
+#ifdef	CPM_FTL
+		ftl_write(base,disk_temp);
+#endif
+#ifndef	CPM_FTL
+#ifdef	CPM_BIG_DISK
+		base = (((uint32_t )(track))*CPM_BIG_SPT) + sector;
+#endif
+		fl_write_128(base+CPM_DISK_D_SECT,disk_temp);
+#endif
 		}
 	}
 if (drive==4)
@@ -185,7 +353,7 @@ if (drive==4)
 	disk_temp[disk_temp_pointer] = dat;
 	if (disk_temp_pointer==127) 
 		{
-		fl_write_128(base+(CPM1_DISK2_OFFSET)+(1*4096),disk_temp);
+		fl_write_128(base+CPM_DISK_E_SECT,disk_temp);
 		}
 	}
 if (drive==5)
@@ -193,7 +361,7 @@ if (drive==5)
 	disk_temp[disk_temp_pointer] = dat;
 	if (disk_temp_pointer==127) 
 		{
-		fl_write_128(base+(CPM1_DISK3_OFFSET)+(2*4096),disk_temp);
+		fl_write_128(base+CPM_DISK_F_SECT,disk_temp);
 		}
 	}
 if (drive==6)
@@ -202,6 +370,131 @@ if (drive==6)
 disk_temp_pointer++;
 }
 
+#ifdef	USE_ROMDISK_COMPRESSED
+//read sector of compressed ROM disk, measuring how long it takes
+void rd_read_128(const uint8_t * img, uint32_t addr, uint8_t * data)
+{
+uint32_t t;
+t = _CP0_GET_COUNT();
+rdz_read(img,addr,data,128);
+t = _CP0_GET_COUNT() - t;
+rd_stat_ticks += t;
+if (t>rd_stat_max) rd_stat_max = t;
+}
+
+void rd_get_stats(uint32_t * reads, uint32_t * misses, uint32_t * avg_us, uint32_t * max_us)
+{
+rdz_get_stats(reads,misses);
+*avg_us = 0;
+if (*reads>0) *avg_us = (rd_stat_ticks / *reads) / CORE_TICKS_US;
+*max_us = rd_stat_max / CORE_TICKS_US;
+}
+#endif
+
+//note change of RAM disk bytes for next sync
+void ramdisk_mark(uint16_t offs, uint16_t len)
+{
+#ifdef	RAMDISK_PERSIST
+uint16_t i;
+for (i=offs/128;i<=((offs+len-1)/128);i++) ramdisk_dirty[i/8] |= 1<<(i%8);
+ramdisk_last_write = millis();
+#endif
+}
+
+uint8_t disk_get_status(void)
+{
+uint8_t temp;
+temp = disk_status;
+disk_status = 0;
+return temp;
+}
+
+#ifdef	RAMDISK_PERSIST
+//start with empty image in FLASH
+void ramdisk_clear(void)
+{
+uint8_t hdr[RAMDISK_HDR_BITMAP];
+uint16_t i;
+fl_erase_4k(RAMDISK_FL_HDR);
+hdr[0] = (RAMDISK_MAGIC>>0)&0xFF;
+hdr[1] = (RAMDISK_MAGIC>>8)&0xFF;
+hdr[2] = (RAMDISK_MAGIC>>16)&0xFF;
+hdr[3] = (RAMDISK_MAGIC>>24)&0xFF;
+hdr[4] = (RAMDISK_SECTS>>0)&0xFF;
+hdr[5] = (RAMDISK_SECTS>>8)&0xFF;
+hdr[6] = 0xFF;
+hdr[7] = 0xFF;
+fl_write_page(RAMDISK_FL_HDR,hdr,RAMDISK_HDR_BITMAP);
+for (i=0;i<sizeof(ramdisk_pop);i++) ramdisk_pop[i] = 0xFF;
+}
+
+//load populated sectors into ram_disk, which is already filled with 0xE5
+void ramdisk_restore(void)
+{
+uint8_t hdr[RAMDISK_HDR_BITMAP];
+uint16_t i,run;
+uint32_t magic;
+for (i=0;i<sizeof(ramdisk_dirty);i++) ramdisk_dirty[i] = 0;
+fl_read_nk(RAMDISK_FL_HDR,hdr,RAMDISK_HDR_BITMAP);
+magic = ((uint32_t)(hdr[0])) | (((uint32_t)(hdr[1]))<<8) | (((uint32_t)(hdr[2]))<<16) | (((uint32_t)(hdr[3]))<<24);
+if ((magic!=RAMDISK_MAGIC)||((hdr[4]|(((uint16_t)(hdr[5]))<<8))!=RAMDISK_SECTS))
+	{
+	ramdisk_clear();
+	return;
+	}
+fl_read_nk(RAMDISK_FL_HDR+RAMDISK_HDR_BITMAP,ramdisk_pop,sizeof(ramdisk_pop));
+//consecutive populated sectors are read in one go
+for (i=0;i<RAMDISK_SECTS;i+=run)
+	{
+	for (run=0;(i+run)<RAMDISK_SECTS;run++)
+		if (ramdisk_pop[(i+run)/8]&(1<<((i+run)%8))) break;
+	if (run>0)
+		fl_read_nk(RAMDISK_FL_DATA+(((uint32_t)(i))*128),ram_disk+(((uint32_t)(i))*128),run*128);
+	else
+		run = 1;
+	}
+}
+
+//write 4k blocks holding dirty sectors, then mark them populated
+//may be called from ISR before sleep, so it backs off if FLASH is in use
+void ramdisk_sync(void)
+{
+uint16_t blk,i,len;
+uint8_t any;
+if ((fl_lock!=0)||(ramdisk_syncing!=0)) return;
+ramdisk_syncing = 1;
+for (blk=0;blk<((RAMDISK_SIZE+4095)/4096);blk++)
+	{
+	any = 0;
+	for (i=blk*4;(i<((blk+1)*4))&&(i<sizeof(ramdisk_dirty));i++)
+		{
+		if (ramdisk_dirty[i]!=0) any = 1;
+		ramdisk_pop[i] &= ~ramdisk_dirty[i];
+		ramdisk_dirty[i] = 0;
+		}
+	if (any==0) continue;
+	len = RAMDISK_SIZE - (blk*4096);
+	if (len>4096) len = 4096;
+	fl_update_4k(RAMDISK_FL_DATA+(((uint32_t)(blk))*4096),ram_disk+(((uint32_t)(blk))*4096),len);
+	fl_write_page(RAMDISK_FL_HDR+RAMDISK_HDR_BITMAP+(blk*4),ramdisk_pop+(blk*4),i-(blk*4));
+	}
+ramdisk_syncing = 0;
+}
+
+//called while CP/M waits for a key, syncs once writes settle down
+void ramdisk_idle(void)
+{
+uint8_t i;
+for (i=0;i<sizeof(ramdisk_dirty);i++)
+	if (ramdisk_dirty[i]!=0) break;
+if (i==sizeof(ramdisk_dirty)) return;
+if ((millis()-ramdisk_last_write)<RAMDISK_SYNC_DELAY) return;
+ramdisk_sync();
+}
+#endif
+
+//SPI FLASH access, host build provides the same over image files
+#ifndef	HOST_BUILD
 uint8_t fl_rdsr(void)
 {
 volatile uint8_t temp;
@@ -230,6 +523,7 @@ return retval;
 void fl_read_4k(uint32_t  addr, uint8_t * data)
 {
 uint16_t i;
+fl_lock++;
 CS_FLASH = 0;
 SPI_dat(0x03);
 SPI_dat((addr>>16)&0xFF);
@@ -237,11 +531,13 @@ SPI_dat((addr>>8)&0xFF);
 SPI_dat((addr>>0)&0xFF);
 for (i=0;i<4096;i++) *data++ = SPI_dat(0xFF);
 CS_FLASH = 1;
+fl_lock--;
 }
 
 void fl_read_nk(uint32_t  addr, uint8_t * data, uint16_t n)
 {
 uint16_t i;
+fl_lock++;
 CS_FLASH = 0;
 SPI_dat(0x03);
 SPI_dat((addr>>16)&0xFF);
@@ -249,6 +545,7 @@ SPI_dat((addr>>8)&0xFF);
 SPI_dat((addr>>0)&0xFF);
 for (i=0;i<n;i++) *data++ = SPI_dat(0xFF);
 CS_FLASH = 1;
+fl_lock--;
 }
 
 void fl_unlock(void)
@@ -263,6 +560,7 @@ CS_FLASH = 1;
 void fl_erase_4k(uint32_t  addr)
 {
 uint16_t i;
+fl_lock++;
 fl_wren();
 CS_FLASH = 0;
 SPI_dat(0x20);
@@ -271,12 +569,15 @@ SPI_dat((addr>>8)&0xFF);
 SPI_dat((addr>>0)&0xFF);
 CS_FLASH = 1;
 while ((fl_rdsr())&0x01);
+fl_stat_erases++;
+fl_lock--;
 }
 
 
 void fl_write(uint32_t  addr,uint8_t data)
 {
 uint16_t i;
+fl_lock++;
 fl_wren();
 CS_FLASH = 0;
 SPI_dat(0x02);
@@ -285,6 +586,7 @@ SPI_dat((addr>>8)&0xFF);
 SPI_dat((addr>>0)&0xFF);
 SPI_dat(data);
 CS_FLASH = 1;
+fl_lock--;
 }
 
 void fl_rst_pb(void)
@@ -309,14 +611,139 @@ CS_FLASH = 1;
 }
 
 
-void fl_write_4k(uint32_t  addr, uint8_t * data)
+//program up to 256 bytes, must not cross page boundary
+void fl_write_page(uint32_t  addr, uint8_t * data, uint16_t n)
 {
 uint16_t i;
-for (i=0;i<4096;i++) 
+fl_lock++;
+fl_wren();
+CS_FLASH = 0;
+SPI_dat(0x02);
+SPI_dat((addr>>16)&0xFF);
+SPI_dat((addr>>8)&0xFF);
+SPI_dat((addr>>0)&0xFF);
+for (i=0;i<n;i++) SPI_dat(*data++);
+CS_FLASH = 1;
+while ((fl_rdsr())&0x01);
+fl_lock--;
+}
+#endif
+
+void fl_write_4k(uint32_t  addr, uint8_t * data)
+{
+uint16_t i,j;
+for (i=0;i<4096;i+=FL_PAGE_SIZE) 
+	{
+	//erased page doesn't need to be programmed with 0xFF
+	for (j=0;j<FL_PAGE_SIZE;j++) 
+		if (data[i+j]!=0xFF) break;
+	if (j<FL_PAGE_SIZE)
+		{
+		fl_write_page(addr+i,data+i,FL_PAGE_SIZE);
+		fl_stat_pages_written++;
+		}
+	else
+		fl_stat_pages_skipped++;
+	}
+}
+
+/*
+ * Write len bytes (up to 4096) into 4k sector at addr, touching the FLASH
+ * only as much as needed. Current content is compared with new data first:
+ * - identical sector is not written at all
+ * - if all changed bits go 1->0, only changed span of each page is programmed
+ * - sector is erased only when some bit has to go 0->1
+ * When erased, the rest of sector beyond len is left blank.
+ */
+uint8_t fl_update_4k(uint32_t  addr, uint8_t * data, uint16_t len)
+{
+uint16_t i,j,n,pg;
+uint16_t pg_first[4096/FL_PAGE_SIZE],pg_last[4096/FL_PAGE_SIZE];
+uint8_t fl_cmp_buff[FL_CMP_CHUNK];
+uint8_t need_erase = 0, changed = 0;
+for (pg=0;pg<(4096/FL_PAGE_SIZE);pg++)
+	{
+	pg_first[pg] = 0xFFFF;
+	pg_last[pg] = 0;
+	}
+for (i=0;(i<len)&(need_erase==0);i+=FL_CMP_CHUNK)
+	{
+	n = len - i;
+	if (n>FL_CMP_CHUNK) n = FL_CMP_CHUNK;
+	fl_read_nk(addr+i,fl_cmp_buff,n);
+	for (j=0;j<n;j++)
+		{
+		if (fl_cmp_buff[j]!=data[i+j])
+			{
+			if ((fl_cmp_buff[j]&data[i+j])!=data[i+j])
+				{
+				need_erase = 1;
+				break;
+				}
+			changed = 1;
+			pg = (i+j)/FL_PAGE_SIZE;
+			if (pg_first[pg]==0xFFFF) pg_first[pg] = i+j;
+			pg_last[pg] = i+j;
+			}
+		}
+	}
+if (need_erase)
+	{
+	fl_erase_4k(addr);
+	for (i=0;i<len;i+=FL_PAGE_SIZE) 
+		{
+		n = len - i;
+		if (n>FL_PAGE_SIZE) n = FL_PAGE_SIZE;
+		for (j=0;j<n;j++) 
+			if (data[i+j]!=0xFF) break;
+		if (j<n)
+			{
+			fl_write_page(addr+i,data+i,n);
+			fl_stat_pages_written++;
+			}
+		else
+			fl_stat_pages_skipped++;
+		}
+	return FL_UPD_ERASED;
+	}
+fl_stat_erases_saved++;
+if (changed==0) 
+	{
+	fl_stat_pages_skipped += (len+FL_PAGE_SIZE-1)/FL_PAGE_SIZE;
+	return FL_UPD_SAME;
+	}
+for (pg=0;pg<(4096/FL_PAGE_SIZE);pg++)
+	{
+	if (pg_first[pg]==0xFFFF)
+		{
+		if ((pg*FL_PAGE_SIZE)<len) fl_stat_pages_skipped++;
+		continue;
+		}
+	fl_write_page(addr+pg_first[pg],data+pg_first[pg],pg_last[pg]-pg_first[pg]+1);
+	fl_stat_pages_written++;
+	}
+return FL_UPD_PROGRAMMED;
+}
+
+void fl_get_stats(uint32_t * erases, uint32_t * saved, uint32_t * written, uint32_t * skipped)
+{
+*erases = fl_stat_erases;
+*saved = fl_stat_erases_saved;
+*written = fl_stat_pages_written;
+*skipped = fl_stat_pages_skipped;
+}
+
+//write back buffered 4k sector of CP/M disk, if any
+void fl_flush(void)
+{
+#ifdef	FLASH_BUFFERING	
+if (unwritten == 1)
 	{
-	fl_write(addr+i,*data++);
-	while ((fl_rdsr())&0x01);
+	fl_update_4k(last_addr,flash_buff,4096);
+	unwritten = 0;	
+	last_addr = 0xFFFFF000;
 	}
+#endif
 }
 
 void fl_write_128(uint32_t sector,uint8_t * data)
@@ -329,10 +756,7 @@ addr = addr&0xFFFFF000;
 if (last_addr!=addr)
 	{
 	if (last_addr!=0xFFFFF000)
-		{
-		fl_erase_4k(last_addr);
-		fl_write_4k(last_addr,flash_buff);
-		}
+		fl_update_4k(last_addr,flash_buff,4096);
 	fl_read_4k(addr,flash_buff);
 	last_addr = addr;
 	}
@@ -347,47 +771,66 @@ for (i=0;i<128;i++) flash_buff[addr+i] = data[i];
 addr = ((uint32_t )(sector))*128UL;
 addr = addr&0xFFFFF000;
 #ifndef	FLASH_BUFFERING	
-fl_erase_4k(addr);
-fl_write_4k(addr,flash_buff);
+fl_update_4k(addr,flash_buff,4096);
 #endif
 }
 
 void fl_read_128(uint32_t sector,uint8_t * data)
 {
 uint32_t  addr;
-#ifdef	FLASH_BUFFERING	
-if (unwritten == 1)
-	{
-	fl_erase_4k(last_addr);
-	fl_write_4k(last_addr,flash_buff);
-	unwritten = 0;	
-	last_addr = 0xFFFFF000;
-	}
-#endif
+fl_flush();
 addr = ((uint32_t )(sector))*128UL;
 fl_read_nk(addr,data,128);
 }
 
-uint8_t init_first_x_sects (uint8_t i, uint8_t verify)			//format directory area
+//write empty directory to FLASH disks D, E and F
+uint8_t cpm_format_drives (uint8_t verify)
 {
 uint32_t j,k;
+uint16_t dir_d;
 for (j=0;j<128;j++) disk_temp[j]=0xE5;
 #ifdef USE_EEPROM
-for (j=0;j<i;j++) 
+for (j=0;j<CPM_STD_DIR_SECTS;j++) 
 	{
 	ee_wren();
 	write_sector(disk_temp,j);
 	}
 #endif
-for (j=0;j<i;j++) fl_write_128(j+(CPM1_DISK1_OFFSET),disk_temp);
-for (j=0;j<i;j++) fl_write_128(j+(CPM1_DISK2_OFFSET),disk_temp);
-for (j=0;j<i;j++) fl_write_128(j+(CPM1_DISK3_OFFSET),disk_temp);
+dir_d = CPM_STD_DIR_SECTS;
+#ifdef	CPM_FTL
+for (j=0;j<dir_d;j++) ftl_trim(j);
+#endif
+#ifdef	CPM_BIG_DISK
+dir_d = CPM_BIG_DIR_SECTS;
+//directory is exactly one erase block
+fl_flush();
+for (j=0;j<4096;j++) flash_buff[j] = 0xE5;
+fl_update_4k(((uint32_t)(CPM_DISK_D_SECT))*128UL,flash_buff,4096);
+#endif
+#ifndef	CPM_FTL
+#ifndef	CPM_BIG_DISK
+for (j=0;j<dir_d;j++) fl_write_128(j+CPM_DISK_D_SECT,disk_temp);
+#endif
+#endif
+for (j=0;j<CPM_STD_DIR_SECTS;j++) fl_write_128(j+CPM_DISK_E_SECT,disk_temp);
+for (j=0;j<CPM_STD_DIR_SECTS;j++) fl_write_128(j+CPM_DISK_F_SECT,disk_temp);
+fl_flush();
+#ifdef	RAMDISK_PERSIST
+ramdisk_clear();
+#endif
 
 if (verify!=0)
 	{
-	for (j=0;j<i;j++) 
+	for (j=0;j<(dir_d+(2*CPM_STD_DIR_SECTS));j++) 
 		{
-		fl_read_128(j+(1*4096),disk_temp);
+#ifdef	CPM_FTL
+		if (j<dir_d) ftl_read(j,disk_temp);
+#endif
+#ifndef	CPM_FTL
+		if (j<dir_d) fl_read_128(j+CPM_DISK_D_SECT,disk_temp);
+#endif
+		if ((j>=dir_d)&&(j<(dir_d+CPM_STD_DIR_SECTS))) fl_read_128(j-dir_d+CPM_DISK_E_SECT,disk_temp);
+		if (j>=(dir_d+CPM_STD_DIR_SECTS)) fl_read_128(j-dir_d-CPM_STD_DIR_SECTS+CPM_DISK_F_SECT,disk_temp);
 		for (k=0;k<128;k++) 
 			{
 			if (disk_temp[k]!=0xE5)
@@ -401,6 +844,100 @@ return 0;
 }
 
 
+//native access to CP/M drives for file tools, sectors take the same path as from BIOS
+struct cpm_drive_ctx
+{
+	uint8_t drive;
+	uint16_t spt;
+};
+struct cpm_drive_ctx cpm_drive_ctx[CPM_DRIVES];
+
+//BIOS transfer in progress is left as it was
+static uint8_t cpm_sect_io (void * ctx, uint32_t sect, uint8_t * data, uint8_t wr)
+{
+struct cpm_drive_ctx * d = ctx;
+uint8_t drive_s, track_s, sector_s, pointer_s, status = 0;
+uint8_t i;
+drive_s = drive;
+track_s = track;
+sector_s = sector;
+pointer_s = disk_temp_pointer;
+set_drive(d->drive);
+set_track(sect/d->spt);
+set_sector(sect%d->spt);
+if (wr)
+	{
+	for (i=0;i<128;i++) write_disk_byte(data[i]);
+	status = disk_get_status();
+	}
+else
+	for (i=0;i<128;i++) data[i] = read_disk_byte();
+drive = drive_s;
+track = track_s;
+sector = sector_s;
+disk_temp_pointer = pointer_s;
+return status;
+}
+
+static uint8_t cpm_sect_read (void * ctx, uint32_t sect, uint8_t * data)
+{
+return cpm_sect_io(ctx,sect,data,0);
+}
+
+static uint8_t cpm_sect_write (void * ctx, uint32_t sect, uint8_t * data)
+{
+return cpm_sect_io(ctx,sect,data,1);
+}
+
+//sectors backed by medium of drive, 0 for no drive
+uint32_t cpm_drive_sects (uint8_t drv)
+{
+if (drv==0)
+	{
+#ifdef	RAMDISK_COMPRESSED
+	return RDC_SECTS;
+#endif
+#ifdef	USE_RAMDISK
+	return RAMDISK_SIZE/128;
+#endif
+	return 0;
+	}
+if (drv==1) return 131072/128;
+if (drv==2) return ROMDISK2_SIZE/128;
+if (drv==3)
+	{
+#ifdef	CPM_FTL
+	return FTL_SECTORS;
+#endif
+#ifdef	CPM_BIG_DISK
+	return CPM_BIG_DISK_SECTS;
+#endif
+	return CPM_STD_DISK_SECTS;
+	}
+if ((drv==4)||(drv==5)) return CPM_STD_DISK_SECTS;
+return 0;
+}
+
+//DPB of drive in BIOS, so BIOS has to be loaded (reload_cpm_warm)
+uint8_t * cpm_drive_dpb (uint8_t drv)
+{
+return ram + (ram[CPM_DPH+(drv*CPM_DPH_LEN)+10] | (((uint16_t)(ram[CPM_DPH+(drv*CPM_DPH_LEN)+11]))<<8));
+}
+
+uint8_t cpm_drive_attach (struct cpmfs * fs, uint8_t drv, uint8_t wr)
+{
+uint8_t * dpb;
+if (cpm_drive_sects(drv)==0) return CPMFS_ERR_IO;
+//ROM disks
+if ((wr)&&((drv==1)||(drv==2))) return CPMFS_ERR_IO;
+dpb = cpm_drive_dpb(drv);
+cpm_drive_ctx[drv].drive = drv;
+cpm_drive_ctx[drv].spt = dpb[0] | (((uint16_t)(dpb[1]))<<8);
+fs->read = cpm_sect_read;
+fs->write = cpm_sect_write;
+fs->ctx = &cpm_drive_ctx[drv];
+return cpmfs_init(fs,dpb,cpm_drive_sects(drv));
+}
 
 #ifdef USE_EEPROM
 void write_sector (unsigned char *data, unsigned int addr)
@@ -15,10 +15,57 @@
 
 #define	RAMDISK_SIZE	(1024*22)
 
+#ifndef	USE_RAMDISK
+#undef	RAMDISK_PERSIST
+#undef	RAMDISK_COMPRESSED
+#endif
+
+//RAM disk image kept in FLASH, header with populated sector bitmap, then data
+#define	RAMDISK_SECTS		(RAMDISK_SIZE/128)
+#define	RAMDISK_FL_HDR		0x300000
+#define	RAMDISK_FL_DATA		0x301000
+#define	RAMDISK_MAGIC		0x314B4452
+#define	RAMDISK_HDR_BITMAP	8
+//idle sync waits for this long after last RAM disk write (ms)
+#define	RAMDISK_SYNC_DELAY	1000
+
+//core timer runs at SYS_CLK/2
+#define	CORE_TICKS_US	24
+
+//CCP, BDOS and BIOS in ram_image_b, reloaded on warm boot
+#define	CPM_IMAGE_BASE		0xD800
+#define	CPM_IMAGE_LEN		0x1AFF
+#define	CPM_IMAGE_PAGE		256
+
 #define	CPM1_DISK1_OFFSET	1*4096
 #define	CPM1_DISK2_OFFSET	2*4096
 #define	CPM1_DISK3_OFFSET	3*4096
 
+//first 128B sector of FLASH disks D, E and F
+#define	CPM_DISK_D_SECT		(CPM1_DISK1_OFFSET)
+#define	CPM_DISK_E_SECT		((CPM1_DISK2_OFFSET)+4096)
+#define	CPM_DISK_F_SECT		((CPM1_DISK3_OFFSET)+(2*4096))
+//standard format: 16 sectors per track, 2k blocks, 32 directory entries
+#define	CPM_STD_SPT			16
+#define	CPM_STD_DIR_SECTS	8
+
+//big format of disk D: 1MB at 0x080000-0x17FFFF, one track and one
+//4k allocation block per FLASH erase block, directory fills block 0
+#define	CPM_BIG_SPT			32
+#define	CPM_BIG_DIR_SECTS	32
+#define	CPM_DPB_D			0xEF65
+//disk parameter headers in BIOS, DPB address is at offset 10
+#define	CPM_DPH				0xEEC8
+#define	CPM_DPH_LEN			16
+#define	CPM_DRIVES			7
+//128B sectors of FLASH disks
+#define	CPM_STD_DISK_SECTS	4096
+#define	CPM_BIG_DISK_SECTS	8192
+
+#if defined(CPM_BIG_DISK) && defined(CPM_FTL)
+#error "CPM_BIG_DISK and CPM_FTL can't be used together"
+#endif
+
 //#define	USE_EEPROM
 
 uint8_t rx_sta (void);
@@ -47,7 +94,11 @@ void init_termint (void);
 
 
 
-uint8_t init_first_x_sects (uint8_t i, uint8_t verify);
+uint8_t cpm_format_drives (uint8_t verify);
+struct cpmfs;
+uint32_t cpm_drive_sects (uint8_t drv);
+uint8_t * cpm_drive_dpb (uint8_t drv);
+uint8_t cpm_drive_attach (struct cpmfs * fs, uint8_t drv, uint8_t wr);
 
 void fl_write(uint32_t  addr,uint8_t data);
 void fl_erase_4k(uint32_t  addr);
@@ -59,11 +110,44 @@ void fl_read_nk(uint32_t  addr, uint8_t * data, uint16_t n);
 void fl_read_128(uint32_t sector,uint8_t * data);
 void fl_write_128(uint32_t sector,uint8_t * data);
 void fl_unlock(void);
+void fl_write_page(uint32_t  addr, uint8_t * data, uint16_t n);
+uint8_t fl_update_4k(uint32_t  addr, uint8_t * data, uint16_t len);
+void fl_flush(void);
+void fl_get_stats(uint32_t * erases, uint32_t * saved, uint32_t * written, uint32_t * skipped);
+void ramdisk_mark(uint16_t offs, uint16_t len);
+uint8_t disk_get_status(void);
+void ramdisk_restore(void);
+void ramdisk_sync(void);
+void ramdisk_idle(void);
+void ramdisk_clear(void);
+void rd_read_128(const uint8_t * img, uint32_t addr, uint8_t * data);
+void rd_get_stats(uint32_t * reads, uint32_t * misses, uint32_t * avg_us, uint32_t * max_us);
+void cpm_boot_start (uint8_t cold);
+void cpm_boot_done (void);
+void cpm_get_boot_stats (uint32_t * cold_us, uint32_t * warm_us, uint32_t * warm_cnt, uint32_t * pages);
+void cpm_turn_start (void);
+void cpm_turn_done (void);
+void cpm_get_turn_stats (uint32_t * turns, uint32_t * avg_us, uint32_t * max_us);
+
+#define		FL_PAGE_SIZE	256
+#define		FL_CMP_CHUNK	64
+
+//return values of fl_update_4k
+#define		FL_UPD_SAME			0
+#define		FL_UPD_PROGRAMMED	1
+#define		FL_UPD_ERASED		2
 
 
 void read_sector (unsigned char *data, unsigned int addr);
 void write_sector (unsigned char *data, unsigned int addr);
 
+#ifdef	HOST_BUILD
+//host build serves drive G from host directory, BDOS calls are trapped on this port
+#define		HOST_BDOS_PORT	0xFD
+void host_bdos_patch (void);
+void host_bdos_trap (void);
+#endif
+
 #define		IO_CPM_MODE		0
 #define		IO_BASIC_MODE	1
 
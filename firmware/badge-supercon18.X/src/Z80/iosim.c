@@ -33,6 +33,8 @@
 #include "sim.h"
 #include "simglb.h"
 #include "hwz.h"
+#include "ftl.h"
+#include "ymodem.h"
 #include "../hw.h"
 
 uint8_t iosim_mode;
@@ -74,19 +76,45 @@ if (iosim_mode==IO_CPM_MODE)
 	{	
 	if (adr==0x01)	
 		{								//const
+		con_flush();
 	//	return rx_sta();
 		return stdio_get_state();
 		}
 	if (adr==0x02)						//conin
 		{
-		while (stdio_get_state()==0);
+		cpm_boot_done();
+		con_flush();
+		vwin_sync(1);
+		cpm_turn_done();
+		while (stdio_get_state()==0)
+			{
+#ifdef	CPM_FTL
+			ftl_idle();
+#endif
+#ifdef	RAMDISK_PERSIST
+			ramdisk_idle();
+#endif
+			}
 		stdio_get(sstr);
+		if ((sstr[0]=='\r')||(sstr[0]==K_ENT)) cpm_turn_start();
 		return sstr[0];
 		}
 	if (adr==0x07)
 		{
 		return read_disk_byte();
 		}
+	if (adr==0x0C)						//disk status, 0 = OK
+		{
+		return disk_get_status();
+		}
+	if (adr==YM_PORT)					//result of YMODEM transfer
+		{
+		return ym_cpm_status();
+		}
+	if (adr==VWIN_PORT)					//video window page, 0 = off
+		{
+		return vwin_get();
+		}
 	//B_CPM001
 	if (adr==0x0A)						//reader device
 		{
@@ -113,6 +141,7 @@ if (iosim_mode==IO_BASIC_MODE)
 //  IN 1 reads data from serial port
 	if (adr==0x00)	
 		{		
+		con_flush();
 		if (stdio_get_state()==0)
 			return 0x02;
 		else
@@ -120,6 +149,7 @@ if (iosim_mode==IO_BASIC_MODE)
 		}	
 	if (adr==0x01)	
 		{		
+		con_flush();
 		stdio_get(sstr);
 		return sstr[0];
 		}
@@ -139,7 +169,7 @@ if (iosim_mode==IO_CPM_MODE)
 	{		
 	if (adr==0x03)						//concout device
 		{
-		stdio_c(data);
+		con_put(data);
 		}
 	if (adr==0x04)
 		{
@@ -157,6 +187,11 @@ if (iosim_mode==IO_CPM_MODE)
 		{
 		write_disk_byte(data);
 		}
+	if (adr==YM_PORT)					//YMODEM transfer, DE = FCB, B = user
+		{
+		con_flush();
+		ym_cpm_cmd(data,ram+((((uint16_t)(D))<<8)|E),B);
+		}
 	//B_CPM002
 	if (adr==0x09)					//punch device
 		{
@@ -170,16 +205,29 @@ if (iosim_mode==IO_CPM_MODE)
 		{
 		tx_write(data);
 		}
+	if (adr==VWIN_PORT)					//video window at page, 0 = off
+		{
+		con_flush();
+		vwin_set(data);
+		}
 	if (adr==0xFF)
 		{
+		cpm_boot_start(0);
+		vwin_set(0);
 		reload_cpm_warm();
 		}
+#ifdef	HOST_BUILD
+	if (adr==HOST_BDOS_PORT)
+		{
+		host_bdos_trap();
+		}
+#endif
 	}
 if (iosim_mode==IO_BASIC_MODE)
 	{
 	if (adr==0x01)						//concout device
 		{
-		stdio_c(data);
+		con_put(data);
 		}	
 	}
 }
@@ -0,0 +1,382 @@
+#include "rdc.h"
+#include <plib.h>
+#include "hwz.h"
+#include "rdz.h"
+#include "sim.h"
+#include "simglb.h"
+
+#ifdef	RAMDISK_COMPRESSED
+
+extern uint8_t ram_disk[RAMDISK_SIZE];
+#ifdef	USE_ROMDISK
+#ifdef	USE_ROMDISK_COMPRESSED
+extern const uint8_t rdz_image[];
+#endif
+#ifndef	USE_ROMDISK_COMPRESSED
+extern const uint8_t rd_image[131072];
+#endif
+#endif
+
+struct rdc_cache_entry
+{
+	uint16_t sect;
+	uint8_t age;
+	uint8_t data[RDC_SECT_SIZE];
+};
+
+struct rdc_cache_entry rdc_cache[RDC_CACHE_NUM];
+uint8_t rdc_buff[RDC_SECT_SIZE+3];
+uint32_t rdc_stat_reads, rdc_stat_hits, rdc_stat_writes, rdc_stat_fails;
+//blocks of disk A last written to, with sectors written since, see rdc_reserve
+uint16_t rdc_fill_blk[RDC_FILL];
+uint16_t rdc_fill_mask[RDC_FILL];
+
+static uint16_t rdc_get16 (uint16_t offs)
+{
+return ram_disk[offs] | (((uint16_t)(ram_disk[offs+1]))<<8);
+}
+
+static void rdc_put16 (uint16_t offs, uint16_t val)
+{
+ram_disk[offs] = val&0xFF;
+ram_disk[offs+1] = val>>8;
+ramdisk_mark(offs,2);
+}
+
+static uint16_t rdc_blk_offs (uint16_t blk)
+{
+return RDC_POOL + (blk*RDC_BLK_SIZE);
+}
+
+static void rdc_set_index (uint16_t sect, uint8_t len, uint16_t head)
+{
+uint16_t offs;
+offs = RDC_INDEX + (sect*3);
+ram_disk[offs] = len;
+ram_disk[offs+1] = head&0xFF;
+ram_disk[offs+2] = head>>8;
+ramdisk_mark(offs,3);
+}
+
+//return chain to free list
+static void rdc_free_chain (uint16_t blk)
+{
+uint16_t next;
+while (blk!=RDC_NONE)
+	{
+	next = rdc_get16(rdc_blk_offs(blk));
+	rdc_put16(rdc_blk_offs(blk),rdc_get16(4));
+	rdc_put16(4,blk);
+	rdc_put16(6,rdc_get16(6)+1);
+	blk = next;
+	}
+}
+
+static uint16_t rdc_chain_len (uint8_t len)
+{
+if (len==0) return 0;
+return (len+RDC_BLK_DATA-1)/RDC_BLK_DATA;
+}
+
+//build empty disk, every sector reads as 0xE5
+static void rdc_format (void)
+{
+uint16_t i;
+for (i=0;i<RDC_SECTS;i++) rdc_set_index(i,0,0xE5);
+for (i=0;i<RDC_BLOCKS;i++)
+	rdc_put16(rdc_blk_offs(i),(i==(RDC_BLOCKS-1))?RDC_NONE:(i+1));
+rdc_put16(4,0);
+rdc_put16(6,RDC_BLOCKS);
+ram_disk[0] = (RDC_MAGIC>>0)&0xFF;
+ram_disk[1] = (RDC_MAGIC>>8)&0xFF;
+ram_disk[2] = (RDC_MAGIC>>16)&0xFF;
+ram_disk[3] = (RDC_MAGIC>>24)&0xFF;
+ramdisk_mark(0,4);
+}
+
+static uint8_t rdc_valid (void)
+{
+return (ram_disk[0]==(RDC_MAGIC&0xFF))&&(ram_disk[1]==((RDC_MAGIC>>8)&0xFF))&&
+	(ram_disk[2]==((RDC_MAGIC>>16)&0xFF))&&(ram_disk[3]==((RDC_MAGIC>>24)&0xFF));
+}
+
+//called once ram_disk holds restored (or blank) content
+void rdc_init (void)
+{
+uint8_t i;
+for (i=0;i<RDC_CACHE_NUM;i++)
+	{
+	rdc_cache[i].sect = RDC_NONE;
+	rdc_cache[i].age = 0xFF;
+	}
+for (i=0;i<RDC_FILL;i++) rdc_fill_blk[i] = RDC_NONE;
+if (rdc_valid()==0) rdc_format();
+}
+
+//least recently used cache entry, or the one already holding sect
+static uint8_t rdc_cache_slot (uint16_t sect, uint8_t * hit)
+{
+uint8_t e,slot = 0;
+*hit = 0;
+for (e=0;e<RDC_CACHE_NUM;e++)
+	{
+	if (rdc_cache[e].age<0xFF) rdc_cache[e].age++;
+	if (rdc_cache[e].sect==sect)
+		{
+		slot = e;
+		*hit = 1;
+		}
+	}
+if (*hit==0)
+	for (e=1;e<RDC_CACHE_NUM;e++)
+		if (rdc_cache[e].age>rdc_cache[slot].age) slot = e;
+rdc_cache[slot].age = 0;
+rdc_cache[slot].sect = sect;
+return slot;
+}
+
+void rdc_read (uint16_t sect, uint8_t * data)
+{
+uint16_t offs,blk,n,i;
+uint8_t len,slot,hit;
+rdc_stat_reads++;
+if (sect>=RDC_SECTS)
+	{
+	for (i=0;i<RDC_SECT_SIZE;i++) data[i] = 0xE5;
+	return;
+	}
+slot = rdc_cache_slot(sect,&hit);
+if (hit)
+	{
+	rdc_stat_hits++;
+	for (i=0;i<RDC_SECT_SIZE;i++) data[i] = rdc_cache[slot].data[i];
+	return;
+	}
+offs = RDC_INDEX + (sect*3);
+len = ram_disk[offs];
+blk = ram_disk[offs+1] | (((uint16_t)(ram_disk[offs+2]))<<8);
+if (len==0)
+	for (i=0;i<RDC_SECT_SIZE;i++) data[i] = blk&0xFF;
+else
+	{
+	//gather chain, then decode
+	for (n=0;(n<len)&&(blk!=RDC_NONE);blk=rdc_get16(rdc_blk_offs(blk)))
+		for (i=0;(i<RDC_BLK_DATA)&&(n<len);i++) rdc_buff[n++] = ram_disk[rdc_blk_offs(blk)+2+i];
+	if (len==RDC_SECT_SIZE)
+		for (i=0;i<RDC_SECT_SIZE;i++) data[i] = rdc_buff[i];
+	else
+		rdz_lzss_decode(rdc_buff,len,data,RDC_SECT_SIZE);
+	}
+for (i=0;i<RDC_SECT_SIZE;i++) rdc_cache[slot].data[i] = data[i];
+}
+
+//returns 1 when there is not enough free space, old content is kept then
+uint8_t rdc_write (uint16_t sect, uint8_t * data)
+{
+uint16_t offs,old,blk,next,n,i,need;
+uint8_t len,old_len,slot,hit;
+const uint8_t * src;
+if (sect>=RDC_SECTS) return 1;
+rdc_stat_writes++;
+offs = RDC_INDEX + (sect*3);
+old_len = ram_disk[offs];
+old = ram_disk[offs+1] | (((uint16_t)(ram_disk[offs+2]))<<8);
+for (i=1;(i<RDC_SECT_SIZE)&&(data[i]==data[0]);i++);
+if (i==RDC_SECT_SIZE)
+	len = 0;
+else
+	{
+	len = rdz_lzss_encode(data,RDC_SECT_SIZE,rdc_buff,RDC_SECT_SIZE-1);
+	if (len==0) len = RDC_SECT_SIZE;
+	}
+need = rdc_chain_len(len);
+if (need>(rdc_get16(6)+rdc_chain_len(old_len)))
+	{
+	rdc_stat_fails++;
+	return 1;
+	}
+if (old_len!=0) rdc_free_chain(old);
+if (len==0)
+	rdc_set_index(sect,0,data[0]);
+else
+	{
+	src = (len==RDC_SECT_SIZE) ? data : rdc_buff;
+	//pop blocks from free list and fill them in order
+	blk = rdc_get16(4);
+	rdc_set_index(sect,len,blk);
+	for (n=0;n<len;)
+		{
+		next = rdc_get16(rdc_blk_offs(blk));
+		for (i=0;(i<RDC_BLK_DATA)&&(n<len);i++) ram_disk[rdc_blk_offs(blk)+2+i] = src[n++];
+		ramdisk_mark(rdc_blk_offs(blk)+2,i);
+		if (n>=len) rdc_put16(rdc_blk_offs(blk),RDC_NONE);
+		blk = next;
+		}
+	rdc_put16(4,blk);
+	rdc_put16(6,rdc_get16(6)-need);
+	}
+slot = rdc_cache_slot(sect,&hit);
+for (i=0;i<RDC_SECT_SIZE;i++) rdc_cache[slot].data[i] = data[i];
+return 0;
+}
+
+//disk A gets RDC_SECTS sectors, BIOS WRITE returns disk status port instead of 0.
+//Done on every warm boot, no file is left being written then
+void rdc_patch_bios (void)
+{
+uint8_t i;
+for (i=0;i<RDC_FILL;i++) rdc_fill_blk[i] = RDC_NONE;
+ram[RDC_DPB_ADDR+5] = ((RDC_SECTS/16)-1)&0xFF;
+ram[RDC_DPB_ADDR+6] = ((RDC_SECTS/16)-1)>>8;
+ram[RDC_BIOS_WR_RET] = 0xDB;
+ram[RDC_BIOS_WR_RET+1] = 0x0C;
+}
+
+//pool blocks that writing sector could still take, on top of what it holds
+static uint16_t rdc_sect_cost (uint16_t sect)
+{
+return rdc_chain_len(RDC_SECT_SIZE) - rdc_chain_len(ram_disk[RDC_INDEX+(sect*3)]);
+}
+
+//BDOS hands out blocks of disk A by its allocation vector, not by the pool, and
+//takes one block per sector it writes at most. After every write, free blocks
+//the pool can't fill at worst case (raw sectors) are marked as taken, so BDOS
+//reports disk full before the pool runs out. Left aside first: directory sectors
+//growing and unwritten sectors of last RDC_FILL blocks written to. Bits are only
+//ever set, login after warm boot builds vector from directory again and reads
+//of directory redo it. Called by BIOS after every write to disk A and every read
+void rdc_reserve (uint16_t sect, uint8_t wr)
+{
+uint8_t * dpb, * alv;
+uint16_t spb,dsm,dir,b,i,budget,c;
+uint32_t need;
+dpb = ram + RDC_DPB_ADDR;
+alv = ram + (ram[CPM_DPH+14] | (((uint16_t)(ram[CPM_DPH+15]))<<8));
+spb = 1<<dpb[2];
+dsm = dpb[5] | (((uint16_t)(dpb[6]))<<8);
+dir = ((dpb[7] | (((uint16_t)(dpb[8]))<<8)) + 4)/4;
+if ((spb>16)||((dsm+1)*spb>RDC_SECTS)) return;
+if ((wr==0)&&(sect>=dir)) return;
+b = sect/spb;
+if ((wr)&&(sect>=dir))
+	{
+	for (i=0;(i<RDC_FILL)&&(rdc_fill_blk[i]!=b);i++);
+	if (i==RDC_FILL)
+		{
+		for (i=RDC_FILL-1;i>0;i--)
+			{
+			rdc_fill_blk[i] = rdc_fill_blk[i-1];
+			rdc_fill_mask[i] = rdc_fill_mask[i-1];
+			}
+		rdc_fill_blk[0] = b;
+		rdc_fill_mask[0] = 0;
+		}
+	rdc_fill_mask[i] |= 1<<(sect%spb);
+	}
+need = 0;
+for (i=0;i<dir;i++) need += rdc_sect_cost(i);
+for (b=0;b<RDC_FILL;b++)
+	if (rdc_fill_blk[b]!=RDC_NONE)
+		for (i=0;i<spb;i++)
+			if ((rdc_fill_mask[b]&(1<<i))==0) need += rdc_sect_cost((rdc_fill_blk[b]*spb)+i);
+budget = 0;
+if (rdc_get16(6)>need) budget = rdc_get16(6) - need;
+for (b=0;b<=dsm;b++)
+	{
+	if (alv[b/8]&(0x80>>(b%8))) continue;
+	c = 0;
+	for (i=0;i<spb;i++) c += rdc_sect_cost((b*spb)+i);
+	if (c>budget) alv[b/8] |= 0x80>>(b%8);
+	}
+}
+
+void rdc_get_usage (uint16_t * used_sects, uint16_t * free_blk, uint32_t * stored)
+{
+uint16_t i;
+*used_sects = 0;
+*stored = 0;
+//disk A not set up until CP/M is started, it is formatted empty then
+*free_blk = RDC_BLOCKS;
+if (rdc_valid()==0) return;
+for (i=0;i<RDC_SECTS;i++)
+	{
+	if ((ram_disk[RDC_INDEX+(i*3)]==0)&&(ram_disk[RDC_INDEX+(i*3)+1]==0xE5)) continue;
+	(*used_sects)++;
+	*stored += ram_disk[RDC_INDEX+(i*3)];
+	}
+*free_blk = rdc_get16(6);
+}
+
+//compress sectors of ROM disk B (or Z80 memory without it) the same way rdc_write does,
+//without touching disk A. Reports pool blocks those sectors would take and coder timing
+void rdc_bench (uint16_t sects, struct rdc_bench_result * res)
+{
+uint8_t data[RDC_SECT_SIZE],check[RDC_SECT_SIZE];
+uint16_t s,i,len;
+uint32_t t,enc_ticks = 0,dec_ticks = 0;
+res->sects = sects;
+res->fill = 0;
+res->raw = 0;
+res->blocks = 0;
+res->errors = 0;
+res->enc_max_us = 0;
+res->dec_max_us = 0;
+for (s=0;s<sects;s++)
+	{
+#ifdef	USE_ROMDISK
+#ifdef	USE_ROMDISK_COMPRESSED
+	rd_read_128(rdz_image,((uint32_t)(s))*RDC_SECT_SIZE,data);
+#endif
+#ifndef	USE_ROMDISK_COMPRESSED
+	for (i=0;i<RDC_SECT_SIZE;i++) data[i] = rd_image[(((uint32_t)(s))*RDC_SECT_SIZE)+i];
+#endif
+#endif
+#ifndef	USE_ROMDISK
+	for (i=0;i<RDC_SECT_SIZE;i++) data[i] = ram[((s*RDC_SECT_SIZE)+i)&0xFFFF];
+#endif
+	for (i=1;(i<RDC_SECT_SIZE)&&(data[i]==data[0]);i++);
+	if (i==RDC_SECT_SIZE)
+		{
+		res->fill++;
+		continue;
+		}
+	t = _CP0_GET_COUNT();
+	len = rdz_lzss_encode(data,RDC_SECT_SIZE,rdc_buff,RDC_SECT_SIZE-1);
+	t = _CP0_GET_COUNT() - t;
+	enc_ticks += t;
+	if ((t/CORE_TICKS_US)>res->enc_max_us) res->enc_max_us = t/CORE_TICKS_US;
+	if (len==0)
+		{
+		res->raw++;
+		len = RDC_SECT_SIZE;
+		}
+	else
+		{
+		t = _CP0_GET_COUNT();
+		rdz_lzss_decode(rdc_buff,len,check,RDC_SECT_SIZE);
+		t = _CP0_GET_COUNT() - t;
+		dec_ticks += t;
+		if ((t/CORE_TICKS_US)>res->dec_max_us) res->dec_max_us = t/CORE_TICKS_US;
+		for (i=0;i<RDC_SECT_SIZE;i++)
+			if (check[i]!=data[i]) break;
+		if (i<RDC_SECT_SIZE) res->errors++;
+		}
+	res->blocks += rdc_chain_len(len);
+	}
+res->enc_avg_us = 0;
+res->dec_avg_us = 0;
+if (sects>res->fill)
+	res->enc_avg_us = (enc_ticks/(sects-res->fill))/CORE_TICKS_US;
+if (sects>(res->fill+res->raw))
+	res->dec_avg_us = (dec_ticks/(sects-res->fill-res->raw))/CORE_TICKS_US;
+}
+
+void rdc_get_stats (uint32_t * reads, uint32_t * hits, uint32_t * writes, uint32_t * fails)
+{
+*reads = rdc_stat_reads;
+*hits = rdc_stat_hits;
+*writes = rdc_stat_writes;
+*fails = rdc_stat_fails;
+}
+
+#endif
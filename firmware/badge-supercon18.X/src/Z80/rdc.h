@@ -0,0 +1,62 @@
+#ifndef		__RDC_H
+#define		__RDC_H
+
+#include <stdint.h>
+#include "hwz.h"
+
+/*
+ * Compressed RAM disk, everything lives in ram_disk[] so RAMDISK_PERSIST
+ * keeps working unchanged
+ * 0..7			header: magic, head of free block list, free block count
+ * 8..			sector index, 3 bytes per logical sector: len, head lo, head hi
+ *				len 0 - sector filled by single value kept in head lo
+ *				len 1..RDC_SECT_SIZE-1 - LZSS stream in block chain
+ *				len RDC_SECT_SIZE - raw sector in block chain
+ * RDC_POOL..	32B blocks: next block lo, next block hi, 30 data bytes
+ * Disk A is overcommitted, its RDC_SECTS logical sectors don't fit the pool
+ * unless they compress. rdc_reserve keeps BDOS from taking blocks the pool
+ * can't fill, free space STAT shows drops to 0k all at once when pool is
+ * short. A sector rewritten bigger in place can still fail as BAD SECTOR.
+ */
+
+#define		RDC_SECT_SIZE	128
+//logical size of disk A, 64k is the most that fits allocation vector in BIOS
+#define		RDC_SECTS		512
+#define		RDC_MAGIC		0x31434452
+#define		RDC_INDEX		8
+#define		RDC_POOL		((RDC_INDEX+(RDC_SECTS*3)+31)&0xFFE0)
+#define		RDC_BLK_SIZE	32
+#define		RDC_BLK_DATA	(RDC_BLK_SIZE-2)
+#define		RDC_BLOCKS		((RAMDISK_SIZE-RDC_POOL)/RDC_BLK_SIZE)
+#define		RDC_NONE		0xFFFF
+#define		RDC_CACHE_NUM	4
+//blocks of disk A kept as being written to, see rdc_reserve
+#define		RDC_FILL		2
+
+//DPB of disk A and return of BIOS WRITE, patched to report full pool as write error
+#define		RDC_DPB_ADDR	0xEF38
+#define		RDC_BIOS_WR_RET	0xF023
+
+struct rdc_bench_result
+{
+	uint16_t sects;
+	uint16_t fill;
+	uint16_t raw;
+	uint16_t errors;
+	uint32_t blocks;
+	uint32_t enc_avg_us;
+	uint32_t enc_max_us;
+	uint32_t dec_avg_us;
+	uint32_t dec_max_us;
+};
+
+void rdc_init (void);
+void rdc_read (uint16_t sect, uint8_t * data);
+uint8_t rdc_write (uint16_t sect, uint8_t * data);
+void rdc_patch_bios (void);
+void rdc_reserve (uint16_t sect, uint8_t wr);
+void rdc_get_usage (uint16_t * used_sects, uint16_t * free_blk, uint32_t * stored);
+void rdc_bench (uint16_t sects, struct rdc_bench_result * res);
+void rdc_get_stats (uint32_t * reads, uint32_t * hits, uint32_t * writes, uint32_t * fails);
+
+#endif
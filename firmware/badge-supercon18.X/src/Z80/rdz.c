@@ -0,0 +1,184 @@
+#include "rdz.h"
+
+//decoder of compressed ROM disks, also linked into romdisk_pack host tool for verification
+
+struct rdz_cache_entry
+{
+	const uint8_t * img;
+	uint16_t chunk;
+	uint8_t age;
+	uint8_t data[RDZ_CHUNK_MAX];
+};
+
+struct rdz_cache_entry rdz_cache[RDZ_CACHE_NUM];
+uint32_t rdz_stat_reads, rdz_stat_misses;
+
+static uint32_t rdz_get32 (const uint8_t * p)
+{
+return ((uint32_t)(p[0])) | (((uint32_t)(p[1]))<<8) | (((uint32_t)(p[2]))<<16) | (((uint32_t)(p[3]))<<24);
+}
+
+uint16_t rdz_chunk_size (const uint8_t * img)
+{
+return img[0] | (((uint16_t)(img[1]))<<8);
+}
+
+uint16_t rdz_chunk_count (const uint8_t * img)
+{
+return img[2] | (((uint16_t)(img[3]))<<8);
+}
+
+//decode LZSS stream of srclen bytes, producing up to size bytes
+uint16_t rdz_lzss_decode (const uint8_t * src, uint16_t srclen, uint8_t * out, uint16_t size)
+{
+const uint8_t * end;
+uint16_t pos,dist,len,i;
+uint8_t flags,bit;
+end = src + srclen;
+pos = 0;
+flags = 0;
+bit = 0;
+while ((pos<size)&&(src<end))
+	{
+	if (bit==0)
+		{
+		flags = *src++;
+		bit = 8;
+		}
+	bit--;
+	if (flags&0x01)
+		out[pos++] = *src++;
+	else
+		{
+		dist = src[0] | (((uint16_t)(src[1]&0x0F))<<8);
+		len = (src[1]>>4) + RDZ_MIN_MATCH;
+		src += 2;
+		if (dist>pos) return pos;
+		for (i=0;(i<len)&&(pos<size);i++,pos++) out[pos] = out[pos-dist];
+		}
+	flags = flags>>1;
+	}
+return pos;
+}
+
+static void rdz_find_match (const uint8_t * in, uint16_t pos, uint16_t size, uint16_t * best_len, uint16_t * best_dist)
+{
+uint16_t d,l,max;
+*best_len = 0;
+*best_dist = 0;
+max = size - pos;
+if (max>RDZ_MAX_MATCH) max = RDZ_MAX_MATCH;
+for (d=1;(d<=pos)&&(d<=RDZ_MAX_DIST);d++)
+	{
+	for (l=0;(l<max)&&(in[pos+l]==in[pos+l-d]);l++);
+	if (l>*best_len)
+		{
+		*best_len = l;
+		*best_dist = d;
+		if (l==max) break;
+		}
+	}
+}
+
+//greedy LZSS with one step lazy matching, returns 0 if output would exceed max bytes
+//out has to have room for max+3 bytes
+uint16_t rdz_lzss_encode (const uint8_t * in, uint16_t size, uint8_t * out, uint16_t max)
+{
+uint16_t pos = 0, o = 0, flag_pos = 0, len, dist, len2, dist2;
+uint8_t bit = 8;
+while (pos<size)
+	{
+	if (bit==8)
+		{
+		flag_pos = o++;
+		out[flag_pos] = 0;
+		bit = 0;
+		}
+	rdz_find_match(in,pos,size,&len,&dist);
+	if ((len>=RDZ_MIN_MATCH)&&((pos+1)<size))
+		{
+		rdz_find_match(in,pos+1,size,&len2,&dist2);
+		if (len2>(len+1)) len = 0;
+		}
+	if (len>=RDZ_MIN_MATCH)
+		{
+		out[o++] = dist&0xFF;
+		out[o++] = ((dist>>8)&0x0F) | ((len-RDZ_MIN_MATCH)<<4);
+		pos += len;
+		}
+	else
+		{
+		out[flag_pos] |= 1<<bit;
+		out[o++] = in[pos++];
+		}
+	bit++;
+	if (o>max) return 0;
+	}
+return o;
+}
+
+//decode one chunk into out, returns number of bytes produced
+uint16_t rdz_decode_chunk (const uint8_t * img, uint16_t chunk, uint8_t * out)
+{
+const uint8_t * src;
+uint32_t start,end;
+uint16_t size,i;
+size = rdz_chunk_size(img);
+start = rdz_get32(img+RDZ_HDR_LEN+(((uint32_t)(chunk))*4));
+end = rdz_get32(img+RDZ_HDR_LEN+(((uint32_t)(chunk))*4)+4);
+src = img + start;
+if (*src==RDZ_CHUNK_FILL)
+	{
+	for (i=0;i<size;i++) out[i] = src[1];
+	return size;
+	}
+if (*src==RDZ_CHUNK_RAW)
+	{
+	src++;
+	for (i=0;i<size;i++) out[i] = *src++;
+	return size;
+	}
+return rdz_lzss_decode(src+1,end-start-1,out,size);
+}
+
+//read n bytes at addr of uncompressed image, n must not cross chunk boundary
+//returns 1 on cache hit
+uint8_t rdz_read (const uint8_t * img, uint32_t addr, uint8_t * data, uint16_t n)
+{
+uint16_t chunk,offs,i;
+uint8_t e,hit = 0xFF;
+chunk = addr / rdz_chunk_size(img);
+offs = addr % rdz_chunk_size(img);
+rdz_stat_reads++;
+for (e=0;e<RDZ_CACHE_NUM;e++)
+	{
+	if (rdz_cache[e].age<0xFF) rdz_cache[e].age++;
+	if ((rdz_cache[e].img==img)&&(rdz_cache[e].chunk==chunk)) hit = e;
+	}
+if (hit==0xFF)
+	{
+	rdz_stat_misses++;
+	//evict the least recently used entry
+	hit = 0;
+	for (e=1;e<RDZ_CACHE_NUM;e++)
+		if (rdz_cache[e].age>rdz_cache[hit].age) hit = e;
+	if (chunk<rdz_chunk_count(img))
+		rdz_decode_chunk(img,chunk,rdz_cache[hit].data);
+	else
+		for (i=0;i<RDZ_CHUNK_MAX;i++) rdz_cache[hit].data[i] = 0xE5;
+	rdz_cache[hit].img = img;
+	rdz_cache[hit].chunk = chunk;
+	rdz_cache[hit].age = 0;
+	for (i=0;i<n;i++) data[i] = rdz_cache[hit].data[offs+i];
+	return 0;
+	}
+rdz_cache[hit].age = 0;
+for (i=0;i<n;i++) data[i] = rdz_cache[hit].data[offs+i];
+return 1;
+}
+
+void rdz_get_stats (uint32_t * reads, uint32_t * misses)
+{
+*reads = rdz_stat_reads;
+*misses = rdz_stat_misses;
+}
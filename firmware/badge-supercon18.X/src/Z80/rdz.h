@@ -0,0 +1,37 @@
+#ifndef		__RDZ_H
+#define		__RDZ_H
+
+#include <stdint.h>
+
+/*
+ * Compressed ROM disk image, produced by romdisk_pack host tool
+ * 0..1		chunk size
+ * 2..3		chunk count
+ * 4..		chunk offsets, uint32, count+1 of them, relative to image start
+ * then chunks, each decodable on its own, first byte is chunk type
+ */
+
+#define		RDZ_HDR_LEN		4
+
+#define		RDZ_CHUNK_RAW	0
+#define		RDZ_CHUNK_FILL	1
+#define		RDZ_CHUNK_LZSS	2
+
+//LZSS match is 2 bytes: 12 bits of distance, 4 bits of length-RDZ_MIN_MATCH
+#define		RDZ_MIN_MATCH	3
+#define		RDZ_MAX_MATCH	(15+RDZ_MIN_MATCH)
+#define		RDZ_MAX_DIST	4095
+
+//decompressed chunk cache, RDZ_CACHE_NUM*RDZ_CHUNK_MAX bytes of RAM
+#define		RDZ_CHUNK_MAX	1024
+#define		RDZ_CACHE_NUM	3
+
+uint16_t rdz_chunk_size (const uint8_t * img);
+uint16_t rdz_chunk_count (const uint8_t * img);
+uint16_t rdz_lzss_decode (const uint8_t * src, uint16_t srclen, uint8_t * out, uint16_t size);
+uint16_t rdz_lzss_encode (const uint8_t * in, uint16_t size, uint8_t * out, uint16_t max);
+uint16_t rdz_decode_chunk (const uint8_t * img, uint16_t chunk, uint8_t * out);
+uint8_t rdz_read (const uint8_t * img, uint32_t addr, uint8_t * data, uint16_t n);
+void rdz_get_stats (uint32_t * reads, uint32_t * misses);
+
+#endif
@@ -44,7 +44,7 @@ long R;				/* Z80 refresh register */
 /*
  *	Variables for memory of the emulated CPU
  */
-BYTE ram[65536L];		/* 64KB for all other OS's */
+BYTE ram[65536L] __attribute__((aligned(4)));	/* 64KB for all other OS's, word aligned for memcpy */
 BYTE *wrk_ram;			/* workpointer into memory for dump etc. */
 
 /*
@@ -0,0 +1,396 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "hwz.h"
+#include "cpmfs.h"
+#include "ymodem.h"
+
+#define		YM_SOH			0x01
+#define		YM_STX			0x02
+#define		YM_EOT			0x04
+#define		YM_ACK			0x06
+#define		YM_NAK			0x15
+#define		YM_CAN			0x18
+#define		YM_CRC			'C'
+
+//timeouts in ms
+#define		YM_CHAR_MS		1000
+#define		YM_PACKET_MS	5000
+#define		YM_PURGE_MS		200
+#define		YM_START_MS		60000
+//retries of one packet, 'C' polls while waiting for sender (1 s apart)
+#define		YM_MAX_ERRORS	10
+#define		YM_START_TRIES	60
+
+//ym_getc and ym_packet results besides data
+#define		YM_NONE			-1
+#define		YM_ABORT		-2
+#define		YM_PKT_EOT		-3
+#define		YM_PKT_CAN		-4
+#define		YM_PKT_BAD		-5
+
+uint32_t millis(void);
+
+uint8_t (*ym_cancel)(void);
+void (*ym_progress)(const char * name, uint32_t bytes);
+
+struct cpmfs ym_fs;
+struct cpmfs_file ym_file;
+uint8_t ym_buf[1024];
+char ym_name[13];
+uint8_t ym_cpm_result;
+
+static int16_t ym_getc (uint32_t ms)
+{
+uint32_t t;
+t = millis();
+do
+	{
+	if (rx_sta()) return rx_read();
+	if ((ym_cancel!=NULL)&&(ym_cancel())) return YM_ABORT;
+	}
+while ((millis()-t)<ms);
+return YM_NONE;
+}
+
+//wait until line is quiet, rest of broken packet is dropped
+static void ym_purge (void)
+{
+while (ym_getc(YM_PURGE_MS)>=0);
+}
+
+//abort transfer on both sides
+static void ym_abort (void)
+{
+uint8_t i;
+for (i=0;i<5;i++) tx_write(YM_CAN);
+for (i=0;i<5;i++) tx_write(0x08);
+}
+
+static uint16_t ym_crc (uint16_t crc, uint8_t c)
+{
+uint8_t i;
+crc ^= ((uint16_t)(c))<<8;
+for (i=0;i<8;i++)
+	{
+	if (crc&0x8000) crc = (crc<<1) ^ 0x1021;
+	else crc = crc<<1;
+	}
+return crc;
+}
+
+//receive one packet into ym_buf, returns its length or YM_NONE, YM_ABORT, YM_PKT_*
+static int16_t ym_packet (uint8_t * blk, uint32_t ms)
+{
+int16_t c, hdr[2];
+uint16_t len, i, crc;
+c = ym_getc(ms);
+if (c<0) return c;
+if (c==YM_EOT) return YM_PKT_EOT;
+if (c==YM_CAN) return (ym_getc(YM_CHAR_MS)==YM_CAN) ? YM_PKT_CAN : YM_PKT_BAD;
+if (c==YM_SOH) len = 128;
+else if (c==YM_STX) len = 1024;
+else return YM_PKT_BAD;
+for (i=0;i<2;i++)
+	{
+	hdr[i] = ym_getc(YM_CHAR_MS);
+	if (hdr[i]==YM_ABORT) return YM_ABORT;
+	if (hdr[i]<0) return YM_PKT_BAD;
+	}
+crc = 0;
+for (i=0;i<len;i++)
+	{
+	c = ym_getc(YM_CHAR_MS);
+	if (c==YM_ABORT) return YM_ABORT;
+	if (c<0) return YM_PKT_BAD;
+	ym_buf[i] = c;
+	crc = ym_crc(crc,c);
+	}
+for (i=0;i<2;i++)
+	{
+	c = ym_getc(YM_CHAR_MS);
+	if (c==YM_ABORT) return YM_ABORT;
+	if (c<0) return YM_PKT_BAD;
+	crc = ym_crc(crc,c);
+	}
+if ((crc!=0)||((hdr[0]^hdr[1])!=0xFF)) return YM_PKT_BAD;
+*blk = hdr[0];
+return len;
+}
+
+//block 0: "name\0size ...\0", path is dropped
+static uint8_t ym_parse_header (uint8_t * name, uint32_t * size, uint8_t * have_size)
+{
+char * p, * base;
+ym_buf[127] = 0;
+base = (char *)ym_buf;
+for (p=base;*p!=0;p++)
+	if ((*p=='/')||(*p=='\\')) base = p+1;
+strncpy(ym_name,base,sizeof(ym_name)-1);
+ym_name[sizeof(ym_name)-1] = 0;
+if (cpmfs_name(base,name)!=CPMFS_OK) return YM_ERR_NAME;
+p++;
+*size = 0;
+*have_size = ((*p>='0')&&(*p<='9'));
+for (;(*p>='0')&&(*p<='9');p++) *size = (*size)*10 + (*p-'0');
+return YM_OK;
+}
+
+//store data of packet, size from header (if any) cuts padding of last packet
+static uint8_t ym_store (uint16_t len, uint32_t * left, uint8_t have_size, struct ym_stat * st)
+{
+uint16_t i, n;
+for (i=0;i<len;i+=128)
+	{
+	n = 128;
+	if (have_size)
+		{
+		if (*left==0) break;
+		if (*left<128)
+			{
+			n = *left;
+			memset(ym_buf+i+n,0x1A,128-n);
+			}
+		*left -= n;
+		}
+	if (cpmfs_write(&ym_file,ym_buf+i)!=CPMFS_OK) return YM_ERR_DISK;
+	st->bytes += n;
+	}
+return YM_OK;
+}
+
+static uint8_t ym_fail (uint8_t err, uint8_t * name, uint8_t user)
+{
+ym_abort();
+if (name!=NULL)
+	{
+	//no truncated file left behind
+	cpmfs_close(&ym_file);
+	cpmfs_delete(&ym_fs,user,name);
+	fl_flush();
+	}
+return err;
+}
+
+uint8_t ym_receive (uint8_t drv, uint8_t user, struct ym_stat * st)
+{
+uint8_t name[11], blk, expect, have_size, eot, errors, ret;
+uint32_t size, t;
+int16_t len;
+memset(st,0,sizeof(struct ym_stat));
+t = millis();
+if (cpm_drive_attach(&ym_fs,drv,1)!=CPMFS_OK) return YM_ERR_DRIVE;
+while (1)
+	{
+	//block 0 with name of next file, empty name ends batch
+	for (errors=0;errors<YM_START_TRIES;errors++)
+		{
+		tx_write(YM_CRC);
+		len = ym_packet(&blk,1000);
+		if ((len>0)&&(blk==0)) break;
+		if (len==YM_ABORT) return ym_fail(YM_ERR_CANCEL,NULL,user);
+		if (len==YM_PKT_CAN) return YM_ERR_CANCEL;
+		//sender still finishing previous file
+		if (len==YM_PKT_EOT) tx_write(YM_ACK);
+		if (len==YM_PKT_BAD) ym_purge();
+		}
+	if (errors==YM_START_TRIES) return ym_fail(YM_ERR_TIMEOUT,NULL,user);
+	if (ym_buf[0]==0)
+		{
+		tx_write(YM_ACK);
+		st->ms = millis() - t;
+		return YM_OK;
+		}
+	ret = ym_parse_header(name,&size,&have_size);
+	if (ret!=YM_OK) return ym_fail(ret,NULL,user);
+	cpmfs_delete(&ym_fs,user,name);
+	if (cpmfs_create(&ym_fs,&ym_file,user,name)!=CPMFS_OK) return ym_fail(YM_ERR_DISK,NULL,user);
+	if (ym_progress!=NULL) ym_progress(ym_name,0);
+	tx_write(YM_ACK);
+	tx_write(YM_CRC);
+	expect = 1;
+	eot = 0;
+	errors = 0;
+	while (1)
+		{
+		len = ym_packet(&blk,YM_PACKET_MS);
+		if (len==YM_ABORT) return ym_fail(YM_ERR_CANCEL,name,user);
+		if (len==YM_PKT_CAN)
+			{
+			cpmfs_close(&ym_file);
+			cpmfs_delete(&ym_fs,user,name);
+			fl_flush();
+			return YM_ERR_CANCEL;
+			}
+		if (len==YM_PKT_EOT)
+			{
+			//first EOT is NAKed, a real one comes again
+			if (eot)
+				{
+				tx_write(YM_ACK);
+				break;
+				}
+			eot = 1;
+			tx_write(YM_NAK);
+			continue;
+			}
+		if ((len==YM_NONE)||(len==YM_PKT_BAD))
+			{
+			if (++errors>=YM_MAX_ERRORS) return ym_fail(YM_ERR_TIMEOUT,name,user);
+			st->retries++;
+			ym_purge();
+			tx_write((expect==1) ? YM_CRC : YM_NAK);
+			continue;
+			}
+		eot = 0;
+		if (blk==((uint8_t)(expect-1)))
+			{
+			//our ACK got lost, sender repeats
+			tx_write(YM_ACK);
+			if (blk==0) tx_write(YM_CRC);
+			continue;
+			}
+		if (blk!=expect) return ym_fail(YM_ERR_PROTO,name,user);
+		if (ym_store(len,&size,have_size,st)!=YM_OK) return ym_fail(YM_ERR_DISK,name,user);
+		if (ym_progress!=NULL) ym_progress(ym_name,st->bytes);
+		tx_write(YM_ACK);
+		expect++;
+		errors = 0;
+		}
+	if (cpmfs_close(&ym_file)!=CPMFS_OK) return ym_fail(YM_ERR_DISK,NULL,user);
+	fl_flush();
+	st->files++;
+	}
+}
+
+//receiver asks for next block 0 or for data with 'C'
+static uint8_t ym_wait_start (void)
+{
+uint32_t t;
+int16_t c;
+t = millis();
+while ((millis()-t)<YM_START_MS)
+	{
+	c = ym_getc(YM_CHAR_MS);
+	if (c==YM_CRC) return YM_OK;
+	if (c==YM_ABORT) return YM_ERR_CANCEL;
+	if ((c==YM_CAN)&&(ym_getc(YM_CHAR_MS)==YM_CAN)) return YM_ERR_CANCEL;
+	}
+return YM_ERR_TIMEOUT;
+}
+
+static uint8_t ym_send_packet (uint8_t blk, uint16_t len, struct ym_stat * st)
+{
+uint16_t i, crc;
+uint8_t errors;
+int16_t c;
+for (errors=0;errors<YM_MAX_ERRORS;errors++)
+	{
+	tx_write((len==1024) ? YM_STX : YM_SOH);
+	tx_write(blk);
+	tx_write(~blk);
+	crc = 0;
+	for (i=0;i<len;i++)
+		{
+		tx_write(ym_buf[i]);
+		crc = ym_crc(crc,ym_buf[i]);
+		}
+	tx_write(crc>>8);
+	tx_write(crc);
+	c = ym_getc(YM_PACKET_MS);
+	if (c==YM_ACK) return YM_OK;
+	if (c==YM_ABORT) return YM_ERR_CANCEL;
+	if ((c==YM_CAN)&&(ym_getc(YM_CHAR_MS)==YM_CAN)) return YM_ERR_CANCEL;
+	st->retries++;
+	ym_purge();
+	}
+return YM_ERR_TIMEOUT;
+}
+
+uint8_t ym_send (uint8_t drv, uint8_t user, const uint8_t * name, struct ym_stat * st)
+{
+uint8_t nm[11], blk, n, ret;
+uint32_t t;
+char * p;
+int16_t c;
+memset(st,0,sizeof(struct ym_stat));
+t = millis();
+if (cpm_drive_attach(&ym_fs,drv,0)!=CPMFS_OK) return YM_ERR_DRIVE;
+for (n=0;n<11;n++) nm[n] = name[n]&0x7F;
+if (cpmfs_open(&ym_fs,&ym_file,user,nm)!=CPMFS_OK) return YM_ERR_NOFILE;
+cpmfs_name_str(nm,ym_name);
+for (p=ym_name;*p!=0;p++)
+	if ((*p>='A')&&(*p<='Z')) *p = *p - 'A' + 'a';
+ret = ym_wait_start();
+if (ret!=YM_OK) return ym_fail(ret,NULL,user);
+memset(ym_buf,0,128);
+strcpy((char *)ym_buf,ym_name);
+sprintf((char *)ym_buf+strlen(ym_name)+1,"%lu",(unsigned long)(ym_file.size*128UL));
+ret = ym_send_packet(0,128,st);
+if (ret==YM_OK) ret = ym_wait_start();
+if (ret!=YM_OK) return ym_fail(ret,NULL,user);
+if (ym_progress!=NULL) ym_progress(ym_name,0);
+blk = 1;
+while (1)
+	{
+	for (n=0;n<8;n++)
+		{
+		ret = cpmfs_read(&ym_file,ym_buf+(n*128));
+		if (ret!=CPMFS_OK) break;
+		}
+	if ((ret!=CPMFS_OK)&&(ret!=CPMFS_ERR_NOFILE)) return ym_fail(YM_ERR_DISK,NULL,user);
+	if (n==0) break;
+	//short tail goes in 1k packet too, receiver cuts it by size
+	if (n>1) memset(ym_buf+(n*128),0x1A,1024-(n*128));
+	ret = ym_send_packet(blk++,(n>1)?1024:128,st);
+	if (ret!=YM_OK) return ym_fail(ret,NULL,user);
+	st->bytes += n*128UL;
+	if (ym_progress!=NULL) ym_progress(ym_name,st->bytes);
+	if (n<8) break;
+	}
+for (n=0;n<YM_MAX_ERRORS;n++)
+	{
+	tx_write(YM_EOT);
+	c = ym_getc(YM_PACKET_MS);
+	if (c==YM_ACK) break;
+	if (c==YM_ABORT) return ym_fail(YM_ERR_CANCEL,NULL,user);
+	}
+if (n==YM_MAX_ERRORS) return ym_fail(YM_ERR_TIMEOUT,NULL,user);
+//empty block 0 ends batch
+ret = ym_wait_start();
+memset(ym_buf,0,128);
+if (ret==YM_OK) ret = ym_send_packet(0,128,st);
+if (ret!=YM_OK) return ym_fail(ret,NULL,user);
+st->files = 1;
+st->ms = millis() - t;
+return YM_OK;
+}
+
+//called from port YM_PORT of Z80, see ymodem.h
+void ym_cpm_cmd (uint8_t cmd, uint8_t * fcb, uint8_t user)
+{
+struct ym_stat st;
+if (cmd==YM_CMD_RECV)
+	ym_cpm_result = ym_receive(fcb[0]-1,user&0x0F,&st);
+else if (cmd==YM_CMD_SEND)
+	ym_cpm_result = ym_send(fcb[0]-1,user&0x0F,fcb+1,&st);
+else
+	ym_cpm_result = YM_ERR_PROTO;
+}
+
+uint8_t ym_cpm_status (void)
+{
+return ym_cpm_result;
+}
+
+const char * ym_err_str (uint8_t err)
+{
+if (err==YM_OK) return "OK";
+if (err==YM_ERR_TIMEOUT) return "timeout";
+if (err==YM_ERR_CANCEL) return "cancelled";
+if (err==YM_ERR_DISK) return "disk error or disk full";
+if (err==YM_ERR_NOFILE) return "no such file";
+if (err==YM_ERR_NAME) return "bad file name";
+if (err==YM_ERR_DRIVE) return "bad drive";
+return "protocol error";
+}
@@ -0,0 +1,51 @@
+#ifndef		__YMODEM_H
+#define		__YMODEM_H
+
+#include <stdint.h>
+
+/*
+ * YMODEM-1K with CRC-16 over serial port, files are written straight into
+ * CP/M drive through cpmfs and the disk code of hwz.c, so FLASH drives get
+ * whole 4k blocks programmed at once (FLASH_BUFFERING, FTL).
+ * Receive takes a batch of files, send transmits one file.
+ *
+ * CP/M side, port YM_PORT:
+ * OUT	YM_CMD_RECV or YM_CMD_SEND, DE points to FCB, its drive byte (1=A)
+ *		selects the drive, name is file to send; B holds user number
+ * IN	result of last transfer, YM_OK or YM_ERR_*
+ * Program has to reset disk system (BDOS 13) after receive, so BDOS
+ * reads the new directory.
+ */
+
+#define		YM_PORT				0x0D
+#define		YM_CMD_RECV			1
+#define		YM_CMD_SEND			2
+
+#define		YM_OK				0
+#define		YM_ERR_TIMEOUT		1
+#define		YM_ERR_CANCEL		2
+#define		YM_ERR_DISK			3
+#define		YM_ERR_NOFILE		4
+#define		YM_ERR_NAME			5
+#define		YM_ERR_DRIVE		6
+#define		YM_ERR_PROTO		7
+
+struct ym_stat
+{
+	uint16_t files;
+	uint32_t bytes;
+	uint16_t retries;
+	uint32_t ms;
+};
+
+//optional hooks: local abort (e.g. BRK key), progress of current file
+extern uint8_t (*ym_cancel)(void);
+extern void (*ym_progress)(const char * name, uint32_t bytes);
+
+uint8_t ym_receive (uint8_t drv, uint8_t user, struct ym_stat * st);
+uint8_t ym_send (uint8_t drv, uint8_t user, const uint8_t * name, struct ym_stat * st);
+void ym_cpm_cmd (uint8_t cmd, uint8_t * fcb, uint8_t user);
+uint8_t ym_cpm_status (void);
+const char * ym_err_str (uint8_t err);
+
+#endif
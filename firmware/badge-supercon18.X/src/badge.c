@@ -10,6 +10,17 @@
 #include <stdint.h>
 #include "Z80/sim.h"
 #include "Z80/simglb.h"
+#include "Z80/ftl.h"
+#include "Z80/rdc.h"
+#include "Z80/cpmfs.h"
+#include "Z80/ymodem.h"
+#include "zmachine.h"
+#include "journal.h"
+#include "bench.h"
+#include "prof.h"
+#include "cost.h"
+#include "progtab.h"
+#include "bstore.h"
 
 
 //==================================================================================================
@@ -22,6 +33,7 @@
 uint16_t basic_loads (int8_t * data, uint16_t maxlen);
 uint16_t basic_saves (int8_t * data, uint16_t maxlen);
 void init_z80_cpm (void);
+void init_cpm_disks (void);
 void init_basic (void);
 void init_puzzle(void);
 void init_userprog(void);
@@ -35,9 +47,20 @@ void loop_8080_basic (void);
 uint8_t cmd_exec (int8_t * cmd);
 uint8_t basic_save_program (uint8_t * data, uint8_t slot);
 uint8_t basic_load_program (uint8_t * data, uint8_t slot);
-uint16_t get_free_mem(uint8_t * prog, uint16_t max_mem);
-uint8_t add_prog_line (int8_t * line, int8_t * prog, int16_t linenum);
+int8_t * basic_name (int8_t * arg);
+void basic_store_msg (uint8_t ret);
+void basic_dir (void);
 void list_more (void);
+void show_stats (void);
+void basic_changed (void);
+void basic_bg_step (void);
+void show_bench (uint8_t serial);
+void bench_menu (uint8_t serial);
+void ramdisk_bench (void);
+void ymodem_menu (void);
+void zork_menu (void);
+void stdio_out (uint8_t data);
+uint8_t ym_brk_pressed (void);
 void menu(void);
 void show_help(void);
 uint32_t hash(int8_t *);
@@ -55,6 +78,8 @@ uint8_t playriff(unsigned char);
 
 /************ Defines ****************************/
 #define STDIO_LOCAL_BUFF_SIZE	25
+//emulated CPU instructions per loop_z80_cpm()/loop_8080_basic() call, console output is drained after each slice
+#define CPU_SLICE	256
 
 //Prompt handling defines
 #define COMMAND_MAX 32
@@ -91,6 +116,9 @@ uint8_t playriff(unsigned char);
 /*** End Function Prototypes **********************88*/
 
 int8_t bprog[BPROG_LEN+1];
+//program started by bg, it runs from loop_basic and between batches of RUN
+struct ubasic_ctx bg_ctx;
+uint8_t bg_run;
 int8_t bprog_init[700] =
 "10 c = 1 + rnd 4\n\
 20 color c,c+8\n\
@@ -128,6 +156,11 @@ int32_t i,j,len;
 jmp_buf jbuf;
 volatile uint8_t handle_display = 1;
 volatile int8_t brk_key,stdio_src;
+//console output ring, 256 entries so 8-bit indexes wrap by themselves
+uint8_t con_ring[256],con_head,con_tail;
+//start page of video window in ram[], 0 when off
+uint8_t vwin_page;
+uint32_t vwin_last;
 extern volatile uint16_t bufsize;
 volatile uint32_t ticks;			// millisecond timer incremented in ISR
 
@@ -266,6 +299,8 @@ void badge_init (void)
 //	stdio_src = STDIO_TTY1;
 	term_init();
 	strcpy(bprog,bprog_init);
+	pt_rebuild();
+	basic_changed();
 	set_cursor_state(1);
 	fl_unlock();
 	}
@@ -302,7 +337,7 @@ void badge_menu(void)
 			if (random_has_been_seeded == 0)
 				{
 				//Pull seed directly from TIMER1 register
-				srand(*(char*)0xBF800610);
+				srand(jr_seed(TIMER1_LOW));
 				++random_has_been_seeded;
 				}
 			
@@ -321,8 +356,8 @@ void badge_menu(void)
 			// Define variables used in customization. Please note that 'static' is used to preserve 
 			// values after exiting scope of '{..}'. Also, the scope surrounds the if...else... to 
 			// allow access to required variables within both the if and else statements.
-			static uint8_t		menu[11][20]		= {{"1\0"}, {"2\0"}, {"3\0"}, {"4\0"}, {"5\0"}, {"6\0"}, {"7\0"}, {"UUDDLRLRba\0"}, {"nya\0"}, {"mario\0"}, {"hackaday\0"}};	// Values used within internal buffer to simulate relevant key presses.
-			static uint8_t		size				= 11;						// Size of menu.
+			static uint8_t		menu[12][20]		= {{"1\0"}, {"2\0"}, {"3\0"}, {"4\0"}, {"5\0"}, {"6\0"}, {"7\0"}, {"8\0"}, {"UUDDLRLRba\0"}, {"nya\0"}, {"mario\0"}, {"hackaday\0"}};	// Values used within internal buffer to simulate relevant key presses.
+			static uint8_t		size				= 12;						// Size of menu.
 			static int8_t		entry				= 0;						// Tracks which entry in menu is active [1 indexed]
 			static uint32_t		actualMenuPointer	= 0;						// Used to track the amount of text printed on screen (vs inside internal buffer). Erased first time used in 'else' statement.
 			int8_t				index				= 0;
@@ -384,13 +419,14 @@ void badge_menu(void)
 					case 2:		sprintf(&tmp[0], "[%d] CP/M @ Z80\0",				entry);	break;
 					case 3:		sprintf(&tmp[0], "[%d] Tiny Basic @ 8080\0",		entry);	break;
 					case 4:		sprintf(&tmp[0], "[%d] Play Badgetris!\0",			entry);	break;
-					case 5:		sprintf(&tmp[0], "[%d] Zork @ CP/M @ Z80\0",		entry);	break;
+					case 5:		sprintf(&tmp[0], "[%d] Zork @ PIC32\0",			entry);	break;
 					case 6:		sprintf(&tmp[0], "[%d] Puzzle\0",					entry);	break;
 					case 7:		sprintf(&tmp[0], "[%d] User Program\0",				entry);	break;
-					case 8:		sprintf(&tmp[0], "[+] Play Snake\0"						);	break;
-					case 9:		sprintf(&tmp[0], "[+] Become Engrossed by Nya\0"		);	break;
-					case 10:	sprintf(&tmp[0], "[+] Play Mario\0"						);	break;
-					case 11:	sprintf(&tmp[0], "[+] Hackaday Logo\0"					);	break;
+					case 8:		sprintf(&tmp[0], "[%d] File Transfer\0",			entry);	break;
+					case 9:		sprintf(&tmp[0], "[+] Play Snake\0"						);	break;
+					case 10:	sprintf(&tmp[0], "[+] Become Engrossed by Nya\0"		);	break;
+					case 11:	sprintf(&tmp[0], "[+] Play Mario\0"						);	break;
+					case 12:	sprintf(&tmp[0], "[+] Hackaday Logo\0"					);	break;
 				}
 				
 				// Track the number of characters to print to screen to override if non-navigation 
@@ -475,6 +511,9 @@ void badge_menu(void)
 					video_clrscr();
 					init_z80_cpm();
 					while (!WiiInterface_ExitToMenu()) loop_z80_cpm();
+#ifdef	RAMDISK_PERSIST
+					ramdisk_sync();
+#endif
 					}			
 				else if (strcmp(menu_buff,"3")==0)
 					{
@@ -489,14 +528,7 @@ void badge_menu(void)
 				//B_BDG006		
 				else if (strcmp(menu_buff,"5")==0)
 					{
-					stdio_local_buffer_puts("c:\nzork1\n");
-					video_clrscr();
-					video_set_color(0,14);
-					stdio_write("\n\n\n\n\n\nPROTIP:\n\tUse Shift-Enter when playing ZORK!\n\n");
-					video_set_color(15,0);
-					wait_ms(2000);
-					init_z80_cpm();
-					while (!WiiInterface_ExitToMenu()) loop_z80_cpm();
+					zork_menu();
 					}
 				else if (strcmp(menu_buff,"6")==0)
 					{
@@ -508,6 +540,53 @@ void badge_menu(void)
 					init_userprog();
 					while (!WiiInterface_ExitToMenu()) loop_userprog();
 					}
+				else if (strcmp(menu_buff,"8")==0)
+					{
+					ymodem_menu();
+					}
+				else if (strcmp(menu_buff,"bench")==0)
+					{
+					bench_menu(0);
+					}
+				else if (strcmp(menu_buff,"benchs")==0)
+					{
+					bench_menu(1);
+					}
+				else if (strcmp(menu_buff,"costs")==0)
+					{
+					cost_send();
+					clear_flag = wisecrack("ISR costs sent to serial",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"prof")==0)
+					{
+					prof_start(PROF_RATE);
+					clear_flag = wisecrack("Profiler sampling",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"profs")==0)
+					{
+					prof_send();
+					clear_flag = wisecrack("Profile sent to serial",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"jrec")==0)
+					{
+					jr_record(JR_FLASH);
+					clear_flag = wisecrack("Recording input journal",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"jrecs")==0)
+					{
+					jr_record(JR_SERIAL);
+					clear_flag = wisecrack("Input journal to serial",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"jplay")==0)
+					{
+					if (jr_play()) clear_flag = wisecrack("No input journal",CRACK_X,CRACK_Y,0);
+					else clear_flag = wisecrack("Playing input journal",CRACK_X,CRACK_Y,0);
+					}
+				else if (strcmp(menu_buff,"jstop")==0)
+					{
+					jr_stop();
+					clear_flag = wisecrack("Input journal stopped",CRACK_X,CRACK_Y,0);
+					}
 #ifdef NYANCAT_DEMO
 				else if (strcmp(menu_buff,"nya")==0)
 					{
@@ -580,7 +659,7 @@ uint32_t  hash(int8_t *command)
 		hash = (hash*33)^c;
 		if (infinite_loop_breaker++ > 100) return 0;	//In case we get stuck
 		}
-	//sprintf(stdio_buff, "has %d\n", hash);
+	//snprintf(stdio_buff,sizeof(stdio_buff), "has %d\n", hash);
 	return hash;
 	}
 
@@ -692,11 +771,13 @@ void showmenu(void)
 	video_gotoxy(TEXT_LEFT,9);
 	stdio_write("4 - Play Badgetris!");
 	video_gotoxy(TEXT_LEFT,10);
-	stdio_write("5 - Zork @ CP/M @ Z80");
+	stdio_write("5 - Zork @ PIC32");
 	video_gotoxy(TEXT_LEFT,11);
 	stdio_write("6 - Puzzle");
 	video_gotoxy(TEXT_LEFT,12);
 	stdio_write("7 - User Program");
+	video_gotoxy(TEXT_LEFT,13);
+	stdio_write("8 - File Transfer");
 	
 	show_version();
 	clear_prompt();
@@ -838,6 +919,10 @@ void loop_badge(uint8_t force_pwroff)
 		{
 		while (K_PWR==0);
 		wait_ms(100);
+		jr_stop();
+#ifdef	RAMDISK_PERSIST
+		ramdisk_sync();
+#endif
 		hw_sleep();
 		wait_ms(30);
 		while (K_PWR==0);
@@ -845,6 +930,10 @@ void loop_badge(uint8_t force_pwroff)
 		}
 	if (force_pwroff)
 		{
+		jr_stop();
+#ifdef	RAMDISK_PERSIST
+		ramdisk_sync();
+#endif
 		hw_sleep();
 		wait_ms(30);
 		while (K_PWR==0);
@@ -863,7 +952,10 @@ void loop_badge(uint8_t force_pwroff)
 					stdio_src = STDIO_TTY1;
 				}
 			else
+				{
 				brk_key = 1;
+				jr_brk();
+				}
 			}
 		if (brk_is_pressed<10) brk_is_pressed++;
 		}
@@ -890,37 +982,72 @@ void init_8080_basic (void)
 	for (i=0;i<2048;i++) ram[i] = b2_rom[i];
 	for (i=0;i<30;i++) ram[i+0x1000] = ram_init[i];
 	wrk_ram	= PC = STACK = ram;
+	vwin_set(0);
 	init_io(IO_BASIC_MODE);
 	}
 
 void loop_8080_basic (void)
 	{
+	uint16_t n;
+	struct cost_mark m;
 	cpu_error = NONE;
-	cpu();	
+	COST_BEGIN(m);
+	for (n=0;n<CPU_SLICE;n++) cpu();
+	COST_END(m,COST_Z80);
+	con_flush();
 	}
 
-void init_z80_cpm (void)
+//BIOS and RAM disk, enough for CP/M drives to be accessed natively too
+void init_cpm_disks (void)
 	{
-	video_set_color(15,0);
 #ifdef	USE_RAM_IMAGE_OLD	
-	for (i=0;i<65536;i++) ram[i] = ram_image[i];
+	memcpy(ram,ram_image,65536);
 #endif	
 #ifdef	USE_RAM_IMAGE_NEW	
-	for (i=0;i<65536;i++) ram[i] = 0;
-	for (i=0;i<3;i++) ram[i] = ram_image_a[i];
+	memset(ram,0,65536);
+	memcpy(ram,ram_image_a,3);
 	reload_cpm_warm();
 #endif	
 #ifdef	USE_RAMDISK
-	for (i=0;i<RAMDISK_SIZE;i++) ram_disk[i] = 0xE5;
+	memset(ram_disk,0xE5,RAMDISK_SIZE);
+#ifdef	RAMDISK_PERSIST
+	ramdisk_restore();
+#endif
+#ifdef	RAMDISK_COMPRESSED
+	rdc_init();
+#endif
 #endif
+	}
+
+uint8_t ym_brk_pressed (void)
+	{
+	if (brk_key==0) return 0;
+	brk_key = 0;
+	return 1;
+	}
+
+void init_z80_cpm (void)
+	{
+	video_set_color(15,0);
+	cpm_boot_start(1);
+	vwin_set(0);
+	init_cpm_disks();
+	ym_cancel = ym_brk_pressed;
+	ym_progress = NULL;
 	wrk_ram	= PC = STACK = ram;
 	init_io(IO_CPM_MODE);
 	}
 
 void loop_z80_cpm (void)
 	{
+	uint16_t n;
+	struct cost_mark m;
 	cpu_error = NONE;
-	cpu();	
+	COST_BEGIN(m);
+	for (n=0;n<CPU_SLICE;n++) cpu();
+	COST_END(m,COST_Z80);
+	con_flush();
+	vwin_sync(0);
 	}
 
 //B_BAS005
@@ -942,6 +1069,16 @@ void loop_basic (void)
 	    stdio_write(">");	
 	    prompt = 0;
 	    }
+	if (bg_run)
+		{
+		if (brk_key)
+			{
+			brk_key = 0;
+			bg_run = 0;
+			stdio_write("\nBRK pressed\n");
+			}
+		basic_bg_step();
+		}
 	get_stat = stdio_get(&char_out);
 	if (get_stat!=0)
 	    {
@@ -1012,68 +1149,35 @@ const char* get_firmware_string(void) {
 	return FIRMWARE_VERSION;
 	}
 
-uint16_t get_free_mem(uint8_t * prog, uint16_t max_mem)
+//B_BAS007
+//program text is about to move, background program can't go on, arrays
+//live in the gap after the text and are gone too
+void basic_changed (void)
 	{
-	uint16_t prog_len;
-	prog_len = strlen(prog);
-	return (max_mem-prog_len);
+	int8_t * gap;
+	uint16_t len;
+	if (bg_run) stdio_write("bg stopped\n");
+	bg_run = 0;
+	ubasic_program_changed();
+	gap = pt_gap(&len);
+	ubasic_arena(gap,len);
 	}
 
-//B_BAS008
-uint8_t add_prog_line (int8_t * line, int8_t * prog, int16_t linenum)
-    {
-    uint8_t * prog_ptr=prog, * prog_ptr_prev, * prog_ptr_dest;
-    int16_t linenum_now,linenum_prev=0,line_exp_len,cnt, prog_len;
-    int8_t line_rest[INPUT_BUFFER_LEN+1],line_exp[INPUT_BUFFER_LEN+1],ret;
-    sprintf(line_exp,"%d %s\n",linenum,line);
-    line_exp_len = strlen(line_exp);
-	prog_len = strlen(prog);
-	if ((prog_len + line_exp_len)>BPROG_LEN) return 1;
-    while (1)
-	{
-	ret = sscanf(prog_ptr,"%d %[^\n]s",&linenum_now,line_rest);
-	if (ret==2)
-	    {
-	    if ((linenum>linenum_prev)&(linenum<linenum_now))
-			{
-			cnt = strlen(prog_ptr) +1;
-			prog_ptr_dest = prog_ptr + line_exp_len;
-			memmove(prog_ptr_dest,prog_ptr,cnt);
-			memcpy(prog_ptr,line_exp,line_exp_len);
-			return 0;
-			}
-	    if (linenum==linenum_now)
-			{
-			prog_ptr_prev = prog_ptr;
-			prog_ptr = strchr(prog_ptr,'\n')+1;
-			cnt = strlen(prog_ptr)+1;
-			memmove(prog_ptr_prev,prog_ptr,cnt);
-			if (strlen(line)>1)
-				{
-				prog_ptr = prog_ptr_prev;
-				cnt = strlen(prog_ptr);
-				prog_ptr_dest = prog_ptr + line_exp_len;
-				memmove(prog_ptr_dest,prog_ptr,cnt+1);
-				memcpy(prog_ptr,line_exp,line_exp_len);		
-				}
-			return 0;
-			}
-	    }
-	if (ret==-1)
-	    {
-	    strcat(prog,line_exp);
-	    return 0;
-	    }
-	linenum_prev = linenum_now;
-	prog_ptr_prev = prog_ptr;
-	prog_ptr = strchr(prog_ptr,'\n')+1;
+void basic_bg_step (void)
+	{
+	uint8_t r;
+	if (bg_run==0) return;
+	r = ubasic_step(&bg_ctx,UBASIC_BG_LINES,UBASIC_BG_MS);
+	if (r==UBASIC_RUNNING) return;
+	bg_run = 0;
+	if (r==UBASIC_ERROR) stdio_write("\nBASIC error in bg\n");
+	else stdio_write("\nbg done\n");
 	}
-    }
 
-//B_BAS007
 uint8_t cmd_exec (int8_t * cmd)
     {
     int8_t cmd_clean[INPUT_BUFFER_LEN+1];
+	struct cost_mark m;
 	cmd_clean[0]=0;
     int32_t linenum,prognum;
 	int8_t len = strlen(cmd);
@@ -1081,25 +1185,75 @@ uint8_t cmd_exec (int8_t * cmd)
     if (isdigit(cmd[0]))
 		{
 		sscanf(cmd,"%d %[^\n]s",&linenum,cmd_clean);
-		add_prog_line (cmd_clean,bprog, linenum);
+		pt_add_line(cmd_clean,linenum);
+		basic_changed();
 		}
     else
 		{
 		if (strcmp("list",cmd)==0) stdio_write(bprog);
-		else if (strcmp("memclr",cmd)==0) bprog[0]=0;
+		else if (strcmp("memclr",cmd)==0)
+			{
+			bprog[0]=0;
+			pt_rebuild();
+			basic_changed();
+			}
 		else if (strcmp("free",cmd)==0)
 			{
-			sprintf(stdio_buff,"%d B of memory free\n",get_free_mem(bprog,BPROG_LEN));
+			snprintf(stdio_buff,sizeof(stdio_buff),"%d B of memory free\n",pt_free());
 			stdio_write(stdio_buff);
 			}	
 		else if (strcmp("more",cmd)==0) list_more();
+		else if (strcmp("stats",cmd)==0) show_stats();
+		else if (strcmp("rdbench",cmd)==0) ramdisk_bench();
+		else if (strcmp("bench",cmd)==0) show_bench(0);
+		else if (strcmp("benchs",cmd)==0) show_bench(1);
+		else if (strcmp("costs",cmd)==0) cost_send();
+		else if (strcmp("profs",cmd)==0) prof_send();
+		else if (strncmp("prof",cmd,4)==0)
+			{
+			prognum = PROF_RATE;
+			sscanf (cmd+4,"%d",&prognum);
+			prof_start(prognum);
+			}
+		else if (strcmp("jrec",cmd)==0) jr_record(JR_FLASH);
+		else if (strcmp("jrecs",cmd)==0) jr_record(JR_SERIAL);
+		else if (strcmp("jplay",cmd)==0)
+			{
+			if (jr_play()) stdio_write("No input journal\n");
+			}
+		else if (strcmp("jstop",cmd)==0) jr_stop();
 		else if (strcmp("help",cmd)==0) 
 			{
 			stdio_write("Basic BASIC help:\n");
 			stdio_write("Type more to list the program in buffer, ");
 			stdio_write("or run to run it.\n");
+			stdio_write("bg runs it in background, stop ends it.\n");
+			stdio_write("dim a(n) or a(n),16 makes array, fill and copy work on them.\n");
+#ifdef	BASIC_STORE
+			stdio_write("save, load and del take a name, dir lists saved programs.\n");
+#endif
 			stdio_write(" For more documentation see hac.io/VKtq9\n");
 			}
+#ifdef	BASIC_STORE
+		else if (strncmp("load",cmd,4)==0)
+			{
+			stdio_write("loading...");
+			prognum = bs_load(basic_name(cmd+4),bprog,BPROG_LEN);
+			if ((prognum==BS_OK)||(prognum==BS_BAD))
+				{
+				pt_rebuild();
+				basic_changed();
+				}
+			basic_store_msg(prognum);
+			}
+		else if (strncmp("save",cmd,4)==0)
+			{
+			stdio_write("saving...");
+			basic_store_msg(bs_save(basic_name(cmd+4),bprog));
+			}
+		else if (strncmp("del",cmd,3)==0) basic_store_msg(bs_del(basic_name(cmd+3)));
+		else if (strcmp("dir",cmd)==0) basic_dir();
+#else
 		else if (strncmp("load",cmd,4)==0)
 			{
 			sscanf (cmd+4,"%d",&prognum);
@@ -1107,6 +1261,8 @@ uint8_t cmd_exec (int8_t * cmd)
 				{
 				stdio_write("loading...");
 				basic_load_program(bprog,prognum);
+				pt_rebuild();
+				basic_changed();
 				stdio_write("OK\n");
 				}
 			}
@@ -1120,11 +1276,12 @@ uint8_t cmd_exec (int8_t * cmd)
 				stdio_write("OK\n");
 				}
 			}	
+#endif
 		else if (strncmp("ssave",cmd,5)==0)
 			{
 			stdio_write("Transmitting via serial port...\n");
 			i = basic_saves(bprog,BPROG_LEN);
-			sprintf(stdio_buff,"\nOK, transmitted %d bytes.\n",i);
+			snprintf(stdio_buff,sizeof(stdio_buff),"\nOK, transmitted %d bytes.\n",i);
 			stdio_write(stdio_buff);
 			}	
 		else if (strncmp("sload",cmd,5)==0)
@@ -1135,31 +1292,50 @@ uint8_t cmd_exec (int8_t * cmd)
 			handle_display = 0;
 			display_refresh_force();
 			i = basic_loads(bprog,BPROG_LEN);
+			pt_rebuild();
+			basic_changed();
 			handle_display = 1;
-			sprintf(stdio_buff,"\nOK, received %d bytes.\n",i);
+			snprintf(stdio_buff,sizeof(stdio_buff),"\nOK, received %d bytes.\n",i);
 			stdio_write(stdio_buff);
 			}	
+		else if (strcmp("bg",cmd)==0)
+			{
+			ubasic_ctx_init(&bg_ctx,bprog);
+			brk_key = 0;
+			bg_run = 1;
+			}
+		else if (strcmp("stop",cmd)==0)
+			{
+			if (bg_run) stdio_write("bg stopped\n");
+			bg_run = 0;
+			}
 		else if (strcmp("run",cmd)==0)
 			{
 			ubasic_init(bprog,0);
 			brk_key = 0;
-			do 
+			//error context is set once, BRK is polled between batches of lines
+			if (!setjmp(jbuf))
 				{
-				if (brk_key) 
-					{
-					brk_key = 0;
-					video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
-					stdio_write("\nBRK pressed\n");
-					break;
-					}
-				if (!setjmp(jbuf)) ubasic_run();
-				else
+				do 
 					{
-					video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
-					stdio_write("\nBASIC error\n");
-					break;
-					}
-				} 	while(!ubasic_finished());
+					if (brk_key) 
+						{
+						brk_key = 0;
+						video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
+						stdio_write("\nBRK pressed\n");
+						break;
+						}
+					COST_BEGIN(m);
+					ubasic_run_lines(UBASIC_BATCH_LINES,UBASIC_BATCH_MS);
+					COST_END(m,COST_BASIC);
+					basic_bg_step();
+					} 	while(!ubasic_finished());
+				}
+			else
+				{
+				video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
+				stdio_write("\nBASIC error\n");
+				}
 			handle_display = 1;
 			video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
 			stdio_write("\n");
@@ -1231,10 +1407,7 @@ uint8_t basic_save_program (uint8_t * data, uint8_t slot)
 	addr = addr * BPROG_SECSIZ * BPROG_SECNUM;
 	addr = addr + BASIC_BASEADDR;
 	for (cnt = 0;cnt<BPROG_SECNUM;cnt++)
-		{
-		fl_erase_4k(addr + cnt*BPROG_SECSIZ);
-		fl_write_4k(addr + cnt*BPROG_SECSIZ,data + cnt*BPROG_SECSIZ);	
-		}
+		fl_update_4k(addr + cnt*BPROG_SECSIZ,data + cnt*BPROG_SECSIZ,BPROG_SECSIZ);	
 	return 1;
 	}
 
@@ -1253,6 +1426,39 @@ uint8_t basic_load_program (uint8_t * data, uint8_t slot)
 	return 1;
 	}
 
+//name after a command, blanks around it dropped
+int8_t * basic_name (int8_t * arg)
+	{
+	int8_t * end;
+	while (*arg==' ') arg++;
+	end = arg + strlen(arg);
+	while ((end>arg)&&(end[-1]==' ')) *--end = 0;
+	return arg;
+	}
+
+void basic_store_msg (uint8_t ret)
+	{
+	if (ret==BS_OK) stdio_write("OK\n");
+	else if (ret==BS_NONAME) stdio_write("\nName of 1-16 characters expected\n");
+	else if (ret==BS_FULL) stdio_write("\nNo room for it in FLASH\n");
+	else if (ret==BS_NOTFOUND) stdio_write("\nNo such program\n");
+	else stdio_write("\nProgram damaged or too long\n");
+	}
+
+void basic_dir (void)
+	{
+	struct bs_entry e;
+	e.addr = 0;
+	stdio_write("Name              Text FLASH\n");
+	while (bs_dir(&e))
+		{
+		snprintf(stdio_buff,sizeof(stdio_buff),"%-16s %5u %5u\n",e.name,e.len,e.stored);
+		stdio_write(stdio_buff);
+		}
+	snprintf(stdio_buff,sizeof(stdio_buff),"%lu B free\n",(unsigned long)bs_free());
+	stdio_write(stdio_buff);
+	}
+
 void list_more (void)
 	{
 	uint8_t retval;
@@ -1275,11 +1481,273 @@ void list_more (void)
 		}	
 	}
 
+void show_stats (void)
+	{
+	uint32_t erases,saved,written,skipped;
+	uint32_t cold_us,warm_us,warm_cnt,pages;
+	uint32_t turns,avg_us,max_us;
+	uint32_t events,jticks,lost;
+	uint16_t slots,pt_text;
+	uint32_t cmin;
+	uint8_t c;
+	int8_t cost_line[64];
+#ifdef	CPM_FTL
+	uint16_t free_blk;
+	uint32_t ec_min,ec_max,gc_runs;
+#endif
+#ifdef	USE_ROMDISK_COMPRESSED
+	uint32_t rd_reads,rd_misses,rd_avg,rd_max;
+#endif
+#ifdef	RAMDISK_COMPRESSED
+	uint32_t rdc_reads,rdc_hits,rdc_writes,rdc_fails,rdc_stored;
+	uint16_t rdc_used,rdc_free;
+#endif
+	fl_get_stats(&erases,&saved,&written,&skipped);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FLASH erases: %lu\n",(unsigned long)erases);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FLASH erases saved: %lu\n",(unsigned long)saved);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FLASH pages written: %lu\n",(unsigned long)written);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FLASH pages skipped: %lu\n",(unsigned long)skipped);
+	stdio_write(stdio_buff);
+#ifdef	CPM_FTL
+	ftl_get_stats(&free_blk,&ec_min,&ec_max,&gc_runs);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FTL free blocks: %u GC runs: %lu\n",free_blk,(unsigned long)gc_runs);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"FTL erase count min/max: %lu/%lu\n",(unsigned long)ec_min,(unsigned long)ec_max);
+	stdio_write(stdio_buff);
+#endif
+#ifdef	USE_ROMDISK_COMPRESSED
+	rd_get_stats(&rd_reads,&rd_misses,&rd_avg,&rd_max);
+	snprintf(stdio_buff,sizeof(stdio_buff),"ROM disk reads: %lu misses: %lu\n",(unsigned long)rd_reads,(unsigned long)rd_misses);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"ROM disk read avg/max: %lu/%lu us\n",(unsigned long)rd_avg,(unsigned long)rd_max);
+	stdio_write(stdio_buff);
+#endif
+#ifdef	RAMDISK_COMPRESSED
+	rdc_get_stats(&rdc_reads,&rdc_hits,&rdc_writes,&rdc_fails);
+	snprintf(stdio_buff,sizeof(stdio_buff),"RAM disk reads: %lu hits: %lu\n",(unsigned long)rdc_reads,(unsigned long)rdc_hits);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"RAM disk writes: %lu full: %lu\n",(unsigned long)rdc_writes,(unsigned long)rdc_fails);
+	stdio_write(stdio_buff);
+	rdc_get_usage(&rdc_used,&rdc_free,&rdc_stored);
+	snprintf(stdio_buff,sizeof(stdio_buff),"RAM disk pool free: %lu of %lu B\n",
+		(unsigned long)rdc_free*RDC_BLK_DATA,(unsigned long)RDC_BLOCKS*RDC_BLK_DATA);
+	stdio_write(stdio_buff);
+#endif
+	cpm_get_boot_stats(&cold_us,&warm_us,&warm_cnt,&pages);
+	snprintf(stdio_buff,sizeof(stdio_buff),"CP/M boot cold/warm: %lu/%lu us\n",(unsigned long)cold_us,(unsigned long)warm_us);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Warm boots: %lu pages back: %lu\n",(unsigned long)warm_cnt,(unsigned long)pages);
+	stdio_write(stdio_buff);
+	//Zork turn latency, native interpreter against ZORK1 run under CP/M
+	zm_get_stats(&turns,&avg_us,&max_us);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Zork turns: %lu\n",(unsigned long)turns);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Zork turn avg/max: %lu/%lu us\n",(unsigned long)avg_us,(unsigned long)max_us);
+	stdio_write(stdio_buff);
+	cpm_get_turn_stats(&turns,&avg_us,&max_us);
+	snprintf(stdio_buff,sizeof(stdio_buff),"CP/M turns: %lu\n",(unsigned long)turns);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"CP/M turn avg/max: %lu/%lu us\n",(unsigned long)avg_us,(unsigned long)max_us);
+	stdio_write(stdio_buff);
+	jr_get_stats(&events,&jticks,&lost);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Journal events: %lu lost: %lu\n",(unsigned long)events,(unsigned long)lost);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Journal ticks: %lu\n",(unsigned long)jticks);
+	stdio_write(stdio_buff);
+	pt_get_stats(&slots,&pt_text,&c);
+	snprintf(stdio_buff,sizeof(stdio_buff),"BASIC lines: %u text: %u B %s\n",slots,pt_text,c ? "indexed" : "scanned");
+	stdio_write(stdio_buff);
+	ubasic_arena_stats(&slots,&pt_text);
+	snprintf(stdio_buff,sizeof(stdio_buff),"BASIC arrays: %u of %u B\n",slots,pt_text);
+	stdio_write(stdio_buff);
+	prof_get_stats(&events,&lost,&slots);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Profile samples: %lu lost: %lu\n",(unsigned long)events,(unsigned long)lost);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Profile PCs: %u\n",slots);
+	stdio_write(stdio_buff);
+	//entries that ran so far, cycles min/avg/max and overruns
+	for (c=0;c<COST_N;c++)
+		{
+		cost_get(c,&turns,&cmin,&avg_us,&max_us,&lost);
+		if (turns==0) continue;
+		snprintf(cost_line,sizeof(cost_line),"%s %lu/%lu/%lu cyc ov %lu\n",cost_name(c),(unsigned long)cmin,(unsigned long)avg_us,(unsigned long)max_us,(unsigned long)lost);
+		stdio_write(cost_line);
+		}
+	}
+
+//estimate how much drive A can hold with compressed sectors
+void ramdisk_bench (void)
+	{
+#ifdef	RAMDISK_COMPRESSED
+	struct rdc_bench_result res;
+	uint16_t used,free_blk;
+	uint32_t stored,cap;
+	stdio_write("Compressing 256 sectors...\n");
+	rdc_bench(256,&res);
+	snprintf(stdio_buff,sizeof(stdio_buff),"%u fill, %u raw, %u LZSS, %u errors\n",res.fill,res.raw,res.sects-res.fill-res.raw,res.errors);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"%u sectors take %lu of %u blocks\n",res.sects,(unsigned long)res.blocks,RDC_BLOCKS);
+	stdio_write(stdio_buff);
+	cap = RDC_SECTS;
+	if (res.blocks>0) cap = (((uint32_t)(RDC_BLOCKS))*res.sects)/res.blocks;
+	if (cap>RDC_SECTS) cap = RDC_SECTS;
+	snprintf(stdio_buff,sizeof(stdio_buff),"Disk A capacity: %lu kB, raw %u kB\n",(unsigned long)cap/8,RAMDISK_SIZE/1024);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Encode avg/max: %lu/%lu us\n",(unsigned long)res.enc_avg_us,(unsigned long)res.enc_max_us);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Decode avg/max: %lu/%lu us\n",(unsigned long)res.dec_avg_us,(unsigned long)res.dec_max_us);
+	stdio_write(stdio_buff);
+	rdc_get_usage(&used,&free_blk,&stored);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Disk A: %u sectors in %lu B\n",used,(unsigned long)stored);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"Disk A pool free: %lu of %lu B\n",
+		(unsigned long)free_blk*RDC_BLK_DATA,(unsigned long)RDC_BLOCKS*RDC_BLK_DATA);
+	stdio_write(stdio_buff);
+#endif
+#ifndef	RAMDISK_COMPRESSED
+	stdio_write("RAM disk compression is off\n");
+#endif
+	}
+
+//one result on screen, and as "BENCH name value unit" line on serial port
+void bench_line (const char * text, const char * name, uint32_t val, const char * unit, uint8_t serial)
+	{
+	uint8_t * p;
+	snprintf(stdio_buff,sizeof(stdio_buff),"%s: %lu %s\n",text,(unsigned long)val,unit);
+	stdio_write(stdio_buff);
+	if (serial==0) return;
+	snprintf(stdio_buff,sizeof(stdio_buff),"BENCH %s %lu %s\r\n",name,(unsigned long)val,unit);
+	for (p=stdio_buff;*p!=0;p++) tx_write(*p);
+	}
+
+void show_bench (uint8_t serial)
+	{
+	struct bench_result res;
+	stdio_write("Running benchmarks...\n");
+	bench_run(&res);
+	bench_line("Z80","z80",res.z80_ips,"instr/s",serial);
+	bench_line("BASIC","basic",res.basic_sps,"stmt/s",serial);
+	bench_line("BASIC text","basic_text",res.basic_text_sps,"stmt/s",serial);
+	bench_line("tft_print_char","char",res.char_cps,"char/s",serial);
+	bench_line("Full refresh","refresh",res.refresh_us,"us",serial);
+	bench_line("FLASH read","fl_read",res.fl_read_kbs,"kB/s",serial);
+	bench_line("FLASH erase","fl_erase",res.fl_erase_kbs,"kB/s",serial);
+	bench_line("FLASH program","fl_prog",res.fl_prog_kbs,"kB/s",serial);
+	bench_line("VT100","vt100",res.vt100_cps,"char/s",serial);
+	}
+
+//bench from main menu, results stay on screen until key
+void bench_menu (uint8_t serial)
+	{
+	video_clrscr();
+	video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
+	show_bench(serial);
+	stdio_write("hit any key");
+	while (stdio_get(&char_out)==0);
+	showmenu();
+	}
+
+void ym_show_progress (const char * name, uint32_t bytes)
+	{
+	snprintf(stdio_buff,sizeof(stdio_buff),"\r%-12s %lu B",name,(unsigned long)bytes);
+	stdio_write(stdio_buff);
+	}
+
+//file transfer from main menu, same YMODEM code as YM.COM uses under CP/M
+void ymodem_menu (void)
+	{
+	struct ym_stat st;
+	uint8_t line[20], len, drv, ret, name[11];
+	video_clrscr();
+	video_set_color(MENU_DEFAULT_FG, MENU_DEFAULT_BG);
+	stdio_write("YMODEM-1K over serial port\n\n");
+	stdio_write("R d:          receive into d:\n");
+	stdio_write("S d:NAME.EXT  send file\n");
+	stdio_write("empty line returns to menu\n\n>");
+	len = 0;
+	while (1)
+		{
+		while (stdio_get(&char_out)==0);
+		if (char_out==NEWLINE) break;
+		if ((char_out>=' ')&(char_out<0x7F)&(len<(sizeof(line)-1)))
+			{
+			stdio_c(char_out);
+			line[len++] = char_out;
+			}
+		else if ((char_out==BACKSPACE)&(len>0))
+			{
+			len--;
+			stdio_c(char_out);
+			}
+		}
+	line[len] = 0;
+	stdio_c(NEWLINE);
+	drv = (line[2]|0x20) - 'a';
+	if ((len<4)||(line[1]!=' ')||(line[3]!=':')||(drv>=CPM_DRIVES))
+		{
+		showmenu();
+		return;
+		}
+	init_cpm_disks();
+	ym_cancel = ym_brk_pressed;
+	ym_progress = ym_show_progress;
+	brk_key = 0;
+	serial_flush();
+	stdio_write("waiting for other side, BRK cancels\n");
+	if ((line[0]|0x20)=='r')
+		ret = ym_receive(drv,0,&st);
+	else if (cpmfs_name((const char *)line+4,name)!=CPMFS_OK)
+		ret = YM_ERR_NAME;
+	else
+		ret = ym_send(drv,0,name,&st);
+#ifdef	RAMDISK_PERSIST
+	ramdisk_sync();
+#endif
+	ym_progress = NULL;
+	snprintf(stdio_buff,sizeof(stdio_buff),"\n%s\n",ym_err_str(ret));
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"%u files, %lu B in %lu ms\n",st.files,(unsigned long)st.bytes,(unsigned long)st.ms);
+	stdio_write(stdio_buff);
+	snprintf(stdio_buff,sizeof(stdio_buff),"%u retries\n",st.retries);
+	stdio_write(stdio_buff);
+	stdio_write("hit any key");
+	while (stdio_get(&char_out)==0);
+	showmenu();
+	}
+
+//menu entry 5, ZORK1 from ROM disk C played by native Z-machine
+//instead of Infocom interpreter under CP/M, menu exit or BRK ends it
+uint8_t zork_exit (void)
+	{
+	return WiiInterface_ExitToMenu() | ym_brk_pressed();
+	}
+
+void zork_menu (void)
+	{
+	uint8_t ret;
+	video_clrscr();
+	video_set_color(15,0);
+	brk_key = 0;
+	zm_cancel = zork_exit;
+	ret = zm_run(2,"ZORK1.DAT");
+	if ((ret!=ZM_OK)&&(ret!=ZM_CANCEL))
+		{
+		sprintf(stdio_buff,"\nZORK1.DAT: %s\nhit any key",zm_err_str(ret));
+		stdio_write(stdio_buff);
+		while (stdio_get(&char_out)==0);
+		}
+	showmenu();
+	}
+
 //B_BDG003
 
 //write null-terminated string to standard output
 uint8_t stdio_write (int8_t * data)
 	{
+	if (con_head!=con_tail) con_flush();
 	if (stdio_src==STDIO_LOCAL)
 		{
 		while (*data!=0x00)
@@ -1308,32 +1776,85 @@ uint8_t stdio_write (int8_t * data)
 //write one character to standard output
 uint8_t stdio_c (uint8_t data)
 	{
-	int8_t tmp[3];
+	if (con_head!=con_tail) con_flush();
+	stdio_out(data);
+	}
+
+void stdio_out (uint8_t data)
+	{
 	if (stdio_src==STDIO_LOCAL)
-		{
-		tmp[0] = data;
-		tmp[1] = 0;
-		buf_enqueue (data);
-		while (bufsize)
-			receive_char(buf_dequeue());
-		}
+		receive_char(data);
 	else if (stdio_src==STDIO_TTY1)
 		{
 		tx_write(data);
 #ifdef	STDIO_TTY_DOUBLE
-		tmp[0] = data;
-		tmp[1] = 0;
-		buf_enqueue (data);
-		while (bufsize)
-			receive_char(buf_dequeue());
+		receive_char(data);
 #endif		
 		}
 	}
 
+//console output of emulated machines, io_out only appends, screen is updated
+//in batches between CPU slices, before console input and when ring is full
+void con_put (uint8_t data)
+	{
+	if (((uint8_t)(con_head+1))==con_tail) con_flush();
+	con_ring[con_head++] = data;
+	}
+
+void con_flush (void)
+	{
+	while (con_tail!=con_head)
+		stdio_out(con_ring[con_tail++]);
+	}
+
+/*
+ * Video window: OUT (0Eh) with page number maps 40x20 characters at page*256,
+ * followed by 800 color bytes in color_buffer format (low nibble text, high
+ * nibble background); OUT 0 or warm boot turns it off, IN (0Eh) returns the
+ * page. Window takes over the screen while on, rows which differ from screen
+ * are copied there every VWIN_SYNC_MS and before CP/M waits for a key.
+ */
+uint8_t vwin_set (uint8_t page)
+	{
+	uint8_t * win;
+	if ((((uint32_t)(page))*256 + 2*VWIN_CHARS)>65536) page = 0;
+	vwin_page = page;
+	if (page==0) return 0;
+	//start with what is on screen now
+	win = ram + ((uint16_t)(page)<<8);
+	memcpy(win,disp_buffer,VWIN_CHARS);
+	memcpy(win+VWIN_CHARS,color_buffer,VWIN_CHARS);
+	vwin_last = millis();
+	return page;
+	}
+
+uint8_t vwin_get (void)
+	{
+	return vwin_page;
+	}
+
+void vwin_sync (uint8_t force)
+	{
+	uint8_t * win, r;
+	if (vwin_page==0) return;
+	if ((force==0)&&((millis()-vwin_last)<VWIN_SYNC_MS)) return;
+	vwin_last = millis();
+	win = ram + ((uint16_t)(vwin_page)<<8);
+	for (r=0;r<DISP_BUFFER_HIGH;r++)
+		{
+		if (memcmp(disp_buffer[r],win,DISP_BUFFER_WIDE)!=0)
+			memcpy(disp_buffer[r],win,DISP_BUFFER_WIDE);
+		if (memcmp(color_buffer[r],win+VWIN_CHARS,DISP_BUFFER_WIDE)!=0)
+			memcpy(color_buffer[r],win+VWIN_CHARS,DISP_BUFFER_WIDE);
+		win += DISP_BUFFER_WIDE;
+		}
+	}
+
 //check, whether is there something to read from standard input
 //zero is returned when empty, nonzero when character is available
 int8_t stdio_get_state (void)
 	{
+	jr_tasks();
 	if (stdio_local_buffer_state()!=0)
 		return 1;
 	if (stdio_src==STDIO_LOCAL)
@@ -1345,6 +1866,7 @@ int8_t stdio_get_state (void)
 //zero when there is nothing to read
 int8_t stdio_get (int8_t * dat)
 	{
+	jr_tasks();
 	if (stdio_local_buffer_state()!=0)
 		{
 		*dat = stdio_local_buffer_get();
@@ -1371,9 +1893,9 @@ int8_t stdio_get (int8_t * dat)
 int8_t term_k_stat (void)
 	{
 	uint8_t key_len;
-	IEC0bits.T2IE = 0;
+	KEYB_INT_OFF;
 	key_len = key_buffer_ptr;
-	IEC0bits.T2IE = 1;
+	KEYB_INT_ON;
 	if (key_len == 0)
 		return 0;
 	else 
@@ -1383,14 +1905,14 @@ int8_t term_k_stat (void)
 int8_t term_k_char (int8_t * out)
 	{
 	uint8_t retval;
-	IEC0bits.T2IE = 0;
+	KEYB_INT_OFF;
 	retval = key_buffer_ptr;
 	if (key_buffer_ptr>0)
 		{
 		strncpy(out,key_buffer,key_buffer_ptr);
 		key_buffer_ptr = 0;
 		}
-	IEC0bits.T2IE = 1;
+	KEYB_INT_ON;
 	return retval;
 	}
 
@@ -1474,24 +1996,54 @@ void display_refresh_force (void)
 
 
 //B_BDG003
+//ISR bodies are plain functions, so host build can run them from its clock
+#ifndef	HOST_BUILD
 void __ISR(_TIMER_5_VECTOR, IPL3AUTO) Timer5Handler(void)
+	{
+    IFS0bits.T5IF = 0;
+	tick_display_tasks();
+	}
+
+void __ISR(_TIMER_1_VECTOR, IPL4AUTO) Timer1Handler(void)
+	{
+    IFS0bits.T1IF = 0;
+	tick_ms_tasks();
+	}
+void __ISR(_EXTERNAL_2_VECTOR, IPL4AUTO) Int2Handler(void)
+	{
+	IEC0bits.INT2IE = 0;
+	}
+#endif
+
+void tick_display_tasks (void)
 {
     uint8_t key_temp;
 	static uint32_t auto_pwrdn_counter=0;
-    IFS0bits.T5IF = 0;
+	struct cost_mark isr,m;
+	COST_BEGIN(isr);
 	disp_tasks();
 
     if (handle_display)
+		{
+		COST_BEGIN(m);
 		tft_disp_buffer_refresh_part((uint8_t *)(disp_buffer),(uint8_t *)color_buffer);
+		COST_END(m,COST_REFRESH);
+		}
     
+	COST_BEGIN(m);
 	key_temp = keyb_tasks();
+	COST_END(m,COST_KEYB);
 	
 	
 //==================================================================================================
 //	[CUSTOMIZATION]>	Override keypress determined based on state of Nunchuck.
 //--------------------------------------------------------------------------------------------------
+	COST_BEGIN(m);
 	WiiInterface_Refresh(&key_temp);
+	COST_END(m,COST_WII);
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+	//input journal logs the key, or replaces it while playing
+	key_temp = jr_tick(key_temp);
 	
     
 	if (key_temp>0)
@@ -1512,15 +2064,18 @@ void __ISR(_TIMER_5_VECTOR, IPL3AUTO) Timer5Handler(void)
 		loop_badge(1);
 		}
 	else
+		{
+		COST_BEGIN(m);
 		loop_badge(0);
+		COST_END(m,COST_PWR);
+		}
+	COST_ISR_END(isr,COST_T5,COST_T5_PERIOD);
 }
 
-void __ISR(_TIMER_1_VECTOR, IPL4AUTO) Timer1Handler(void)
+void tick_ms_tasks (void)
 	{
-    IFS0bits.T1IF = 0;
+	struct cost_mark isr;
+	COST_BEGIN(isr);
     ++ticks;
-	}
-void __ISR(_EXTERNAL_2_VECTOR, IPL4AUTO) Int2Handler(void)
-	{
-	IEC0bits.INT2IE = 0;
+	COST_ISR_END(isr,COST_T1,COST_T1_PERIOD);
 	}
@@ -23,6 +23,12 @@
 // load and save functions are set to 4096B only though
 #define	BPROG_LEN	16384
 
+//RUN compiles BASIC program into bytecode, in up to BASIC_BC_LEN bytes of free program
+//buffer (the memory DIM takes arrays from, so it costs no RAM of its own),
+//programs that don't fit are interpreted from text as before. comment to always interpret
+#define	BASIC_BYTECODE
+#define	BASIC_BC_LEN	4096
+
 //define size and number of sectors for saving BASIC programs
 //BPROG_LEN = BPROG_SECSIZ*BPROG_SECNUM
 #define	BPROG_SECSIZ	4096
@@ -36,14 +42,27 @@
 
 //where is the start of slot region in FLASH
 #define		BASIC_BASEADDR	0
+
+//keep BASIC programs by name in slot region, each one in its packed length, see bstore.h
+//save, load and del take a name, dir lists them. if off, save and load take slot number 0-15
+//switching it on or off loses programs saved in slot region
+#define		BASIC_STORE
 /*
  * FLASH organization is as follows
  * 0x000000-0x003FFF - first slot
  * 0x004000-0x007FFF - second slot
  * ...etc
  * 0x03C000-0x03FFFF - 16-th slot
+ * 0x000000-0x03FFFF - named BASIC program store, if BASIC_STORE is defined
  * 0x040000-0x07FFFF - empty space
  * 0x080000-0x0FFFFF - D disk of CP/M machine
+ * 0x080000-0x17FFFF - D disk of CP/M machine, if CPM_BIG_DISK is defined
+ * 0x180000-0x1FFFFF - E disk of CP/M machine
+ * 0x280000-0x2FFFFF - F disk of CP/M machine
+ * 0x300000-0x306FFF - RAM disk image, if RAMDISK_PERSIST is defined
+ * 0x310000-0x34FFFF - saved games of native Z-machine, 8 slots of 32kB
+ * 0x360000-0x37FFFF - input journal, see journal.h
+ * 0x3F0000-0x3FFFFF - scratch area of bench command, see bench.h
  */
 
 //Set SHOW_SPLASH to 0 to skip splash screen at boot
@@ -57,14 +76,49 @@
 #define	USE_ROMDISK
 //second ROM disk, with games, mapped as disk C. you can disable this one
 #define	USE_ROMDISK2
+//keep ROM disks B and C compressed (Z80/rd_images_z.c, made by romdisk_pack)
+//saves about 35kB of program FLASH and holds full disk C, costs 3kB of RAM for decompressed chunk cache
+#define	USE_ROMDISK_COMPRESSED
 //RAM disk, you can save 22kb of RAM by disabling it
 #define	USE_RAMDISK
+//keep RAM disk content in FLASH at 0x300000, changed sectors are written
+//when CP/M waits for a key, on exit to menu and before power off
+#define	RAMDISK_PERSIST
+//store RAM disk sectors compressed, disk A grows to 64kB logical in the same 22kB.
+//the logical disk is overcommitted: STAT counts 64kB, real capacity depends on content,
+//about 19kB for what doesn't compress. Blocks the pool can't back are marked taken, so
+//a full pool ends writes as disk full (PIP: DISK WRITE ERROR). rdbench and stats show
+//free pool space
+#define	RAMDISK_COMPRESSED
 
 //FLASH buffering of CP/M disk drives. 
 //enabled - use RAM buffering, faster, less wear-out
 //disabled - more stable and straight-forward
 #define	FLASH_BUFFERING
 
+//big format of CP/M disk D: 1MB, 4k allocation blocks aligned to FLASH erase blocks,
+//128 directory entries. Switching it on or off loses content of disk D, reformat it from POST
+//#define	CPM_BIG_DISK
+
+//log-structured FLASH translation layer for CP/M disk D
+//spreads writes over whole 0x080000-0x0FFFFF region and levels wear,
+//costs about 8kB of RAM and disk D shrinks to 448kB
+//switching it on or off loses content of disk D, reformat it from POST
+//#define	CPM_FTL
+
+//tools for looking into firmware, off to keep their RAM, host build has them all on
+//sampling profiler, prof and profs in menu and BASIC, see prof.h
+//costs 3kB of RAM for the histogram
+//#define	PROFILER
+
+//cycles of ISRs and hot functions off CP0 Count, with overruns, see cost.h
+//costs 320B of RAM and a few cycles in every ISR
+//#define	COST_STATS
+
+//input journal, jrec and jplay in menu and BASIC record and replay sessions, see journal.h
+//costs 600B of RAM
+//#define	INPUT_JOURNAL
+
 #define	INPUT_BUFFER_LEN	70
 
 //Nyancat demo, can free 84 bytes of RAM and 8468 bytes of ROM by disabling.
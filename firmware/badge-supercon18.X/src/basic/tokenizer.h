@@ -93,8 +93,25 @@ enum {
   TOKENIZER_POKE,  
   TOKENIZER_CURSOR,
   TOKENIZER_KIN,
+  TOKENIZER_DIM,
+  TOKENIZER_FILL,
+  TOKENIZER_COPY,
 };
 
+//scanner state, each interpreter context has its own, tokenizer_select
+//sets the one tokenizer_* calls work on
+typedef struct Scanner
+{
+	const char* top;			//start of token
+	const char* _pchCur;		//cursor; will be just past token when emitting tokens
+	const char* ptr;			//used by re2c to store position for backtracking
+	const char* pos;			//
+	const char* _pchBackup;		//if we need to do backup from a lookahead
+	int line;					//line no in source file
+	int current_token;
+} Scanner;
+
+void tokenizer_select(Scanner *s);
 void tokenizer_init(const char *program);
 void tokenizer_next(void);
 int tokenizer_token(void);
@@ -104,6 +121,7 @@ void tokenizer_string(char *dest, int len);
 
 int tokenizer_finished(void);
 void tokenizer_error_print(void);
+const char* __getAt(void);
 
 #define		SUBTOKEN_LEN	10
 
@@ -12,19 +12,6 @@
 #define YYCTXMARKER	s->_pchBackup
 
 
-typedef struct Scanner
-{
-	const char* top;			//start of token
-	const char* _pchCur;		//cursor; will be just past token when emitting tokens
-	const char* ptr;			//used by re2c to store position for backtracking
-	const char* pos;			//
-	const char* _pchBackup;		//if we need to do backup from a lookahead
-	int line;					//line no in source file
-	int current_token;
-} Scanner;
-
-
-
 int scan(Scanner* s)
 {
 regular:
@@ -75,7 +62,6 @@ regular:
 	case '>':	goto yy38;
 	case 'A':
 	case 'B':
-	case 'D':
 	case 'H':
 	case 'J':
 	case 'M':
@@ -86,7 +72,6 @@ regular:
 	case 'Z':
 	case 'a':
 	case 'b':
-	case 'd':
 	case 'h':
 	case 'j':
 	case 'm':
@@ -97,6 +82,8 @@ regular:
 	case 'z':	goto yy40;
 	case 'C':
 	case 'c':	goto yy42;
+	case 'D':
+	case 'd':	goto yy214;
 	case 'E':
 	case 'e':	goto yy43;
 	case 'F':
@@ -264,6 +251,8 @@ yy44:
 	yyaccept = 1;
 	yych = *(YYMARKER = ++YYCURSOR);
 	switch (yych) {
+	case 'I':
+	case 'i':	goto yy215;
 	case 'O':
 	case 'o':	goto yy72;
 	default:	goto yy41;
@@ -435,6 +424,8 @@ yy65:
 	switch (yych) {
 	case 'L':
 	case 'l':	goto yy107;
+	case 'P':
+	case 'p':	goto yy216;
 	default:	goto yy62;
 	}
 yy66:
@@ -1021,6 +1012,51 @@ yy210:
 yy212:
 	++YYCURSOR;
 	{ return (TOKENIZER_PRINTLN); }
+yy214:
+	yyaccept = 1;
+	yych = *(YYMARKER = ++YYCURSOR);
+	switch (yych) {
+	case 'I':
+	case 'i':	goto yy217;
+	default:	goto yy41;
+	}
+yy215:
+	yych = *++YYCURSOR;
+	switch (yych) {
+	case 'L':
+	case 'l':	goto yy218;
+	default:	goto yy62;
+	}
+yy216:
+	yych = *++YYCURSOR;
+	switch (yych) {
+	case 'Y':
+	case 'y':	goto yy219;
+	default:	goto yy62;
+	}
+yy217:
+	yych = *++YYCURSOR;
+	switch (yych) {
+	case 'M':
+	case 'm':	goto yy221;
+	default:	goto yy62;
+	}
+yy218:
+	yych = *++YYCURSOR;
+	switch (yych) {
+	case 'L':
+	case 'l':	goto yy223;
+	default:	goto yy62;
+	}
+yy219:
+	++YYCURSOR;
+	{ return (TOKENIZER_COPY); }
+yy221:
+	++YYCURSOR;
+	{ return (TOKENIZER_DIM); }
+yy223:
+	++YYCURSOR;
+	{ return (TOKENIZER_FILL); }
 }
 
 
@@ -1136,6 +1172,9 @@ int xxxxTest()
 			case TOKENIZER_POKE: printf("TOKENIZER_POKE "); break;
 			case TOKENIZER_CURSOR: printf("TOKENIZER_CURSOR "); break;
 			case TOKENIZER_KIN: printf("TOKENIZER_KIN "); break;
+			case TOKENIZER_DIM: printf("TOKENIZER_DIM "); break;
+			case TOKENIZER_FILL: printf("TOKENIZER_FILL "); break;
+			case TOKENIZER_COPY: printf("TOKENIZER_COPY "); break;
 
 			default:
 			break;
@@ -1165,27 +1204,36 @@ int xxxxTest()
 #define DEBUG_PRINTF(...)
 #endif
 
-Scanner _scanner;
+static Scanner _scanner0;
+static Scanner *_scanner = &_scanner0;
 
 
+/*---------------------------------------------------------------------------*/
+//state tokenizer_* calls work on, every interpreter context has its own
+void
+tokenizer_select(Scanner *s)
+	{
+	_scanner = s;
+	}
+
 /*---------------------------------------------------------------------------*/
 void
 tokenizer_init(const char* program)
 	{
 	/* Start scanning */
-	_scanner.top = program;
-	_scanner._pchCur = program;
-	_scanner.pos = program;
-	_scanner._pchBackup = program;
-	_scanner.line = 1;
+	_scanner->top = program;
+	_scanner->_pchCur = program;
+	_scanner->pos = program;
+	_scanner->_pchBackup = program;
+	_scanner->line = 1;
 
-	_scanner.current_token = scan(&_scanner);
+	_scanner->current_token = scan(_scanner);
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_token(void)
 	{
-	return _scanner.current_token;
+	return _scanner->current_token;
 	}
 /*---------------------------------------------------------------------------*/
 void
@@ -1195,51 +1243,51 @@ tokenizer_next(void)
 		{
 		return;
 		}
-	_scanner.current_token = scan(&_scanner);
-	DEBUG_PRINTF("tokenizer_next: '%.*s' %d\n", _scanner._pchCur - _scanner.top, _scanner.top, _scanner.current_token);
+	_scanner->current_token = scan(_scanner);
+	DEBUG_PRINTF("tokenizer_next: '%.*s' %d\n", _scanner->_pchCur - _scanner->top, _scanner->top, _scanner->current_token);
 	return;
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_num(void)
 	{
-	return atoi(_scanner.top);
+	return atoi(_scanner->top);
 	}
 /*---------------------------------------------------------------------------*/
 void
 tokenizer_string(char *dest, int len)
 	{
-	int string_len = _scanner._pchCur - _scanner.top;
+	int string_len = _scanner->_pchCur - _scanner->top;
 	//2 because of quote marks we know we have
 	string_len -= 2;
 	if(len < string_len)
 		{
 		string_len = len;
 		}
-	memcpy(dest, _scanner.top+1, string_len);
+	memcpy(dest, _scanner->top+1, string_len);
 	dest[string_len] = 0;
 	}
 /*---------------------------------------------------------------------------*/
 void
 tokenizer_error_print(void)
 	{
-	DEBUG_PRINTF("tokenizer_error_print: '%.*s'\n", _scanner._pchCur - _scanner.top, _scanner.top);
+	DEBUG_PRINTF("tokenizer_error_print: '%.*s'\n", _scanner->_pchCur - _scanner->top, _scanner->top);
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_finished(void)
 	{
-	return *_scanner.top == 0 || _scanner.current_token == TOKENIZER_ENDOFINPUT;
+	return *_scanner->top == 0 || _scanner->current_token == TOKENIZER_ENDOFINPUT;
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_variable_num(void)
 	{
-	if (*_scanner.top >= 'a' && *_scanner.top <= 'z') return *_scanner.top - 'a';
-	else return *_scanner.top - 'A';
+	if (*_scanner->top >= 'a' && *_scanner->top <= 'z') return *_scanner->top - 'a';
+	else return *_scanner->top - 'A';
 	}
 /*---------------------------------------------------------------------------*/
 const char* __getAt ( void )	//XXX hack for goto cache impl
 {
-	return _scanner.top;
+	return _scanner->top;
 }
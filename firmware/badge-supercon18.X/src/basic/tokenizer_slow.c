@@ -42,7 +42,9 @@
 #include <ctype.h>
 #include <stdlib.h>
 
-static char const *ptr, *nextptr;
+//top is start of current token, _pchCur just past it
+static Scanner _scanner0;
+static Scanner *_scanner = &_scanner0;
 
 #define MAX_NUMLEN 6
 
@@ -52,8 +54,6 @@ struct keyword_token
 	int token;
 	};
 
-static int current_token = TOKENIZER_ERROR;
-
 //B_BAS001 - list of tokens
 static const struct keyword_token keywords[] =
 	{
@@ -129,6 +129,12 @@ static const struct keyword_token keywords[] =
 		{"CURSOR", TOKENIZER_CURSOR},
 		{"KIN", TOKENIZER_KIN},
 		{"kin", TOKENIZER_KIN},
+		{"dim", TOKENIZER_DIM},
+		{"DIM", TOKENIZER_DIM},
+		{"fill", TOKENIZER_FILL},
+		{"FILL", TOKENIZER_FILL},
+		{"copy", TOKENIZER_COPY},
+		{"COPY", TOKENIZER_COPY},
 //aliases
 		{"clr", TOKENIZER_CLRSCR},
 		{"CLR", TOKENIZER_CLRSCR},
@@ -153,70 +159,70 @@ static const struct keyword_token keywords[] =
 static int
 singlechar(void)
 	{
-	if(*ptr == '|')
+	if(*_scanner->top == '|')
 		{
 		return TOKENIZER_OR;
 		}
-	if (*ptr > '?')
+	if (*_scanner->top > '?')
 		return 0;
-	if(*ptr == '\n')
+	if(*_scanner->top == '\n')
 		{
 		return TOKENIZER_CR;
 		}
-	if(*ptr == '\r')
+	if(*_scanner->top == '\r')
 		{
-		*ptr++;
+		*_scanner->top++;
 		return TOKENIZER_CR;
 		}
-	if(*ptr == ',')
+	if(*_scanner->top == ',')
 		{
 		return TOKENIZER_COMMA;
 		}
-	if(*ptr == ';')
+	if(*_scanner->top == ';')
 		{
 		return TOKENIZER_SEMICOLON;
 		}
-	if(*ptr == '+')
+	if(*_scanner->top == '+')
 		{
 		return TOKENIZER_PLUS;
 		}
-	if(*ptr == '-')
+	if(*_scanner->top == '-')
 		{
 		return TOKENIZER_MINUS;
 		}
-	if(*ptr == '&')
+	if(*_scanner->top == '&')
 		{
 		return TOKENIZER_AND;
 		}
-	if(*ptr == '*')
+	if(*_scanner->top == '*')
 		{
 		return TOKENIZER_ASTR;
 		}
-	if(*ptr == '/')
+	if(*_scanner->top == '/')
 		{
 		return TOKENIZER_SLASH;
 		}
-	if(*ptr == '%')
+	if(*_scanner->top == '%')
 		{
 		return TOKENIZER_MOD;
 		}
-	if(*ptr == '(')
+	if(*_scanner->top == '(')
 		{
 		return TOKENIZER_LEFTPAREN;
 		}
-	if(*ptr == ')')
+	if(*_scanner->top == ')')
 		{
 		return TOKENIZER_RIGHTPAREN;
 		}
-	if(*ptr == '<')
+	if(*_scanner->top == '<')
 		{
 		return TOKENIZER_LT;
 		}
-	if(*ptr == '>')
+	if(*_scanner->top == '>')
 		{
 		return TOKENIZER_GT;
 		}
-	if(*ptr == '=')
+	if(*_scanner->top == '=')
 		{
 		return TOKENIZER_EQ;
 		}
@@ -231,25 +237,25 @@ get_next_token(void)
 	int i,token_string_len;
 	char *ptr2;
 
-	strncpy(token_string,ptr,SUBTOKEN_LEN);
+	strncpy(token_string,_scanner->top,SUBTOKEN_LEN);
 	ptr2 = strchr(token_string, ' ');
 	if (ptr2!=0) *ptr2 = 0;
 	ptr2 = strchr(token_string, '\n');
 	if (ptr2!=0) *ptr2 = 0;
-	DEBUG_PRINTF("get_next_token(): '%s'\n", ptr);
+	DEBUG_PRINTF("get_next_token(): '%s'\n", _scanner->top);
 
-	if(*ptr == 0)
+	if(*_scanner->top == 0)
 		return TOKENIZER_ENDOFINPUT;
 
-	if(isdigit(*ptr))
+	if(isdigit(*_scanner->top))
 		{
 		for(i = 0; i < MAX_NUMLEN; ++i)
 			{
-			if(!isdigit(ptr[i]))
+			if(!isdigit(_scanner->top[i]))
 				{
 				if(i > 0)
 					{
-					nextptr = ptr + i;
+					_scanner->_pchCur = _scanner->top + i;
 					return TOKENIZER_NUMBER;
 					}
 				else
@@ -258,7 +264,7 @@ get_next_token(void)
 					return TOKENIZER_ERROR;
 					}
 				}
-			if(!isdigit(ptr[i]))
+			if(!isdigit(_scanner->top[i]))
 				{
 				DEBUG_PRINTF("get_next_token: error due to malformed number\n");
 				return TOKENIZER_ERROR;
@@ -270,18 +276,18 @@ get_next_token(void)
 	i = singlechar();
 	if(i)
 		{
-		nextptr = ptr + 1;
+		_scanner->_pchCur = _scanner->top + 1;
 		return i;
 		}
-	if(*ptr == '"')
+	if(*_scanner->top == '"')
 		{
-		nextptr = ptr;
+		_scanner->_pchCur = _scanner->top;
 		do
 			{
-			++nextptr;
+			++_scanner->_pchCur;
 			}
-		while(*nextptr != '"');
-		++nextptr;
+		while(*_scanner->_pchCur != '"');
+		++_scanner->_pchCur;
 		return TOKENIZER_STRING;
 		}
 	else
@@ -293,34 +299,40 @@ get_next_token(void)
 				{
 				if (strlen(token_string)==strlen(kt->keyword))
 					{
-					nextptr = ptr + strlen(kt->keyword);
+					_scanner->_pchCur = _scanner->top + strlen(kt->keyword);
 					return kt->token;
 					}
 				}
 			}
 		}
 
-	if((*ptr >= 'a' && *ptr <= 'z')|(*ptr >= 'A' && *ptr <= 'Z'))
+	if((*_scanner->top >= 'a' && *_scanner->top <= 'z')|(*_scanner->top >= 'A' && *_scanner->top <= 'Z'))
 		{
-		nextptr = ptr + 1;
+		_scanner->_pchCur = _scanner->top + 1;
 		return TOKENIZER_VARIABLE;
 		}
-	nextptr = ptr + 1;
+	_scanner->_pchCur = _scanner->top + 1;
 
 	return TOKENIZER_ERROR;
 	}
 /*---------------------------------------------------------------------------*/
 void
+tokenizer_select(Scanner *s)
+	{
+	_scanner = s;
+	}
+/*---------------------------------------------------------------------------*/
+void
 tokenizer_init(const char *program)
 	{
-	ptr = program;
-	current_token = get_next_token();
+	_scanner->top = program;
+	_scanner->current_token = get_next_token();
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_token(void)
 	{
-	return current_token;
+	return _scanner->current_token;
 	}
 /*---------------------------------------------------------------------------*/
 void
@@ -332,21 +344,21 @@ tokenizer_next(void)
 		return;
 		}
 
-	DEBUG_PRINTF("tokenizer_next: %p\n", nextptr);
-	ptr = nextptr;
-	while(*ptr == ' ')
+	DEBUG_PRINTF("tokenizer_next: %p\n", _scanner->_pchCur);
+	_scanner->top = _scanner->_pchCur;
+	while(*_scanner->top == ' ')
 		{
-		++ptr;
+		++_scanner->top;
 		}
-	current_token = get_next_token();
-	DEBUG_PRINTF("tokenizer_next: '%s' %d\n", ptr, current_token);
+	_scanner->current_token = get_next_token();
+	DEBUG_PRINTF("tokenizer_next: '%s' %d\n", _scanner->top, _scanner->current_token);
 	return;
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_num(void)
 	{
-	return atoi(ptr);
+	return atoi(_scanner->top);
 	}
 /*---------------------------------------------------------------------------*/
 void
@@ -359,36 +371,40 @@ tokenizer_string(char *dest, int len)
 		{
 		return;
 		}
-	string_end = strchr(ptr + 1, '"');
+	string_end = strchr(_scanner->top + 1, '"');
 	if(string_end == NULL)
 		{
 		return;
 		}
-	string_len = string_end - ptr - 1;
+	string_len = string_end - _scanner->top - 1;
 	if(len < string_len)
 		{
 		string_len = len;
 		}
-	memcpy(dest, ptr + 1, string_len);
+	memcpy(dest, _scanner->top + 1, string_len);
 	dest[string_len] = 0;
 	}
 /*---------------------------------------------------------------------------*/
 void
 tokenizer_error_print(void)
 	{
-	DEBUG_PRINTF("tokenizer_error_print: '%s'\n", ptr);
+	DEBUG_PRINTF("tokenizer_error_print: '%s'\n", _scanner->top);
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_finished(void)
 	{
-	return *ptr == 0 || current_token == TOKENIZER_ENDOFINPUT;
+	return *_scanner->top == 0 || _scanner->current_token == TOKENIZER_ENDOFINPUT;
 	}
 /*---------------------------------------------------------------------------*/
 int
 tokenizer_variable_num(void)
 	{
-	if (*ptr >= 'a' && *ptr <= 'z') return *ptr - 'a';
-	else return *ptr - 'A';
+	if (*_scanner->top >= 'a' && *_scanner->top <= 'z') return *_scanner->top - 'a';
+	else return *_scanner->top - 'A';
 	}
 /*---------------------------------------------------------------------------*/
+const char* __getAt ( void )
+	{
+	return _scanner->top;
+	}
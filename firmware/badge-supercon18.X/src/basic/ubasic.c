@@ -46,6 +46,7 @@
 #include <stdio.h> /* printf() */
 #include <stdlib.h> /* exit() */
 #include <setjmp.h>
+#include <string.h>
 
 extern jmp_buf jbuf;
 extern uint8_t handle_display;
@@ -57,31 +58,33 @@ void set_memory (uint16_t addr, uint8_t value);
 
 
 char err_msg[40];
-int last_linenum;
 
-static char const *program_ptr;
 #define MAX_STRINGLEN 40
 static char string[MAX_STRINGLEN];
 
-#define MAX_GOSUB_STACK_DEPTH 30
-static int gosub_stack[MAX_GOSUB_STACK_DEPTH];
-static int gosub_stack_ptr;
+//program ubasic_init starts and RUN runs, ubasic_step points ctx to others
+static struct ubasic_ctx ubasic_main;
+static struct ubasic_ctx *ctx = &ubasic_main;
 
-struct for_state
-	{
-	int line_after_for;
-	int for_variable;
-	int to;
-	};
-#define MAX_FOR_STACK_DEPTH 4
-static struct for_state for_stack[MAX_FOR_STACK_DEPTH];
-static int for_stack_ptr;
+//line number index of program, built by RUN after the program was changed.
+//Every line_step-th line start is in, lines in between are scanned. Programs
+//with line numbers not ascending or over 16 bits are scanned from start.
+#define LINE_INDEX_LEN 256
+static uint16_t line_num[LINE_INDEX_LEN];
+static uint16_t line_pos[LINE_INDEX_LEN];
+static uint16_t line_cnt;
+static const char *line_prog;
+uint8_t ubasic_compile=1;
 
-#define MAX_VARNUM 26
-static int variables[MAX_VARNUM];
-
-static int ended;
-uint8_t interactive_mode;
+//arrays of DIM, a 4 byte header (count, element size) and the elements.
+//RUN and the prompt take them from the bottom of the arena, programs of
+//ubasic_step from the top, one context at a time, or from a slice of their
+//own given with ubasic_ctx_arena
+static uint8_t *arr_base;
+static uint16_t arr_len, arr_lo, arr_hi;
+static struct ubasic_ctx *arr_owner;		//context with arrays at the top
+#define ARR_COUNT(h)	(*(uint16_t *)(h))
+#define ARR_SIZE(h)		((h)[2])
 
 uint8_t term_vt100=1;
 unsigned int term_x=0,term_y=0;
@@ -89,19 +92,43 @@ unsigned int term_x=0,term_y=0;
 static int expr(void);
 static void line_statement(void);
 static void statement(void);
+static void line_index(const char *program);
+static int arr_get(int var, int i);
+static void arr_set(int var, int i, int v);
+#ifdef	BASIC_BYTECODE
+static void bc_compile(const char *program);
+static void bc_run(void);
+#endif
 extern volatile int8_t brk_key;
 
+/*---------------------------------------------------------------------------*/
+static void ubasic_select(struct ubasic_ctx *c)
+	{
+	ctx = c;
+	tokenizer_select(&c->scan);
+	}
 //B_BAS009
 /*---------------------------------------------------------------------------*/
 void ubasic_init(const char *program, uint8_t mode)
 	{
-	program_ptr = program;
-	for_stack_ptr = gosub_stack_ptr = 0;
+	ubasic_select(&ubasic_main);
+	ctx->program_ptr = program;
+	ctx->for_stack_ptr = ctx->gosub_stack_ptr = 0;
+	if ((mode==0)&&(line_prog!=program)) line_index(program);
+	if (mode==0)
+		{
+		arr_lo = 0;
+		memset(ctx->arrays,0,sizeof(ctx->arrays));
+		}
+#ifdef	BASIC_BYTECODE
+	ctx->bc_on = 0;
+	if ((mode==0)&&(ubasic_compile)) bc_compile(program);
+#endif
 	tokenizer_init(program);
-	ended = 0;
+	ctx->ended = 0;
 	term_vt100=1;
-	last_linenum = 0;
-	interactive_mode = mode;
+	ctx->last_linenum = 0;
+	ctx->interactive_mode = mode;
 	serial_flush();
 	}
 /*---------------------------------------------------------------------------*/
@@ -109,7 +136,7 @@ static void accept(int token)
 	{
 	if(token != tokenizer_token())
 		{
-		sprintf(err_msg,"Bad token %d at line %d\n", token,last_linenum);
+		sprintf(err_msg,"Bad token %d at line %d\n", token,ctx->last_linenum);
 		stdio_write(err_msg);
 		tokenizer_error_print();
 		longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1
@@ -121,10 +148,18 @@ static void accept(int token)
 /*---------------------------------------------------------------------------*/
 static int varfactor(void)
 	{
-	int r;
-	DEBUG_PRINTF("varfactor: obtaining %d from variable %d\n", variables[tokenizer_variable_num()], tokenizer_variable_num());
-	r = ubasic_get_variable(tokenizer_variable_num());
+	int r, var;
+	DEBUG_PRINTF("varfactor: obtaining %d from variable %d\n", ctx->variables[tokenizer_variable_num()], tokenizer_variable_num());
+	var = tokenizer_variable_num();
 	accept(TOKENIZER_VARIABLE);
+	if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+		{
+		accept(TOKENIZER_LEFTPAREN);
+		r = expr();
+		accept(TOKENIZER_RIGHTPAREN);
+		return arr_get(var, r);
+		}
+	r = ubasic_get_variable(var);
 	return r;
 	}
 
@@ -331,34 +366,133 @@ static int relation(void)
 	return r1;
 	}
 /*---------------------------------------------------------------------------*/
-static void jump_linenum(int linenum)
+//from one line start to the next, 0 at end of program
+static uint8_t line_next(void)
 	{
-	tokenizer_init(program_ptr);
-	while(tokenizer_num() != linenum)
+	do
 		{
 		do
 			{
-			do
-				{
-				tokenizer_next();
-				}
-			while(tokenizer_token() != TOKENIZER_CR &&
-			        tokenizer_token() != TOKENIZER_ENDOFINPUT);
-			if(tokenizer_token() == TOKENIZER_CR)
-				{
-				tokenizer_next();
-				}
-			if (tokenizer_token() == TOKENIZER_ENDOFINPUT)
-				{
-				sprintf(err_msg,"Unreachable line %d called from %d\n",linenum,last_linenum);
-				stdio_write(err_msg);
-				tokenizer_error_print();
-				longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1
-				}
+			tokenizer_next();
 			}
-		while(tokenizer_token() != TOKENIZER_NUMBER);
-		DEBUG_PRINTF("jump_linenum: Found line %d\n", tokenizer_num());
+		while(tokenizer_token() != TOKENIZER_CR &&
+		        tokenizer_token() != TOKENIZER_ENDOFINPUT);
+		if(tokenizer_token() == TOKENIZER_CR)
+			{
+			tokenizer_next();
+			}
+		if (tokenizer_token() == TOKENIZER_ENDOFINPUT) return 0;
+		}
+	while(tokenizer_token() != TOKENIZER_NUMBER);
+	return 1;
+	}
+/*---------------------------------------------------------------------------*/
+//two scans, first one counts lines and checks the order
+static void line_index(const char *program)
+	{
+	uint16_t n, step;
+	int num, prev;
+	line_prog = 0;
+	if (strlen(program) >= 0xFFFF) return;
+	tokenizer_init(program);
+	if (tokenizer_finished()) return;
+	n = 0;
+	prev = 0;
+	do
+		{
+		num = tokenizer_num();
+		if ((num < prev)||(num > 0xFFFF)) return;
+		prev = num;
+		n++;
 		}
+	while (line_next());
+	step = (n + LINE_INDEX_LEN - 1) / LINE_INDEX_LEN;
+	tokenizer_init(program);
+	line_cnt = 0;
+	n = 0;
+	do
+		{
+		if ((n++ % step) == 0)
+			{
+			line_num[line_cnt] = tokenizer_num();
+			line_pos[line_cnt] = __getAt() - program;
+			line_cnt++;
+			}
+		}
+	while (line_next());
+	line_prog = program;
+	}
+/*---------------------------------------------------------------------------*/
+void ubasic_program_changed(void)
+	{
+	line_prog = 0;
+	}
+/*---------------------------------------------------------------------------*/
+//text offset of first line with the number, -1 if there is none
+static int line_find(int linenum)
+	{
+	uint16_t lo, hi, mid;
+	int num;
+	if (line_prog != ctx->program_ptr)
+		{
+		tokenizer_init(ctx->program_ptr);
+		while(tokenizer_num() != linenum)
+			{
+			if (!line_next()) return -1;
+			DEBUG_PRINTF("jump_linenum: Found line %d\n", tokenizer_num());
+			}
+		return __getAt() - ctx->program_ptr;
+		}
+	if ((linenum < 0)||(linenum > 0xFFFF)) return -1;
+	//first indexed line not below linenum, scan from the one before it
+	lo = 0;
+	hi = line_cnt;
+	while (lo < hi)
+		{
+		mid = (lo + hi) / 2;
+		if (line_num[mid] < linenum) lo = mid + 1;
+		else hi = mid;
+		}
+	if (lo > 0) lo--;
+	tokenizer_init(ctx->program_ptr + line_pos[lo]);
+	while (1)
+		{
+		num = tokenizer_num();
+		if (num == linenum) return __getAt() - ctx->program_ptr;
+		if (num > linenum) return -1;
+		if (!line_next()) return -1;
+		}
+	}
+/*---------------------------------------------------------------------------*/
+//text offset of the line RETURN or NEXT goes to, when it starts at tokenizer,
+//looked up once here instead of on every jump
+static int line_here(void)
+	{
+	const char *at;
+	int pos;
+	if ((line_prog != ctx->program_ptr)||(tokenizer_token() != TOKENIZER_NUMBER)) return -1;
+	at = __getAt();
+	pos = line_find(tokenizer_num());
+	tokenizer_init(at);
+	return pos;
+	}
+/*---------------------------------------------------------------------------*/
+static void jump_pos(int linenum, int pos)
+	{
+	if (pos < 0) pos = line_find(linenum);
+	if (pos < 0)
+		{
+		sprintf(err_msg,"Unreachable line %d called from %d\n",linenum,ctx->last_linenum);
+		stdio_write(err_msg);
+		tokenizer_error_print();
+		longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1
+		}
+	tokenizer_init(ctx->program_ptr + pos);
+	}
+/*---------------------------------------------------------------------------*/
+static void jump_linenum(int linenum)
+	{
+	jump_pos(linenum,-1);
 	}
 /*---------------------------------------------------------------------------*/
 static void goto_statement(void)
@@ -473,14 +607,24 @@ static void if_statement(void)
 /*---------------------------------------------------------------------------*/
 static void let_statement(void)
 	{
-	int var;
+	int var, i;
 
 	var = tokenizer_variable_num();
 
 	accept(TOKENIZER_VARIABLE);
+	if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+		{
+		accept(TOKENIZER_LEFTPAREN);
+		i = expr();
+		accept(TOKENIZER_RIGHTPAREN);
+		accept(TOKENIZER_EQ);
+		arr_set(var, i, expr());
+		accept(TOKENIZER_CR);
+		return;
+		}
 	accept(TOKENIZER_EQ);
 	ubasic_set_variable(var, expr());
-	DEBUG_PRINTF("let_statement: assign %d to %d\n", variables[var], var);
+	DEBUG_PRINTF("let_statement: assign %d to %d\n", ctx->variables[var], var);
 	accept(TOKENIZER_CR);
 
 	}
@@ -492,15 +636,16 @@ static void gosub_statement(void)
 	linenum = tokenizer_num();
 	accept(TOKENIZER_NUMBER);
 	accept(TOKENIZER_CR);
-	if(gosub_stack_ptr < MAX_GOSUB_STACK_DEPTH)
+	if(ctx->gosub_stack_ptr < MAX_GOSUB_STACK_DEPTH)
 		{
-		gosub_stack[gosub_stack_ptr] = tokenizer_num();
-		gosub_stack_ptr++;
+		ctx->gosub_stack[ctx->gosub_stack_ptr] = tokenizer_num();
+		ctx->gosub_pos[ctx->gosub_stack_ptr] = line_here();
+		ctx->gosub_stack_ptr++;
 		jump_linenum(linenum);
 		}
 	else
 		{
-		sprintf(err_msg,"gosub stack overflow at line %d\n", last_linenum);
+		sprintf(err_msg,"gosub stack overflow at line %d\n", ctx->last_linenum);
 		stdio_write(err_msg);
 		tokenizer_error_print();
 		longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1		
@@ -510,14 +655,14 @@ static void gosub_statement(void)
 static void return_statement(void)
 	{
 	accept(TOKENIZER_RETURN);
-	if(gosub_stack_ptr > 0)
+	if(ctx->gosub_stack_ptr > 0)
 		{
-		gosub_stack_ptr--;
-		jump_linenum(gosub_stack[gosub_stack_ptr]);
+		ctx->gosub_stack_ptr--;
+		jump_pos(ctx->gosub_stack[ctx->gosub_stack_ptr],ctx->gosub_pos[ctx->gosub_stack_ptr]);
 		}
 	else
 		{
-		sprintf(err_msg,"gosub stack underflow at line %d\n", last_linenum);
+		sprintf(err_msg,"gosub stack underflow at line %d\n", ctx->last_linenum);
 		stdio_write(err_msg);
 		tokenizer_error_print();
 		longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1	
@@ -531,24 +676,24 @@ static void next_statement(void)
 	accept(TOKENIZER_NEXT);
 	var = tokenizer_variable_num();
 	accept(TOKENIZER_VARIABLE);
-	if(for_stack_ptr > 0 &&
-	        var == for_stack[for_stack_ptr - 1].for_variable)
+	if(ctx->for_stack_ptr > 0 &&
+	        var == ctx->for_stack[ctx->for_stack_ptr - 1].for_variable)
 		{
 		ubasic_set_variable(var,
 		                    ubasic_get_variable(var) + 1);
-		if(ubasic_get_variable(var) <= for_stack[for_stack_ptr - 1].to)
+		if(ubasic_get_variable(var) <= ctx->for_stack[ctx->for_stack_ptr - 1].to)
 			{
-			jump_linenum(for_stack[for_stack_ptr - 1].line_after_for);
+			jump_pos(ctx->for_stack[ctx->for_stack_ptr - 1].line_after_for,ctx->for_stack[ctx->for_stack_ptr - 1].pos_after_for);
 			}
 		else
 			{
-			for_stack_ptr--;
+			ctx->for_stack_ptr--;
 			accept(TOKENIZER_CR);
 			}
 		}
 	else
 		{
-		DEBUG_PRINTF("next_statement: non-matching next (expected %d, found %d)\n", for_stack[for_stack_ptr - 1].for_variable, var);
+		DEBUG_PRINTF("next_statement: non-matching next (expected %d, found %d)\n", ctx->for_stack[ctx->for_stack_ptr - 1].for_variable, var);
 		accept(TOKENIZER_CR);
 		}
 
@@ -567,20 +712,21 @@ static void for_statement(void)
 	to = expr();
 	accept(TOKENIZER_CR);
 
-	if(for_stack_ptr < MAX_FOR_STACK_DEPTH)
+	if(ctx->for_stack_ptr < MAX_FOR_STACK_DEPTH)
 		{
-		for_stack[for_stack_ptr].line_after_for = tokenizer_num();
-		for_stack[for_stack_ptr].for_variable = for_variable;
-		for_stack[for_stack_ptr].to = to;
+		ctx->for_stack[ctx->for_stack_ptr].line_after_for = tokenizer_num();
+		ctx->for_stack[ctx->for_stack_ptr].pos_after_for = line_here();
+		ctx->for_stack[ctx->for_stack_ptr].for_variable = for_variable;
+		ctx->for_stack[ctx->for_stack_ptr].to = to;
 		DEBUG_PRINTF("for_statement: new for, var %d to %d\n",
-		             for_stack[for_stack_ptr].for_variable,
-		             for_stack[for_stack_ptr].to);
+		             ctx->for_stack[ctx->for_stack_ptr].for_variable,
+		             ctx->for_stack[ctx->for_stack_ptr].to);
 
-		for_stack_ptr++;
+		ctx->for_stack_ptr++;
 		}
 	else
 		{
-		sprintf(err_msg,"FOR stack overflow at line %d\n", last_linenum);
+		sprintf(err_msg,"FOR stack overflow at line %d\n", ctx->last_linenum);
 		stdio_write(err_msg);
 		tokenizer_error_print();
 		longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1	
@@ -590,7 +736,7 @@ static void for_statement(void)
 static void end_statement(void)
 	{
 	accept(TOKENIZER_END);
-	ended = 1;
+	ctx->ended = 1;
 	}
 /*---------------------------------------------------------------------------*/
 static void out_statement(void)
@@ -796,6 +942,188 @@ static void cursor_statement(void)
 	tokenizer_next();
 	}
 /*---------------------------------------------------------------------------*/
+static void arr_error(const char *fmt, int n)
+	{
+	sprintf(err_msg,fmt,n,ctx->last_linenum);
+	stdio_write(err_msg);
+	longjmp(jbuf,1);
+	}
+static uint8_t *arr_head(int var)
+	{
+	if (ctx->arrays[var]==0) arr_error("No array %c at line %d\n",'a'+var);
+	if (ctx->slice) return ctx->slice + 4*(ctx->arrays[var]-1);
+	return arr_base + 4*(ctx->arrays[var]-1);
+	}
+//elements i to i+n-1 are in array
+static void arr_range(uint8_t *h, int i, int n)
+	{
+	if ((i<0)||(i>=ARR_COUNT(h))) arr_error("Bad index %d at line %d\n",i);
+	if ((n<0)||(n>(ARR_COUNT(h) - i))) arr_error("Bad count %d at line %d\n",n);
+	}
+/*---------------------------------------------------------------------------*/
+//elements 0 to n, all zero
+static void arr_dim(int var, int n, int bits)
+	{
+	uint8_t *h;
+	uint32_t len;
+	if (ctx->arrays[var]) arr_error("Array %c again at line %d\n",'a'+var);
+	if ((bits!=16)&&(bits!=32)) arr_error("Bad width %d at line %d\n",bits);
+	if ((n<0)||(n>=0xFFFF)) arr_error("Bad size %d at line %d\n",n);
+	len = (4 + (uint32_t)(n+1)*(bits/8) + 3) & ~3;
+	if (ctx->slice)
+		{
+		if (len > (uint32_t)(ctx->slice_len - ctx->slice_used)) arr_error("No room for %c at line %d\n",'a'+var);
+		h = ctx->slice + ctx->slice_used;
+		ctx->slice_used += len;
+		ctx->arrays[var] = (h - ctx->slice)/4 + 1;
+		}
+	else
+		{
+		if ((ctx!=&ubasic_main)&&(arr_owner!=0)&&(arr_owner!=ctx))
+			arr_error("No arena for %c at line %d\n",'a'+var);
+		if (len > (uint32_t)(arr_hi - arr_lo)) arr_error("No room for %c at line %d\n",'a'+var);
+		if (ctx==&ubasic_main)
+			{
+			h = arr_base + arr_lo;
+			arr_lo += len;
+			}
+		else
+			{
+			arr_owner = ctx;
+			arr_hi -= len;
+			h = arr_base + arr_hi;
+			}
+		ctx->arrays[var] = (h - arr_base)/4 + 1;
+		}
+	memset(h,0,len);
+	ARR_COUNT(h) = n+1;
+	ARR_SIZE(h) = bits/8;
+	}
+static int arr_get(int var, int i)
+	{
+	uint8_t *h;
+	h = arr_head(var);
+	if ((i<0)||(i>=ARR_COUNT(h))) arr_error("Bad index %d at line %d\n",i);
+	if (ARR_SIZE(h)==2) return ((int16_t *)(h+4))[i];
+	return ((int32_t *)(h+4))[i];
+	}
+static void arr_set(int var, int i, int v)
+	{
+	uint8_t *h;
+	h = arr_head(var);
+	if ((i<0)||(i>=ARR_COUNT(h))) arr_error("Bad index %d at line %d\n",i);
+	if (ARR_SIZE(h)==2) ((int16_t *)(h+4))[i] = v;
+	else ((int32_t *)(h+4))[i] = v;
+	}
+static int arr_count(int var)
+	{
+	return ARR_COUNT(arr_head(var));
+	}
+static void arr_fill(int var, int i, int v, int n)
+	{
+	uint8_t *h;
+	int16_t *e16;
+	int32_t *e32;
+	h = arr_head(var);
+	arr_range(h,i,n);
+	if (ARR_SIZE(h)==2)
+		{
+		e16 = (int16_t *)(h+4) + i;
+		while (n--) *e16++ = v;
+		}
+	else
+		{
+		e32 = (int32_t *)(h+4) + i;
+		while (n--) *e32++ = v;
+		}
+	}
+//n elements of src from j on to dst from i on, as memmove within an array
+static void arr_copy(int dst, int i, int src, int j, int n)
+	{
+	uint8_t *hd, *hs;
+	int k;
+	hd = arr_head(dst);
+	hs = arr_head(src);
+	arr_range(hd,i,n);
+	arr_range(hs,j,n);
+	if (ARR_SIZE(hd)==ARR_SIZE(hs))
+		memmove(hd + 4 + i*ARR_SIZE(hd),hs + 4 + j*ARR_SIZE(hs),n*ARR_SIZE(hd));
+	else if (ARR_SIZE(hd)==2)
+		for (k=0;k<n;k++) ((int16_t *)(hd+4))[i+k] = ((int32_t *)(hs+4))[j+k];
+	else
+		for (k=0;k<n;k++) ((int32_t *)(hd+4))[i+k] = ((int16_t *)(hs+4))[j+k];
+	}
+/*---------------------------------------------------------------------------*/
+//DIM a(n) of 32 bit elements, DIM a(n),16 of 16 bit ones
+static void dim_statement(void)
+	{
+	int var, n, bits;
+	accept(TOKENIZER_DIM);
+	var = tokenizer_variable_num();
+	accept(TOKENIZER_VARIABLE);
+	accept(TOKENIZER_LEFTPAREN);
+	n = expr();
+	accept(TOKENIZER_RIGHTPAREN);
+	bits = 32;
+	if (tokenizer_token() == TOKENIZER_COMMA)
+		{
+		accept(TOKENIZER_COMMA);
+		bits = expr();
+		}
+	accept(TOKENIZER_CR);
+	arr_dim(var, n, bits);
+	}
+/*---------------------------------------------------------------------------*/
+//FILL a,v sets whole array, FILL a(i),v,n n elements from i on
+static void fill_statement(void)
+	{
+	int var, i, v, n;
+	accept(TOKENIZER_FILL);
+	var = tokenizer_variable_num();
+	accept(TOKENIZER_VARIABLE);
+	if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+		{
+		accept(TOKENIZER_LEFTPAREN);
+		i = expr();
+		accept(TOKENIZER_RIGHTPAREN);
+		accept(TOKENIZER_COMMA);
+		v = expr();
+		accept(TOKENIZER_COMMA);
+		n = expr();
+		}
+	else
+		{
+		accept(TOKENIZER_COMMA);
+		v = expr();
+		i = 0;
+		n = arr_count(var);
+		}
+	accept(TOKENIZER_CR);
+	arr_fill(var, i, v, n);
+	}
+/*---------------------------------------------------------------------------*/
+//COPY b(i),a(j),n copies n elements of a from j on to b from i on
+static void copy_statement(void)
+	{
+	int dst, src, i, j, n;
+	accept(TOKENIZER_COPY);
+	dst = tokenizer_variable_num();
+	accept(TOKENIZER_VARIABLE);
+	accept(TOKENIZER_LEFTPAREN);
+	i = expr();
+	accept(TOKENIZER_RIGHTPAREN);
+	accept(TOKENIZER_COMMA);
+	src = tokenizer_variable_num();
+	accept(TOKENIZER_VARIABLE);
+	accept(TOKENIZER_LEFTPAREN);
+	j = expr();
+	accept(TOKENIZER_RIGHTPAREN);
+	accept(TOKENIZER_COMMA);
+	n = expr();
+	accept(TOKENIZER_CR);
+	arr_copy(dst, i, src, j, n);
+	}
+/*---------------------------------------------------------------------------*/
 
 
 
@@ -828,7 +1156,7 @@ static void statement(void)
 			println_statement();
 			break;
 		case TOKENIZER_IF:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -836,7 +1164,7 @@ static void statement(void)
 			if_statement();
 			break;
 		case TOKENIZER_GOTO:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -844,7 +1172,7 @@ static void statement(void)
 			goto_statement();
 			break;
 		case TOKENIZER_GOSUB:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -852,7 +1180,7 @@ static void statement(void)
 			gosub_statement();
 			break;
 		case TOKENIZER_RETURN:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -860,7 +1188,7 @@ static void statement(void)
 			return_statement();
 			break;
 		case TOKENIZER_FOR:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -868,7 +1196,7 @@ static void statement(void)
 			for_statement();
 			break;
 		case TOKENIZER_NEXT:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -876,7 +1204,7 @@ static void statement(void)
 			next_statement();
 			break;
 		case TOKENIZER_END:
-			if (interactive_mode)
+			if (ctx->interactive_mode)
 				{
 				seek_end();
 				break;
@@ -937,8 +1265,17 @@ static void statement(void)
 		case TOKENIZER_CURSOR:
 			cursor_statement();
 			break;
+		case TOKENIZER_DIM:
+			dim_statement();
+			break;
+		case TOKENIZER_FILL:
+			fill_statement();
+			break;
+		case TOKENIZER_COPY:
+			copy_statement();
+			break;
 		default:
-			sprintf(err_msg,"Bad token %d at line %d\n", token,last_linenum);
+			sprintf(err_msg,"Bad token %d at line %d\n", token,ctx->last_linenum);
 			stdio_write(err_msg);
 			//exit(1);
 			longjmp(jbuf,1);             // jumps back to where setjmp was called - making setjmp now return 1
@@ -948,15 +1285,942 @@ static void statement(void)
 static void line_statement(void)
 	{
 	DEBUG_PRINTF("----------- Line number %d ---------\n", tokenizer_num());
-	last_linenum = tokenizer_num();
+	ctx->last_linenum = tokenizer_num();
 	accept(TOKENIZER_NUMBER);
 	statement();
 	return;
 	}
+#ifdef	BASIC_BYTECODE
+/*---------------------------------------------------------------------------*/
+//RUN compiles the program into bytecode first. Interpreter state between
+//two lines is just the tokenizer position, so the program is cut into blocks,
+//one per position a line can start at, each compiled by the same token walk
+//the statements above do. Literals, variable slots, expressions in RPN and
+//jump targets are resolved once. A block that does not compile (bad token,
+//deep expression) is left to the interpreter, which takes over from there,
+//so error messages and line numbers stay as they were.
+enum
+	{
+	BC_LINE, BC_LIT8, BC_LIT16, BC_LIT32, BC_VAR, BC_STORE, BC_POP,
+	BC_ADD, BC_SUB, BC_AND, BC_OR, BC_MUL, BC_DIV, BC_MOD, BC_LT, BC_GT, BC_EQ,
+	BC_RND, BC_EIN, BC_PEEK, BC_KIN, BC_UIN, BC_INPUT, BC_PUTS, BC_PRINT, BC_PRINTLN,
+	BC_TUNE, BC_SETXY, BC_TERMT, BC_CLRSCR, BC_WAIT, BC_LED, BC_COLOR, BC_CHR,
+	BC_EDR, BC_EOUT, BC_TERMUP, BC_UOUT, BC_POKE, BC_CURSOR,
+	BC_AGET, BC_ASET, BC_DIM, BC_FILL, BC_FILLALL, BC_COPY,
+	BC_JZ, BC_GO, BC_UNREACH, BC_GOSUB, BC_RETURN, BC_FOR, BC_NEXT, BC_END,
+	};
+
+//block table grows down from the end of the buffer, code up from its start.
+//The buffer is the bottom of the array arena, up to BASIC_BC_LEN, and what
+//RUN doesn't take of it is left to DIM
+struct bc_block
+	{
+	uint16_t pos;				//offset of first token in program text
+	uint16_t off;				//code offset, or BC_TEXT
+	};
+#define BC_TEXT			0xFFFF
+#define BC_DONE			0xFFFF	//block index of end of program
+#define BC_NOLINE		0xFFFE	//block index of line that does not exist
+#define BC_STACK		16
+#define BC_TAB(i)		(&bc_mem[bc_max/4-1-(i)])
+#define BC_U16(p)		((uint16_t)((p)[0]|((p)[1]<<8)))
+#define BC_S32(p)		((int)((uint32_t)(p)[0]|((uint32_t)(p)[1]<<8)|((uint32_t)(p)[2]<<16)|((uint32_t)(p)[3]<<24)))
+
+static struct bc_block *bc_mem;
+#define bc_code			((uint8_t *)bc_mem)
+static uint16_t bc_max, bc_len, bc_blocks, bc_end;
+static uint8_t bc_depth;
+static const char *bc_prog;
+static jmp_buf bc_jbuf;
+
+static uint8_t bc_statement(void);
+static void bc_expr(void);
+
+//1 gives up on current block, 2 on whole program
+static void bc_fail(int how)
+	{
+	longjmp(bc_jbuf,how);
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_emit(uint8_t b)
+	{
+	if ((bc_len + 1 + 4*bc_blocks) > bc_max) bc_fail(2);
+	bc_code[bc_len++] = b;
+	}
+static void bc_emit16(uint16_t v)
+	{
+	bc_emit(v);
+	bc_emit(v>>8);
+	}
+static void bc_emit32(int v)
+	{
+	bc_emit16(v);
+	bc_emit16(((uint32_t)v)>>16);
+	}
+//stack depth is tracked so that the VM needs no checks
+static void bc_emit_push(uint8_t op)
+	{
+	if (++bc_depth > BC_STACK) bc_fail(1);
+	bc_emit(op);
+	}
+static void bc_emit_pop(uint8_t op, uint8_t n)
+	{
+	bc_depth -= n;
+	bc_emit(op);
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_accept(int token)
+	{
+	if (token != tokenizer_token()) bc_fail(1);
+	tokenizer_next();
+	}
+//position of tokenizer, end of input is the terminating zero
+static uint16_t bc_pos(void)
+	{
+	if (tokenizer_token() == TOKENIZER_ENDOFINPUT) return bc_end;
+	return __getAt() - bc_prog;
+	}
+//block starting at position, new ones are compiled later in order
+static uint16_t bc_block(uint16_t pos)
+	{
+	uint16_t i;
+	if (pos == bc_end) return BC_DONE;
+	for (i=0;i<bc_blocks;i++)
+		if (BC_TAB(i)->pos == pos) return i;
+	if ((bc_len + 4*(bc_blocks+1)) > bc_max) bc_fail(2);
+	if (bc_blocks >= BC_NOLINE) bc_fail(2);
+	BC_TAB(i)->pos = pos;
+	BC_TAB(i)->off = BC_TEXT;
+	bc_blocks++;
+	return i;
+	}
+//block jump_linenum would get to
+static uint16_t bc_line(int linenum)
+	{
+	uint16_t save;
+	int pos;
+	save = bc_pos();
+	pos = line_find(linenum);
+	tokenizer_init(bc_prog + save);
+	if (pos < 0) return BC_NOLINE;
+	return bc_block(pos);
+	}
+//continue with block at current position
+static void bc_emit_next(void)
+	{
+	bc_emit(BC_GO);
+	bc_emit16(bc_block(bc_pos()));
+	}
+//jump to line, or the error jump_linenum gives
+static void bc_emit_jump(int linenum)
+	{
+	uint16_t blk;
+	blk = bc_line(linenum);
+	if (blk == BC_NOLINE)
+		{
+		bc_emit(BC_UNREACH);
+		bc_emit32(linenum);
+		}
+	else
+		{
+		bc_emit(BC_GO);
+		bc_emit16(blk);
+		}
+	}
+static void bc_emit_string(const char *s)
+	{
+	bc_emit(BC_PUTS);
+	do bc_emit(*s); while (*s++);
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_factor(void)
+	{
+	char str[MAX_STRINGLEN+1];
+	int r;
+	uint8_t op;
+	str[0] = 0;
+	switch(tokenizer_token())
+		{
+		case TOKENIZER_NUMBER:
+			r = tokenizer_num();
+			if ((r>=0)&&(r<=0xFF))
+				{
+				bc_emit_push(BC_LIT8);
+				bc_emit(r);
+				}
+			else if ((r>=0)&&(r<=0xFFFF))
+				{
+				bc_emit_push(BC_LIT16);
+				bc_emit16(r);
+				}
+			else
+				{
+				bc_emit_push(BC_LIT32);
+				bc_emit32(r);
+				}
+			bc_accept(TOKENIZER_NUMBER);
+			break;
+		case TOKENIZER_LEFTPAREN:
+			bc_accept(TOKENIZER_LEFTPAREN);
+			bc_expr();
+			bc_accept(TOKENIZER_RIGHTPAREN);
+			break;
+		case TOKENIZER_RND:
+		case TOKENIZER_EIN:
+		case TOKENIZER_PEEK:
+		case TOKENIZER_KIN:
+		case TOKENIZER_UIN:
+			switch (tokenizer_token())
+				{
+				case TOKENIZER_RND:	op = BC_RND; break;
+				case TOKENIZER_EIN:	op = BC_EIN; break;
+				case TOKENIZER_PEEK:	op = BC_PEEK; break;
+				case TOKENIZER_KIN:	op = BC_KIN; break;
+				default:			op = BC_UIN; break;
+				}
+			tokenizer_next();
+			bc_expr();
+			bc_emit(op);
+			break;
+		case TOKENIZER_INPUT:
+			bc_accept(TOKENIZER_INPUT);
+			if(tokenizer_token() == TOKENIZER_STRING)
+				{
+				tokenizer_string(str, MAX_STRINGLEN);
+				bc_emit_string(str);
+				tokenizer_next();
+				}
+			bc_emit_push(BC_INPUT);
+			break;
+		default:
+			r = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((r<0)||(r>=MAX_VARNUM)) bc_fail(1);
+			if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+				{
+				bc_accept(TOKENIZER_LEFTPAREN);
+				bc_expr();
+				bc_accept(TOKENIZER_RIGHTPAREN);
+				bc_emit(BC_AGET);
+				}
+			else bc_emit_push(BC_VAR);
+			bc_emit(r);
+			break;
+		}
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_term(void)
+	{
+	int op;
+	bc_factor();
+	op = tokenizer_token();
+	while(op == TOKENIZER_ASTR ||
+	        op == TOKENIZER_SLASH ||
+	        op == TOKENIZER_MOD)
+		{
+		tokenizer_next();
+		bc_factor();
+		if (op == TOKENIZER_ASTR) bc_emit_pop(BC_MUL,1);
+		else if (op == TOKENIZER_SLASH) bc_emit_pop(BC_DIV,1);
+		else bc_emit_pop(BC_MOD,1);
+		op = tokenizer_token();
+		}
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_expr(void)
+	{
+	int op;
+	bc_term();
+	op = tokenizer_token();
+	while(op == TOKENIZER_PLUS ||
+	        op == TOKENIZER_MINUS ||
+	        op == TOKENIZER_AND ||
+	        op == TOKENIZER_OR)
+		{
+		tokenizer_next();
+		bc_term();
+		if (op == TOKENIZER_PLUS) bc_emit_pop(BC_ADD,1);
+		else if (op == TOKENIZER_MINUS) bc_emit_pop(BC_SUB,1);
+		else if (op == TOKENIZER_AND) bc_emit_pop(BC_AND,1);
+		else bc_emit_pop(BC_OR,1);
+		op = tokenizer_token();
+		}
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_relation(void)
+	{
+	int op;
+	bc_expr();
+	op = tokenizer_token();
+	while(op == TOKENIZER_LT ||
+	        op == TOKENIZER_GT ||
+	        op == TOKENIZER_EQ)
+		{
+		tokenizer_next();
+		bc_expr();
+		if (op == TOKENIZER_LT) bc_emit_pop(BC_LT,1);
+		else if (op == TOKENIZER_GT) bc_emit_pop(BC_GT,1);
+		else bc_emit_pop(BC_EQ,1);
+		op = tokenizer_token();
+		}
+	}
+/*---------------------------------------------------------------------------*/
+//expressions separated by commas, as TUNE, LED and others take them
+static void bc_args(uint8_t n)
+	{
+	bc_expr();
+	while (--n)
+		{
+		bc_accept(TOKENIZER_COMMA);
+		bc_expr();
+		}
+	}
+/*---------------------------------------------------------------------------*/
+//only the last item is printed, expressions before it are evaluated anyway,
+//PRINTLN adds new line to item but not to the space there is without one
+static void bc_print(uint8_t ln)
+	{
+	char str[MAX_STRINGLEN+2];
+	uint16_t last_expr = 0;
+	uint8_t nl = 0;
+	strcpy(str," ");
+	tokenizer_next();
+	do
+		{
+		if(tokenizer_token() == TOKENIZER_STRING)
+			{
+			tokenizer_string(str, MAX_STRINGLEN);
+			last_expr = 0;
+			nl = ln;
+			tokenizer_next();
+			}
+		else if(tokenizer_token() == TOKENIZER_COMMA)
+			{
+			strcpy(str," ");
+			last_expr = 0;
+			nl = ln;
+			tokenizer_next();
+			}
+		else if(tokenizer_token() == TOKENIZER_SEMICOLON)
+			{
+			tokenizer_next();
+			}
+		else
+			{
+			bc_expr();
+			last_expr = bc_len;
+			bc_emit_pop(BC_POP,1);
+			}
+		}
+	while(tokenizer_token() != TOKENIZER_CR &&
+	        tokenizer_token() != TOKENIZER_ENDOFINPUT);
+	if (last_expr) bc_code[last_expr] = ln ? BC_PRINTLN : BC_PRINT;
+	else
+		{
+		if (nl) strcat(str,"\n");
+		bc_emit_string(str);
+		}
+	tokenizer_next();
+	}
+/*---------------------------------------------------------------------------*/
+//IF compiles both ways the interpreter can go through the line
+static void bc_if(void)
+	{
+	uint16_t jz, pos;
+	bc_accept(TOKENIZER_IF);
+	bc_relation();
+	bc_accept(TOKENIZER_THEN);
+	pos = bc_pos();
+	jz = bc_len;
+	bc_emit_pop(BC_JZ,1);
+	bc_emit16(0);
+	if (bc_statement()) bc_emit_next();
+	bc_code[jz+1] = bc_len;
+	bc_code[jz+2] = bc_len>>8;
+	tokenizer_init(bc_prog + pos);
+	do
+		{
+		tokenizer_next();
+		}
+	while(tokenizer_token() != TOKENIZER_ELSE &&
+	        tokenizer_token() != TOKENIZER_CR &&
+	        tokenizer_token() != TOKENIZER_ENDOFINPUT);
+	if(tokenizer_token() == TOKENIZER_ELSE)
+		{
+		tokenizer_next();
+		if (bc_statement()) bc_emit_next();
+		}
+	else
+		{
+		if(tokenizer_token() == TOKENIZER_CR) tokenizer_next();
+		bc_emit_next();
+		}
+	}
+/*---------------------------------------------------------------------------*/
+//statements with comma separated arguments and the token after them skipped
+static uint8_t bc_simple(uint8_t op, uint8_t n)
+	{
+	tokenizer_next();
+	if (n) bc_args(n);
+	bc_emit_pop(op,n);
+	tokenizer_next();
+	return 1;
+	}
+/*---------------------------------------------------------------------------*/
+//returns 1 when line goes on to next position, 0 when it jumps by itself
+static uint8_t bc_statement(void)
+	{
+	int var, src, linenum;
+	switch(tokenizer_token())
+		{
+		case TOKENIZER_PRINT:
+			bc_print(0);
+			return 1;
+		case TOKENIZER_PRINTLN:
+			bc_print(1);
+			return 1;
+		case TOKENIZER_IF:
+			bc_if();
+			return 0;
+		case TOKENIZER_GOTO:
+			bc_accept(TOKENIZER_GOTO);
+			bc_emit_jump(tokenizer_num());
+			return 0;
+		case TOKENIZER_GOSUB:
+			bc_accept(TOKENIZER_GOSUB);
+			linenum = tokenizer_num();
+			bc_accept(TOKENIZER_NUMBER);
+			bc_accept(TOKENIZER_CR);
+			bc_emit(BC_GOSUB);
+			bc_emit32(tokenizer_num());
+			bc_emit16(bc_line(tokenizer_num()));
+			bc_emit_jump(linenum);
+			return 0;
+		case TOKENIZER_RETURN:
+			bc_emit(BC_RETURN);
+			return 0;
+		case TOKENIZER_FOR:
+			bc_accept(TOKENIZER_FOR);
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			bc_accept(TOKENIZER_EQ);
+			bc_expr();
+			bc_emit_pop(BC_STORE,1);
+			bc_emit(var);
+			bc_accept(TOKENIZER_TO);
+			bc_expr();
+			bc_accept(TOKENIZER_CR);
+			bc_emit_pop(BC_FOR,1);
+			bc_emit(var);
+			bc_emit32(tokenizer_num());
+			bc_emit16(bc_line(tokenizer_num()));
+			return 1;
+		case TOKENIZER_NEXT:
+			bc_accept(TOKENIZER_NEXT);
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			bc_accept(TOKENIZER_CR);
+			bc_emit(BC_NEXT);
+			bc_emit(var);
+			return 1;
+		case TOKENIZER_END:
+			bc_emit(BC_END);
+			return 0;
+		case TOKENIZER_OUT:
+			tokenizer_next();
+			if(tokenizer_token() == TOKENIZER_VARIABLE ||
+			        tokenizer_token() == TOKENIZER_NUMBER)
+				{
+				bc_expr();
+				bc_emit_pop(BC_POP,1);
+				}
+			tokenizer_next();
+			return 1;
+		case TOKENIZER_LET:
+			bc_accept(TOKENIZER_LET);
+			/* Fall through. */
+		case TOKENIZER_VARIABLE:
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+				{
+				bc_accept(TOKENIZER_LEFTPAREN);
+				bc_expr();
+				bc_accept(TOKENIZER_RIGHTPAREN);
+				bc_accept(TOKENIZER_EQ);
+				bc_expr();
+				bc_emit_pop(BC_ASET,2);
+				}
+			else
+				{
+				bc_accept(TOKENIZER_EQ);
+				bc_expr();
+				bc_emit_pop(BC_STORE,1);
+				}
+			bc_emit(var);
+			bc_accept(TOKENIZER_CR);
+			return 1;
+		case TOKENIZER_DIM:
+			bc_accept(TOKENIZER_DIM);
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			bc_accept(TOKENIZER_LEFTPAREN);
+			bc_expr();
+			bc_accept(TOKENIZER_RIGHTPAREN);
+			if (tokenizer_token() == TOKENIZER_COMMA)
+				{
+				bc_accept(TOKENIZER_COMMA);
+				bc_expr();
+				}
+			else
+				{
+				bc_emit_push(BC_LIT8);
+				bc_emit(32);
+				}
+			bc_accept(TOKENIZER_CR);
+			bc_emit_pop(BC_DIM,2);
+			bc_emit(var);
+			return 1;
+		case TOKENIZER_FILL:
+			bc_accept(TOKENIZER_FILL);
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			if (tokenizer_token() == TOKENIZER_LEFTPAREN)
+				{
+				bc_accept(TOKENIZER_LEFTPAREN);
+				bc_expr();
+				bc_accept(TOKENIZER_RIGHTPAREN);
+				bc_accept(TOKENIZER_COMMA);
+				bc_args(2);
+				bc_emit_pop(BC_FILL,3);
+				}
+			else
+				{
+				bc_accept(TOKENIZER_COMMA);
+				bc_expr();
+				bc_emit_pop(BC_FILLALL,1);
+				}
+			bc_emit(var);
+			bc_accept(TOKENIZER_CR);
+			return 1;
+		case TOKENIZER_COPY:
+			bc_accept(TOKENIZER_COPY);
+			var = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((var<0)||(var>=MAX_VARNUM)) bc_fail(1);
+			bc_accept(TOKENIZER_LEFTPAREN);
+			bc_expr();
+			bc_accept(TOKENIZER_RIGHTPAREN);
+			bc_accept(TOKENIZER_COMMA);
+			src = tokenizer_variable_num();
+			bc_accept(TOKENIZER_VARIABLE);
+			if ((src<0)||(src>=MAX_VARNUM)) bc_fail(1);
+			bc_accept(TOKENIZER_LEFTPAREN);
+			bc_expr();
+			bc_accept(TOKENIZER_RIGHTPAREN);
+			bc_accept(TOKENIZER_COMMA);
+			bc_expr();
+			bc_accept(TOKENIZER_CR);
+			bc_emit_pop(BC_COPY,3);
+			bc_emit(var);
+			bc_emit(src);
+			return 1;
+		case TOKENIZER_REM:
+			tokenizer_next();
+			do
+				{
+				tokenizer_next();
+				}
+			while(tokenizer_token() != TOKENIZER_CR &&
+			        tokenizer_token() != TOKENIZER_ENDOFINPUT);
+			if(tokenizer_token() == TOKENIZER_CR) tokenizer_next();
+			return 1;
+		case TOKENIZER_TUNE:	return bc_simple(BC_TUNE,4);
+		case TOKENIZER_SETXY:	return bc_simple(BC_SETXY,2);
+		case TOKENIZER_TERMT:	return bc_simple(BC_TERMT,1);
+		case TOKENIZER_CLRSCR:	return bc_simple(BC_CLRSCR,0);
+		case TOKENIZER_WAIT:	return bc_simple(BC_WAIT,1);
+		case TOKENIZER_LED:		return bc_simple(BC_LED,2);
+		case TOKENIZER_COLOR:	return bc_simple(BC_COLOR,2);
+		case TOKENIZER_CHR:		return bc_simple(BC_CHR,1);
+		case TOKENIZER_EDR:		return bc_simple(BC_EDR,2);
+		case TOKENIZER_EOUT:	return bc_simple(BC_EOUT,2);
+		case TOKENIZER_TERMUP:	return bc_simple(BC_TERMUP,0);
+		case TOKENIZER_UOUT:	return bc_simple(BC_UOUT,1);
+		case TOKENIZER_POKE:	return bc_simple(BC_POKE,2);
+		case TOKENIZER_CURSOR:	return bc_simple(BC_CURSOR,1);
+		default:
+			bc_fail(1);
+		}
+	return 0;
+	}
+/*---------------------------------------------------------------------------*/
+//one line as line_statement runs it, from block position
+static void bc_line_statement(uint16_t blk)
+	{
+	tokenizer_init(bc_prog + BC_TAB(blk)->pos);
+	if (tokenizer_token() != TOKENIZER_NUMBER) bc_fail(1);
+	bc_depth = 0;
+	bc_emit(BC_LINE);
+	bc_emit32(tokenizer_num());
+	tokenizer_next();
+	if (bc_statement()) bc_emit_next();
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_compile(const char *program)
+	{
+	static uint16_t start;
+	static int r;
+	ctx->bc_on = 0;
+	if (strlen(program) >= BC_NOLINE) return;
+	bc_mem = (struct bc_block *)arr_base;
+	bc_max = arr_hi;
+	if (bc_max > BASIC_BC_LEN) bc_max = BASIC_BC_LEN & ~3;
+	bc_prog = program;
+	bc_end = strlen(program);
+	bc_len = 0;
+	bc_blocks = 0;
+	ctx->bc_blk = BC_DONE;
+	tokenizer_init(program);
+	if (tokenizer_finished()) 
+		{
+		ctx->bc_on = 1;
+		return;
+		}
+	if (setjmp(bc_jbuf)) return;
+	ctx->bc_blk = bc_block(0);
+	for (ctx->bc_blk=0;ctx->bc_blk<bc_blocks;ctx->bc_blk++)
+		{
+		start = bc_len;
+		r = setjmp(bc_jbuf);
+		if (r == 0)
+			{
+			bc_line_statement(ctx->bc_blk);
+			BC_TAB(ctx->bc_blk)->off = start;
+			}
+		else if (r == 1) bc_len = start;
+		else return;
+		}
+	ctx->bc_blk = 0;
+	ctx->bc_on = 1;
+	//table goes down next to the code, arrays of RUN start after it
+	start = (bc_len + 3) & ~3;
+	memmove(bc_code + start, bc_code + bc_max - 4*bc_blocks, 4*bc_blocks);
+	bc_max = start + 4*bc_blocks;
+	arr_lo = bc_max;
+	}
+/*---------------------------------------------------------------------------*/
+//for the interpreter, should it take over below GOSUB or FOR
+static int bc_text_pos(uint16_t blk)
+	{
+	if (blk >= BC_NOLINE) return -1;
+	return BC_TAB(blk)->pos;
+	}
+/*---------------------------------------------------------------------------*/
+static void bc_unreachable(int linenum)
+	{
+	sprintf(err_msg,"Unreachable line %d called from %d\n",linenum,ctx->last_linenum);
+	stdio_write(err_msg);
+	longjmp(jbuf,1);
+	}
+/*---------------------------------------------------------------------------*/
+//one program line, as ubasic_run does with the interpreter
+static void bc_run(void)
+	{
+	int s[BC_STACK], *sp, r;
+	const uint8_t *p;
+	long temp;
+	uint8_t char_out;
+	if (ctx->bc_blk == BC_DONE) return;
+	if (BC_TAB(ctx->bc_blk)->off == BC_TEXT)
+		{
+		ctx->bc_on = 0;
+		tokenizer_init(ctx->program_ptr + BC_TAB(ctx->bc_blk)->pos);
+		line_statement();
+		return;
+		}
+	p = bc_code + BC_TAB(ctx->bc_blk)->off;
+	sp = s;
+	while (1)
+		{
+		switch (*p++)
+			{
+			case BC_LINE:
+				ctx->last_linenum = BC_S32(p);
+				p += 4;
+				break;
+			case BC_LIT8:
+				*sp++ = *p++;
+				break;
+			case BC_LIT16:
+				*sp++ = BC_U16(p);
+				p += 2;
+				break;
+			case BC_LIT32:
+				*sp++ = BC_S32(p);
+				p += 4;
+				break;
+			case BC_VAR:
+				*sp++ = ctx->variables[*p++];
+				break;
+			case BC_STORE:
+				ctx->variables[*p++] = *--sp;
+				break;
+			case BC_POP:
+				sp--;
+				break;
+			case BC_ADD: sp--; sp[-1] = sp[-1] + sp[0]; break;
+			case BC_SUB: sp--; sp[-1] = sp[-1] - sp[0]; break;
+			case BC_AND: sp--; sp[-1] = sp[-1] & sp[0]; break;
+			case BC_OR:  sp--; sp[-1] = sp[-1] | sp[0]; break;
+			case BC_MUL: sp--; sp[-1] = sp[-1] * sp[0]; break;
+			case BC_DIV: sp--; sp[-1] = sp[-1] / sp[0]; break;
+			case BC_MOD: sp--; sp[-1] = sp[-1] % sp[0]; break;
+			case BC_LT:  sp--; sp[-1] = sp[-1] < sp[0]; break;
+			case BC_GT:  sp--; sp[-1] = sp[-1] > sp[0]; break;
+			case BC_EQ:  sp--; sp[-1] = sp[-1] == sp[0]; break;
+			case BC_RND:
+				temp = get_rnd();
+				temp = temp * (sp[-1]+1);
+				sp[-1] = temp / 65535;
+				break;
+			case BC_EIN:
+				sp[-1] = exp_get(sp[-1]);
+				break;
+			case BC_PEEK:
+				sp[-1] = get_memory(sp[-1]);
+				break;
+			case BC_KIN:
+				char_out = 0;
+				if (sp[-1]==0)
+					{
+					term_k_char((&char_out));
+					sp[-1] = char_out;
+					}
+				else
+					{
+					while (1)
+						{
+						if (term_k_stat()!=0)
+							{
+							term_k_char(&char_out);
+							sp[-1] = char_out;
+							break;
+							}
+						if (brk_key) break;
+						}
+					}
+				break;
+			case BC_UIN:
+				if (sp[-1]==0)
+					{
+					if (rx_sta()!=0) sp[-1] = rx_read();
+					else sp[-1] = 0;
+					}
+				else
+					{
+					while (1)
+						{
+						if (rx_sta()!=0)
+							{
+							sp[-1] = rx_read();
+							break;
+							}
+						if (brk_key) break;
+						}
+					}
+				break;
+			case BC_INPUT:
+				*sp++ = get_user_value();
+				break;
+			case BC_PUTS:
+				stdio_write((char *)p);
+				while (*p++);
+				break;
+			case BC_PRINT:
+			case BC_PRINTLN:
+				sprintf(string,p[-1]==BC_PRINT ? "%d" : "%d\n",*--sp);
+				stdio_write(string);
+				break;
+			case BC_TUNE:
+				sp -= 4;
+				sound_play_notes(sp[0],sp[1],sp[2],sp[3]);
+				break;
+			case BC_SETXY:
+				sp -= 2;
+				video_gotoxy(sp[0],sp[1]);
+				break;
+			case BC_TERMT:
+				if (*--sp==0)
+					{
+					term_vt100 = 0;
+					handle_display = 0;
+					display_refresh_force();
+					}
+				else
+					{
+					term_vt100 = 1;
+					handle_display = 1;
+					}
+				break;
+			case BC_CLRSCR:
+				video_clrscr();
+				break;
+			case BC_WAIT:
+				wait_ms(*--sp);
+				break;
+			case BC_LED:
+				sp -= 2;
+				set_led(sp[0],sp[1]);
+				break;
+			case BC_COLOR:
+				sp -= 2;
+				video_set_color(sp[0],sp[1]);
+				break;
+			case BC_CHR:
+				stdio_c(*--sp);
+				break;
+			case BC_EDR:
+				sp -= 2;
+				exp_ddr(sp[0],sp[1]);
+				break;
+			case BC_EOUT:
+				sp -= 2;
+				exp_set(sp[0],sp[1]);
+				break;
+			case BC_TERMUP:
+				if (handle_display==0)
+					display_refresh_force();
+				break;
+			case BC_UOUT:
+				tx_write(*--sp);
+				break;
+			case BC_POKE:
+				sp -= 2;
+				set_memory(sp[0],sp[1]);
+				break;
+			case BC_CURSOR:
+				set_cursor_state(*--sp);
+				break;
+			case BC_AGET:
+				sp[-1] = arr_get(*p++,sp[-1]);
+				break;
+			case BC_ASET:
+				sp -= 2;
+				arr_set(*p++,sp[0],sp[1]);
+				break;
+			case BC_DIM:
+				sp -= 2;
+				arr_dim(*p++,sp[0],sp[1]);
+				break;
+			case BC_FILL:
+				sp -= 3;
+				arr_fill(*p++,sp[0],sp[1],sp[2]);
+				break;
+			case BC_FILLALL:
+				arr_fill(*p,0,*--sp,arr_count(*p));
+				p++;
+				break;
+			case BC_COPY:
+				sp -= 3;
+				arr_copy(p[0],sp[0],p[1],sp[1],sp[2]);
+				p += 2;
+				break;
+			case BC_JZ:
+				if (*--sp) p += 2;
+				else p = bc_code + BC_U16(p);
+				break;
+			case BC_GO:
+				ctx->bc_blk = BC_U16(p);
+				return;
+			case BC_UNREACH:
+				bc_unreachable(BC_S32(p));
+				break;
+			case BC_GOSUB:
+				if(ctx->gosub_stack_ptr < MAX_GOSUB_STACK_DEPTH)
+					{
+					ctx->gosub_stack[ctx->gosub_stack_ptr] = BC_S32(p);
+					ctx->gosub_bc[ctx->gosub_stack_ptr] = BC_U16(p+4);
+					ctx->gosub_pos[ctx->gosub_stack_ptr] = bc_text_pos(ctx->gosub_bc[ctx->gosub_stack_ptr]);
+					ctx->gosub_stack_ptr++;
+					p += 6;
+					}
+				else
+					{
+					sprintf(err_msg,"gosub stack overflow at line %d\n", ctx->last_linenum);
+					stdio_write(err_msg);
+					longjmp(jbuf,1);
+					}
+				break;
+			case BC_RETURN:
+				if(ctx->gosub_stack_ptr > 0)
+					{
+					ctx->gosub_stack_ptr--;
+					ctx->bc_blk = ctx->gosub_bc[ctx->gosub_stack_ptr];
+					if (ctx->bc_blk == BC_NOLINE) bc_unreachable(ctx->gosub_stack[ctx->gosub_stack_ptr]);
+					return;
+					}
+				sprintf(err_msg,"gosub stack underflow at line %d\n", ctx->last_linenum);
+				stdio_write(err_msg);
+				longjmp(jbuf,1);
+				break;
+			case BC_FOR:
+				r = *--sp;
+				if(ctx->for_stack_ptr < MAX_FOR_STACK_DEPTH)
+					{
+					ctx->for_stack[ctx->for_stack_ptr].for_variable = p[0];
+					ctx->for_stack[ctx->for_stack_ptr].to = r;
+					ctx->for_stack[ctx->for_stack_ptr].line_after_for = BC_S32(p+1);
+					ctx->for_bc[ctx->for_stack_ptr] = BC_U16(p+5);
+					ctx->for_stack[ctx->for_stack_ptr].pos_after_for = bc_text_pos(ctx->for_bc[ctx->for_stack_ptr]);
+					ctx->for_stack_ptr++;
+					p += 7;
+					}
+				else
+					{
+					sprintf(err_msg,"FOR stack overflow at line %d\n", ctx->last_linenum);
+					stdio_write(err_msg);
+					longjmp(jbuf,1);
+					}
+				break;
+			case BC_NEXT:
+				r = *p++;
+				if(ctx->for_stack_ptr > 0 &&
+				        r == ctx->for_stack[ctx->for_stack_ptr - 1].for_variable)
+					{
+					ctx->variables[r]++;
+					if(ctx->variables[r] <= ctx->for_stack[ctx->for_stack_ptr - 1].to)
+						{
+						ctx->bc_blk = ctx->for_bc[ctx->for_stack_ptr - 1];
+						if (ctx->bc_blk == BC_NOLINE) bc_unreachable(ctx->for_stack[ctx->for_stack_ptr - 1].line_after_for);
+						return;
+						}
+					ctx->for_stack_ptr--;
+					}
+				break;
+			case BC_END:
+				ctx->ended = 1;
+				return;
+			}
+		}
+	}
+#endif
 //B_BAS010
 /*---------------------------------------------------------------------------*/
 void ubasic_run(void)
 	{
+#ifdef	BASIC_BYTECODE
+	if (ctx->bc_on)
+		{
+		bc_run();
+		return;
+		}
+#endif
 	if(tokenizer_finished())
 		{
 		DEBUG_PRINTF("uBASIC program finished\n");
@@ -965,16 +2229,108 @@ void ubasic_run(void)
 	line_statement();
 	}
 /*---------------------------------------------------------------------------*/
+//batch of up to lines program lines, fewer when the program ends or ms
+//milliseconds pass, errors longjmp to jbuf as ubasic_run does
+uint16_t ubasic_run_lines(uint16_t lines, uint16_t ms)
+	{
+	uint16_t n;
+	uint32_t t;
+	t = millis();
+	n = 0;
+	do
+		{
+		ubasic_run();
+		n++;
+		}
+	while ((n < lines)&&(!ubasic_finished())&&((millis() - t) < ms));
+	return n;
+	}
+/*---------------------------------------------------------------------------*/
 int ubasic_finished(void)
 	{
-	return ended || tokenizer_finished();
+#ifdef	BASIC_BYTECODE
+	if (ctx->bc_on) return ctx->ended || (ctx->bc_blk == BC_DONE);
+#endif
+	return ctx->ended || tokenizer_finished();
+	}
+/*---------------------------------------------------------------------------*/
+//variables start at zero and no arrays, unlike ubasic_init the terminal is left as it is.
+//Arrays c had at the top of the arena are freed, those of other contexts stay
+void ubasic_ctx_init(struct ubasic_ctx *c, const char *program)
+	{
+	struct ubasic_ctx *prev;
+	if (arr_owner==c)
+		{
+		arr_hi = arr_len;
+		arr_owner = 0;
+		}
+	memset(c,0,sizeof(struct ubasic_ctx));
+	prev = ctx;
+	ubasic_select(c);
+	c->program_ptr = program;
+	if (line_prog!=program) line_index(program);
+	tokenizer_init(program);
+	ubasic_select(prev);
+	}
+/*---------------------------------------------------------------------------*/
+//runs a batch of program of c with its own error context, whatever program
+//was current before is current again on return
+uint8_t ubasic_step(struct ubasic_ctx *c, uint16_t lines, uint16_t ms)
+	{
+	struct ubasic_ctx *prev;
+	jmp_buf save;
+	uint8_t r;
+	if (c->error) return UBASIC_ERROR;
+	prev = ctx;
+	memcpy(save,jbuf,sizeof(jmp_buf));
+	ubasic_select(c);
+	if (!ubasic_finished())
+		{
+		if (!setjmp(jbuf)) ubasic_run_lines(lines,ms);
+		else c->error = 1;
+		}
+	r = UBASIC_RUNNING;
+	if (c->error) r = UBASIC_ERROR;
+	else if (ubasic_finished()) r = UBASIC_DONE;
+	memcpy(jbuf,save,sizeof(jmp_buf));
+	ubasic_select(prev);
+	return r;
+	}
+/*---------------------------------------------------------------------------*/
+void ubasic_arena(void *base, uint16_t len)
+	{
+	uint16_t skip;
+	skip = (4 - ((uintptr_t)base & 3)) & 3;
+	if (len < skip) len = skip;
+	arr_base = (uint8_t *)base + skip;
+	arr_len = (len - skip) & ~3;
+	arr_lo = 0;
+	arr_hi = arr_len;
+	arr_owner = 0;
+	memset(ubasic_main.arrays,0,sizeof(ubasic_main.arrays));
+	}
+//after ubasic_ctx_init, DIM of c takes arrays from base instead of the arena
+void ubasic_ctx_arena(struct ubasic_ctx *c, void *base, uint16_t len)
+	{
+	uint16_t skip;
+	skip = (4 - ((uintptr_t)base & 3)) & 3;
+	if (len < skip) len = skip;
+	c->slice = (uint8_t *)base + skip;
+	c->slice_len = (len - skip) & ~3;
+	c->slice_used = 0;
+	memset(c->arrays,0,sizeof(c->arrays));
+	}
+void ubasic_arena_stats(uint16_t *used, uint16_t *len)
+	{
+	*used = arr_lo + (arr_len - arr_hi);
+	*len = arr_len;
 	}
 /*---------------------------------------------------------------------------*/
 void ubasic_set_variable(int varnum, int value)
 	{
 	if(varnum <= MAX_VARNUM)
 		{
-		variables[varnum] = value;
+		ctx->variables[varnum] = value;
 		}
 	}
 /*---------------------------------------------------------------------------*/
@@ -982,7 +2338,7 @@ int ubasic_get_variable(int varnum)
 	{
 	if(varnum <= MAX_VARNUM)
 		{
-		return variables[varnum];
+		return ctx->variables[varnum];
 		}
 	return 0;
 	}
@@ -31,10 +31,78 @@
 #define __UBASIC_H__
 
 #include <stdint.h>
+#include "../badge_settings.h"
+#include "tokenizer.h"
+
+#define MAX_GOSUB_STACK_DEPTH 30
+#define MAX_FOR_STACK_DEPTH 4
+#define MAX_VARNUM 26
+
+struct for_state
+	{
+	int line_after_for;
+	int pos_after_for;			//text offset of line_after_for, -1 to look up
+	int for_variable;
+	int to;
+	};
+
+//all state of one program, several can be run side by side with ubasic_step
+struct ubasic_ctx
+	{
+	char const *program_ptr;
+	Scanner scan;
+	int gosub_stack[MAX_GOSUB_STACK_DEPTH];
+	int gosub_pos[MAX_GOSUB_STACK_DEPTH];		//text offset of return line, -1 to look up
+	int gosub_stack_ptr;
+	struct for_state for_stack[MAX_FOR_STACK_DEPTH];
+	int for_stack_ptr;
+	int variables[MAX_VARNUM];
+	uint16_t arrays[MAX_VARNUM];				//header offset in arena /4 +1, 0 for none
+	uint8_t *slice;								//own arena of ubasic_ctx_arena, 0 for shared
+	uint16_t slice_len, slice_used;
+	int ended;
+	int last_linenum;
+	uint8_t interactive_mode;
+	uint8_t error;
+#ifdef	BASIC_BYTECODE
+	uint8_t bc_on;
+	uint16_t bc_blk;
+	uint16_t gosub_bc[MAX_GOSUB_STACK_DEPTH];	//blocks of return lines
+	uint16_t for_bc[MAX_FOR_STACK_DEPTH];
+#endif
+	};
+
 void ubasic_init(const char *program, uint8_t mode);
+//to be called when program text is edited, see line index in ubasic.c
+void ubasic_program_changed(void);
 void ubasic_run(void);
+//RUN polls BRK between batches of lines, see ubasic_run_lines
+#define UBASIC_BATCH_LINES	64
+#define UBASIC_BATCH_MS		5
+uint16_t ubasic_run_lines(uint16_t lines, uint16_t ms);
 int ubasic_finished(void);
 
+//ubasic_step results
+#define UBASIC_RUNNING	0
+#define UBASIC_DONE		1
+#define UBASIC_ERROR	2
+//program in its own context, always interpreted from text
+void ubasic_ctx_init(struct ubasic_ctx *c, const char *program);
+uint8_t ubasic_step(struct ubasic_ctx *c, uint16_t lines, uint16_t ms);
+//slice of program started with bg per pass of BASIC prompt loop
+#define UBASIC_BG_LINES	16
+#define UBASIC_BG_MS	2
+//RUN goes through bytecode when set, see BASIC_BYTECODE
+extern uint8_t ubasic_compile;
+
+//memory DIM takes arrays from, setting it drops all of them. RUN drops those
+//of the program before, ubasic_ctx_init those the context had before. Only
+//one context besides RUN has arrays in it, DIM of others fails unless they
+//have a slice of their own
+void ubasic_arena(void *base, uint16_t len);
+void ubasic_ctx_arena(struct ubasic_ctx *c, void *base, uint16_t len);
+void ubasic_arena_stats(uint16_t *used, uint16_t *len);
+
 int ubasic_get_variable(int varnum);
 void ubasic_set_variable(int varum, int value);
 
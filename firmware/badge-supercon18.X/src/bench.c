@@ -0,0 +1,178 @@
+#include <stdint.h>
+#include <string.h>
+#include <setjmp.h>
+#include <plib.h>
+#include "hw.h"
+#include "disp.h"
+#include "vt100.h"
+#include "Z80/hwz.h"
+#include "Z80/sim.h"
+#include "Z80/simglb.h"
+#include "basic/ubasic.h"
+#include "bench.h"
+
+extern volatile uint8_t handle_display;
+extern int8_t disp_buffer[DISP_BUFFER_HIGH+1][DISP_BUFFER_WIDE];
+extern int8_t color_buffer[DISP_BUFFER_HIGH+1][DISP_BUFFER_WIDE];
+extern uint32_t color_table[16];
+extern jmp_buf jbuf;
+//one Z80 instruction, sim1.c
+int cpu (void);
+
+#define		BENCH_Z80_OPS		200000
+#define		BENCH_CHARS			3200
+#define		BENCH_REFRESHES		4
+#define		BENCH_VT100_LOOPS	40
+#define		BENCH_BASIC_RUNS	10
+
+//loads bytes through HL, arithmetic, stack and DJNZ, 256 instructions per
+//outer loop, all of it within 0x0100-0x01FF
+const uint8_t bench_z80_code[] =
+	{
+	0x21,0x00,0x01,		//0100	LD HL,0100h
+	0x06,0x20,			//0103	LD B,32
+	0x7E,				//0105	LD A,(HL)
+	0x80,				//0106	ADD A,B
+	0x4F,				//0107	LD C,A
+	0x23,				//0108	INC HL
+	0xC5,				//0109	PUSH BC
+	0xC1,				//010A	POP BC
+	0x10,0xF8,			//010B	DJNZ 0105h
+	0xC3,0x00,0x01,		//010D	JP 0100h
+	};
+
+//standard program, loop with arithmetic, IF and GOSUB
+const char bench_basic_prog[] =
+	"10 s=0\n"
+	"20 for i=1 to 200\n"
+	"30 a=i*3+7\n"
+	"40 b=(a/2-i)%7\n"
+	"50 if b>3 then s=s+1\n"
+	"60 gosub 100\n"
+	"70 next i\n"
+	"80 end\n"
+	"100 s=s+b\n"
+	"110 return\n";
+
+//text, cursor moves, colors and erase, as CP/M programs send
+const char bench_vt100_text[] =
+	"\x1B[2J\x1B[H\x1B[1;33mBadge VT100 bench\x1B[0m\n"
+	"The quick brown fox jumps over the lazy dog 0123456789\n"
+	"\x1B[5;10H\x1B[7mreverse\x1B[0m \x1B[32mgreen\x1B[0m \x1B[K\n"
+	"\x1B[10;1Hline\tone\r\nline\ttwo\x1B[A\x1B[C\x1B[2K\n";
+
+//rate per second of count events in ticks of core timer
+static uint32_t bench_rate (uint32_t count, uint32_t ticks)
+	{
+	uint32_t us;
+	us = ticks/CORE_TICKS_US;
+	if (us==0) us = 1;
+	return (((uint64_t)count)*1000000)/us;
+	}
+
+static uint32_t bench_z80 (void)
+	{
+	uint32_t i,t;
+	memcpy(ram+0x0100,bench_z80_code,sizeof(bench_z80_code));
+	wrk_ram = PC = ram + 0x0100;
+	STACK = ram + 0x0200;
+	cpu_error = NONE;
+	t = _CP0_GET_COUNT();
+	for (i=0;i<BENCH_Z80_OPS;i++) cpu();
+	t = _CP0_GET_COUNT() - t;
+	return bench_rate(BENCH_Z80_OPS,t);
+	}
+
+//every ubasic_run is one program line, bytecode or text interpreter,
+//compilation at start of each run is counted in
+static uint32_t bench_basic (uint8_t compile)
+	{
+	volatile uint32_t n;
+	uint32_t t,i;
+	uint8_t save;
+	n = 0;
+	save = ubasic_compile;
+	ubasic_compile = compile;
+	t = _CP0_GET_COUNT();
+	for (i=0;i<BENCH_BASIC_RUNS;i++)
+		{
+		ubasic_init(bench_basic_prog,0);
+		//batched as RUN does, n is volatile for longjmp
+		if (setjmp(jbuf)) continue;
+		do
+			n += ubasic_run_lines(UBASIC_BATCH_LINES,UBASIC_BATCH_MS);
+			while (!ubasic_finished());
+		}
+	t = _CP0_GET_COUNT() - t;
+	ubasic_compile = save;
+	return bench_rate(n,t);
+	}
+
+static uint32_t bench_chars (void)
+	{
+	uint32_t i,t;
+	t = _CP0_GET_COUNT();
+	for (i=0;i<BENCH_CHARS;i++)
+		tft_print_char(' '+(i%95),(i%40)*8,((i/40)%20)*12,color_table[i&0xF],color_table[(i>>4)&0xF]);
+	t = _CP0_GET_COUNT() - t;
+	return bench_rate(BENCH_CHARS,t);
+	}
+
+static uint32_t bench_refresh (void)
+	{
+	uint32_t i,t;
+	t = _CP0_GET_COUNT();
+	for (i=0;i<BENCH_REFRESHES;i++)
+		tft_disp_buffer_refresh((uint8_t *)disp_buffer,(uint8_t *)color_buffer);
+	t = _CP0_GET_COUNT() - t;
+	return (t/BENCH_REFRESHES)/CORE_TICKS_US;
+	}
+
+static uint32_t bench_vt100 (void)
+	{
+	uint32_t i,j,t;
+	t = _CP0_GET_COUNT();
+	for (i=0;i<BENCH_VT100_LOOPS;i++)
+		for (j=0;j<(sizeof(bench_vt100_text)-1);j++)
+			receive_char(bench_vt100_text[j]);
+	t = _CP0_GET_COUNT() - t;
+	return bench_rate(BENCH_VT100_LOOPS*(sizeof(bench_vt100_text)-1),t);
+	}
+
+static void bench_flash (struct bench_result * res)
+	{
+	uint8_t page[FL_PAGE_SIZE];
+	uint32_t a,t;
+	fl_flush();
+	t = _CP0_GET_COUNT();
+	for (a=0;a<BENCH_FL_SIZE;a+=4096) fl_erase_4k(BENCH_FL_BASE+a);
+	t = _CP0_GET_COUNT() - t;
+	res->fl_erase_kbs = bench_rate(BENCH_FL_SIZE/1024,t);
+	for (a=0;a<FL_PAGE_SIZE;a++) page[a] = a;
+	t = _CP0_GET_COUNT();
+	for (a=0;a<BENCH_FL_SIZE;a+=FL_PAGE_SIZE) fl_write_page(BENCH_FL_BASE+a,page,FL_PAGE_SIZE);
+	t = _CP0_GET_COUNT() - t;
+	res->fl_prog_kbs = bench_rate(BENCH_FL_SIZE/1024,t);
+	t = _CP0_GET_COUNT();
+	for (a=0;a<BENCH_FL_SIZE;a+=FL_PAGE_SIZE) fl_read_nk(BENCH_FL_BASE+a,page,FL_PAGE_SIZE);
+	t = _CP0_GET_COUNT() - t;
+	res->fl_read_kbs = bench_rate(BENCH_FL_SIZE/1024,t);
+	}
+
+//display scanning is off while LCD is measured, screen is cleared after
+void bench_run (struct bench_result * res)
+	{
+	uint8_t disp;
+	res->z80_ips = bench_z80();
+	res->basic_sps = bench_basic(1);
+	res->basic_text_sps = bench_basic(0);
+	bench_flash(res);
+	disp = handle_display;
+	handle_display = 0;
+	res->char_cps = bench_chars();
+	res->refresh_us = bench_refresh();
+	res->vt100_cps = bench_vt100();
+	video_clrscr();
+	tft_disp_buffer_refresh((uint8_t *)disp_buffer,(uint8_t *)color_buffer);
+	handle_display = disp;
+	}
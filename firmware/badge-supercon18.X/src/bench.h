@@ -0,0 +1,33 @@
+#ifndef		__BENCH_H
+#define		__BENCH_H
+
+#include <stdint.h>
+
+/*
+ * Fixed set of benchmarks of hot paths, run by bench command in menu and
+ * BASIC, so firmware changes can be compared on the badge or in host build.
+ * Z80 loop runs in ram[] of Z80 machine, which is unused outside CP/M and
+ * reloaded when CP/M starts. Screen is redrawn afterwards, FLASH scratch
+ * area is erased and programmed each run.
+ */
+
+//scratch area in FLASH, see FLASH map in badge_settings.h
+#define		BENCH_FL_BASE		0x3F0000
+#define		BENCH_FL_SIZE		0x010000
+
+struct bench_result
+	{
+	uint32_t z80_ips;
+	uint32_t basic_sps;
+	uint32_t basic_text_sps;
+	uint32_t char_cps;
+	uint32_t refresh_us;
+	uint32_t fl_read_kbs;
+	uint32_t fl_erase_kbs;
+	uint32_t fl_prog_kbs;
+	uint32_t vt100_cps;
+	};
+
+void bench_run (struct bench_result * res);
+
+#endif
@@ -0,0 +1,506 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "hw.h"
+#include "Z80/hwz.h"
+#include "bstore.h"
+
+//packed data, line number follows as 2 bytes, keyword i is BS_WORD+i
+#define		BS_LINENUM		0x80
+#define		BS_WORD			0x81
+
+//longer one first where one starts with the other
+static const char * const bs_words[] =
+	{
+	"println","print","then","else","goto","gosub","return","next","for",
+	"let","if","to","end","rem","input","peek","poke","cursor","clrscr",
+	"color","setxy","termup","termt","tune","wait","led","rnd","chr","eout",
+	"ein","edr","uout","uin","call","out","kin",
+	"PRINTLN","PRINT","THEN","ELSE","GOTO","GOSUB","RETURN","NEXT","FOR",
+	"LET","IF","TO","END","REM","INPUT","PEEK","POKE","CURSOR","CLRSCR",
+	"COLOR","SETXY","TERMUP","TERMT","TUNE","WAIT","LED","RND","CHR","EOUT",
+	"EIN","EDR","UOUT","UIN","CALL","OUT","KIN",
+	//codes of words above are in saved programs, new ones go below
+	"dim","fill","copy","DIM","FILL","COPY",
+	};
+#define		BS_WORDS		(sizeof(bs_words)/sizeof(bs_words[0]))
+
+//active half, found by bs_mount, log ends at bs_head
+uint32_t bs_act, bs_end, bs_head, bs_seq;
+//nothing but erased FLASH at bs_head, else it is compacted before next save
+uint8_t bs_clean;
+//log up to here was found whole, only its last program can be cut short
+uint32_t bs_whole;
+
+//data going to FLASH or being counted, data coming from FLASH
+uint8_t bs_buf[BS_HDR];
+uint8_t bs_n, bs_wr;
+uint16_t bs_len, bs_sum;
+uint32_t bs_at;
+
+static uint16_t bs_get16 (const uint8_t * p)
+	{
+	return p[0] | (((uint16_t)p[1])<<8);
+	}
+
+static uint32_t bs_get32 (const uint8_t * p)
+	{
+	return bs_get16(p) | (((uint32_t)bs_get16(p+2))<<16);
+	}
+
+static void bs_put16 (uint8_t * p, uint16_t v)
+	{
+	p[0] = v;
+	p[1] = v>>8;
+	}
+
+static void bs_put32 (uint8_t * p, uint32_t v)
+	{
+	bs_put16(p,v);
+	bs_put16(p+2,v>>16);
+	}
+
+//CRC-16 CCITT, as in YMODEM
+static uint16_t bs_crc (uint16_t crc, uint8_t c)
+	{
+	uint8_t i;
+	crc ^= ((uint16_t)c)<<8;
+	for (i=0;i<8;i++)
+		{
+		if (crc&0x8000) crc = (crc<<1) ^ 0x1021;
+		else crc = crc<<1;
+		}
+	return crc;
+	}
+
+//program with header, as it takes place in log
+static uint32_t bs_size (const uint8_t * h)
+	{
+	return BS_HDR + ((bs_get16(h+4) + BS_HDR - 1)&~(BS_HDR - 1));
+	}
+
+//sector is erased right before log gets to its start
+static void bs_ahead (uint32_t addr)
+	{
+	if (((addr%BS_SECT)==0)&&(addr<bs_end)) fl_erase_4k(addr);
+	}
+
+static void bs_write (uint32_t addr, uint8_t * data, uint16_t n)
+	{
+	uint16_t k;
+	while (n)
+		{
+		k = FL_PAGE_SIZE - (addr%FL_PAGE_SIZE);
+		if (k>n) k = n;
+		fl_write_page(addr,data,k);
+		addr += k;
+		data += k;
+		n -= k;
+		bs_ahead(addr);
+		}
+	}
+
+//header of first live program from a on into h, its address, 0 if none
+static uint32_t bs_live (uint32_t a, uint32_t end, uint8_t * h)
+	{
+	while (a<end)
+		{
+		fl_read_nk(a,h,BS_HDR);
+		if (h[10]==0xFF) return a;
+		a += bs_size(h);
+		}
+	return 0;
+	}
+
+static uint8_t bs_check (uint32_t a, const uint8_t * h)
+	{
+	uint8_t b[BS_HDR];
+	uint16_t len,i,n,j,crc;
+	len = bs_get16(h+4);
+	crc = 0;
+	for (i=0;i<len;i+=n)
+		{
+		n = len - i;
+		if (n>BS_HDR) n = BS_HDR;
+		fl_read_nk(a + BS_HDR + i,b,n);
+		for (j=0;j<n;j++) crc = bs_crc(crc,b[j]);
+		}
+	return crc==bs_get16(h+8);
+	}
+
+static void bs_kill (uint32_t a)
+	{
+	uint8_t z;
+	z = 0;
+	fl_write_page(a + 10,&z,1);
+	}
+
+static void bs_mount (void)
+	{
+	uint8_t h[BS_HDR],b[BS_HDR];
+	uint32_t a,seq,last;
+	uint8_t i,found;
+	found = 0;
+	bs_seq = 0;
+	for (i=0;i<2;i++)
+		{
+		a = BS_BASE + i*BS_HALF;
+		fl_read_nk(a,h,8);
+		if (bs_get32(h)!=BS_HALF_MAGIC) continue;
+		seq = bs_get32(h+4);
+		if ((found==0)||(seq>bs_seq))
+			{
+			bs_act = a;
+			bs_seq = seq;
+			found = 1;
+			}
+		}
+	//no store yet, empty second half gets compacted into first one on save
+	if (found==0)
+		{
+		bs_act = BS_BASE + BS_HALF;
+		bs_end = bs_act + BS_HALF;
+		bs_head = bs_act + BS_HDR;
+		bs_clean = 0;
+		return;
+		}
+	bs_end = bs_act + BS_HALF;
+	bs_clean = 1;
+	last = 0;
+	a = bs_act + BS_HDR;
+	while (a<bs_end)
+		{
+		fl_read_nk(a,h,BS_HDR);
+		//left from older half in sector that wasn't erased
+		if ((bs_get32(h)!=BS_MAGIC)||(bs_get32(h+28)!=bs_seq))
+			{
+			//header cut short by power loss
+			for (i=0;i<BS_HDR;i++) if (h[i]!=0xFF) bs_clean = 0;
+			break;
+			}
+		if (bs_size(h)>(bs_end - a))
+			{
+			bs_clean = 0;
+			break;
+			}
+		last = a;
+		a += bs_size(h);
+		}
+	bs_head = a;
+	if ((last==0)||(bs_whole==a)) return;
+	bs_whole = a;
+	fl_read_nk(last,h,BS_HDR);
+	if (h[10]!=0xFF) return;
+	if (bs_check(last,h)==0)
+		{
+		//cut short, its end may lie in sector the log didn't erase yet
+		if (((a/BS_SECT)!=(last/BS_SECT))&&(a<bs_end)) fl_erase_4k(a - (a%BS_SECT));
+		bs_kill(last);
+		return;
+		}
+	//save that didn't get to kill program it replaced
+	a = bs_act + BS_HDR;
+	while ((a = bs_live(a,last,b))!=0)
+		{
+		if (memcmp(h+12,b+12,BS_NAME_LEN)==0) bs_kill(a);
+		a += bs_size(b);
+		}
+	}
+
+//last live program of that name
+static uint32_t bs_find (const int8_t * name)
+	{
+	uint8_t h[BS_HDR];
+	uint32_t a,found;
+	found = 0;
+	a = bs_act + BS_HDR;
+	while ((a = bs_live(a,bs_head,h))!=0)
+		{
+		if (strncmp(name,h+12,BS_NAME_LEN)==0) found = a;
+		a += bs_size(h);
+		}
+	return found;
+	}
+
+//live programs go to the other half, which becomes active once its header is written
+static void bs_compact (void)
+	{
+	uint8_t h[BS_HDR],b[BS_HDR];
+	uint32_t a,i,old,old_head;
+	old = bs_act;
+	old_head = bs_head;
+	bs_whole = 0;
+	if (old==BS_BASE) bs_act = BS_BASE + BS_HALF;
+	else bs_act = BS_BASE;
+	bs_end = bs_act + BS_HALF;
+	fl_erase_4k(bs_act);
+	bs_head = bs_act + BS_HDR;
+	a = old + BS_HDR;
+	while ((a = bs_live(a,old_head,h))!=0)
+		{
+		if (bs_check(a,h))
+			for (i=0;i<bs_size(h);i+=BS_HDR)
+				{
+				fl_read_nk(a + i,b,BS_HDR);
+				if (i==0) bs_put32(b+28,bs_seq + 1);
+				bs_write(bs_head,b,BS_HDR);
+				bs_head += BS_HDR;
+				}
+		a += bs_size(h);
+		}
+	bs_seq++;
+	bs_put32(h,BS_HALF_MAGIC);
+	bs_put32(h+4,bs_seq);
+	bs_write(bs_act,h,8);
+	bs_clean = 1;
+	}
+
+static void bs_out (uint8_t c)
+	{
+	bs_sum = bs_crc(bs_sum,c);
+	bs_len++;
+	if (bs_wr==0) return;
+	bs_buf[bs_n++] = c;
+	if (bs_n<BS_HDR) return;
+	bs_write(bs_at,bs_buf,bs_n);
+	bs_at += bs_n;
+	bs_n = 0;
+	}
+
+//line number as written by editor, 0 if it isn't
+static uint16_t bs_linenum (const int8_t * t, const int8_t ** next)
+	{
+	uint32_t n;
+	uint8_t digits;
+	if ((*t<'1')||(*t>'9')) return 0;
+	n = 0;
+	for (digits=0;(*t>='0')&&(*t<='9');digits++)
+		{
+		if (digits==5) return 0;
+		n = n*10 + (*t++ - '0');
+		}
+	if ((n>32767)||(*t!=' ')) return 0;
+	*next = t + 1;
+	return n;
+	}
+
+static void bs_pack (const int8_t * t, uint8_t fmt)
+	{
+	const int8_t * p;
+	uint16_t n;
+	uint8_t i,l,line;
+	if (fmt==BS_RAW)
+		{
+		while (*t) bs_out(*t++);
+		return;
+		}
+	line = 1;
+	while (*t)
+		{
+		if (line)
+			{
+			line = 0;
+			n = bs_linenum(t,&p);
+			if (n)
+				{
+				bs_out(BS_LINENUM);
+				bs_out(n>>8);
+				bs_out(n);
+				t = p;
+				continue;
+				}
+			}
+		for (i=0;i<BS_WORDS;i++)
+			{
+			if (bs_words[i][0]!=*t) continue;
+			l = strlen(bs_words[i]);
+			if (strncmp(t,bs_words[i],l)==0) break;
+			}
+		if (i<BS_WORDS)
+			{
+			bs_out(BS_WORD + i);
+			t += l;
+			continue;
+			}
+		if (*t=='\n') line = 1;
+		bs_out(*t++);
+		}
+	}
+
+static uint8_t bs_in (void)
+	{
+	if (bs_n==BS_HDR)
+		{
+		fl_read_nk(bs_at,bs_buf,BS_HDR);
+		bs_at += BS_HDR;
+		bs_n = 0;
+		}
+	bs_len--;
+	return bs_buf[bs_n++];
+	}
+
+//text of tlen bytes out of program at a, 0 if it doesn't come out so
+static uint8_t bs_unpack (uint32_t a, const uint8_t * h, int8_t * t, uint16_t tlen)
+	{
+	uint16_t o,n;
+	uint8_t c;
+	const char * w;
+	char num[8];
+	bs_at = a + BS_HDR;
+	bs_n = BS_HDR;
+	bs_len = bs_get16(h+4);
+	o = 0;
+	while (bs_len)
+		{
+		c = bs_in();
+		if ((h[11]==BS_RAW)||(c<BS_LINENUM))
+			{
+			if (o==tlen) return 0;
+			t[o++] = c;
+			continue;
+			}
+		if (c==BS_LINENUM)
+			{
+			if (bs_len<2) return 0;
+			n = ((uint16_t)bs_in())<<8;
+			n |= bs_in();
+			sprintf(num,"%u ",n);
+			w = num;
+			}
+		else
+			{
+			if ((c - BS_WORD)>=BS_WORDS) return 0;
+			w = bs_words[c - BS_WORD];
+			}
+		for (;*w;w++)
+			{
+			if (o==tlen) return 0;
+			t[o++] = *w;
+			}
+		}
+	return o==tlen;
+	}
+
+static uint8_t bs_name_ok (const int8_t * name)
+	{
+	uint8_t i;
+	for (i=0;name[i];i++)
+		if ((i==BS_NAME_LEN)||(name[i]<=' ')) return 0;
+	return i>0;
+	}
+
+uint8_t bs_save (const int8_t * name, const int8_t * text)
+	{
+	uint8_t h[BS_HDR];
+	const int8_t * p;
+	uint32_t old,need;
+	uint8_t fmt;
+	if (bs_name_ok(name)==0) return BS_NONAME;
+	bs_mount();
+	fmt = BS_PACKED;
+	for (p=text;*p;p++) if (((uint8_t)*p)>0x7F) fmt = BS_RAW;
+	//first pass sizes it, header goes ahead of data
+	bs_wr = 0;
+	bs_len = 0;
+	bs_sum = 0;
+	bs_pack(text,fmt);
+	memset(h,0xFF,BS_HDR);
+	bs_put32(h,BS_MAGIC);
+	bs_put16(h+4,bs_len);
+	bs_put16(h+6,p - text);
+	bs_put16(h+8,bs_sum);
+	h[11] = fmt;
+	memset(h+12,0,BS_NAME_LEN);
+	strncpy(h+12,name,BS_NAME_LEN);
+	need = bs_size(h);
+	if (need>(BS_HALF - BS_HDR)) return BS_FULL;
+	if ((bs_clean==0)||(need>(bs_end - bs_head))) bs_compact();
+	if (need>(bs_end - bs_head)) return BS_FULL;
+	bs_put32(h+28,bs_seq);
+	old = bs_find(name);
+	bs_whole = 0;
+	bs_write(bs_head,h,BS_HDR);
+	bs_wr = 1;
+	bs_n = 0;
+	bs_at = bs_head + BS_HDR;
+	bs_pack(text,fmt);
+	if (bs_n) bs_write(bs_at,bs_buf,bs_n);
+	bs_wr = 0;
+	bs_head += need;
+	if (bs_get16(h+4)%BS_HDR) bs_ahead(bs_head);
+	//replaced only now, power loss leaves one of them
+	if (old) bs_kill(old);
+	bs_whole = bs_head;
+	return BS_OK;
+	}
+
+uint8_t bs_load (const int8_t * name, int8_t * text, uint16_t maxlen)
+	{
+	uint8_t h[BS_HDR];
+	uint32_t a;
+	uint16_t len;
+	if (bs_name_ok(name)==0) return BS_NONAME;
+	bs_mount();
+	a = bs_find(name);
+	if (a==0) return BS_NOTFOUND;
+	fl_read_nk(a,h,BS_HDR);
+	len = bs_get16(h+6);
+	if ((len>maxlen)||(bs_check(a,h)==0)) return BS_BAD;
+	if (bs_unpack(a,h,text,len)==0)
+		{
+		text[0] = 0;
+		return BS_BAD;
+		}
+	text[len] = 0;
+	return BS_OK;
+	}
+
+uint8_t bs_del (const int8_t * name)
+	{
+	uint32_t a;
+	uint8_t ret;
+	if (bs_name_ok(name)==0) return BS_NONAME;
+	bs_mount();
+	ret = BS_NOTFOUND;
+	while ((a = bs_find(name))!=0)
+		{
+		bs_kill(a);
+		ret = BS_OK;
+		}
+	return ret;
+	}
+
+uint8_t bs_dir (struct bs_entry * e)
+	{
+	uint8_t h[BS_HDR];
+	uint32_t a;
+	if (e->addr==0)
+		{
+		bs_mount();
+		a = bs_act + BS_HDR;
+		}
+	else a = e->addr + BS_HDR + ((e->stored + BS_HDR - 1)&~(BS_HDR - 1));
+	a = bs_live(a,bs_head,h);
+	if (a==0) return 0;
+	e->addr = a;
+	memcpy(e->name,h+12,BS_NAME_LEN);
+	e->name[BS_NAME_LEN] = 0;
+	e->len = bs_get16(h+6);
+	e->stored = bs_get16(h+4);
+	return 1;
+	}
+
+uint32_t bs_free (void)
+	{
+	uint8_t h[BS_HDR];
+	uint32_t a,used;
+	bs_mount();
+	used = 2*BS_HDR;
+	a = bs_act + BS_HDR;
+	while ((a = bs_live(a,bs_head,h))!=0)
+		{
+		used += bs_size(h);
+		a += bs_size(h);
+		}
+	return BS_HALF - used;
+	}
@@ -0,0 +1,69 @@
+#ifndef		__BSTORE_H
+#define		__BSTORE_H
+
+#include <stdint.h>
+#include "badge_settings.h"
+
+/*
+ * Named store of BASIC programs in FLASH slot region, see FLASH map in
+ * badge_settings.h. Region is two halves, programs are appended to the log
+ * in active half and take as many bytes as they need, so saving touches
+ * only sectors the program lands in, loading reads only what was stored.
+ * Sector is erased just before log gets to it. Half that is full is
+ * compacted by copying live programs into the other one, its header is
+ * written last, so the old half holds until copy is done.
+ *
+ * half header, first 32 bytes of half:
+ * 0..3		magic
+ * 4..7		sequence number, the higher valid one is active
+ *
+ * program, 32 byte header and data, padded to 32 bytes:
+ * 0..3		magic
+ * 4..5		length of data
+ * 6..7		length of text
+ * 8..9		CRC-16 of data
+ * 10		0xFF live, 0x00 deleted or replaced
+ * 11		data format
+ * 12..27	name, padded with zeros
+ * 28..31	sequence number of half, program from older one ends log
+ *
+ * Packed data is program text with line numbers at line start as 0x80 and
+ * 2 bytes, keywords as one byte from 0x81 on. Text with bytes above 0x7F
+ * is stored as it is.
+ */
+
+#define		BS_BASE			BASIC_BASEADDR
+#define		BS_HALF			((uint32_t)BASIC_SAVNUM*BPROG_LEN/2)
+#define		BS_SECT			4096
+#define		BS_HDR			32
+#define		BS_HALF_MAGIC	0x31485342
+#define		BS_MAGIC		0x31505342
+#define		BS_NAME_LEN		16
+
+#define		BS_RAW			0
+#define		BS_PACKED		1
+
+//results of bs_save, bs_load and bs_del
+#define		BS_OK			0
+#define		BS_NONAME		1
+#define		BS_FULL			2
+#define		BS_NOTFOUND		3
+#define		BS_BAD			4
+
+struct bs_entry
+	{
+	uint32_t addr;				//0 to start listing
+	int8_t name[BS_NAME_LEN+1];
+	uint16_t len;				//text
+	uint16_t stored;
+	};
+
+uint8_t bs_save (const int8_t * name, const int8_t * text);
+uint8_t bs_load (const int8_t * name, int8_t * text, uint16_t maxlen);
+uint8_t bs_del (const int8_t * name);
+//next live program after e, 0 when there are no more
+uint8_t bs_dir (struct bs_entry * e);
+//bytes a program can take after compaction
+uint32_t bs_free (void);
+
+#endif
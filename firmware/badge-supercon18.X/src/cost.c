@@ -0,0 +1,96 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <plib.h>
+#include "hw.h"
+#include "Z80/hwz.h"
+#include "cost.h"
+
+struct cost_entry
+	{
+	uint32_t cnt;
+	uint64_t sum;
+	uint32_t min;
+	uint32_t max;
+	uint32_t over;
+	};
+
+const char * cost_names[COST_N] =
+	{
+	"T5","T1","sound","prof","refresh","keyb","wii","pwr","z80","basic"
+	};
+
+#ifdef	COST_STATS
+struct cost_entry cost_tab[COST_N];
+//own time of all ISRs so far, what grew during a measure was nested in it
+volatile uint32_t cost_nested;
+
+void cost_begin (struct cost_mark * m)
+	{
+	m->nested = cost_nested;
+	m->t = _CP0_GET_COUNT();
+	}
+
+void cost_end (struct cost_mark * m, uint8_t id, uint32_t period, uint8_t isr)
+	{
+	struct cost_entry * e;
+	uint32_t t,own;
+	t = _CP0_GET_COUNT() - m->t;
+	own = t - (cost_nested - m->nested);
+	if (isr) cost_nested += own;
+	e = &cost_tab[id];
+	if ((e->cnt==0)||(own<e->min)) e->min = own;
+	if (own>e->max) e->max = own;
+	e->sum += own;
+	e->cnt++;
+	if ((period)&&(t>period)) e->over++;
+	}
+#endif
+
+const char * cost_name (uint8_t id)
+	{
+	return cost_names[id];
+	}
+
+#ifdef	COST_STATS
+//core timer ticks to CPU cycles
+void cost_get (uint8_t id, uint32_t * cnt, uint32_t * min, uint32_t * avg, uint32_t * max, uint32_t * over)
+	{
+	struct cost_entry * e;
+	e = &cost_tab[id];
+	*cnt = e->cnt;
+	*min = e->min*2;
+	*avg = 0;
+	if (e->cnt) *avg = (uint32_t)((e->sum*2)/e->cnt);
+	*max = e->max*2;
+	*over = e->over;
+	}
+
+void cost_send (void)
+	{
+	char line[96], * p;
+	uint32_t cnt,min,avg,max,over;
+	uint8_t i;
+	for (i=0;i<COST_N;i++)
+		{
+		cost_get(i,&cnt,&min,&avg,&max,&over);
+		snprintf(line,sizeof(line),"COST %s %lu %lu %lu %lu %lu\r\n",cost_names[i],
+			(unsigned long)cnt,(unsigned long)min,(unsigned long)avg,(unsigned long)max,(unsigned long)over);
+		for (p=line;*p;p++) tx_write(*p);
+		}
+	}
+#else
+void cost_get (uint8_t id, uint32_t * cnt, uint32_t * min, uint32_t * avg, uint32_t * max, uint32_t * over)
+	{
+	*cnt = 0;
+	*min = 0;
+	*avg = 0;
+	*max = 0;
+	*over = 0;
+	}
+
+void cost_send (void)
+	{
+	char * p = "COST off, see COST_STATS in badge_settings.h\r\n";
+	while (*p) tx_write(*p++);
+	}
+#endif
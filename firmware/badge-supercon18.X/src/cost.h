@@ -0,0 +1,56 @@
+#ifndef		__COST_H
+#define		__COST_H
+
+#include <stdint.h>
+#include "badge_settings.h"
+
+/*
+ * Cost of ISRs and hot functions, in CPU cycles off CP0 Count (it runs at
+ * half of SYS_CLK, so one core timer tick is two cycles). Time spent in ISRs
+ * nested inside is taken out, every entry is its own cost only. ISR whose
+ * whole run, nested ones included, is longer than its period is an overrun.
+ * Figures are in stats, costs sends them to serial port as lines
+ * COST <name> <count> <min> <avg> <max> <overruns>
+ */
+
+#define		COST_T5			0		//timer5, display, keyboard, Wii, power button
+#define		COST_T1			1		//timer1, millisecond tick
+#define		COST_SND		2		//timers 2-4, half period of sound generators
+#define		COST_PROF		3		//core timer, profiler samples
+#define		COST_REFRESH	4		//tft_disp_buffer_refresh_part in timer5
+#define		COST_KEYB		5		//keyb_tasks in timer5
+#define		COST_WII		6		//WiiInterface_Refresh in timer5
+#define		COST_PWR		7		//loop_badge in timer5
+#define		COST_Z80		8		//CPU_SLICE instructions of Z80
+#define		COST_BASIC		9		//ubasic_run_lines, one batch of BASIC lines
+#define		COST_N			10
+
+//periods of ISRs in core timer ticks
+#define		COST_T5_PERIOD	(12*1000*CORE_TICKS_US)
+#define		COST_T1_PERIOD	(1000*CORE_TICKS_US)
+//sound timers count PB_CLK/8, core timer SYS_CLK/2, both clocks are 48MHz
+#define		COST_SND_PERIOD(pr)	((((uint32_t)(pr))+1)*4)
+
+struct cost_mark
+	{
+	uint32_t t;
+	uint32_t nested;
+	};
+
+#ifdef	COST_STATS
+#define		COST_BEGIN(m)			cost_begin(&(m))
+#define		COST_END(m,id)			cost_end(&(m),(id),0,0)
+#define		COST_ISR_END(m,id,per)	cost_end(&(m),(id),(per),1)
+#else
+#define		COST_BEGIN(m)
+#define		COST_END(m,id)
+#define		COST_ISR_END(m,id,per)
+#endif
+
+void cost_begin (struct cost_mark * m);
+void cost_end (struct cost_mark * m, uint8_t id, uint32_t period, uint8_t isr);
+const char * cost_name (uint8_t id);
+void cost_get (uint8_t id, uint32_t * cnt, uint32_t * min, uint32_t * avg, uint32_t * max, uint32_t * over);
+void cost_send (void);
+
+#endif
@@ -428,6 +428,8 @@ inline void tft_set_write_area (uint16_t x, uint16_t y, uint16_t xlen, uint16_t
 
 
 
+//8080 bus to ST7789, host build has model of the controller instead (host/host_lcd.c)
+#ifndef	HOST_BUILD
 /*******************************************************************************/
 void TFT_24_7789_Write_Command(uint16_t command)
 	{
@@ -458,6 +460,7 @@ inline void TFT_24_7789_Write_Data3(uint16_t data1,uint16_t data2, uint16_t data
 	LCD_PORT = data3;
 	LCD_WR_SET;
 	}
+#endif
 
 /*******************************************************************************/
 void TFT_24_7789_Init(void)
@@ -1,8 +1,12 @@
 #include <xc.h>
 #include "hw.h"
 #include "Z80/hwz.h"
+#include "journal.h"
+#include "prof.h"
+#include "cost.h"
 #include <plib.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 // DEVCFG3
 // USERID = No Setting
@@ -547,6 +551,8 @@ uint16_t get_rnd (void)
 	{
 	uint32_t  var;
 	static uint32_t  var_prev;
+	//journaled runs take rand(), seeded by journal
+	if (jr_mode!=JR_OFF) return rand()&0xFFFF;
 	var = rnd_var1 + rnd_var2 + rnd_var3 + (var_prev*1103515245) + 12345;
 	var = var & 0xFFFF;
 	var_prev = var;
@@ -556,23 +562,63 @@ uint16_t get_rnd (void)
 void __ISR(_TIMER_2_VECTOR, IPL6AUTO) Timer2Handler(void)
 //void __ISR(_TIMER_2_VECTOR, ipl6) Timer2Handler(void)
 	{
+	struct cost_mark isr;
+	COST_BEGIN(isr);
     IFS0bits.T2IF = 0;
 	GEN_0_PIN = ~ GEN_0_PIN;
 	rnd_var3++;
+	COST_ISR_END(isr,COST_SND,COST_SND_PERIOD(PR2));
 	}
 void __ISR(_TIMER_3_VECTOR, IPL6AUTO) Timer3Handler(void)
 //void __ISR(_TIMER_3_VECTOR, ipl6) Timer3Handler(void)
 	{
+	struct cost_mark isr;
+	COST_BEGIN(isr);
     IFS0bits.T3IF = 0;
 	GEN_1_PIN = ~ GEN_1_PIN;
 	rnd_var3++;
+	COST_ISR_END(isr,COST_SND,COST_SND_PERIOD(PR3));
 	}
 void __ISR(_TIMER_4_VECTOR, IPL6AUTO) Timer4Handler(void)
 //void __ISR(_TIMER_4_VECTOR, ipl6) Timer4Handler(void)
 	{
+	struct cost_mark isr;
+	COST_BEGIN(isr);
     IFS0bits.T4IF = 0;
 	GEN_2_PIN = ~ GEN_2_PIN;
 	rnd_var3++;
+	COST_ISR_END(isr,COST_SND,COST_SND_PERIOD(PR4));
+	}
+
+//profiler runs on core timer, timers 1-5 are taken by ticks and sound
+uint32_t prof_period;
+
+void prof_hw_start (uint32_t rate)
+	{
+	prof_period = (CORE_TICKS_US*1000000UL)/rate;
+	IEC0bits.CTIE = 0;
+	_CP0_SET_COMPARE(_CP0_GET_COUNT()+prof_period);
+	IFS0bits.CTIF = 0;
+	IPC0bits.CTIP = 7;
+	IEC0bits.CTIE = 1;
+	}
+
+void prof_hw_stop (void)
+	{
+	IEC0bits.CTIE = 0;
+	}
+
+//highest priority, so EPC is where main loop or any other ISR was interrupted
+void __ISR(_CORE_TIMER_VECTOR, IPL7SRS) CoreTimerHandler(void)
+	{
+	uint32_t epc;
+	struct cost_mark isr;
+	COST_BEGIN(isr);
+	epc = _CP0_GET_EPC();
+	_CP0_SET_COMPARE(_CP0_GET_COUNT()+prof_period);
+	IFS0bits.CTIF = 0;
+	prof_sample(epc);
+	COST_ISR_END(isr,COST_PROF,prof_period);
 	}
 
 void exp_set(uint8_t pos, uint8_t val)
@@ -608,8 +654,10 @@ void serial_flush (void)
 	while (rx_sta()) rx_read();
 	}
 
+//serial bytes come from input journal while it plays
 uint8_t rx_sta (void)
 	{
+	if (jr_mode==JR_PLAY) return jr_rx_sta();
 	if (U3STAbits.URXDA==1) return 0xFF;
 	else return 0x00;
 	}
@@ -617,7 +665,9 @@ uint8_t rx_sta (void)
 uint8_t rx_read (void)
 	{
 	uint8_t data;
+	if (jr_mode==JR_PLAY) return jr_rx_read();
 	data = U3RXREG;
+	jr_rx(data);
 	return data;
 	}
 void tx_write (uint8_t data)
@@ -679,4 +729,83 @@ uint8_t iic_ackstat (void)
 	{
 	if (I2C1STATbits.ACKSTAT==0) return 0;
 	else return 1;
-	}
\ No newline at end of file
+	}
+
+//expansion port and serial pins driven one at a time, for test in post.c
+void exp_test_init (void)
+	{
+	U3MODEbits.ON = 0;
+	TRISCbits.TRISC13 = 0;
+	TRISCbits.TRISC14 = 0;
+	TRISBbits.TRISB0 = 0;
+	TRISBbits.TRISB1 = 0;
+	}
+
+void exp_test_state (uint8_t state)
+	{
+	if (state==0)
+		{
+		LATCbits.LATC13 = 1;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 0;
+		}
+	else if (state==1)
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 1;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 0;
+		}
+	else if (state==2)
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 1;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 0;
+		}
+	else if (state==3)
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 1;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 0;
+		}
+	else if (state==4)
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 1;
+		LATBbits.LATB1 = 0;
+		}
+	else if (state==5)
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 1;
+		}	
+	else
+		{
+		LATCbits.LATC13 = 0;
+		LATCbits.LATC14 = 0;
+		LATGbits.LATG2 = 0;
+		LATGbits.LATG3 = 0;
+		LATBbits.LATB0 = 0;
+		LATBbits.LATB1 = 0;
+		}	
+		
+	
+	}
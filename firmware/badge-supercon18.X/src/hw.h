@@ -10,6 +10,16 @@
 #define DISP_BUFFER_WIDE    40
 #define DISP_BUFFER_HIGH    20
 
+#define		SYS_CLK		48000000UL
+#define		PB_CLK		48000000UL
+
+/*
+ * Hardware abstraction: hw.c is the PIC32 side, it alone pokes SFRs, with
+ * LCD bus in disp.c and timer ISRs in badge.c. Host build (HOST_BUILD, see
+ * host/readme) replaces hw.c by host/hal_host.c, the LCD bus by ST7789 model
+ * in host/host_lcd.c and runs the ISR tasks from its virtual clock.
+ */
+#ifndef	HOST_BUILD
 #define		LCD_PORT	LATE
 #define		LCD_WR		LATDbits.LATD4
 #define		LCD_RES		LATGbits.LATG7
@@ -45,9 +55,6 @@
 #define		K_PWR		PORTGbits.RG6
 #define		KEY_BRK		PORTGbits.RG9
 
-#define		SYS_CLK		48000000UL
-#define		PB_CLK		48000000UL
-
 #define     LEDR        LATDbits.LATD6
 #define     LEDG        LATFbits.LATF1
 #define     LEDB        LATDbits.LATD7
@@ -82,6 +89,31 @@
 #define		EXP_3_OUT	LATBbits.LATB1
 #define		EXP_3_T		TRISBbits.TRISB1
 
+//low byte of TMR1, seeds rand()
+#define		TIMER1_LOW	(*(char*)0xBF800610)
+//key_buffer is filled from timer5 interrupt
+#define		KEYB_INT_OFF	IEC0bits.T5IE = 0
+#define		KEYB_INT_ON		IEC0bits.T5IE = 1
+#else
+//inputs sampled outside of hw.c, active low like the pins, set by host keyboard
+extern volatile uint8_t hal_k_shiftl, hal_k_shiftr, hal_k_pwr, hal_k_brk;
+#define		K_SHIFTL	hal_k_shiftl
+#define		K_SHIFTR	hal_k_shiftr
+#define		K_PWR		hal_k_pwr
+#define		KEY_BRK		hal_k_brk
+//LCD control lines are only latched, bus cycles are modeled per byte
+extern uint8_t hal_lcd_res, hal_lcd_rd, hal_lcd_wr;
+#define		LCD_RES		hal_lcd_res
+#define		LCD_RD		hal_lcd_rd
+#define		LCD_WR		hal_lcd_wr
+uint32_t host_core_count (void);
+#define		TIMER1_LOW	((char)host_core_count())
+void hal_irq_off (void);
+void hal_irq_on (void);
+#define		KEYB_INT_OFF	hal_irq_off()
+#define		KEYB_INT_ON		hal_irq_on()
+#endif
+
 
 void wait_1ms (void);
 void wait_ms (uint32_t count);
@@ -101,6 +133,11 @@ uint8_t exp_get (uint8_t pos);
 uint8_t get_led_word(void);
 void set_led_word (uint8_t val);
 uint8_t key_functional_pressed (void);
+void exp_test_init (void);
+void exp_test_state (uint8_t state);
+//bodies of timer1 (1ms) and timer5 (12ms) interrupts, in badge.c
+void tick_ms_tasks (void);
+void tick_display_tasks (void);
 
 
 
@@ -147,6 +184,16 @@ uint8_t stdio_c (uint8_t data);
 uint8_t stdio_in (uint8_t block);
 int8_t stdio_get_state (void);
 int8_t stdio_get (int8_t * dat);
+void con_put (uint8_t data);
+void con_flush (void);
+
+//memory-mapped text window of CP/M machine, see vwin_set()
+#define	VWIN_PORT	0x0E
+#define	VWIN_CHARS	(DISP_BUFFER_WIDE*DISP_BUFFER_HIGH)
+#define	VWIN_SYNC_MS	20
+uint8_t vwin_set (uint8_t page);
+uint8_t vwin_get (void);
+void vwin_sync (uint8_t force);
 
 #define	FCY		48000000UL
 #define	FPB		FCY/1
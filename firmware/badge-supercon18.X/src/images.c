@@ -5589,7 +5589,7 @@ const unsigned char ram_image[] = {
 
 #ifdef	USE_RAM_IMAGE_NEW
 const unsigned char ram_image_a[3] = {0xc3, 0x68, 0xee};
-const unsigned char ram_image_b[] = {
+const unsigned char ram_image_b[] __attribute__((aligned(4))) = {
   0xc3, 0x5c, 0xdb, 0xc3, 0x58, 0xdb, 0x7f, 0x00, 0x43, 0x4f, 0x50, 0x59,
   0x52, 0x49, 0x47, 0x48, 0x54, 0x20, 0x31, 0x39, 0x37, 0x39, 0x20, 0x28,
   0x43, 0x29, 0x20, 0x42, 0x59, 0x20, 0x44, 0x49, 0x47, 0x49, 0x54, 0x41,
@@ -6452,6 +6452,7 @@ const unsigned char ram_image_b[] = {
 
 
 #ifdef	USE_ROMDISK
+#ifndef	USE_ROMDISK_COMPRESSED
 
 const unsigned char rd_image[131072] = {
 0x00,0x58,0x4D,0x44,0x4D,0x20,0x20,0x20,       //byte 0
@@ -6522,9 +6523,9 @@ const unsigned char rd_image[131072] = {
 0x20,0x43,0x4F,0x4D,0x00,0x00,0x00,0x1A,       //byte 520
 0x7B,0x7C,0x7D,0x7E,0x00,0x00,0x00,0x00,       //byte 528
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,       //byte 536
-0xE5,0x54,0x49,0x4E,0x53,0x54,0x20,0x20,       //byte 544
-0x20,0x4D,0x53,0x47,0x00,0x00,0x00,0x1F,       //byte 552
-0x6C,0x6D,0x6E,0x6F,0x00,0x00,0x00,0x00,       //byte 560
+0x00,0x59,0x4D,0x20,0x20,0x20,0x20,0x20,       //byte 544
+0x20,0x43,0x4F,0x4D,0x00,0x00,0x00,0x02,       //byte 552
+0x7F,0x00,0x00,0x00,0x00,0x00,0x00,0x00,       //byte 560
 0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,       //byte 568
 0xE5,0x54,0x55,0x52,0x42,0x4F,0x20,0x20,       //byte 576
 0x20,0x24,0x24,0x24,0x00,0x00,0x00,0x80,       //byte 584
@@ -22710,38 +22711,38 @@ const unsigned char rd_image[131072] = {
 0xC8,0xC3,0x6B,0x02,0x3A,0xE0,0x00,0xB7,       //byte 130024
 0xC0,0xFD,0xCB,0x07,0x46,0xC8,0xC3,0x84,       //byte 130032
 0x02,0x04,0x05,0xC8,0x3A,0xBC,0x01,0xB7,       //byte 130040
-0xC2,0x99,0x02,0x3E,0x20,0xCD,0xC9,0x03,       //byte 130048
-0x10,0xF9,0xC9,0x3A,0xB4,0x01,0xB7,0x20,       //byte 130056
-0x12,0x32,0x74,0x44,0x3A,0x69,0x01,0x3D,       //byte 130064
-0x6F,0x26,0x00,0xCD,0xA2,0x02,0x3E,0x0A,       //byte 130072
-0xC3,0xC9,0x03,0x21,0x01,0x00,0xCD,0xA2,       //byte 130080
-0x02,0xC3,0x59,0x02,0x2A,0x50,0x44,0x11,       //byte 130088
-0x00,0x00,0xED,0x53,0x64,0x44,0xED,0x53,       //byte 130096
-0x66,0x44,0x06,0x7F,0xDD,0x21,0x74,0x7B,       //byte 130104
-0xFD,0x36,0x01,0x00,0x7E,0xED,0x5B,0x60,       //byte 130112
-0x44,0xCD,0xE2,0x3B,0x20,0x08,0xDD,0x22,       //byte 130120
-0x64,0x44,0xFD,0xCB,0x01,0xC6,0xED,0x5B,       //byte 130128
-0x62,0x44,0xCD,0xE2,0x3B,0x20,0x08,0xDD,       //byte 130136
-0x22,0x66,0x44,0xFD,0xCB,0x01,0xCE,0xFE,       //byte 130144
-0x0D,0x20,0x58,0xDD,0x36,0x00,0x20,0xDD,       //byte 130152
-0x23,0x05,0x28,0x65,0xCD,0xDD,0x3B,0x30,       //byte 130160
-0xCB,0xED,0x5B,0x62,0x44,0xCD,0xE2,0x3B,       //byte 130168
-0x30,0x08,0xE5,0x21,0xFF,0xFF,0x22,0x66,       //byte 130176
-0x44,0xE1,0xED,0x5B,0x60,0x44,0xCD,0xE2,       //byte 130184
-0x3B,0x30,0x06,0x21,0xFF,0xFF,0x22,0x64,       //byte 130192
-0x44,0x3E,0x7F,0x90,0x32,0x6F,0x44,0xDD,       //byte 130200
-0x36,0x00,0x20,0xDD,0x23,0x10,0xF8,0x2A,       //byte 130208
-0x52,0x44,0xCD,0xE7,0x3F,0xFD,0xCB,0x0E,       //byte 130216
-0x46,0xFD,0xCB,0x0E,0xC6,0xC2,0x4E,0x37,       //byte 130224
-0x3A,0x75,0x44,0x3D,0xFD,0xBE,0x05,0xD0,       //byte 130232
-0xC3,0x4E,0x37,0xFE,0x0A,0x28,0xB2,0xDD,       //byte 130240
-0x77,0x00,0xDD,0x23,0x05,0x20,0x02,0x18,       //byte 130248
-0x08,0xCD,0xDD,0x3B,0x30,0xA3,0xC3,0x44,       //byte 130256
-0x3D,0xCD,0x04,0x3E,0x4C,0x69,0x6E,0x65,       //byte 130264
-0x20,0x74,0x6F,0x6F,0x20,0x6C,0x6F,0x6E,       //byte 130272
-0x67,0x20,0x2D,0x20,0x43,0x52,0x20,0x69,       //byte 130280
-0x6E,0x73,0x65,0x72,0x74,0x65,0x64,0x00,       //byte 130288
-0xCD,0x12,0x3F,0x21,0x7D,0x00,0xCD,0x70,       //byte 130296
+0x3A,0x5D,0x00,0xFE,0x52,0x28,0x0C,0xFE,       //byte 130048
+0x53,0x28,0x08,0x11,0x54,0x01,0x0E,0x09,       //byte 130056
+0xC3,0x05,0x00,0x11,0x8D,0x01,0x0E,0x09,       //byte 130064
+0xCD,0x05,0x00,0x0E,0x19,0xCD,0x05,0x00,       //byte 130072
+0x3C,0x47,0x3A,0x6C,0x00,0xB7,0x20,0x04,       //byte 130080
+0x78,0x32,0x6C,0x00,0x1E,0xFF,0x0E,0x20,       //byte 130088
+0xCD,0x05,0x00,0x47,0x11,0x6C,0x00,0x3A,       //byte 130096
+0x5D,0x00,0xFE,0x52,0x3E,0x01,0x28,0x02,       //byte 130104
+0x3E,0x02,0xD3,0x0D,0xDB,0x0D,0xB7,0x28,       //byte 130112
+0x08,0x11,0xB2,0x01,0x0E,0x09,0xCD,0x05,       //byte 130120
+0x00,0xC3,0x00,0x00,0x59,0x4D,0x20,0x52,       //byte 130128
+0x20,0x5B,0x64,0x3A,0x5D,0x20,0x20,0x72,       //byte 130136
+0x65,0x63,0x65,0x69,0x76,0x65,0x20,0x66,       //byte 130144
+0x69,0x6C,0x65,0x73,0x0D,0x0A,0x59,0x4D,       //byte 130152
+0x20,0x53,0x20,0x5B,0x64,0x3A,0x5D,0x6E,       //byte 130160
+0x61,0x6D,0x65,0x2E,0x65,0x78,0x74,0x20,       //byte 130168
+0x20,0x73,0x65,0x6E,0x64,0x20,0x66,0x69,       //byte 130176
+0x6C,0x65,0x0D,0x0A,0x24,0x59,0x4D,0x4F,       //byte 130184
+0x44,0x45,0x4D,0x20,0x6F,0x6E,0x20,0x73,       //byte 130192
+0x65,0x72,0x69,0x61,0x6C,0x20,0x70,0x6F,       //byte 130200
+0x72,0x74,0x2C,0x20,0x42,0x52,0x4B,0x20,       //byte 130208
+0x63,0x61,0x6E,0x63,0x65,0x6C,0x73,0x0D,       //byte 130216
+0x0A,0x24,0x54,0x72,0x61,0x6E,0x73,0x66,       //byte 130224
+0x65,0x72,0x20,0x66,0x61,0x69,0x6C,0x65,       //byte 130232
+0x64,0x0D,0x0A,0x24,0x1A,0x1A,0x1A,0x1A,       //byte 130240
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130248
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130256
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130264
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130272
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130280
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130288
+0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,0x1A,       //byte 130296
 0x39,0xC3,0x2C,0x3D,0xCD,0xA4,0x3B,0xCD,       //byte 130304
 0x0D,0x3E,0xC3,0x11,0x42,0xFD,0x36,0x08,       //byte 130312
 0x00,0x21,0x00,0x00,0xCD,0xA2,0x02,0xCD,       //byte 130320
@@ -22840,12 +22841,13 @@ const unsigned char rd_image[131072] = {
 0x44,0xCD,0x47,0x41,0xFD,0xCB,0x0E,0xC6       //byte 131064
 };
 
-
+#endif
 #endif
 
 
 
 #ifdef	USE_ROMDISK2
+#ifndef	USE_ROMDISK_COMPRESSED
 
 const unsigned char rd_image2[ROMDISK2_SIZE] = {
   0x00, 0x5a, 0x4f, 0x52, 0x4b, 0x31, 0x20, 0x20, 0x20, 0x43, 0x4f, 0x4d,
@@ -33777,4 +33779,5 @@ const unsigned char rd_image2[ROMDISK2_SIZE] = {
 
 	};
 
+#endif
 #endif
\ No newline at end of file
@@ -0,0 +1,393 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hw.h"
+#include "Z80/hwz.h"
+#include "journal.h"
+
+extern volatile int8_t brk_key;
+extern volatile uint8_t fl_lock;
+
+volatile uint8_t jr_mode;
+
+#ifdef	INPUT_JOURNAL
+uint8_t jr_sink;
+
+//two pages, timer5 fills or drains one while main loop writes or loads the other
+uint8_t jr_page[2][JR_PAGE];
+volatile uint8_t jr_full[2];
+uint8_t jr_cur, jr_io;
+uint16_t jr_pos;
+uint32_t jr_addr;
+//pages are being written, recording stopped with pages left to write
+volatile uint8_t jr_busy, jr_flush_due;
+
+//serial bytes between rx_read in main loop and timer5, recorded or played
+#define		JR_RX_LEN		64
+uint8_t jr_rx_buf[JR_RX_LEN];
+volatile uint8_t jr_rx_in, jr_rx_out;
+
+uint32_t jr_ticks, jr_last, jr_events, jr_lost;
+//next record when playing, due on journal tick jr_due
+uint8_t jr_have, jr_type, jr_data;
+uint32_t jr_due;
+
+static void jr_reset (void)
+	{
+	jr_full[0] = 0;
+	jr_full[1] = 0;
+	jr_cur = 0;
+	jr_io = 0;
+	jr_pos = JR_HDR_LEN;
+	jr_addr = JR_BASE;
+	jr_rx_in = 0;
+	jr_rx_out = 0;
+	jr_ticks = 0;
+	jr_last = 0;
+	jr_events = 0;
+	jr_lost = 0;
+	jr_have = 0;
+	jr_due = 0;
+	srand(JR_SEED);
+	}
+
+static void jr_put_raw (uint8_t b0, uint8_t b1)
+	{
+	//main loop didn't get to write the other page yet
+	if (jr_full[jr_cur])
+		{
+		jr_lost++;
+		return;
+		}
+	jr_page[jr_cur][jr_pos++] = b0;
+	jr_page[jr_cur][jr_pos++] = b1;
+	if (jr_pos>=JR_PAGE)
+		{
+		jr_full[jr_cur] = 1;
+		jr_cur ^= 1;
+		jr_pos = 0;
+		}
+	}
+
+//ticks since last record, WAITs for what doesn't fit in record itself
+static uint8_t jr_delta (uint8_t max)
+	{
+	uint32_t dt,w;
+	dt = jr_ticks - jr_last;
+	jr_last = jr_ticks;
+	while (dt>max)
+		{
+		w = (dt>JR_WAIT_MAX) ? JR_WAIT_MAX : dt;
+		jr_put_raw(JR_T_WAIT|(w&0x3F),w>>6);
+		dt -= w;
+		}
+	return dt;
+	}
+
+static void jr_put (uint8_t type, uint8_t data)
+	{
+	jr_put_raw(type|jr_delta(0x3F),data);
+	jr_events++;
+	}
+
+//next record out of page, WAITs are folded into its due tick
+static uint8_t jr_fetch (void)
+	{
+	uint8_t b0,b1;
+	while (jr_have==0)
+		{
+		if (jr_full[jr_cur]==0) return 0;
+		b0 = jr_page[jr_cur][jr_pos++];
+		b1 = jr_page[jr_cur][jr_pos++];
+		if (jr_pos>=JR_PAGE)
+			{
+			jr_full[jr_cur] = 0;
+			jr_cur ^= 1;
+			jr_pos = 0;
+			}
+		//end mark, played out on the tick recording stopped
+		if ((b0==0xFF)&&(b1==0xFF))
+			{
+			jr_type = JR_T_END;
+			jr_have = 1;
+			return 1;
+			}
+		if ((b0&0xC0)==JR_T_WAIT)
+			{
+			jr_due += (b0&0x3F)|(((uint16_t)b1)<<6);
+			continue;
+			}
+		jr_due += b0&0x3F;
+		jr_type = b0&0xC0;
+		jr_data = b1;
+		jr_have = 1;
+		jr_events++;
+		}
+	return 1;
+	}
+
+//FLASH sectors are erased as the log reaches them, first one in jr_record
+static void jr_write (uint8_t * data, uint16_t len)
+	{
+	uint16_t i;
+	if (jr_sink==JR_SERIAL)
+		{
+		for (i=0;i<len;i++) tx_write(data[i]);
+		return;
+		}
+	if ((jr_addr+len)>(JR_BASE+JR_SIZE))
+		{
+		jr_mode = JR_OFF;
+		return;
+		}
+	if (((jr_addr%4096)==0)&&(jr_addr!=JR_BASE)) fl_erase_4k(jr_addr);
+	fl_write_page(jr_addr,data,len);
+	jr_addr += len;
+	}
+
+//what jr_stop left, timer5 backs off while main loop uses FLASH or pages
+//as ramdisk_sync does, main loop writes it later
+static void jr_flush (void)
+	{
+	if (jr_busy!=0) return;
+	if ((jr_sink==JR_FLASH)&&(fl_lock!=0)) return;
+	jr_busy = 1;
+	while (jr_full[jr_io])
+		{
+		jr_write(jr_page[jr_io],JR_PAGE);
+		jr_full[jr_io] = 0;
+		jr_io ^= 1;
+		}
+	if (jr_pos>0) jr_write(jr_page[jr_cur],jr_pos);
+	jr_pos = 0;
+	jr_flush_due = 0;
+	jr_busy = 0;
+	}
+
+uint8_t jr_record (uint8_t sink)
+	{
+	jr_stop();
+	if (jr_flush_due) jr_flush();
+	jr_reset();
+	jr_sink = sink;
+	memset(jr_page[0],0,JR_HDR_LEN);
+	jr_page[0][0] = (JR_MAGIC>>0)&0xFF;
+	jr_page[0][1] = (JR_MAGIC>>8)&0xFF;
+	jr_page[0][2] = (JR_MAGIC>>16)&0xFF;
+	jr_page[0][3] = (JR_MAGIC>>24)&0xFF;
+	if (sink==JR_FLASH) fl_erase_4k(JR_BASE);
+	jr_mode = JR_REC;
+	return 0;
+	}
+
+uint8_t jr_play (void)
+	{
+	uint8_t hdr[4];
+	jr_stop();
+	if (jr_flush_due) jr_flush();
+	fl_read_nk(JR_BASE,hdr,4);
+	if ((hdr[0]|(hdr[1]<<8)|(hdr[2]<<16)|((uint32_t)hdr[3]<<24))!=JR_MAGIC) return 1;
+	jr_reset();
+	fl_read_nk(JR_BASE,jr_page[0],JR_PAGE);
+	fl_read_nk(JR_BASE+JR_PAGE,jr_page[1],JR_PAGE);
+	jr_full[0] = 1;
+	jr_full[1] = 1;
+	jr_addr = JR_BASE + 2*JR_PAGE;
+	jr_mode = JR_PLAY;
+	return 0;
+	}
+
+//end of recording: end mark after WAITs up to this tick, so playing
+//keeps seeds fixed as long as recording did, then pages still waiting.
+//Also called from timer5 on power-off
+void jr_stop (void)
+	{
+	uint8_t mode;
+	mode = jr_mode;
+	jr_mode = JR_OFF;
+	if (mode!=JR_REC) return;
+	jr_delta(0);
+	jr_put_raw(0xFF,0xFF);
+	jr_flush_due = 1;
+	jr_flush();
+	}
+
+//main loop side, called when firmware polls stdio
+void jr_tasks (void)
+	{
+	if (jr_mode==JR_REC)
+		{
+		jr_busy = 1;
+		while ((jr_full[jr_io])&&(jr_mode==JR_REC))
+			{
+			jr_write(jr_page[jr_io],JR_PAGE);
+			jr_full[jr_io] = 0;
+			jr_io ^= 1;
+			}
+		jr_busy = 0;
+		}
+	else if (jr_mode==JR_PLAY)
+		{
+		while ((jr_full[jr_io]==0)&&(jr_addr<(JR_BASE+JR_SIZE)))
+			{
+			fl_read_nk(jr_addr,jr_page[jr_io],JR_PAGE);
+			jr_addr += JR_PAGE;
+			jr_full[jr_io] = 1;
+			jr_io ^= 1;
+			}
+		//log filled whole region, no end mark
+		if ((jr_full[0]==0)&&(jr_full[1]==0)&&(jr_have==0)) jr_mode = JR_OFF;
+		}
+	if (jr_flush_due) jr_flush();
+	}
+
+//timer5 side, takes key of keyboard or Wii and returns the one to use
+uint8_t jr_tick (uint8_t key)
+	{
+	if (jr_mode==JR_REC)
+		{
+		jr_ticks++;
+		while (jr_rx_out!=jr_rx_in)
+			{
+			jr_put(JR_T_RX,jr_rx_buf[jr_rx_out]);
+			jr_rx_out = (jr_rx_out+1)%JR_RX_LEN;
+			}
+		if (key) jr_put(JR_T_KEY,key);
+		return key;
+		}
+	if (jr_mode!=JR_PLAY) return key;
+	//keys of whoever holds the badge don't count while journal plays
+	key = 0;
+	//page not loaded yet, journal time waits for it
+	if ((jr_have==0)&&(jr_fetch()==0)) return 0;
+	jr_ticks++;
+	while ((jr_have)&&(jr_due<=jr_ticks))
+		{
+		if (jr_type==JR_T_END)
+			{
+			jr_mode = JR_OFF;
+			break;
+			}
+		if (jr_type==JR_T_KEY)
+			{
+			//one key per tick, like keyb_tasks
+			if (key) break;
+			key = jr_data;
+			}
+		else if (jr_type==JR_T_BRK)
+			brk_key = 1;
+		else if (((jr_rx_in+1)%JR_RX_LEN)!=jr_rx_out)
+			{
+			jr_rx_buf[jr_rx_in] = jr_data;
+			jr_rx_in = (jr_rx_in+1)%JR_RX_LEN;
+			}
+		else
+			jr_lost++;
+		jr_have = 0;
+		jr_fetch();
+		}
+	return key;
+	}
+
+//BRK went through loop_badge, pressing it during play takes control back
+void jr_brk (void)
+	{
+	if (jr_mode==JR_REC) jr_put(JR_T_BRK,0);
+	else if (jr_mode==JR_PLAY) jr_mode = JR_OFF;
+	}
+
+//serial byte read by firmware, goes to log on next tick
+void jr_rx (uint8_t data)
+	{
+	if (jr_mode!=JR_REC) return;
+	if (((jr_rx_in+1)%JR_RX_LEN)==jr_rx_out)
+		{
+		jr_lost++;
+		return;
+		}
+	jr_rx_buf[jr_rx_in] = data;
+	jr_rx_in = (jr_rx_in+1)%JR_RX_LEN;
+	}
+
+uint8_t jr_rx_sta (void)
+	{
+	if (jr_rx_out!=jr_rx_in) return 0xFF;
+	return 0x00;
+	}
+
+uint8_t jr_rx_read (void)
+	{
+	uint8_t data;
+	if (jr_rx_out==jr_rx_in) return 0;
+	data = jr_rx_buf[jr_rx_out];
+	jr_rx_out = (jr_rx_out+1)%JR_RX_LEN;
+	return data;
+	}
+
+//seeds of rand() and friends, fixed while journal records or plays
+uint32_t jr_seed (uint32_t live)
+	{
+	if (jr_mode!=JR_OFF) return JR_SEED;
+	return live;
+	}
+
+void jr_get_stats (uint32_t * events, uint32_t * ticks, uint32_t * lost)
+	{
+	*events = jr_events;
+	*ticks = jr_ticks;
+	*lost = jr_lost;
+	}
+#else
+uint8_t jr_record (uint8_t sink)
+	{
+	return 1;
+	}
+
+uint8_t jr_play (void)
+	{
+	return 1;
+	}
+
+void jr_stop (void)
+	{
+	}
+
+void jr_tasks (void)
+	{
+	}
+
+uint8_t jr_tick (uint8_t key)
+	{
+	return key;
+	}
+
+void jr_brk (void)
+	{
+	}
+
+void jr_rx (uint8_t data)
+	{
+	}
+
+uint8_t jr_rx_sta (void)
+	{
+	return 0x00;
+	}
+
+uint8_t jr_rx_read (void)
+	{
+	return 0;
+	}
+
+uint32_t jr_seed (uint32_t live)
+	{
+	return live;
+	}
+
+void jr_get_stats (uint32_t * events, uint32_t * ticks, uint32_t * lost)
+	{
+	*events = 0;
+	*ticks = 0;
+	*lost = 0;
+	}
+#endif
@@ -0,0 +1,62 @@
+#ifndef		__JOURNAL_H
+#define		__JOURNAL_H
+
+#include <stdint.h>
+#include "badge_settings.h"
+
+/*
+ * Input journal: keys (after keyboard and Wii), BRK and serial bytes are
+ * logged with the timer5 tick they arrived on, and fed back on the same
+ * ticks when played. Random seeds are fixed while journal runs, so the
+ * same log gives the same session, on the badge or in host build.
+ *
+ * Log is a 16 byte header and 2 byte records:
+ * byte 0	type in bits 7-6, ticks since previous record in bits 5-0
+ * byte 1	key code or serial byte
+ * WAIT records move time by (byte0&0x3F)|(byte1<<6) ticks, FFFF ends log
+ * on the tick recording stopped
+ * Without INPUT_JOURNAL in badge_settings.h journal takes no RAM, jrec and
+ * jplay do nothing and seeds stay live.
+ */
+
+//log in FLASH, see FLASH map in badge_settings.h
+#define		JR_BASE			0x360000
+#define		JR_SIZE			0x020000
+#define		JR_PAGE			256
+#define		JR_HDR_LEN		16
+#define		JR_MAGIC		0x314E524A
+
+#define		JR_T_KEY		0x00
+#define		JR_T_BRK		0x40
+#define		JR_T_RX			0x80
+#define		JR_T_WAIT		0xC0
+#define		JR_WAIT_MAX		0x3FFE
+//end mark FFFF, as read back when playing
+#define		JR_T_END		0xFF
+
+//what rand() and get_rnd() start from in journaled runs
+#define		JR_SEED			1
+
+#define		JR_OFF			0
+#define		JR_REC			1
+#define		JR_PLAY			2
+
+//where recording goes
+#define		JR_FLASH		0
+#define		JR_SERIAL		1
+
+extern volatile uint8_t jr_mode;
+
+uint8_t jr_record (uint8_t sink);
+uint8_t jr_play (void);
+void jr_stop (void);
+void jr_tasks (void);
+uint8_t jr_tick (uint8_t key);
+void jr_brk (void);
+void jr_rx (uint8_t data);
+uint8_t jr_rx_sta (void);
+uint8_t jr_rx_read (void);
+uint32_t jr_seed (uint32_t live);
+void jr_get_stats (uint32_t * events, uint32_t * ticks, uint32_t * lost);
+
+#endif
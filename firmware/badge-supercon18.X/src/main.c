@@ -8,7 +8,12 @@ extern int8_t bprog[BPROG_LEN+1];
 extern jmp_buf jbuf;
 extern uint8_t disk_temp[128],flash_buff[4096], conin_buffer[30], conin_buffer_pointer;
 
+#ifdef	HOST_BUILD
+//host build has its own main() taking options, see host/badge_host.c
+int16_t firmware_main(void)
+#else
 int16_t main(void)
+#endif
 {
 	hw_init();
 	badge_init();	
@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "hw.h"
+#include "prof.h"
+
+volatile uint8_t prof_on;
+
+#ifdef	PROFILER
+uint32_t prof_rate;
+
+//open addressing on address, count 0 is free slot, counts stop at 0xFFFF
+//and samples past that are lost as those without a free slot
+uint32_t prof_pc[PROF_SLOTS];
+uint16_t prof_cnt[PROF_SLOTS];
+uint32_t prof_samples, prof_lost;
+
+void prof_start (uint32_t rate)
+	{
+	prof_stop();
+	if (rate<PROF_RATE_MIN) rate = PROF_RATE_MIN;
+	if (rate>PROF_RATE_MAX) rate = PROF_RATE_MAX;
+	memset(prof_cnt,0,sizeof(prof_cnt));
+	prof_samples = 0;
+	prof_lost = 0;
+	prof_rate = rate;
+	prof_on = 1;
+	prof_hw_start(rate);
+	}
+
+void prof_stop (void)
+	{
+	if (prof_on==0) return;
+	prof_hw_stop();
+	prof_on = 0;
+	}
+
+//called from timer interrupt, PROF_PROBES slots are tried before sample is lost
+void prof_sample (uint32_t pc)
+	{
+	uint16_t i,s;
+	prof_samples++;
+	s = ((uint32_t)((pc>>1)*2654435761UL))>>(32-PROF_BITS);
+	for (i=0;i<PROF_PROBES;i++)
+		{
+		if (prof_cnt[s]==0)
+			{
+			prof_pc[s] = pc;
+			prof_cnt[s] = 1;
+			return;
+			}
+		if (prof_pc[s]==pc)
+			{
+			if (prof_cnt[s]<0xFFFF) prof_cnt[s]++;
+			else prof_lost++;
+			return;
+			}
+		s = (s+1)%PROF_SLOTS;
+		}
+	prof_lost++;
+	}
+
+static void prof_tx (char * line)
+	{
+	while (*line) tx_write(*line++);
+	}
+
+//histogram over serial port, sampling is stopped first
+void prof_send (void)
+	{
+	char line[64];
+	uint16_t i;
+	prof_stop();
+	snprintf(line,sizeof(line),"PROF rate %lu samples %lu lost %lu\r\n",
+		(unsigned long)prof_rate,(unsigned long)prof_samples,(unsigned long)prof_lost);
+	prof_tx(line);
+	for (i=0;i<PROF_SLOTS;i++)
+		if (prof_cnt[i])
+			{
+			snprintf(line,sizeof(line),"PROF %08lX %u\r\n",(unsigned long)prof_pc[i],prof_cnt[i]);
+			prof_tx(line);
+			}
+	prof_tx("PROF end\r\n");
+	}
+
+void prof_get_stats (uint32_t * samples, uint32_t * lost, uint16_t * used)
+	{
+	uint16_t i;
+	*samples = prof_samples;
+	*lost = prof_lost;
+	*used = 0;
+	for (i=0;i<PROF_SLOTS;i++)
+		if (prof_cnt[i]) (*used)++;
+	}
+#else
+void prof_start (uint32_t rate)
+	{
+	}
+
+void prof_stop (void)
+	{
+	}
+
+void prof_sample (uint32_t pc)
+	{
+	}
+
+void prof_send (void)
+	{
+	char * line = "PROF off, see PROFILER in badge_settings.h\r\n";
+	while (*line) tx_write(*line++);
+	}
+
+void prof_get_stats (uint32_t * samples, uint32_t * lost, uint16_t * used)
+	{
+	*samples = 0;
+	*lost = 0;
+	*used = 0;
+	}
+#endif
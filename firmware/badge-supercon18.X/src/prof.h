@@ -0,0 +1,38 @@
+#ifndef		__PROF_H
+#define		__PROF_H
+
+#include <stdint.h>
+#include "badge_settings.h"
+
+/*
+ * Statistical profiler: core timer interrupt at IPL7 takes EPC, the address
+ * any code (timer ISRs included) was interrupted at, into a hash histogram.
+ * prof starts it, profs stops it and sends histogram over serial port:
+ * PROF rate <Hz> samples <n> lost <n>
+ * PROF <address in hex> <count>		one line per address
+ * PROF end
+ * lost samples found no free slot or hit a count already at 0xFFFF.
+ * profile/prof.py maps addresses to functions with symbols of the ELF.
+ * Without PROFILER in badge_settings.h the histogram takes no RAM and
+ * profs only answers PROF off.
+ */
+
+#define		PROF_BITS		9
+#define		PROF_SLOTS		(1<<PROF_BITS)
+#define		PROF_PROBES		8
+#define		PROF_RATE		1000
+#define		PROF_RATE_MIN	10
+#define		PROF_RATE_MAX	20000
+
+extern volatile uint8_t prof_on;
+
+void prof_start (uint32_t rate);
+void prof_stop (void);
+void prof_send (void);
+void prof_sample (uint32_t pc);
+void prof_get_stats (uint32_t * samples, uint32_t * lost, uint16_t * used);
+//timer side, in hw.c and host HAL
+void prof_hw_start (uint32_t rate);
+void prof_hw_stop (void);
+
+#endif
@@ -0,0 +1,239 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "badge_settings.h"
+#include "progtab.h"
+
+extern int8_t bprog[BPROG_LEN+1];
+
+uint16_t pt_len;			//strlen(bprog), kept by every edit
+uint16_t pt_lines;
+uint8_t pt_ok;				//table describes the text
+
+//offset of line i, 2 bytes growing down from top of bprog, bprog[BPROG_LEN]
+//stays the terminator of a full buffer
+#define		PT_AT(i)	((uint8_t *)bprog + BPROG_LEN - 2*((i)+1))
+
+static uint16_t pt_get (uint16_t i)
+	{
+	uint8_t * e;
+	e = PT_AT(i);
+	return e[0] | (((uint16_t)e[1])<<8);
+	}
+
+static void pt_set (uint16_t i, uint16_t off)
+	{
+	uint8_t * e;
+	e = PT_AT(i);
+	e[0] = off;
+	e[1] = off>>8;
+	}
+
+static int16_t pt_num (uint16_t i)
+	{
+	return atoi(bprog + pt_get(i));
+	}
+
+//number of line at p, 0 for line the table can't hold, *next is the line
+//after, *text 0 for line of blanks only
+static uint16_t pt_parse (const int8_t * p, const int8_t ** next, uint8_t * text)
+	{
+	uint32_t n;
+	uint8_t digits;
+	n = 0;
+	digits = 0;
+	while ((*p>='0')&&(*p<='9'))
+		{
+		n = n*10 + (*p++ - '0');
+		if (++digits>5) return 0;
+		}
+	if ((digits==0)||(n==0)||(n>32767)) return 0;
+	*text = 0;
+	while ((*p!='\n')&&(*p!=0))
+		if (!isspace((uint8_t)*p++)) *text = 1;
+	if (*p==0) return 0;
+	*next = p + 1;
+	return n;
+	}
+
+//old scan reads blanks after the number on into the next line, so only a
+//blank last line is one it can't find
+static void pt_check_last (void)
+	{
+	const int8_t * p;
+	uint8_t text;
+	if (pt_lines==0) return;
+	pt_parse(bprog + pt_get(pt_lines-1),&p,&text);
+	if (text==0)
+		{
+		pt_ok = 0;
+		pt_lines = 0;
+		}
+	}
+
+void pt_rebuild (void)
+	{
+	const int8_t * p;
+	uint16_t n,prev,cnt,i;
+	uint8_t text;
+	pt_len = strlen(bprog);
+	pt_lines = 0;
+	pt_ok = 0;
+	//checked before written, table may lie over text yet to be checked
+	cnt = 0;
+	prev = 0;
+	p = bprog;
+	while (*p)
+		{
+		n = pt_parse(p,&p,&text);
+		if (n<=prev) return;
+		prev = n;
+		cnt++;
+		}
+	if (((uint32_t)pt_len + 2*(uint32_t)cnt)>=BPROG_LEN) return;
+	p = bprog;
+	for (i=0;i<cnt;i++)
+		{
+		pt_set(i,p - bprog);
+		pt_parse(p,&p,&text);
+		}
+	pt_lines = cnt;
+	pt_ok = 1;
+	pt_check_last();
+	}
+
+uint16_t pt_free (void)
+	{
+	if (pt_ok==0) return BPROG_LEN - pt_len;
+	return BPROG_LEN - 1 - pt_len - 2*pt_lines;
+	}
+
+int8_t * pt_gap (uint16_t * len)
+	{
+	if (pt_ok==0) *len = BPROG_LEN - 1 - pt_len;
+	else *len = pt_free();
+	return bprog + pt_len + 1;
+	}
+
+void pt_get_stats (uint16_t * lines, uint16_t * len, uint8_t * indexed)
+	{
+	*lines = pt_lines;
+	*len = pt_len;
+	*indexed = pt_ok;
+	}
+
+//text from off on moves by delta, entries after line i follow it
+static void pt_shift (uint16_t i, uint16_t off, int16_t delta)
+	{
+	memmove(bprog + off + delta,bprog + off,pt_len - off + 1);
+	pt_len += delta;
+	for (i++;i<pt_lines;i++) pt_set(i,pt_get(i) + delta);
+	}
+
+//B_BAS008
+//line scan of the old editor, for text the table doesn't describe
+static uint8_t pt_add_slow (int8_t * line, int16_t linenum)
+    {
+    uint8_t * prog_ptr=bprog, * prog_ptr_prev, * prog_ptr_dest;
+    int32_t linenum_now;
+    int16_t linenum_prev=0,line_exp_len,cnt, prog_len;
+    int8_t line_rest[INPUT_BUFFER_LEN+1],line_exp[INPUT_BUFFER_LEN+1],ret;
+    sprintf(line_exp,"%d %s\n",linenum,line);
+    line_exp_len = strlen(line_exp);
+	prog_len = strlen(bprog);
+	if ((prog_len + line_exp_len)>BPROG_LEN) return 1;
+    while (1)
+	{
+	ret = sscanf(prog_ptr,"%d %[^\n]s",&linenum_now,line_rest);
+	if (ret==2)
+	    {
+	    if ((linenum>linenum_prev)&(linenum<linenum_now))
+			{
+			cnt = strlen(prog_ptr) +1;
+			prog_ptr_dest = prog_ptr + line_exp_len;
+			memmove(prog_ptr_dest,prog_ptr,cnt);
+			memcpy(prog_ptr,line_exp,line_exp_len);
+			return 0;
+			}
+	    if (linenum==linenum_now)
+			{
+			prog_ptr_prev = prog_ptr;
+			prog_ptr = strchr(prog_ptr,'\n')+1;
+			cnt = strlen(prog_ptr)+1;
+			memmove(prog_ptr_prev,prog_ptr,cnt);
+			if (strlen(line)>1)
+				{
+				prog_ptr = prog_ptr_prev;
+				cnt = strlen(prog_ptr);
+				prog_ptr_dest = prog_ptr + line_exp_len;
+				memmove(prog_ptr_dest,prog_ptr,cnt+1);
+				memcpy(prog_ptr,line_exp,line_exp_len);
+				}
+			return 0;
+			}
+	    }
+	if (ret==-1)
+	    {
+	    strcat(bprog,line_exp);
+	    return 0;
+	    }
+	linenum_prev = linenum_now;
+	prog_ptr_prev = prog_ptr;
+	prog_ptr = strchr(prog_ptr,'\n')+1;
+	}
+    }
+
+//same results as the old editor, one character of text deletes a line
+uint8_t pt_add_line (int8_t * line, int16_t linenum)
+	{
+	int8_t line_exp[INPUT_BUFFER_LEN+8];
+	uint16_t lo,hi,mid,len,at,old,n;
+	uint8_t ret;
+	if ((pt_ok==0)||(linenum<=0))
+		{
+		ret = pt_add_slow(line,linenum);
+		pt_rebuild();
+		return ret;
+		}
+	sprintf(line_exp,"%d %s\n",linenum,line);
+	len = strlen(line_exp);
+	n = pt_lines;
+	lo = 0;
+	hi = n;
+	while (lo<hi)
+		{
+		mid = (lo + hi)/2;
+		if (pt_num(mid)<linenum) lo = mid + 1;
+		else hi = mid;
+		}
+	if ((lo<n)&&(pt_num(lo)==linenum))
+		{
+		at = pt_get(lo);
+		if (lo+1<n) old = pt_get(lo+1) - at;
+		else old = pt_len - at;
+		if (strlen(line)>1)
+			{
+			if ((len>old)&&((len - old)>pt_free())) return 1;
+			pt_shift(lo,at + old,len - old);
+			memcpy(bprog + at,line_exp,len);
+			return 0;
+			}
+		pt_shift(lo,at + old,-old);
+		if (lo+1<n) memmove(PT_AT(n-2),PT_AT(n-1),2*(n - 1 - lo));
+		pt_lines--;
+		pt_check_last();
+		return 0;
+		}
+	if ((len + 2)>pt_free()) return 1;
+	if (lo<n) at = pt_get(lo);
+	else at = pt_len;
+	if (lo<n) memmove(PT_AT(n),PT_AT(n-1),2*(n - lo));
+	pt_lines++;
+	pt_shift(lo,at,len);
+	memcpy(bprog + at,line_exp,len);
+	pt_set(lo,at);
+	pt_check_last();
+	return 0;
+	}
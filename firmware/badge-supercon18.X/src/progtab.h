@@ -0,0 +1,27 @@
+#ifndef		__PROGTAB_H
+#define		__PROGTAB_H
+
+#include <stdint.h>
+
+/*
+ * Line table of BASIC program in bprog. Text stays as it always was, lines
+ * in ascending order, so RUN, list and save see no difference. Offsets of
+ * line starts are 2 bytes each at the top of bprog, growing down towards
+ * the text, a line costs its text and 2 bytes. Lines are found by binary
+ * search over the table, text after the edited line moves by one memmove,
+ * appending at the end moves nothing.
+ * Text the table can't describe (line numbers not ascending or not in
+ * 1..32767, line without newline, last line without text, no room for the
+ * table) is edited by the old linear scan until it is in order again.
+ */
+
+//text of bprog was replaced, as by load or memclr
+void pt_rebuild (void);
+//line as typed after its number, 1 if there is no room for it
+uint8_t pt_add_line (int8_t * line, int16_t linenum);
+uint16_t pt_free (void);
+//unused bytes between text and table, gone with the next edit
+int8_t * pt_gap (uint16_t * len);
+void pt_get_stats (uint16_t * lines, uint16_t * len, uint8_t * indexed);
+
+#endif
@@ -1,6 +1,24 @@
 #include "splash.h"
 #include <stdint.h>
 
+const uint16_t b_cipher[12] = {
+    0b0000101010111101,
+    0b0000010111100110,
+    0b0000101101111101,
+    
+    0b0000010110010101,
+    0b0000111101111010,
+    0b0000101110101010,
+    
+    0b0000100111100110,
+    0b0000111110100101,
+    0b0000111111111111,
+    
+    0b0000111010110111,
+    0b0000110111101110,
+    0b0000101101110111
+};
+
 const uint32_t arc[25] = {
   0b00000000000000000000000000001111,
   0b00000000000000000000000011111111,
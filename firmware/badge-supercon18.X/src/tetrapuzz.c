@@ -3,6 +3,7 @@
 #include "box_game.h"
 #include <stdint.h>
 #include "wii_interface.h"
+#include "journal.h"
 
 //FIXME: these should probably not be globals
 uint32_t  wait_until;
@@ -46,7 +47,7 @@ void tetrapuzz_init(void)
 	start_after_wake = &BOX_pregame;	//Set function to run when waking from sleep]
 	
 	//Pull TMR1 value for a bit of not-really-but-kinda-random number
-	int16_t timer1val = *(char*)0xBF800610;
+	int16_t timer1val = jr_seed(TIMER1_LOW);
 	BOX_seed_random((unsigned char) timer1val&0xF);
 
 	BOX_clearscreen();
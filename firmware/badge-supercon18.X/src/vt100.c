@@ -5,6 +5,15 @@
 #include "badge.h"
 #include "hw.h"
 
+static void CURSOR_INVERT(void);
+static void _video_scrollup(void);
+static void _video_scrolldown(void);
+static void _video_lfwd(void);
+static void _video_cfwd(void);
+static void _video_lback(void);
+static void _video_scrollup_lin(uint8_t lin);
+static void _video_scrolldown_lin(uint8_t line);
+
 #define MAX_BUF 50
 
 uint8_t msg1[50];
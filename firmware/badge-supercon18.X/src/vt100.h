@@ -1,6 +1,8 @@
 #ifndef	__VT100_H
 #define	__VT100_H
 
+#include <stdint.h>
+
 #define MAX_ESC_LEN 48 
 #define  NOT_IN_ESC 	0
 #define    ESC_GOT_1B	1
@@ -129,14 +131,6 @@ void video_hide_cursor(void);
 uint8_t video_cursor_visible();
 /* Set inverse video for the character range specified. */
 void video_invert_range(int8_t x, int8_t y, uint8_t rangelen);  
-static void CURSOR_INVERT(void);
-static void _video_scrollup(void);
-static void _video_scrolldown(void);
-static void _video_lfwd(void);
-static void _video_cfwd(void);
-static void _video_lback(void);
-static void _video_scrollup_lin(uint8_t lin);
-static void _video_scrolldown_lin(uint8_t line);
 
 
 void term_init (void);
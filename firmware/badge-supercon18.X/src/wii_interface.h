@@ -12,6 +12,7 @@
 //	INCLUDES
 //--------------------------------------------------------------------------------------------------
 #include <stdio.h>
+#include <stdint.h>
 
 
 
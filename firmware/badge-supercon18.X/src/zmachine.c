@@ -0,0 +1,1129 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <plib.h>
+#include "hw.h"
+#include "Z80/hwz.h"
+#include "Z80/sim.h"
+#include "Z80/simglb.h"
+#include "Z80/cpmfs.h"
+#include "zmachine.h"
+#include "journal.h"
+
+//header fields
+#define		ZH_VERSION		0x00
+#define		ZH_FLAGS1		0x01
+#define		ZH_PC			0x06
+#define		ZH_DICT			0x08
+#define		ZH_OBJECTS		0x0A
+#define		ZH_GLOBALS		0x0C
+#define		ZH_STATIC		0x0E
+#define		ZH_FLAGS2		0x10
+#define		ZH_ABBR			0x18
+#define		ZH_LENGTH		0x1A
+#define		ZH_CHECKSUM		0x1C
+
+//running state
+#define		ZS_RUN			0
+#define		ZS_QUIT			1
+#define		ZS_ERROR		2
+
+#define		ZM_NO_PAGE		0xFFFF
+#define		ZM_NO_SLOT		0xFF
+
+uint32_t millis(void);
+void reload_cpm_warm (void);
+
+uint8_t (*zm_cancel)(void);
+const char * zm_script;
+
+struct cpmfs zm_fs;
+struct cpmfs_file zm_file;
+
+//story
+uint16_t zm_dyn, zm_objects, zm_globals, zm_abbr, zm_dict;
+uint32_t zm_len, zm_pc, zm_start_pc;
+uint8_t zm_state, zm_err;
+
+//page cache of static and high memory, story pages up to 128kB
+uint8_t * zm_cache;
+uint8_t zm_slots, zm_hand, zm_slot_of[256];
+uint16_t zm_page_of[128];
+
+//stack and call frames, frame holds return PC, store variable and old frame pointer
+uint8_t * zm_save_hdr;
+uint16_t * zm_stack;
+uint16_t zm_sp, zm_fp;
+
+//screen output, current word is kept until it's known whether it fits the line
+uint8_t zm_word[ZM_WIDTH], zm_wlen, zm_col, zm_lines, zm_screen;
+//output stream 3 to table in memory
+uint16_t zm_table, zm_table_len;
+uint8_t zm_table_on;
+//text captured instead of printed, for status line
+uint8_t * zm_cap;
+uint8_t zm_cap_len, zm_cap_max;
+
+//turn latency, from ENTER until game waits for next command
+uint32_t zm_turn_start, zm_turn_ticks, zm_turn_max, zm_turns;
+uint8_t zm_turn_on;
+
+static const char zm_a2[] = "0123456789.,!?_#'\"/\\-:()";
+
+//---------------------------------- memory ----------------------------------
+
+static uint8_t zm_load_page (uint16_t page)
+	{
+	uint8_t s,k;
+	uint8_t * p;
+	s = zm_hand;
+	if (++zm_hand>=zm_slots) zm_hand = 0;
+	if (zm_page_of[s]!=ZM_NO_PAGE) zm_slot_of[zm_page_of[s]] = ZM_NO_SLOT;
+	p = zm_cache + ((uint16_t)(s))*ZM_PAGE;
+	for (k=0;k<(ZM_PAGE/CPMFS_SECT_SIZE);k++)
+		{
+		//records are read at random, cpmfs keeps the extent it used last
+		zm_file.rec = ((uint32_t)(page))*(ZM_PAGE/CPMFS_SECT_SIZE) + k;
+		if (cpmfs_read(&zm_file,p+(k*CPMFS_SECT_SIZE))!=CPMFS_OK)
+			memset(p+(k*CPMFS_SECT_SIZE),0,CPMFS_SECT_SIZE);
+		}
+	zm_page_of[s] = page;
+	zm_slot_of[page] = s;
+	return s;
+	}
+
+static uint8_t zm_rb (uint32_t addr)
+	{
+	uint8_t s;
+	uint16_t page;
+	if (addr<zm_dyn) return ram[addr];
+	page = (addr>>9)&0xFF;
+	s = zm_slot_of[page];
+	if (s==ZM_NO_SLOT) s = zm_load_page(page);
+	return zm_cache[(((uint16_t)(s))*ZM_PAGE)+(addr&(ZM_PAGE-1))];
+	}
+
+static uint16_t zm_rw (uint32_t addr)
+	{
+	return (((uint16_t)(zm_rb(addr)))<<8) | zm_rb(addr+1);
+	}
+
+//static and high memory is read only, stores there are dropped
+static void zm_wb (uint16_t addr, uint8_t data)
+	{
+	if (addr<zm_dyn) ram[addr] = data;
+	}
+
+static void zm_ww (uint16_t addr, uint16_t data)
+	{
+	zm_wb(addr,data>>8);
+	zm_wb(addr+1,data);
+	}
+
+static uint8_t zm_fetch (void)
+	{
+	return zm_rb(zm_pc++);
+	}
+
+static uint16_t zm_fetch_w (void)
+	{
+	uint16_t w;
+	w = zm_rw(zm_pc);
+	zm_pc += 2;
+	return w;
+	}
+
+static void zm_fail (uint8_t err)
+	{
+	if (zm_state==ZS_RUN) zm_err = err;
+	zm_state = ZS_ERROR;
+	}
+
+//------------------------------- stack and variables -------------------------------
+
+static void zm_push (uint16_t val)
+	{
+	if (zm_sp>=ZM_STACK)
+		{
+		zm_fail(ZM_ERR_STACK);
+		return;
+		}
+	zm_stack[zm_sp++] = val;
+	}
+
+static uint16_t zm_pop (void)
+	{
+	if (zm_sp<=zm_fp)
+		{
+		zm_fail(ZM_ERR_STACK);
+		return 0;
+		}
+	return zm_stack[--zm_sp];
+	}
+
+static uint16_t zm_get_var (uint8_t var)
+	{
+	if (var==0) return zm_pop();
+	if (var<16) return zm_stack[zm_fp+var-1];
+	return zm_rw(zm_globals+2*(var-16));
+	}
+
+static void zm_set_var (uint8_t var, uint16_t val)
+	{
+	if (var==0) zm_push(val);
+	else if (var<16) zm_stack[zm_fp+var-1] = val;
+	else zm_ww(zm_globals+2*(var-16),val);
+	}
+
+//variable given by reference (inc, store, pull...), stack top is used in place
+static uint16_t zm_get_var_ref (uint8_t var)
+	{
+	if (var==0)
+		{
+		if (zm_sp<=zm_fp)
+			{
+			zm_fail(ZM_ERR_STACK);
+			return 0;
+			}
+		return zm_stack[zm_sp-1];
+		}
+	return zm_get_var(var);
+	}
+
+static void zm_set_var_ref (uint8_t var, uint16_t val)
+	{
+	if (var==0)
+		{
+		if (zm_sp<=zm_fp) zm_fail(ZM_ERR_STACK);
+		else zm_stack[zm_sp-1] = val;
+		}
+	else
+		zm_set_var(var,val);
+	}
+
+static void zm_store (uint16_t val)
+	{
+	zm_set_var(zm_fetch(),val);
+	}
+
+static void zm_return (uint16_t val)
+	{
+	uint8_t var;
+	zm_sp = zm_fp;
+	zm_fp = zm_stack[--zm_sp];
+	var = zm_stack[--zm_sp];
+	zm_pc = zm_stack[--zm_sp];
+	zm_pc |= ((uint32_t)(zm_stack[--zm_sp]))<<16;
+	zm_set_var(var,val);
+	}
+
+static void zm_branch (uint8_t cond)
+	{
+	uint8_t b;
+	int16_t offs;
+	b = zm_fetch();
+	if (b&0x40) offs = b&0x3F;
+	else
+		{
+		offs = (((uint16_t)(b&0x3F))<<8) | zm_fetch();
+		if (offs&0x2000) offs -= 0x4000;
+		}
+	if (((b&0x80)!=0)!=(cond!=0)) return;
+	if (offs==0) zm_return(0);
+	else if (offs==1) zm_return(1);
+	else zm_pc += offs - 2;
+	}
+
+static void zm_call (uint16_t * ops, uint8_t cnt)
+	{
+	uint32_t addr;
+	uint8_t n,i;
+	uint16_t val;
+	if (ops[0]==0)
+		{
+		zm_store(0);
+		return;
+		}
+	addr = ((uint32_t)(ops[0]))*2;
+	if ((zm_sp+4+15)>=ZM_STACK)
+		{
+		zm_fail(ZM_ERR_STACK);
+		return;
+		}
+	val = zm_fetch();
+	zm_stack[zm_sp++] = zm_pc>>16;
+	zm_stack[zm_sp++] = zm_pc;
+	zm_stack[zm_sp++] = val;
+	zm_stack[zm_sp++] = zm_fp;
+	zm_fp = zm_sp;
+	zm_pc = addr;
+	n = zm_fetch();
+	if (n>15) n = 15;
+	for (i=0;i<n;i++)
+		{
+		val = zm_fetch_w();
+		if ((i+1)<cnt) val = ops[i+1];
+		zm_stack[zm_sp++] = val;
+		}
+	}
+
+//---------------------------------- screen ----------------------------------
+
+static void zm_raw (const char * s)
+	{
+	while (*s) stdio_c(*s++);
+	}
+
+static int16_t zm_key (void)
+	{
+	int8_t c;
+	if (zm_script!=NULL)
+		{
+		if (*zm_script==0) return -1;
+		return *zm_script++;
+		}
+	while (stdio_get_state()==0)
+		if ((zm_cancel!=NULL)&&(zm_cancel())) return -1;
+	if (stdio_get(&c)==0) return -1;
+	return (uint8_t)(c);
+	}
+
+static void zm_newline (void)
+	{
+	int16_t k;
+	zm_raw("\r\n");
+	zm_col = 0;
+	//one row is status line, one is taken by [MORE] itself
+	if ((++zm_lines<(ZM_LINES-2))||(zm_script!=NULL)) return;
+	zm_raw("[MORE]");
+	k = zm_key();
+	zm_raw("\b \b\b \b\b \b\b \b\b \b\b \b");
+	zm_lines = 0;
+	if (k<0) zm_state = ZS_QUIT;
+	}
+
+//word is moved to next line when it doesn't fit, last column is left
+//empty, cursor in it would wrap the terminal by itself
+static void zm_flush_word (void)
+	{
+	uint8_t i;
+	if (zm_wlen==0) return;
+	if ((zm_col+zm_wlen)>(ZM_WIDTH-1)) zm_newline();
+	for (i=0;i<zm_wlen;i++) stdio_c(zm_word[i]);
+	zm_col += zm_wlen;
+	zm_wlen = 0;
+	}
+
+static void zm_putc (uint8_t c)
+	{
+	if (zm_cap!=NULL)
+		{
+		if (zm_cap_len<zm_cap_max) zm_cap[zm_cap_len++] = c;
+		return;
+		}
+	if (zm_table_on)
+		{
+		zm_wb(zm_table+2+zm_table_len++,(c=='\n') ? 13 : c);
+		return;
+		}
+	if (zm_screen==0) return;
+	if (c=='\n')
+		{
+		zm_flush_word();
+		zm_newline();
+		}
+	else if (c==' ')
+		{
+		zm_flush_word();
+		if (zm_col<(ZM_WIDTH-1))
+			{
+			stdio_c(' ');
+			zm_col++;
+			}
+		}
+	else
+		{
+		zm_word[zm_wlen++] = c;
+		if (zm_wlen>=(ZM_WIDTH-1)) zm_flush_word();
+		}
+	}
+
+static void zm_zscii (uint16_t c)
+	{
+	if (c==13) zm_putc('\n');
+	else if ((c>=32)&&(c<127)) zm_putc(c);
+	else if (c!=0) zm_putc('?');
+	}
+
+//print Z-string at addr, returns address after it
+static uint32_t zm_print_str (uint32_t addr, uint8_t abbr)
+	{
+	uint16_t w;
+	uint8_t z[3],i,shift = 0,esc = 0,hi = 0,ab = 0;
+	do
+		{
+		w = zm_rw(addr);
+		addr += 2;
+		z[0] = (w>>10)&0x1F;
+		z[1] = (w>>5)&0x1F;
+		z[2] = w&0x1F;
+		for (i=0;i<3;i++)
+			{
+			if (esc==2)
+				{
+				hi = z[i];
+				esc = 1;
+				}
+			else if (esc==1)
+				{
+				zm_zscii((((uint16_t)(hi))<<5)|z[i]);
+				esc = 0;
+				}
+			else if (ab!=0)
+				{
+				if (abbr==0)
+					zm_print_str(((uint32_t)(zm_rw(zm_abbr+2*(32*(ab-1)+z[i]))))*2,1);
+				ab = 0;
+				}
+			else if (z[i]==0)
+				zm_putc(' ');
+			else if (z[i]<4)
+				ab = z[i];
+			else if (z[i]<6)
+				{
+				shift = z[i] - 3;
+				continue;
+				}
+			else if (shift==0)
+				zm_putc('a'+z[i]-6);
+			else if (shift==1)
+				zm_putc('A'+z[i]-6);
+			else if (z[i]==6)
+				esc = 2;
+			else if (z[i]==7)
+				zm_putc('\n');
+			else
+				zm_putc(zm_a2[z[i]-8]);
+			shift = 0;
+			}
+		}
+	while ((w&0x8000)==0);
+	return addr;
+	}
+
+static void zm_print_num (int16_t n)
+	{
+	char s[8],*p;
+	sprintf(s,"%d",n);
+	for (p=s;*p;p++) zm_putc(*p);
+	}
+
+//---------------------------------- objects ----------------------------------
+
+static uint16_t zm_obj (uint16_t o)
+	{
+	return zm_objects + 62 + (o-1)*9;
+	}
+
+static uint8_t zm_parent (uint16_t o)
+	{
+	return (o==0) ? 0 : zm_rb(zm_obj(o)+4);
+	}
+
+static uint8_t zm_sibling (uint16_t o)
+	{
+	return (o==0) ? 0 : zm_rb(zm_obj(o)+5);
+	}
+
+static uint8_t zm_child (uint16_t o)
+	{
+	return (o==0) ? 0 : zm_rb(zm_obj(o)+6);
+	}
+
+static uint16_t zm_props (uint16_t o)
+	{
+	return zm_rw(zm_obj(o)+7);
+	}
+
+static uint8_t zm_attr_mask (uint16_t attr)
+	{
+	return 0x80>>(attr&7);
+	}
+
+static void zm_remove (uint16_t o)
+	{
+	uint16_t p,c;
+	p = zm_parent(o);
+	if (p==0) return;
+	c = zm_child(p);
+	if (c==o)
+		zm_wb(zm_obj(p)+6,zm_sibling(o));
+	else
+		{
+		while ((c!=0)&&(zm_sibling(c)!=o)) c = zm_sibling(c);
+		if (c!=0) zm_wb(zm_obj(c)+5,zm_sibling(o));
+		}
+	zm_wb(zm_obj(o)+4,0);
+	zm_wb(zm_obj(o)+5,0);
+	}
+
+static void zm_insert (uint16_t o, uint16_t d)
+	{
+	if ((o==0)||(d==0)) return;
+	zm_remove(o);
+	zm_wb(zm_obj(o)+4,d);
+	zm_wb(zm_obj(o)+5,zm_child(d));
+	zm_wb(zm_obj(d)+6,o);
+	}
+
+//first property of object, skipping its short name
+static uint16_t zm_first_prop (uint16_t o)
+	{
+	uint16_t p;
+	p = zm_props(o);
+	return p + 1 + 2*zm_rb(p);
+	}
+
+//address of size byte of property, 0 when object doesn't have it
+static uint16_t zm_find_prop (uint16_t o, uint8_t num)
+	{
+	uint16_t p;
+	uint8_t sb;
+	if (o==0) return 0;
+	p = zm_first_prop(o);
+	while ((sb=zm_rb(p))!=0)
+		{
+		if ((sb&0x1F)==num) return p;
+		if ((sb&0x1F)<num) return 0;
+		p += 2 + (sb>>5);
+		}
+	return 0;
+	}
+
+//------------------------------- input and parsing -------------------------------
+
+static void zm_status (void)
+	{
+	char line[ZM_WIDTH+1],right[28];
+	uint8_t i;
+	uint16_t o;
+	int16_t a,b;
+	zm_flush_word();
+	a = zm_rw(zm_globals+2);
+	b = zm_rw(zm_globals+4);
+	if (zm_rb(ZH_FLAGS1)&0x02)
+		snprintf(right,sizeof(right),"Time: %d:%02d ",a,b);
+	else
+		snprintf(right,sizeof(right),"Score:%d Moves:%d ",a,b);
+	memset(line,' ',ZM_WIDTH);
+	line[ZM_WIDTH] = 0;
+	//short name of location object, cut to what is left of the row
+	o = zm_rw(zm_globals);
+	if (o!=0)
+		{
+		zm_cap = (uint8_t *)(line+1);
+		zm_cap_len = 0;
+		zm_cap_max = ZM_WIDTH - 2 - strlen(right);
+		zm_print_str(zm_props(o)+1,0);
+		zm_cap = NULL;
+		}
+	memcpy(line+ZM_WIDTH-strlen(right),right,strlen(right));
+	zm_raw("\0337\033[1;1H\033[7m");
+	for (i=0;i<ZM_WIDTH;i++) stdio_c(line[i]);
+	zm_raw("\033[0m\0338");
+	}
+
+//six Z-characters of word, packed in two words like dictionary entries
+static void zm_encode (const uint8_t * s, uint8_t len, uint16_t * w)
+	{
+	uint8_t z[9],n = 0,i;
+	const char * p;
+	for (i=0;(i<len)&&(n<6);i++)
+		{
+		if ((s[i]>='a')&&(s[i]<='z'))
+			z[n++] = s[i] - 'a' + 6;
+		else if ((p=strchr(zm_a2,s[i]))!=NULL)
+			{
+			z[n++] = 5;
+			z[n++] = p - zm_a2 + 8;
+			}
+		else
+			{
+			z[n++] = 5;
+			z[n++] = 6;
+			z[n++] = s[i]>>5;
+			z[n++] = s[i]&0x1F;
+			}
+		}
+	while (n<6) z[n++] = 5;
+	w[0] = (((uint16_t)(z[0]))<<10) | (((uint16_t)(z[1]))<<5) | z[2];
+	w[1] = (((uint16_t)(z[3]))<<10) | (((uint16_t)(z[4]))<<5) | z[5] | 0x8000;
+	}
+
+//dictionary entries are sorted, binary search
+static uint16_t zm_lookup (const uint8_t * s, uint8_t len)
+	{
+	uint16_t w[2],e,ew;
+	uint8_t elen;
+	int16_t lo,hi,mid,cnt;
+	zm_encode(s,len,w);
+	e = zm_dict + 1 + zm_rb(zm_dict);
+	elen = zm_rb(e);
+	cnt = zm_rw(e+1);
+	e += 3;
+	lo = 0;
+	hi = cnt - 1;
+	while (lo<=hi)
+		{
+		mid = (lo+hi)/2;
+		ew = zm_rw(e+mid*elen);
+		if (ew==w[0]) ew = zm_rw(e+mid*elen+2);
+		else
+			{
+			if (ew<w[0]) lo = mid + 1;
+			else hi = mid - 1;
+			continue;
+			}
+		if (ew==w[1]) return e + mid*elen;
+		if (ew<w[1]) lo = mid + 1;
+		else hi = mid - 1;
+		}
+	return 0;
+	}
+
+static uint8_t zm_separator (uint8_t c)
+	{
+	uint8_t i,n;
+	n = zm_rb(zm_dict);
+	for (i=0;i<n;i++)
+		if (zm_rb(zm_dict+1+i)==c) return 1;
+	return 0;
+	}
+
+static void zm_tokenize (uint16_t text, uint16_t parse)
+	{
+	uint8_t buf[ZM_WIDTH*2],len,i,start,max,n = 0;
+	uint16_t e;
+	for (len=0;(len<sizeof(buf))&&((buf[len]=zm_rb(text+1+len))!=0);len++);
+	max = zm_rb(parse);
+	i = 0;
+	while ((i<len)&&(n<max))
+		{
+		if (buf[i]==' ')
+			{
+			i++;
+			continue;
+			}
+		start = i;
+		if (zm_separator(buf[i])) i++;
+		else
+			while ((i<len)&&(buf[i]!=' ')&&(zm_separator(buf[i])==0)) i++;
+		e = zm_lookup(buf+start,i-start);
+		zm_ww(parse+2+4*n,e);
+		zm_wb(parse+4+4*n,i-start);
+		zm_wb(parse+5+4*n,start+1);
+		n++;
+		}
+	zm_wb(parse+1,n);
+	}
+
+static void zm_read (uint16_t text, uint16_t parse)
+	{
+	uint8_t len = 0,max;
+	int16_t c;
+	zm_status();
+	zm_flush_word();
+	if (zm_turn_on)
+		{
+		zm_turn_start = _CP0_GET_COUNT() - zm_turn_start;
+		zm_turn_ticks += zm_turn_start;
+		if (zm_turn_start>zm_turn_max) zm_turn_max = zm_turn_start;
+		zm_turns++;
+		zm_turn_on = 0;
+		}
+	max = zm_rb(text) - 1;
+	if (max>(ZM_WIDTH*2-1)) max = ZM_WIDTH*2 - 1;
+	while (1)
+		{
+		c = zm_key();
+		if (c<0)
+			{
+			zm_state = ZS_QUIT;
+			return;
+			}
+		if ((c==NEWLINE)||(c=='\r')) break;
+		if (((c==BACKSPACE)||(c==0x7F))&&(len>0))
+			{
+			len--;
+			zm_raw("\b \b");
+			}
+		else if ((c>=' ')&&(c<0x7F)&&(len<max))
+			{
+			if ((c>='A')&&(c<='Z')) c += 'a' - 'A';
+			zm_wb(text+1+len++,c);
+			stdio_c(c);
+			}
+		}
+	zm_wb(text+1+len,0);
+	zm_raw("\r\n");
+	zm_col = 0;
+	zm_lines = 0;
+	zm_turn_start = _CP0_GET_COUNT();
+	zm_turn_on = 1;
+	zm_tokenize(text,parse);
+	}
+
+//------------------------------- save and restore -------------------------------
+
+static uint8_t zm_slot (const char * what)
+	{
+	int16_t c;
+	uint8_t slot;
+	zm_flush_word();
+	zm_raw(what);
+	zm_raw(" slot (0-7): ");
+	//digit is confirmed with enter, so the line doesn't end up as next command
+	slot = 0;
+	while (((c=zm_key())>=0)&&(c!='\r')&&(c!='\n'))
+		if ((c>='0')&&(c<('0'+ZM_SAVE_SLOTS)))
+			{
+			slot = c - '0';
+			stdio_c(c);
+			}
+	if (c<0) zm_state = ZS_QUIT;
+	zm_raw("\r\n");
+	zm_col = 0;
+	zm_lines = 0;
+	return slot;
+	}
+
+static void zm_make_hdr (uint8_t * h)
+	{
+	uint8_t i;
+	h[0] = (ZM_SAVE_MAGIC>>0)&0xFF;
+	h[1] = (ZM_SAVE_MAGIC>>8)&0xFF;
+	h[2] = (ZM_SAVE_MAGIC>>16)&0xFF;
+	h[3] = (ZM_SAVE_MAGIC>>24)&0xFF;
+	//release, serial number and checksum tell which story the save belongs to
+	h[4] = ram[2];
+	h[5] = ram[3];
+	for (i=0;i<6;i++) h[6+i] = ram[0x12+i];
+	h[12] = ram[ZH_CHECKSUM];
+	h[13] = ram[ZH_CHECKSUM+1];
+	h[14] = zm_dyn;
+	h[15] = zm_dyn>>8;
+	}
+
+static uint8_t zm_save (void)
+	{
+	uint32_t addr;
+	uint16_t i,n;
+	addr = ZM_SAVE_BASE + ((uint32_t)(zm_slot("Save")))*ZM_SAVE_SLOT;
+	if (zm_state!=ZS_RUN) return 0;
+	zm_make_hdr(zm_save_hdr);
+	zm_save_hdr[16] = zm_pc;
+	zm_save_hdr[17] = zm_pc>>8;
+	zm_save_hdr[18] = zm_pc>>16;
+	zm_save_hdr[20] = zm_sp;
+	zm_save_hdr[21] = zm_sp>>8;
+	zm_save_hdr[22] = zm_fp;
+	zm_save_hdr[23] = zm_fp>>8;
+	fl_update_4k(addr,zm_save_hdr,ZM_HDR_LEN+2*zm_sp);
+	for (i=0;i<zm_dyn;i+=4096)
+		{
+		n = zm_dyn - i;
+		if (n>4096) n = 4096;
+		fl_update_4k(addr+4096+i,ram+i,n);
+		}
+	fl_flush();
+	return 1;
+	}
+
+static uint8_t zm_restore (void)
+	{
+	uint32_t addr;
+	uint8_t h[ZM_HDR_LEN],ref[ZM_HDR_LEN];
+	uint16_t sp,fp,flags2;
+	addr = ZM_SAVE_BASE + ((uint32_t)(zm_slot("Restore")))*ZM_SAVE_SLOT;
+	if (zm_state!=ZS_RUN) return 0;
+	fl_read_nk(addr,h,ZM_HDR_LEN);
+	zm_make_hdr(ref);
+	sp = h[20] | (((uint16_t)(h[21]))<<8);
+	fp = h[22] | (((uint16_t)(h[23]))<<8);
+	if ((memcmp(h,ref,16)!=0)||(sp>ZM_STACK)||(fp>sp)) return 0;
+	memcpy(zm_save_hdr,h,ZM_HDR_LEN);
+	fl_read_nk(addr+ZM_HDR_LEN,(uint8_t *)zm_stack,2*sp);
+	//transcript and fixed font bits stay as they are now
+	flags2 = zm_rw(ZH_FLAGS2);
+	fl_read_nk(addr+4096,ram,zm_dyn);
+	zm_ww(ZH_FLAGS2,(zm_rw(ZH_FLAGS2)&~3)|(flags2&3));
+	zm_sp = sp;
+	zm_fp = fp;
+	zm_pc = h[16] | (((uint32_t)(h[17]))<<8) | (((uint32_t)(h[18]))<<16);
+	return 1;
+	}
+
+//------------------------------- execution -------------------------------
+
+static uint8_t zm_reset (void)
+	{
+	uint8_t rec[CPMFS_SECT_SIZE];
+	uint16_t i,n,flags2;
+	flags2 = (zm_dyn!=0) ? zm_rw(ZH_FLAGS2) : 0;
+	for (i=0;i<zm_dyn;i+=CPMFS_SECT_SIZE)
+		{
+		zm_file.rec = i/CPMFS_SECT_SIZE;
+		if (cpmfs_read(&zm_file,rec)!=CPMFS_OK) return ZM_ERR_FILE;
+		n = zm_dyn - i;
+		if (n>CPMFS_SECT_SIZE) n = CPMFS_SECT_SIZE;
+		memcpy(ram+i,rec,n);
+		}
+	//status line available, no split screen, fixed font
+	ram[ZH_FLAGS1] &= ~(0x10|0x20|0x40);
+	zm_ww(ZH_FLAGS2,(zm_rw(ZH_FLAGS2)&~3)|(flags2&3));
+	zm_sp = 0;
+	zm_fp = 0;
+	zm_pc = zm_start_pc;
+	return ZM_OK;
+	}
+
+static void zm_2op (uint8_t op, uint16_t * ops, uint8_t cnt)
+	{
+	int16_t a,b;
+	uint16_t p;
+	uint8_t i;
+	a = ops[0];
+	b = ops[1];
+	switch (op)
+		{
+		case 1:		//je
+			for (i=1;(i<cnt)&&(ops[i]!=ops[0]);i++);
+			zm_branch(i<cnt);
+			break;
+		case 2:		zm_branch(a<b);	break;		//jl
+		case 3:		zm_branch(a>b);	break;		//jg
+		case 4:		//dec_chk
+			a = zm_get_var_ref(ops[0]) - 1;
+			zm_set_var_ref(ops[0],a);
+			zm_branch(a<b);
+			break;
+		case 5:		//inc_chk
+			a = zm_get_var_ref(ops[0]) + 1;
+			zm_set_var_ref(ops[0],a);
+			zm_branch(a>b);
+			break;
+		case 6:		zm_branch(zm_parent(ops[0])==ops[1]);	break;		//jin
+		case 7:		zm_branch((ops[0]&ops[1])==ops[1]);	break;		//test
+		case 8:		zm_store(ops[0]|ops[1]);	break;		//or
+		case 9:		zm_store(ops[0]&ops[1]);	break;		//and
+		case 10:	//test_attr
+			zm_branch((ops[0]!=0)&&(zm_rb(zm_obj(ops[0])+(ops[1]>>3))&zm_attr_mask(ops[1])));
+			break;
+		case 11:	//set_attr
+			if (ops[0]==0) break;
+			p = zm_obj(ops[0]) + (ops[1]>>3);
+			zm_wb(p,zm_rb(p)|zm_attr_mask(ops[1]));
+			break;
+		case 12:	//clear_attr
+			if (ops[0]==0) break;
+			p = zm_obj(ops[0]) + (ops[1]>>3);
+			zm_wb(p,zm_rb(p)&~zm_attr_mask(ops[1]));
+			break;
+		case 13:	zm_set_var_ref(ops[0],ops[1]);	break;		//store
+		case 14:	zm_insert(ops[0],ops[1]);	break;		//insert_obj
+		case 15:	zm_store(zm_rw((uint16_t)(ops[0]+2*ops[1])));	break;		//loadw
+		case 16:	zm_store(zm_rb((uint16_t)(ops[0]+ops[1])));	break;		//loadb
+		case 17:	//get_prop
+			p = zm_find_prop(ops[0],ops[1]);
+			if (p==0) zm_store(zm_rw(zm_objects+2*(ops[1]-1)));
+			else if ((zm_rb(p)>>5)==0) zm_store(zm_rb(p+1));
+			else zm_store(zm_rw(p+1));
+			break;
+		case 18:	//get_prop_addr
+			p = zm_find_prop(ops[0],ops[1]);
+			zm_store((p==0) ? 0 : p+1);
+			break;
+		case 19:	//get_next_prop
+			if (ops[1]==0) p = zm_first_prop(ops[0]);
+			else
+				{
+				p = zm_find_prop(ops[0],ops[1]);
+				if (p!=0) p += 2 + (zm_rb(p)>>5);
+				}
+			zm_store((p==0) ? 0 : zm_rb(p)&0x1F);
+			break;
+		case 20:	zm_store(a+b);	break;		//add
+		case 21:	zm_store(a-b);	break;		//sub
+		case 22:	zm_store(a*b);	break;		//mul
+		case 23:	//div
+		case 24:	//mod
+			if (b==0)
+				{
+				zm_fail(ZM_ERR_DIV);
+				break;
+				}
+			zm_store((op==23) ? a/b : a%b);
+			break;
+		default:
+			zm_fail(ZM_ERR_OPCODE);
+		}
+	}
+
+static void zm_1op (uint8_t op, uint16_t a)
+	{
+	uint16_t v;
+	switch (op)
+		{
+		case 0:		zm_branch(a==0);	break;		//jz
+		case 1:		//get_sibling
+			v = zm_sibling(a);
+			zm_store(v);
+			zm_branch(v!=0);
+			break;
+		case 2:		//get_child
+			v = zm_child(a);
+			zm_store(v);
+			zm_branch(v!=0);
+			break;
+		case 3:		zm_store(zm_parent(a));	break;		//get_parent
+		case 4:		zm_store((a==0) ? 0 : (zm_rb(a-1)>>5)+1);	break;		//get_prop_len
+		case 5:		zm_set_var_ref(a,zm_get_var_ref(a)+1);	break;		//inc
+		case 6:		zm_set_var_ref(a,zm_get_var_ref(a)-1);	break;		//dec
+		case 7:		zm_print_str(a,0);	break;		//print_addr
+		case 9:		zm_remove(a);	break;		//remove_obj
+		case 10:	if (a!=0) zm_print_str(zm_props(a)+1,0);	break;		//print_obj
+		case 11:	zm_return(a);	break;		//ret
+		case 12:	zm_pc += (int16_t)(a) - 2;	break;		//jump
+		case 13:	zm_print_str(((uint32_t)(a))*2,0);	break;		//print_paddr
+		case 14:	zm_store(zm_get_var_ref(a));	break;		//load
+		case 15:	zm_store(~a);	break;		//not
+		default:
+			zm_fail(ZM_ERR_OPCODE);
+		}
+	}
+
+static void zm_0op (uint8_t op)
+	{
+	uint32_t a,sum;
+	switch (op)
+		{
+		case 0:		zm_return(1);	break;		//rtrue
+		case 1:		zm_return(0);	break;		//rfalse
+		case 2:		zm_pc = zm_print_str(zm_pc,0);	break;		//print
+		case 3:		//print_ret
+			zm_pc = zm_print_str(zm_pc,0);
+			zm_putc('\n');
+			zm_return(1);
+			break;
+		case 4:		break;		//nop
+		case 5:		zm_branch(zm_save());	break;		//save
+		case 6:		//restore
+			if (zm_restore()) zm_branch(1);
+			else zm_branch(0);
+			break;
+		case 7:		//restart
+			zm_flush_word();
+			if (zm_reset()!=ZM_OK) zm_fail(ZM_ERR_FILE);
+			break;
+		case 8:		zm_return(zm_pop());	break;		//ret_popped
+		case 9:		zm_pop();	break;		//pop
+		case 10:	zm_state = ZS_QUIT;	break;		//quit
+		case 11:	zm_putc('\n');	break;		//new_line
+		case 12:	zm_status();	break;		//show_status
+		case 13:	//verify
+			sum = 0;
+			for (a=0x40;a<zm_len;a++) sum += zm_rb(a);
+			zm_branch((sum&0xFFFF)==zm_rw(ZH_CHECKSUM));
+			break;
+		default:
+			zm_fail(ZM_ERR_OPCODE);
+		}
+	}
+
+static void zm_var (uint8_t op, uint16_t * ops, uint8_t cnt)
+	{
+	int16_t r;
+	uint16_t p;
+	switch (op)
+		{
+		case 0:		zm_call(ops,cnt);	break;		//call
+		case 1:		zm_ww(ops[0]+2*ops[1],ops[2]);	break;		//storew
+		case 2:		zm_wb(ops[0]+ops[1],ops[2]);	break;		//storeb
+		case 3:		//put_prop
+			p = zm_find_prop(ops[0],ops[1]);
+			if (p==0) zm_fail(ZM_ERR_OPCODE);
+			else if ((zm_rb(p)>>5)==0) zm_wb(p+1,ops[2]);
+			else zm_ww(p+1,ops[2]);
+			break;
+		case 4:		zm_read(ops[0],ops[1]);	break;		//sread
+		case 5:		zm_zscii(ops[0]);	break;		//print_char
+		case 6:		zm_print_num(ops[0]);	break;		//print_num
+		case 7:		//random
+			r = ops[0];
+			if (r<=0)
+				{
+				srand((r==0) ? jr_seed(millis()) : -r);
+				zm_store(0);
+				}
+			else
+				zm_store(1+(rand()%r));
+			break;
+		case 8:		zm_push(ops[0]);	break;		//push
+		case 9:		zm_set_var_ref(ops[0],zm_pop());	break;		//pull
+		case 10:	break;		//split_window
+		case 11:	break;		//set_window
+		case 19:	//output_stream
+			r = ops[0];
+			if (r==1) zm_screen = 1;
+			else if (r==-1) zm_screen = 0;
+			else if (r==3)
+				{
+				zm_flush_word();
+				zm_table = ops[1];
+				zm_table_len = 0;
+				zm_table_on = 1;
+				}
+			else if ((r==-3)&&(zm_table_on))
+				{
+				zm_ww(zm_table,zm_table_len);
+				zm_table_on = 0;
+				}
+			break;
+		case 20:	break;		//input_stream
+		case 21:	break;		//sound_effect
+		default:
+			zm_fail(ZM_ERR_OPCODE);
+		}
+	}
+
+static void zm_step (void)
+	{
+	uint8_t op,types,i,cnt,t;
+	uint16_t ops[4];
+	op = zm_fetch();
+	if (op<0x80)
+		{
+		//long form, 2OP with small constants or variables
+		ops[0] = zm_fetch();
+		if (op&0x40) ops[0] = zm_get_var(ops[0]);
+		ops[1] = zm_fetch();
+		if (op&0x20) ops[1] = zm_get_var(ops[1]);
+		zm_2op(op&0x1F,ops,2);
+		}
+	else if (op<0xC0)
+		{
+		//short form
+		t = (op>>4)&3;
+		if (t==3)
+			{
+			zm_0op(op&0x0F);
+			return;
+			}
+		if (t==0) ops[0] = zm_fetch_w();
+		else if (t==1) ops[0] = zm_fetch();
+		else ops[0] = zm_get_var(zm_fetch());
+		zm_1op(op&0x0F,ops[0]);
+		}
+	else
+		{
+		//variable form, 2OP or VAR
+		types = zm_fetch();
+		cnt = 0;
+		for (i=0;i<4;i++)
+			{
+			t = (types>>(6-2*i))&3;
+			if (t==3) break;
+			if (t==0) ops[cnt++] = zm_fetch_w();
+			else if (t==1) ops[cnt++] = zm_fetch();
+			else ops[cnt++] = zm_get_var(zm_fetch());
+			}
+		for (i=cnt;i<4;i++) ops[i] = 0;
+		if (op<0xE0) zm_2op(op&0x1F,ops,cnt);
+		else zm_var(op&0x1F,ops,cnt);
+		}
+	}
+
+//--------------------------------- interface ---------------------------------
+
+uint8_t zm_run (uint8_t drv, const char * name)
+	{
+	uint8_t cname[11],ret;
+	uint16_t i;
+	uint32_t n;
+	zm_dyn = 0;
+	zm_state = ZS_RUN;
+	zm_err = ZM_OK;
+	//DPBs of drives are taken from BIOS, ram[] belongs to the game after that
+	reload_cpm_warm();
+	if (cpmfs_name(name,cname)!=CPMFS_OK) return ZM_ERR_FILE;
+	if (cpm_drive_attach(&zm_fs,drv,0)!=CPMFS_OK) return ZM_ERR_FILE;
+	if (cpmfs_open(&zm_fs,&zm_file,0,cname)!=CPMFS_OK) return ZM_ERR_FILE;
+	zm_file.rec = 0;
+	if (cpmfs_read(&zm_file,ram)!=CPMFS_OK) return ZM_ERR_FILE;
+	if (ram[ZH_VERSION]!=3) return ZM_ERR_VERSION;
+	n = (((uint16_t)(ram[ZH_STATIC]))<<8) | ram[ZH_STATIC+1];
+	if ((n<0x40)||(n>ZM_DYN_MAX)) return ZM_ERR_MEMORY;
+	zm_len = ((((uint32_t)(ram[ZH_LENGTH]))<<8) | ram[ZH_LENGTH+1])*2;
+	if ((zm_len==0)||(zm_len>zm_file.size*CPMFS_SECT_SIZE)) zm_len = zm_file.size*CPMFS_SECT_SIZE;
+	//save header and stack follow dynamic memory, page cache takes the rest
+	zm_save_hdr = ram + ((n+3)&~3);
+	zm_stack = (uint16_t *)(zm_save_hdr+ZM_HDR_LEN);
+	zm_cache = ram + (((zm_save_hdr+ZM_HDR_LEN+2*ZM_STACK-ram)+ZM_PAGE-1)&~(ZM_PAGE-1));
+	n = (65536-(zm_cache-ram))/ZM_PAGE;
+	if (n>sizeof(zm_page_of)/sizeof(zm_page_of[0])) n = sizeof(zm_page_of)/sizeof(zm_page_of[0]);
+	if (n<4) return ZM_ERR_MEMORY;
+	zm_slots = n;
+	zm_hand = 0;
+	for (i=0;i<256;i++) zm_slot_of[i] = ZM_NO_SLOT;
+	for (i=0;i<zm_slots;i++) zm_page_of[i] = ZM_NO_PAGE;
+	zm_dyn = (((uint16_t)(ram[ZH_STATIC]))<<8) | ram[ZH_STATIC+1];
+	zm_start_pc = zm_rw(ZH_PC);
+	ret = zm_reset();
+	if (ret!=ZM_OK) return ret;
+	zm_objects = zm_rw(ZH_OBJECTS);
+	zm_globals = zm_rw(ZH_GLOBALS);
+	zm_abbr = zm_rw(ZH_ABBR);
+	zm_dict = zm_rw(ZH_DICT);
+	zm_wlen = 0;
+	zm_col = 0;
+	zm_lines = 0;
+	zm_screen = 1;
+	zm_table_on = 0;
+	zm_turn_on = 0;
+	srand(jr_seed(millis()));
+	//status line on top row, the rest scrolls under it
+	zm_raw("\033[2J\033[2;20r\033[20;1H");
+	while (zm_state==ZS_RUN) zm_step();
+	zm_flush_word();
+	zm_raw("\033[r\r\n");
+	if (zm_state==ZS_ERROR) return zm_err;
+	return ZM_OK;
+	}
+
+void zm_get_stats (uint32_t * turns, uint32_t * avg_us, uint32_t * max_us)
+	{
+	*turns = zm_turns;
+	*avg_us = 0;
+	if (zm_turns>0) *avg_us = (zm_turn_ticks/zm_turns)/CORE_TICKS_US;
+	*max_us = zm_turn_max/CORE_TICKS_US;
+	}
+
+void zm_clear_stats (void)
+	{
+	zm_turns = 0;
+	zm_turn_ticks = 0;
+	zm_turn_max = 0;
+	}
+
+const char * zm_err_str (uint8_t err)
+	{
+	if (err==ZM_OK) return "OK";
+	if (err==ZM_ERR_FILE) return "can't read story file";
+	if (err==ZM_ERR_VERSION) return "not a version 3 story";
+	if (err==ZM_ERR_MEMORY) return "story too big";
+	if (err==ZM_ERR_OPCODE) return "bad opcode";
+	if (err==ZM_ERR_STACK) return "stack error";
+	if (err==ZM_ERR_DIV) return "division by zero";
+	return "cancelled";
+	}
@@ -0,0 +1,53 @@
+#ifndef		__ZMACHINE_H
+#define		__ZMACHINE_H
+
+#include <stdint.h>
+
+/*
+ * Native Z-machine for version 3 story files, like ZORK1.DAT on ROM disk C.
+ * Story is read through cpmfs from CP/M drive, so it comes straight out of
+ * ROM disk image. Dynamic memory, stack and cache of the rest of story
+ * live in ram[] of Z80 machine, which is unused while the game runs.
+ *
+ * ram[] layout:
+ * 0						dynamic memory, copied from story
+ * dynamic memory end		save header and stack, saved together
+ * after stack				ZM_PAGE pages of static and high memory
+ */
+
+//games are saved to FLASH, see FLASH map in badge_settings.h
+#define		ZM_SAVE_BASE		0x310000
+#define		ZM_SAVE_SLOT		0x8000
+#define		ZM_SAVE_SLOTS		8
+#define		ZM_SAVE_MAGIC		0x33534D5A
+
+//largest dynamic memory, save slot holds it after 4k block of header and stack
+#define		ZM_DYN_MAX			(ZM_SAVE_SLOT-4096)
+#define		ZM_PAGE				512
+#define		ZM_STACK			1024
+#define		ZM_HDR_LEN			32
+
+//screen, status line takes the top row
+#define		ZM_WIDTH			40
+#define		ZM_LINES			20
+
+#define		ZM_OK				0
+#define		ZM_ERR_FILE			1
+#define		ZM_ERR_VERSION		2
+#define		ZM_ERR_MEMORY		3
+#define		ZM_ERR_OPCODE		4
+#define		ZM_ERR_STACK		5
+#define		ZM_ERR_DIV			6
+#define		ZM_CANCEL			7
+
+//optional hook, checked while waiting for a key, nonzero ends the game
+extern uint8_t (*zm_cancel)(void);
+//keys are taken from here when not NULL, game ends when script runs out
+extern const char * zm_script;
+
+uint8_t zm_run (uint8_t drv, const char * name);
+void zm_get_stats (uint32_t * turns, uint32_t * avg_us, uint32_t * max_us);
+void zm_clear_stats (void);
+const char * zm_err_str (uint8_t err);
+
+#endif
@@ -1,2 +1,3 @@
-re2c -i -o tokenizer_fast.c ubasic.re
-
+re2c -i -o tokenizer_fast.c ubasic.re || exit 1
+cp tokenizer_fast.c ../src/basic
+make -C ../host tktest && ../host/tktest